@@ -5,11 +5,19 @@
 #include "Rendering/D3DUtil.h"
 #include "Rendering/Vertex.h"
 #include "Rendering/DDSTextureLoader.h"
+#include "ThreadPool.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "ThumbnailRasterizer.h"
+#include "TextureDecoder.h"
+#include "ImageImporter.h"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <algorithm>
+
 using namespace DirectX;
 using namespace D3DUtil;
 
@@ -18,10 +26,20 @@ AssetManager::~AssetManager()
 
 }
 
-bool AssetManager::Init(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList)
+bool AssetManager::Init(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, UploadRing* uploadRing)
 {
 	_Device = device;
 	_CommandList = cmdList;
+	_UploadRing = uploadRing;
+	_VertexFormat = PACKED_VERTICES ? VertexFormat::Packed : VertexFormat::Full;
+
+	_GeometryPool = std::make_unique<GeometryPool>(
+		_Device,
+		VertexFormats::GetVertexStride(_VertexFormat),
+		GEOMETRY_POOL_VERTEX_CAPACITY,
+		GEOMETRY_POOL_INDEX_CAPACITY);
+
+	_ThumbnailAtlas = std::make_unique<ThumbnailAtlas>(_Device);
 
 	return true;
 }
@@ -32,127 +50,403 @@ void AssetManager::SetTextureDescriptors(CD3DX12_CPU_DESCRIPTOR_HANDLE srvCpu, C
 	_TexSrvGpuDescHandle = srvGpu;
 }
 
+void AssetManager::SetThumbnailDescriptors(CD3DX12_CPU_DESCRIPTOR_HANDLE srvCpu, CD3DX12_GPU_DESCRIPTOR_HANDLE srvGpu)
+{
+	_ThumbnailAtlas->CreateDescriptors(srvCpu, srvGpu);
+}
+
+// Interleaves the assimp streams into Vertex with 4 wide loads and stores instead of one float at a time.
+// A float3 loaded as 4 floats reads into the next element, so the last vertex of the mesh is done scalar.
+static void ConvertVertices(const aiMesh* mesh, uint32_t begin, uint32_t end, Vertex* vertices)
+{
+	static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "assimp has to be built with single precision");
+	static_assert(sizeof(Vertex) == 11 * sizeof(float), "Vertex layout has changed");
+
+	const aiVector3D* positions = mesh->mVertices;
+	const aiVector3D* normals = mesh->mNormals;
+	const aiVector3D* tangents = mesh->mTangents; // no tangents when the mesh has no UVs
+	const aiVector3D* uvs = mesh->mTextureCoords[0];
+
+	const XMVECTOR zero = XMVectorZero();
+	const uint32_t simdEnd = std::min(end, mesh->mNumVertices - 1);
+
+	uint32_t i = begin;
+	for (; i < simdEnd; ++i)
+	{
+		const XMVECTOR p = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&positions[i]));
+		const XMVECTOR n = normals ? XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&normals[i])) : zero;
+		const XMVECTOR t = tangents ? XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&tangents[i])) : zero;
+		const XMVECTOR uv = uvs ? XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&uvs[i])) : zero;
+
+		// [px py pz nx] [ny nz tx ty] [tz u v]
+		float* out = reinterpret_cast<float*>(&vertices[i]);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(out), XMVectorPermute<XM_PERMUTE_0X, XM_PERMUTE_0Y, XM_PERMUTE_0Z, XM_PERMUTE_1X>(p, n));
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(out + 4), XMVectorPermute<XM_PERMUTE_0Y, XM_PERMUTE_0Z, XM_PERMUTE_1X, XM_PERMUTE_1Y>(n, t));
+		XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(out + 8), XMVectorPermute<XM_PERMUTE_0Z, XM_PERMUTE_1X, XM_PERMUTE_1Y, XM_PERMUTE_1Z>(t, uv));
+	}
+
+	for (; i < end; ++i)
+	{
+		vertices[i] = Vertex(
+			positions[i].x, positions[i].y, positions[i].z,
+			normals ? normals[i].x : 0.f, normals ? normals[i].y : 0.f, normals ? normals[i].z : 0.f,
+			tangents ? tangents[i].x : 0.f, tangents ? tangents[i].y : 0.f, tangents ? tangents[i].z : 0.f,
+			uvs ? uvs[i].x : 0.f, uvs ? uvs[i].y : 0.f);
+	}
+}
+
+// aiProcess_Triangulate + aiProcess_SortByPType guarantee 3 indices per face
+static void FlattenIndices(const aiMesh* mesh, uint32_t begin, uint32_t end, uint32_t* indices)
+{
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		const aiFace& face = mesh->mFaces[i];
+		indices[i * 3 + 0] = face.mIndices[0];
+		indices[i * 3 + 1] = face.mIndices[1];
+		indices[i * 3 + 2] = face.mIndices[2];
+	}
+}
+
 int AssetManager::LoadModelFromFile(const std::string& path)
 {
+	std::vector<int> modelIndices = LoadModelsFromFile(path);
+	return modelIndices.empty() ? INVALID_INDEX : modelIndices[0];
+}
+
+std::vector<ImportedMesh> AssetManager::ReadMeshes(const std::string& path, ImportStats* stats)
+{
+	constexpr uint32_t IMPORT_CHUNK_SIZE = 16 * 1024;
+
+	const auto startTime = std::chrono::steady_clock::now();
 	std::string name = D3DUtil::ExtractFilename(path);
 
 	Assimp::Importer importer;
-	const aiScene* const scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenNormals | aiProcess_CalcTangentSpace | aiProcess_GenUVCoords);
-	aiMesh* const importedMesh = scene->mMeshes[0];
-
-	auto mesh = std::make_shared<Mesh>();
-	mesh->Name = name;
+	importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+	const aiScene* const scene = importer.ReadFile(
+		path, 
+		aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_GenNormals | aiProcess_CalcTangentSpace | aiProcess_GenUVCoords);
 
-	std::vector<Vertex> vertices;
-	vertices.reserve(importedMesh->mNumVertices);
+	if (!scene || !scene->HasMeshes())
+	{
+		LOG_ERROR("Failed to import [{0}]: {1}", path, importer.GetErrorString());
+		return {};
+	}
+	const auto readTime = std::chrono::steady_clock::now();
 
-	for (uint32_t i = 0; i < importedMesh->mNumVertices; ++i)
+	// work is split by mesh and by chunks of vertices/faces inside each mesh
+	struct ImportChunk
+	{
+		const aiMesh* Source;
+		ImportedMesh* Mesh;
+		uint32_t Begin;
+		uint32_t End;
+		bool Faces;
+	};
+
+	std::vector<ImportedMesh> meshes;
+	std::vector<const aiMesh*> sources;
+	meshes.reserve(scene->mNumMeshes);
+
+	for (unsigned int m = 0; m < scene->mNumMeshes; ++m)
 	{
-		const float px = importedMesh->mVertices[i].x;
-		const float py = importedMesh->mVertices[i].y;
-		const float pz = importedMesh->mVertices[i].z;
+		const aiMesh* source = scene->mMeshes[m];
+		if (source->mPrimitiveTypes != aiPrimitiveType_TRIANGLE || source->mNumVertices == 0)
+			continue;
+
+		ImportedMesh mesh;
+		if (scene->mNumMeshes == 1)
+			mesh.Name = name;
+		else if (source->mName.length > 0)
+			mesh.Name = name + ":" + source->mName.C_Str();
+		else
+			mesh.Name = name + ":" + std::to_string(m);
+		mesh.Vertices.resize(source->mNumVertices);
+		mesh.Indices.resize(source->mNumFaces * 3ull);
+		meshes.push_back(std::move(mesh));
+		sources.push_back(source);
+	}
 
-		const float nx = importedMesh->mNormals[i].x;
-		const float ny = importedMesh->mNormals[i].y;
-		const float nz = importedMesh->mNormals[i].z;
+	if (meshes.empty())
+		LOG_WARN("No triangle mesh in [{0}]", path);
 
-		const float tx = importedMesh->mTangents[i].x;
-		const float ty = importedMesh->mTangents[i].y;
-		const float tz = importedMesh->mTangents[i].z;
+	std::vector<ImportChunk> chunks;
+	for (size_t m = 0; m < meshes.size(); ++m)
+	{
+		for (uint32_t i = 0; i < sources[m]->mNumVertices; i += IMPORT_CHUNK_SIZE)
+			chunks.push_back({ sources[m], &meshes[m], i, std::min(i + IMPORT_CHUNK_SIZE, sources[m]->mNumVertices), false });
 
-		float u = 0.f;
-		float v = 0.f;
-		if (importedMesh->mTextureCoords[0])
+		for (uint32_t i = 0; i < sources[m]->mNumFaces; i += IMPORT_CHUNK_SIZE)
+			chunks.push_back({ sources[m], &meshes[m], i, std::min(i + IMPORT_CHUNK_SIZE, sources[m]->mNumFaces), true });
+	}
+
+	ThreadPool::Get().ParallelFor(chunks.size(), 1, [&chunks](size_t begin, size_t end)
+	{
+		for (size_t c = begin; c < end; ++c)
 		{
-			u = importedMesh->mTextureCoords[0][i].x;
-			v = importedMesh->mTextureCoords[0][i].y;
+			const ImportChunk& chunk = chunks[c];
+			if (chunk.Faces)
+				FlattenIndices(chunk.Source, chunk.Begin, chunk.End, chunk.Mesh->Indices.data());
+			else
+				ConvertVertices(chunk.Source, chunk.Begin, chunk.End, chunk.Mesh->Vertices.data());
 		}
-		
-		const Vertex vertex(
-			px, py, pz,
-			nx, ny, nz,
-			tx, ty, tz,
-			u, v
-		);
-
-		vertices.push_back(vertex);
+	});
+	const auto convertTime = std::chrono::steady_clock::now();
+
+	if (stats)
+	{
+		using Ms = std::chrono::duration<double, std::milli>;
+		stats->ReadMs = Ms(readTime - startTime).count();
+		stats->ConvertMs = Ms(convertTime - readTime).count();
 	}
 
-	std::vector<uint32_t> indices;
-	indices.reserve(importedMesh->mNumFaces * 3ull);
+	return meshes;
+}
+
+std::vector<int> AssetManager::LoadModelsFromFile(const std::string& path, ImportStats* stats)
+{
+	const auto startTime = std::chrono::steady_clock::now();
+
+	std::vector<ImportedMesh> meshes = ReadMeshes(path, stats);
+	if (meshes.empty())
+		return {};
+	const auto convertTime = std::chrono::steady_clock::now();
 
-	for (UINT i = 0; i < importedMesh->mNumFaces; ++i)
+	struct ProcessedMesh
+	{
+		MeshOptimizer::Report Optimization;
+		std::vector<Meshlet> Meshlets;
+		std::vector<MeshSimplifier::Lod> Lods;
+	};
+	std::vector<ProcessedMesh> processed(meshes.size());
+
+	// reorder for the post-transform cache, overdraw and vertex fetch then split in meshlets, one mesh per task.
+	// The meshlets move triangles around, the vertices are fetched again in the final order and the
+	// stats after the optimization are those of the index buffer uploaded.
+	ThreadPool::Get().ParallelFor(meshes.size(), 1, [&meshes, &processed](size_t begin, size_t end)
+	{
+		for (size_t m = begin; m < end; ++m)
+		{
+			processed[m].Optimization = MeshOptimizer::Optimize(meshes[m].Vertices, meshes[m].Indices);
+			processed[m].Meshlets = Meshlets::Build(meshes[m].Vertices, meshes[m].Indices);
+			MeshOptimizer::OptimizeVertexFetch(meshes[m].Vertices, meshes[m].Indices);
+			processed[m].Optimization.After = MeshOptimizer::AnalyzeVertexCache(meshes[m].Indices, meshes[m].Vertices.size());
+			processed[m].Lods = MeshSimplifier::BuildLodChain(meshes[m].Vertices, meshes[m].Indices, MAX_MODEL_LODS - 1);
+		}
+	});
+	const auto processTime = std::chrono::steady_clock::now();
+
+	// the uploads are recorded in the command list, that happens on this thread
+	std::vector<int> modelIndices;
+	size_t numVertices = 0;
+	size_t numTriangles = 0;
+	size_t transformedBefore = 0;
+	size_t transformedAfter = 0;
+	size_t numMeshlets = 0;
+
+	for (size_t m = 0; m < meshes.size(); ++m)
 	{
-		const aiFace face = importedMesh->mFaces[i];
-		for (UINT j = 0; j < face.mNumIndices; ++j)
+		const ImportedMesh& mesh = meshes[m];
+		ProcessedMesh& result = processed[m];
+		int modelIndex = CreateModel(mesh.Name, mesh.Vertices, mesh.Indices, result.Lods);
+		if (modelIndex == INVALID_INDEX)
 		{
-			indices.push_back(face.mIndices[j]);
+			LOG_ERROR("Failed to create model from mesh [{0}]", mesh.Name);
+			continue;
+		}
+		numMeshlets += result.Meshlets.size();
+		_Models[modelIndex].Meshlets = std::make_shared<const std::vector<Meshlet>>(std::move(result.Meshlets));
+
+		modelIndices.push_back(modelIndex);
+		numVertices += mesh.Vertices.size();
+		numTriangles += mesh.Indices.size() / 3;
+		transformedBefore += result.Optimization.Before.VerticesTransformed;
+		transformedAfter += result.Optimization.After.VerticesTransformed;
+
+		LOG_TRACE("Mesh [{0}] ACMR {1:.3f} -> {2:.3f}, ATVR {3:.3f} -> {4:.3f}", mesh.Name,
+			result.Optimization.Before.ACMR, result.Optimization.After.ACMR, result.Optimization.Before.ATVR, result.Optimization.After.ATVR);
+
+		for (size_t lod = 0; lod < result.Lods.size(); ++lod)
+		{
+			LOG_TRACE("Mesh [{0}] LOD {1}: {2} triangles, error {3:.5f}",
+				mesh.Name, lod + 1, result.Lods[lod].Indices.size() / 3, result.Lods[lod].Error);
 		}
 	}
 
-	const UINT vbByteSize = static_cast<UINT>(vertices.size()) * sizeof(Vertex);
-	const UINT ibByteSize = static_cast<UINT>(indices.size()) * sizeof(uint32_t);
+	const auto endTime = std::chrono::steady_clock::now();
+	const auto elapsed = std::chrono::duration<double, std::milli>(endTime - startTime);
+	LOG_INFO("Imported [{0}]: {1} meshes, {2} vertices, {3} triangles in {4:.2f} ms ({5} threads)",
+		path, modelIndices.size(), numVertices, numTriangles, elapsed.count(), ThreadPool::Get().GetNumThreads());
 
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &mesh->VertexBufferCPU));
-	CopyMemory(mesh->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
+	if (numTriangles > 0)
+	{
+		LOG_INFO("Imported [{0}]: ACMR {1:.3f} -> {2:.3f}, ATVR {3:.3f} -> {4:.3f}, {5} meshlets ({6:.1f} triangles avg)", path,
+			transformedBefore / double(numTriangles), transformedAfter / double(numTriangles),
+			transformedBefore / double(numVertices), transformedAfter / double(numVertices),
+			numMeshlets, numMeshlets ? numTriangles / double(numMeshlets) : 0.0);
+	}
 
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &mesh->IndexBufferCPU));
-	CopyMemory(mesh->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	if (stats)
+	{
+		using Ms = std::chrono::duration<double, std::milli>;
+		stats->ProcessMs = Ms(processTime - convertTime).count();
+		stats->UploadMs = Ms(endTime - processTime).count();
+		stats->TotalMs = elapsed.count();
+		stats->NumMeshes = modelIndices.size();
+		stats->NumVertices = numVertices;
+		stats->NumTriangles = numTriangles;
+	}
 
-	mesh->VertexBufferGPU = D3DUtil::CreateDefaultBuffer(
-		_Device,
-		_CommandList,
-		vertices.data(),
-		vbByteSize,
-		mesh->VertexBufferUploader);
+	return modelIndices;
+}
 
-	mesh->IndexBufferGPU = D3DUtil::CreateDefaultBuffer(
-		_Device,
-		_CommandList,
-		indices.data(),
-		ibByteSize,
-		mesh->IndexBufferUploader);
-
-	mesh->VertexByteStride = sizeof(Vertex);
-	mesh->VertexBufferByteSize = vbByteSize;
-	mesh->IndexFormat = DXGI_FORMAT_R32_UINT;
-	mesh->IndexBufferByteSize = ibByteSize;
-
-	int meshIndex = AssetManager::Get().AddMesh(mesh);
-	if (meshIndex == INVALID_INDEX)
+int AssetManager::CreateModel(
+	const std::string& name,
+	const std::vector<Vertex>& vertices,
+	const std::vector<uint32_t>& indices,
+	const std::vector<MeshSimplifier::Lod>& lods)
+{
+	if (vertices.empty() || indices.empty())
 	{
-		LOG_ERROR("Failed to load mesh from file [{0}]", path);
+		LOG_ERROR("Model [{0}] has no geometry!", name);
 		return INVALID_INDEX;
 	}
 
-	Model model;
-	model.VertexBufferView = mesh->VertexBufferView();
-	model.IndexBufferView = mesh->IndexBufferView();
-	model.Name = mesh->Name;
-	model.IndexCount = (UINT)indices.size();
-	model.StartIndexLocation = 0;
-	model.BaseVertexLocation = 0;
-	
-	int modelIndex = AssetManager::Get().AddModel(model);
-	if (modelIndex == INVALID_INDEX)
+	Model model{};
+	model.Name = name;
+
+	BoundingBox::CreateFromPoints(model.Bounds, vertices.size(), &vertices[0].Position, sizeof(Vertex));
+	BoundingSphere::CreateFromPoints(model.Sphere, vertices.size(), &vertices[0].Position, sizeof(Vertex));
+
+	// the LODs go after the full resolution indices, in the same range
+	std::vector<uint32_t> lodIndices;
+	const std::vector<uint32_t>* allIndices = &indices;
+
+	model.Lods[0].IndexCount = (UINT)indices.size();
+	model.NumLods = 1;
+	if (!lods.empty())
 	{
-		LOG_ERROR("Failed to create mode from mesh [{0}]", path);
-		return INVALID_INDEX;
+		lodIndices = indices;
+		for (size_t lod = 0; lod < lods.size() && model.NumLods < MAX_MODEL_LODS; ++lod)
+		{
+			ModelLod& modelLod = model.Lods[model.NumLods++];
+			modelLod.IndexOffset = (UINT)lodIndices.size();
+			modelLod.IndexCount = (UINT)lods[lod].Indices.size();
+			modelLod.Error = lods[lod].Error;
+			lodIndices.insert(lodIndices.end(), lods[lod].Indices.begin(), lods[lod].Indices.end());
+		}
+		allIndices = &lodIndices;
+	}
+
+	const UINT vertexCount = (UINT)vertices.size();
+	const UINT indexCount = (UINT)allIndices->size();
+
+	const void* vertexData = vertices.data();
+	std::vector<PackedVertex> packedVertices;
+	if (_VertexFormat == VertexFormat::Packed)
+	{
+		constexpr size_t ENCODE_CHUNK_SIZE = 16 * 1024;
+
+		model.Quantization = VertexFormats::ComputeQuantization(vertices.data(), vertices.size());
+		packedVertices.resize(vertices.size());
+
+		ThreadPool::Get().ParallelFor(vertices.size(), ENCODE_CHUNK_SIZE, [&](size_t begin, size_t end)
+		{
+			VertexFormats::EncodeVertices(&vertices[begin], end - begin, model.Quantization, &packedVertices[begin]);
+		});
+		vertexData = packedVertices.data();
+	}
+
+	int rangeId = _GeometryPool->Allocate(_CommandList, *_UploadRing, vertexData, vertexCount, allIndices->data(), indexCount);
+	if (rangeId == INVALID_INDEX)
+	{
+		// compact the free space first, then grow the pool if the model still doesn't fit
+		UINT vertexCapacity = _GeometryPool->GetVertexCapacity();
+		UINT indexCapacity = _GeometryPool->GetIndexCapacity();
+		const OffsetAllocator::StorageReport vertexReport = _GeometryPool->GetVertexAllocator().GetStorageReport();
+		const OffsetAllocator::StorageReport indexReport = _GeometryPool->GetIndexAllocator().GetStorageReport();
+
+		// the free space left must take the model once its sizes are rounded up to their bins
+		const UINT requiredVertices = OffsetAllocator::RoundUpToBinSize(vertexCount);
+		const UINT requiredIndices = OffsetAllocator::RoundUpToBinSize(indexCount);
+		while (vertexCapacity - _GeometryPool->GetVertexAllocator().GetUsedSize() < requiredVertices)
+			vertexCapacity *= 2;
+		while (indexCapacity - _GeometryPool->GetIndexAllocator().GetUsedSize() < requiredIndices)
+			indexCapacity *= 2;
+
+		LOG_TRACE("Geometry pool full for [{0}], largest free regions {1}/{2}, resizing to {3}/{4}",
+			name, vertexReport.LargestFreeRegion, indexReport.LargestFreeRegion, vertexCapacity, indexCapacity);
+
+		if (!_GeometryPool->Defragment(_CommandList, *_UploadRing, vertexCapacity, indexCapacity))
+		{
+			LOG_ERROR("Failed to allocate geometry for [{0}]", name);
+			return INVALID_INDEX;
+		}
+		for (auto& model : _Models)
+			UpdateModelGeometry(model);
+
+		rangeId = _GeometryPool->Allocate(_CommandList, *_UploadRing, vertexData, vertexCount, allIndices->data(), indexCount);
+		if (rangeId == INVALID_INDEX)
+		{
+			LOG_ERROR("Failed to allocate geometry for [{0}]", name);
+			return INVALID_INDEX;
+		}
 	}
 
+	model.GeometryRangeId = rangeId;
+	UpdateModelGeometry(model);
+	model.Preview = ThumbnailRasterizer::CreatePreviewMesh(vertices, indices, lods);
+
+	int modelIndex = AddModel(model);
+	if (modelIndex == INVALID_INDEX)
+		_GeometryPool->Free(rangeId);
+
 	return modelIndex;
 }
 
-int AssetManager::AddMesh(std::shared_ptr<Mesh>& mesh)
+void AssetManager::UpdateModelGeometry(Model& model)
+{
+	if (model.GeometryRangeId == INVALID_INDEX)
+		return;
+
+	const GeometryRange& range = _GeometryPool->GetRange(model.GeometryRangeId);
+	model.VertexBufferView = _GeometryPool->VertexBufferView();
+	model.IndexBufferView = _GeometryPool->IndexBufferView();
+	model.IndexCount = model.Lods[0].IndexCount;
+	model.StartIndexLocation = range.Indices.Offset;
+	model.BaseVertexLocation = range.Vertices.Offset;
+}
+
+void AssetManager::UnloadModel(int index)
 {
-	if (mesh->Name.size() == 0)
+	assert(index != INVALID_INDEX && index < _Models.size() && "Model index out of bounds");
+
+	Model& model = _Models[index];
+	if (model.Name.empty()) // already unloaded
+		return;
+
+	if (model.GeometryRangeId != INVALID_INDEX)
+		_GeometryPool->Free(model.GeometryRangeId);
+
+	auto slot = _ThumbnailSlots.find(index);
+	if (slot != _ThumbnailSlots.end())
 	{
-		LOG_ERROR("Mesh has no name!", mesh->Name);
-		return INVALID_INDEX;
+		_ThumbnailAtlas->FreeSlot(slot->second);
+		_ThumbnailSlots.erase(slot);
 	}
-	_Meshes.push_back(mesh);
+	_PendingThumbnails.erase(std::remove(_PendingThumbnails.begin(), _PendingThumbnails.end(), index), _PendingThumbnails.end());
+
+	// the slot is kept so the indices of the other models don't change, the next model added takes it
+	model = Model{};
+	_FreeModelSlots.push_back(index);
+}
+
+void AssetManager::DefragmentGeometry()
+{
+	if (!_GeometryPool->Defragment(_CommandList, *_UploadRing, _GeometryPool->GetVertexCapacity(), _GeometryPool->GetIndexCapacity()))
+		return;
 
-	return (int)_Meshes.size()-1;
+	for (auto& model : _Models)
+		UpdateModelGeometry(model);
 }
 
 int AssetManager::AddModel(Model& model)
@@ -162,6 +456,15 @@ int AssetManager::AddModel(Model& model)
 		LOG_ERROR("Model has no name!");
 		return INVALID_INDEX;
 	}
+
+	if (!_FreeModelSlots.empty())
+	{
+		const int index = _FreeModelSlots.back();
+		_FreeModelSlots.pop_back();
+		_Models[index] = model;
+		return index;
+	}
+
 	_Models.push_back(model);
 	return (int) _Models.size()-1;
 }
@@ -172,6 +475,120 @@ Model AssetManager::GetModel(int index)
 	return _Models[index];
 }
 
+ThumbnailView AssetManager::RequestThumbnail(int modelIndex)
+{
+	assert(modelIndex != INVALID_INDEX && modelIndex < _Models.size() && "Model index out of bounds");
+
+	auto slot = _ThumbnailSlots.find(modelIndex);
+	if (slot != _ThumbnailSlots.end())
+		return _ThumbnailAtlas->GetView(slot->second);
+
+	if (_Models[modelIndex].Preview && std::find(_PendingThumbnails.begin(), _PendingThumbnails.end(), modelIndex) == _PendingThumbnails.end())
+		_PendingThumbnails.push_back(modelIndex);
+
+	return ThumbnailView();
+}
+
+ThumbnailView AssetManager::RequestTextureThumbnail(size_t textureIndex)
+{
+	assert(textureIndex < _Textures.size() && "Texture index out of bounds");
+
+	auto slot = _TextureThumbnailSlots.find(textureIndex);
+	if (slot != _TextureThumbnailSlots.end())
+		return slot->second != INVALID_INDEX ? _ThumbnailAtlas->GetView(slot->second) : ThumbnailView();
+
+	if (std::find(_PendingTextureThumbnails.begin(), _PendingTextureThumbnails.end(), textureIndex) == _PendingTextureThumbnails.end())
+		_PendingTextureThumbnails.push_back(textureIndex);
+
+	return ThumbnailView();
+}
+
+// The finest mip that fits in a thumbnail, so only a fraction of the file is decoded
+static bool DecodeTextureThumbnail(const std::string& path, uint32_t* pixels)
+{
+	DDSFile file;
+	if (!TextureDecoder::ReadDDS(path, file))
+		return false;
+
+	DecodedImage image;
+	if (!TextureDecoder::DecodeMip(file, TextureDecoder::SelectMip(file, THUMBNAIL_SIZE), image))
+		return false;
+
+	TextureDecoder::Fit(image, THUMBNAIL_SIZE, pixels);
+	return true;
+}
+
+void AssetManager::UpdateThumbnails()
+{
+	struct Job
+	{
+		int ModelIndex;      // INVALID_INDEX for a texture
+		size_t TextureIndex;
+		int Slot;
+		std::vector<uint32_t> Pixels;
+		bool IsReady;
+	};
+
+	std::vector<Job> jobs;
+	size_t numModels = 0;
+	size_t numTextures = 0;
+	while (jobs.size() < MAX_THUMBNAILS_PER_FRAME &&
+		(numModels < _PendingThumbnails.size() || numTextures < _PendingTextureThumbnails.size()))
+	{
+		const int slot = _ThumbnailAtlas->AllocateSlot();
+		if (slot == INVALID_INDEX)
+		{
+			// stays pending until a model is unloaded
+			LOG_WARN("Thumbnail atlas full, {0} previews waiting",
+				_PendingThumbnails.size() - numModels + _PendingTextureThumbnails.size() - numTextures);
+			break;
+		}
+
+		if (numModels < _PendingThumbnails.size())
+			jobs.push_back({ _PendingThumbnails[numModels++], 0, slot, std::vector<uint32_t>(THUMBNAIL_SIZE * THUMBNAIL_SIZE), false });
+		else
+			jobs.push_back({ INVALID_INDEX, _PendingTextureThumbnails[numTextures++], slot, std::vector<uint32_t>(THUMBNAIL_SIZE * THUMBNAIL_SIZE), false });
+	}
+	_PendingThumbnails.erase(_PendingThumbnails.begin(), _PendingThumbnails.begin() + numModels);
+	_PendingTextureThumbnails.erase(_PendingTextureThumbnails.begin(), _PendingTextureThumbnails.begin() + numTextures);
+
+	if (jobs.empty())
+		return;
+
+	// one thumbnail per task, each one also splits its tiles (or rows of blocks) between the workers
+	ThreadPool::Get().ParallelFor(jobs.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			Job& job = jobs[i];
+			if (job.ModelIndex != INVALID_INDEX)
+			{
+				ThumbnailRasterizer::Render(*_Models[job.ModelIndex].Preview, XM_PIDIV4, THUMBNAIL_SIZE, job.Pixels.data());
+				job.IsReady = true;
+			}
+			else
+				job.IsReady = DecodeTextureThumbnail(_Textures[job.TextureIndex]->LoadedPath, job.Pixels.data());
+		}
+	});
+
+	for (const Job& job : jobs)
+	{
+		if (!job.IsReady)
+		{
+			// not requested again, the node shows the GPU texture instead
+			_ThumbnailAtlas->FreeSlot(job.Slot);
+			_TextureThumbnailSlots[job.TextureIndex] = INVALID_INDEX;
+			continue;
+		}
+
+		_ThumbnailAtlas->Upload(_CommandList, *_UploadRing, job.Slot, job.Pixels.data());
+		if (job.ModelIndex != INVALID_INDEX)
+			_ThumbnailSlots[job.ModelIndex] = job.Slot;
+		else
+			_TextureThumbnailSlots[job.TextureIndex] = job.Slot;
+	}
+}
+
 std::shared_ptr<Texture> AssetManager::CreateTextureFromFile(const std::string& path)
 {
 	auto tex = std::make_shared<Texture>();
@@ -180,7 +597,8 @@ std::shared_ptr<Texture> AssetManager::CreateTextureFromFile(const std::string&
 	tex->SrvCpuDescHandle = _TexSrvCpuDescHandle; // TODO: the descHandle has to be handled properly, now it's fixed
 	tex->SrvGpuDescHandle = _TexSrvGpuDescHandle; // TODO: the descHandle has to be handled properly, now it's fixed
 	
-	CreateTextureSRV(tex);
+	if (!CreateTextureSRV(tex))
+		return nullptr;
 
 	tex->Index = StoreTexture(tex);
 	return tex;
@@ -189,19 +607,27 @@ std::shared_ptr<Texture> AssetManager::CreateTextureFromFile(const std::string&
 std::shared_ptr<Texture> AssetManager::CreateTextureFromIndex(size_t index)
 {
 	auto tex = GetTexture(index);
-	CreateTextureSRV(tex);
+	if (!CreateTextureSRV(tex))
+		return nullptr;
 	return tex;
 }
 
-void AssetManager::CreateTextureSRV(std::shared_ptr<Texture> tex)
+bool AssetManager::CreateTextureSRV(std::shared_ptr<Texture> tex)
 {
+	tex->LoadedPath = ImageImporter::IsImportable(tex->Path) ? ImageImporter::Import(tex->Path) : ImageImporter::ImportDDS(tex->Path);
+	if (tex->LoadedPath.empty())
+	{
+		LOG_ERROR("Failed to import texture {0}", tex->Path);
+		return false;
+	}
+
 	ThrowIfFailed(
 		CreateDDSTextureFromFile12(
 			_Device,
 			_CommandList,
-			AnsiToWString(tex->Path).c_str(),
+			AnsiToWString(tex->LoadedPath).c_str(),
 			tex->Resource,
-			tex->UploadHeap));
+			*_UploadRing));
 
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
@@ -212,6 +638,7 @@ void AssetManager::CreateTextureSRV(std::shared_ptr<Texture> tex)
 	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
 
 	_Device->CreateShaderResourceView(tex->Resource.Get(), &srvDesc, tex->SrvCpuDescHandle);
+	return true;
 }
 
 size_t AssetManager::StoreTexture(std::shared_ptr<Texture> tex)
@@ -231,6 +658,15 @@ size_t AssetManager::StoreTexture(std::shared_ptr<Texture> tex)
 		index = it->second;
 		_Textures[index] = tex;
 		_TextureIndexPathMap[index] = tex->Path;
+
+		// decoded again from the new file when requested
+		auto slot = _TextureThumbnailSlots.find(index);
+		if (slot != _TextureThumbnailSlots.end())
+		{
+			if (slot->second != INVALID_INDEX)
+				_ThumbnailAtlas->FreeSlot(slot->second);
+			_TextureThumbnailSlots.erase(slot);
+		}
 		//LOG_TRACE("Updating texture {0} | {1} | {2}", index, name, path);
 	}
 	return index;
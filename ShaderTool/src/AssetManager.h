@@ -1,8 +1,34 @@
 #pragma once
 
-#include "Rendering/Mesh.h"
 #include "Rendering/Texture.h"
 #include "Rendering/Model.h"
+#include "Rendering/Vertex.h"
+#include "Rendering/VertexFormat.h"
+#include "Rendering/UploadRing.h"
+#include "Rendering/GeometryPool.h"
+#include "Rendering/ThumbnailAtlas.h"
+#include "MeshSimplifier.h"
+
+// Wall time of the stages of LoadModelsFromFile, for ShaderToolCli --bench-import
+struct ImportStats
+{
+	double ReadMs{ 0.0 };    // assimp, with its triangulation, normals and tangents (ReadMeshes)
+	double ConvertMs{ 0.0 }; // vertices and indices converted on the thread pool (ReadMeshes)
+	double ProcessMs{ 0.0 }; // optimization, meshlets and LODs of the meshes on the thread pool
+	double UploadMs{ 0.0 };  // models created, their geometry copied to the upload ring
+	double TotalMs{ 0.0 };
+	size_t NumMeshes{ 0 };
+	size_t NumVertices{ 0 };
+	size_t NumTriangles{ 0 };
+};
+
+// A triangle mesh of a model file as read, before the optimization
+struct ImportedMesh
+{
+	std::string Name;
+	std::vector<Vertex> Vertices;
+	std::vector<uint32_t> Indices;
+};
 
 class AssetManager
 {
@@ -17,17 +43,36 @@ public:
 		return instance;
 	}
 
-	bool Init(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList);
+	bool Init(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, UploadRing* uploadRing);
 	void SetTextureDescriptors(CD3DX12_CPU_DESCRIPTOR_HANDLE srvCpu, CD3DX12_GPU_DESCRIPTOR_HANDLE srvGpu);
+	void SetThumbnailDescriptors(CD3DX12_CPU_DESCRIPTOR_HANDLE srvCpu, CD3DX12_GPU_DESCRIPTOR_HANDLE srvGpu);
 
-	int AddMesh(std::shared_ptr<Mesh>& mesh);
+	// Reads the triangle meshes of a model file, it doesn't need Init. Empty if the file can't be read.
+	static std::vector<ImportedMesh> ReadMeshes(const std::string& path, ImportStats* stats = nullptr);
 	int LoadModelFromFile(const std::string& path);
+	std::vector<int> LoadModelsFromFile(const std::string& path, ImportStats* stats = nullptr);
+	int CreateModel(
+		const std::string& name,
+		const std::vector<Vertex>& vertices,
+		const std::vector<uint32_t>& indices,
+		const std::vector<MeshSimplifier::Lod>& lods = {});
 	int AddModel(Model& model);
+	void UnloadModel(int index);
 	Model GetModel(int index);
+	void DefragmentGeometry();
+	const GeometryPool* GetGeometryPool() const { return _GeometryPool.get(); }
+
+	// Preview of the model, rendered on the CPU by UpdateThumbnails the first time it's requested
+	ThumbnailView RequestThumbnail(int modelIndex);
+	// Renders the requested thumbnails (up to MAX_THUMBNAILS_PER_FRAME) and records their upload
+	void UpdateThumbnails();
+	// Preview of the texture, a mip decoded on the CPU by UpdateThumbnails the first time it's requested
+	ThumbnailView RequestTextureThumbnail(size_t textureIndex);
+	VertexFormat GetVertexFormat() const { return _VertexFormat; }
 	
 	std::shared_ptr<Texture> CreateTextureFromFile(const std::string& path);
 	std::shared_ptr<Texture> CreateTextureFromIndex(size_t index);
-	void CreateTextureSRV(std::shared_ptr<Texture> texture);
+	bool CreateTextureSRV(std::shared_ptr<Texture> texture);
 	size_t StoreTexture(std::shared_ptr<Texture> texture);
 	std::shared_ptr<Texture> GetTexture(size_t index);
 	const std::string GetTexturePath(size_t index);
@@ -37,18 +82,27 @@ public:
 	std::istream& Deserialize(std::istream& in);
 
 private:
-	AssetManager() : _Device(nullptr), _CommandList(nullptr){}
+	AssetManager() : _Device(nullptr), _CommandList(nullptr), _UploadRing(nullptr){}
+
+	void UpdateModelGeometry(Model& model);
 
 private:
 	ID3D12Device* _Device;
 	ID3D12GraphicsCommandList* _CommandList;
+	UploadRing* _UploadRing;
+	VertexFormat _VertexFormat{ VertexFormat::Full };
 	CD3DX12_CPU_DESCRIPTOR_HANDLE _TexSrvCpuDescHandle;
 	CD3DX12_GPU_DESCRIPTOR_HANDLE _TexSrvGpuDescHandle;
 
+	std::unique_ptr<GeometryPool> _GeometryPool;
+	std::unique_ptr<ThumbnailAtlas> _ThumbnailAtlas;
+	std::unordered_map<int, int> _ThumbnailSlots; // model index -> atlas slot
+	std::vector<int> _PendingThumbnails;          // model indices, in request order
+	std::unordered_map<size_t, int> _TextureThumbnailSlots; // texture index -> atlas slot, INVALID_INDEX when it can't be decoded
+	std::vector<size_t> _PendingTextureThumbnails;          // texture indices, in request order
 	std::vector<Model> _Models;
-	std::vector<std::shared_ptr<Mesh>> _Meshes;
+	std::vector<int> _FreeModelSlots; // unloaded models, reused by AddModel
 	std::vector<std::shared_ptr<Texture>> _Textures;
-	std::unordered_map<std::string, size_t> _MeshNameIndexMap;
 	std::unordered_map<std::string, size_t> _ModelNameIndexMap;
 	std::unordered_map<std::string, size_t> _TextureNameIndexMap;
 	std::unordered_map<size_t, std::string> _TextureIndexPathMap;
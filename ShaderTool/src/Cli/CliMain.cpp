@@ -0,0 +1,113 @@
+#include "pch.h"
+#include "ShaderToolApp.h"
+#include "SelfTest.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// ShaderToolCli [--frames N] [--dt seconds] [--realtime] [--csv file] [--trace file] [--node-costs file] [--replay file]
+//               [--bench-instances N] [--bench-primitives] [--bench-subdivide]
+//               [--bench-import file] [--bench-simplify file] [project]
+// Evaluates a project saved by the editor, or replays a journal recorded by it, and prints the frame timings,
+// see ShaderToolApp::RunHeadless.
+// ShaderToolCli --selftest [filter]
+// Runs the checks of the modules that don't need a device instead, see SelfTest.h.
+
+void PrintUsage()
+{
+	std::printf(
+		"usage: ShaderToolCli [options] [project]\n"
+		"  project            file saved by the editor, %s by default\n"
+		"  --frames N         number of frames to evaluate (default 1000)\n"
+		"  --dt seconds       fixed time step, 0 runs as fast as possible (default 0)\n"
+		"  --realtime         the nodes read the wall clock, by default the time advances\n"
+		"                     by the time step (1/60s when 0) each frame\n"
+		"  --csv file         writes the timings of each frame\n"
+		"  --trace file       writes the profiler zones of the last frames (Chrome trace format)\n"
+		"  --node-costs file  writes the average cost of each node (CSV)\n"
+		"  --replay file      replays the graph edits of a journal recorded by the editor (F6),\n"
+		"                     with their frame times, instead of the project\n"
+		"  --bench-instances N  times the generation and the upload of N instances (100000 for\n"
+		"                     the reference numbers) for --frames frames, instead of the project\n"
+		"  --bench-primitives  times the generation of each primitive shape and the primitive\n"
+		"                     cache, hit and missed, instead of the project\n"
+		"  --bench-subdivide  times the box and the geosphere at each level of subdivision, with\n"
+		"                     their vertices, triangles and memory, instead of the project\n"
+		"  --bench-import file  times the stages of the import of a model file (OBJ, FBX, ...),\n"
+		"                     imported 5 times, instead of the project\n"
+		"  --bench-simplify file  times the simplification of the meshes of a model file to\n"
+		"                     50, 25, 12.5 and 6.25%% of their triangles, with the error of each\n"
+		"                     level, instead of the project\n"
+		"  --selftest [filter]  runs the checks of the CPU side modules (allocators, mesh and\n"
+		"                     texture processing) whose name contains filter, and nothing else\n",
+		PROJECT_FILE);
+}
+
+int main(int argc, char* argv[])
+{
+#if defined(_DEBUG)
+	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF); // Enable run-time memory check for debug builds.
+#endif
+
+	if (argc > 1 && std::string(argv[1]) == "--selftest")
+	{
+		Log::Init();
+		const int numFailed = SelfTest::Run(argc > 2 ? argv[2] : "");
+		Log::Shutdown();
+		return numFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	HeadlessOptions options;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (arg == "--frames" && hasValue)
+			options.NumFrames = std::atoi(argv[++i]);
+		else if (arg == "--dt" && hasValue)
+			options.FixedTimeStep = std::atof(argv[++i]);
+		else if (arg == "--realtime")
+			options.RealTime = true;
+		else if (arg == "--csv" && hasValue)
+			options.CsvPath = argv[++i];
+		else if (arg == "--trace" && hasValue)
+			options.TracePath = argv[++i];
+		else if (arg == "--node-costs" && hasValue)
+			options.NodeCostsPath = argv[++i];
+		else if (arg == "--replay" && hasValue)
+			options.JournalPath = argv[++i];
+		else if (arg == "--bench-instances" && hasValue)
+			options.BenchmarkInstances = (uint32_t)std::atoi(argv[++i]);
+		else if (arg == "--bench-primitives")
+			options.BenchmarkPrimitives = true;
+		else if (arg == "--bench-subdivide")
+			options.BenchmarkSubdivide = true;
+		else if (arg == "--bench-import" && hasValue)
+			options.BenchmarkImportPath = argv[++i];
+		else if (arg == "--bench-simplify" && hasValue)
+			options.BenchmarkSimplifyPath = argv[++i];
+		else if (arg == "--help" || arg == "-h")
+		{
+			PrintUsage();
+			return EXIT_SUCCESS;
+		}
+		else if (arg[0] == '-')
+		{
+			std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+		else
+			options.ProjectPath = arg;
+	}
+
+	int result;
+	{
+		ShaderToolApp app(GetModuleHandle(nullptr));
+		result = app.RunHeadless(options);
+	}
+	Log::Shutdown();
+	return result;
+}
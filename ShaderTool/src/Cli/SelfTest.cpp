@@ -0,0 +1,73 @@
+#include "pch.h"
+#include "SelfTest.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+	struct TestCase
+	{
+		const char* Name;
+		void (*Function)();
+	};
+
+	const TestCase TESTS[] =
+	{
+		{ "UploadRingAllocator", SelfTest::TestUploadRingAllocator },
+		{ "OffsetAllocator", SelfTest::TestOffsetAllocator },
+		{ "MeshOptimizer", SelfTest::TestMeshOptimizer },
+		{ "GeometryGenerator", SelfTest::TestGeometryGenerator },
+		{ "Meshlets", SelfTest::TestMeshlets },
+		{ "VertexFormat", SelfTest::TestVertexFormat },
+		{ "TransformBatch", SelfTest::TestTransformBatch },
+		{ "GraphOptimizer", SelfTest::TestGraphOptimizer },
+		{ "HlslGenerator", SelfTest::TestHlslGenerator },
+		{ "NodeCostTracker", SelfTest::TestNodeCostTracker },
+		{ "Log", SelfTest::TestLog },
+		{ "FrameClock", SelfTest::TestFrameClock },
+		{ "Journal", SelfTest::TestJournal },
+		{ "RootSignaturePlanner", SelfTest::TestRootSignaturePlanner },
+		{ "ThumbnailRasterizer", SelfTest::TestThumbnailRasterizer },
+		{ "TextureCodec", SelfTest::TestTextureCodec },
+		{ "MipGenerator", SelfTest::TestMipGenerator },
+	};
+
+	int NumChecks = 0;
+	int NumFailed = 0;
+}
+
+bool SelfTest::Check(bool condition, const char* expression, const char* file, int line)
+{
+	++NumChecks;
+	if (!condition)
+	{
+		++NumFailed;
+		std::printf("  failed: %s (%s:%d)\n", expression, file, line);
+	}
+	return condition;
+}
+
+int SelfTest::Run(const char* filter)
+{
+	NumChecks = 0;
+	NumFailed = 0;
+
+	int numTests = 0;
+	for (const TestCase& test : TESTS)
+	{
+		if (filter && *filter && !std::strstr(test.Name, filter))
+			continue;
+
+		const int failedBefore = NumFailed;
+		const auto start = std::chrono::steady_clock::now();
+		test.Function();
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::printf("%-24s %s %8.1f ms\n", test.Name, NumFailed == failedBefore ? "ok    " : "FAILED", ms);
+		++numTests;
+	}
+
+	std::printf("%d tests, %d checks, %d failed\n", numTests, NumChecks, NumFailed);
+	return NumFailed;
+}
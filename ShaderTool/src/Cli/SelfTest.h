@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdio>
+
+// Checks of the modules that run on the CPU (allocators, mesh and texture processing, ...), run by
+// ShaderToolCli --selftest without a device. Each test is a function of one of the SelfTest_*.cpp
+// files listed in SelfTest.cpp, it reports the checks that fail and keeps going.
+namespace SelfTest
+{
+	// Runs the tests whose name contains filter (all of them when empty), returns the number of failed checks
+	int Run(const char* filter);
+
+	bool Check(bool condition, const char* expression, const char* file, int line);
+
+	// UploadRingAllocator and OffsetAllocator
+	void TestUploadRingAllocator();
+	void TestOffsetAllocator();
+
+	// MeshOptimizer ACMR/ATVR on a shuffled grid
+	void TestMeshOptimizer();
+
+	// GeometryGenerator subdivision with shared midpoints against the unshared one
+	void TestGeometryGenerator();
+
+	// Meshlets limits, bounds and cones, Cull throughput
+	void TestMeshlets();
+
+	// VertexFormat packing within the precision of each attribute
+	void TestVertexFormat();
+
+	// TransformBatch against TransformNode::OnEval, bit for bit but the sign of the zeros
+	void TestTransformBatch();
+
+	// GraphOptimizer folded, dead and merged nodes of a small graph
+	void TestGraphOptimizer();
+	// HlslGenerator functions, literals, cbGenerated and its register for a small graph
+	void TestHlslGenerator();
+
+	// NodeCostTracker scopes recorded only while enabled, folded into the averages each frame
+	void TestNodeCostTracker();
+
+	// Log rate limit and repeated messages of a call site, at given times
+	void TestLog();
+
+	// FrameClock Deterministic, FixedStep and RealTime frames at given times
+	void TestFrameClock();
+
+	// Journal written and read back, cut short at each byte, bad headers and older versions
+	void TestJournal();
+
+	// RootSignaturePlanner placement of the cbuffers within the root signature budget
+	void TestRootSignaturePlanner();
+
+	// ThumbnailRasterizer image of a sphere and a quad, LOD picked for the preview
+	void TestThumbnailRasterizer();
+
+	// TextureEncoder and TextureDecoder, PSNR of each block format
+	void TestTextureCodec();
+
+	// MipGenerator filters, chains and formats
+	void TestMipGenerator();
+}
+
+// returns the condition so a test can stop when the next checks make no sense
+#define SELFTEST_CHECK(condition) SelfTest::Check((condition), #condition, __FILE__, __LINE__)
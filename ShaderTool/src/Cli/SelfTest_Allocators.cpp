@@ -0,0 +1,186 @@
+#include "pch.h"
+#include "SelfTest.h"
+#include "Rendering/UploadRingAllocator.h"
+#include "Rendering/OffsetAllocator.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+void SelfTest::TestUploadRingAllocator()
+{
+	// alignment, a frame that doesn't fit and the wrap around
+	{
+		UploadRingAllocator ring(1024);
+		SELFTEST_CHECK(ring.Allocate(100) == 0);
+		SELFTEST_CHECK(ring.Allocate(10, 256) == 256);
+		SELFTEST_CHECK(ring.GetUsedSize() == 266);
+		ring.FinishFrame(1);
+
+		SELFTEST_CHECK(ring.Allocate(800) == UploadRingAllocator::INVALID_OFFSET);
+		SELFTEST_CHECK(ring.Allocate(700) == 266);
+		ring.FinishFrame(2);
+
+		ring.Retire(1);
+		SELFTEST_CHECK(ring.GetUsedSize() == 700);
+
+		// 58 bytes left at the end, they are wasted until the frame retires
+		SELFTEST_CHECK(ring.Allocate(100) == 0);
+		SELFTEST_CHECK(ring.GetUsedSize() == 858);
+		ring.FinishFrame(3);
+
+		ring.Retire(3);
+		SELFTEST_CHECK(ring.GetUsedSize() == 0);
+		SELFTEST_CHECK(ring.GetNumFramesInFlight() == 0);
+	}
+
+	// Frames of random allocations, 3 in flight: the allocations of the frames not retired never overlap.
+	// The ring is large enough for 3 frames of 12 x (4KB + alignment), so nothing should fail either.
+	struct Live
+	{
+		uint64_t Offset;
+		uint64_t Size;
+		uint64_t Frame;
+	};
+
+	constexpr uint64_t CAPACITY = 256 * 1024;
+	constexpr uint64_t FRAMES_IN_FLIGHT = 3;
+
+	UploadRingAllocator ring(CAPACITY);
+	std::mt19937 random(26);
+	std::vector<Live> live;
+	size_t numFailed = 0;
+	for (uint64_t frame = 1; frame <= 2000; ++frame)
+	{
+		const int numAllocations = std::uniform_int_distribution<int>(0, 12)(random);
+		for (int i = 0; i < numAllocations; ++i)
+		{
+			const uint64_t size = std::uniform_int_distribution<uint64_t>(1, 4096)(random);
+			const uint64_t alignment = 1ull << std::uniform_int_distribution<int>(0, 8)(random);
+			const uint64_t offset = ring.Allocate(size, alignment);
+			if (offset == UploadRingAllocator::INVALID_OFFSET)
+			{
+				++numFailed;
+				continue;
+			}
+
+			SELFTEST_CHECK(offset % alignment == 0);
+			SELFTEST_CHECK(offset + size <= CAPACITY);
+			for (const Live& other : live)
+			{
+				if (!SELFTEST_CHECK(offset + size <= other.Offset || other.Offset + other.Size <= offset))
+					return;
+			}
+			live.push_back({ offset, size, frame });
+		}
+
+		ring.FinishFrame(frame);
+		if (frame > FRAMES_IN_FLIGHT)
+		{
+			ring.Retire(frame - FRAMES_IN_FLIGHT);
+			live.erase(std::remove_if(live.begin(), live.end(), [&](const Live& l) { return l.Frame <= frame - FRAMES_IN_FLIGHT; }), live.end());
+		}
+	}
+
+	SELFTEST_CHECK(numFailed == 0);
+
+	ring.Retire(UINT64_MAX);
+	SELFTEST_CHECK(ring.GetUsedSize() == 0);
+}
+
+void SelfTest::TestOffsetAllocator()
+{
+	// the bins round the sizes the right way
+	for (uint32_t size = 1; size < (1u << 24); size += 1 + size / 64)
+	{
+		SELFTEST_CHECK(OffsetAllocator::BinToSize(OffsetAllocator::SizeToBinRoundUp(size)) >= size);
+		SELFTEST_CHECK(OffsetAllocator::BinToSize(OffsetAllocator::SizeToBinRoundDown(size)) <= size);
+	}
+
+	// A free region of exactly the size asked may not take it, one of the size rounded up to its bin always does
+	{
+		SELFTEST_CHECK(!OffsetAllocator(1000).Allocate(1000).IsValid());
+		SELFTEST_CHECK(OffsetAllocator::RoundUpToBinSize(1000) == 1024);
+		SELFTEST_CHECK(OffsetAllocator(1024).Allocate(1000).IsValid());
+	}
+
+	// Ranges placed one after the other from the start, as GeometryPool::Defragment repacks them: the
+	// capacity must leave the rounded up size of each range when it's placed
+	{
+		std::mt19937 random(270);
+		for (int pack = 0; pack < 200; ++pack)
+		{
+			std::vector<uint32_t> sizes(std::uniform_int_distribution<int>(1, 50)(random));
+			uint32_t capacity = 0;
+			uint32_t offset = 0;
+			for (uint32_t& size : sizes)
+			{
+				size = std::uniform_int_distribution<uint32_t>(1, 100000)(random);
+				capacity = std::max(capacity, offset + OffsetAllocator::RoundUpToBinSize(size));
+				offset += size;
+			}
+
+			OffsetAllocator packed(capacity);
+			offset = 0;
+			for (uint32_t size : sizes)
+			{
+				const OffsetAllocator::Allocation allocation = packed.Allocate(size);
+				if (!SELFTEST_CHECK(allocation.IsValid() && allocation.Offset == offset))
+					return;
+				offset += size;
+			}
+		}
+	}
+
+	// Random allocations and frees, the live ranges never overlap and the used size adds up
+	constexpr uint32_t SIZE = 1 << 20;
+	OffsetAllocator allocator(SIZE);
+	std::mt19937 random(27);
+	std::map<uint32_t, OffsetAllocator::Allocation> live; // by offset
+	std::map<uint32_t, uint32_t> sizes;
+	uint32_t usedSize = 0;
+	for (int i = 0; i < 20000; ++i)
+	{
+		if (live.empty() || std::uniform_int_distribution<int>(0, 9)(random) < 6)
+		{
+			const uint32_t size = std::uniform_int_distribution<uint32_t>(1, 4096)(random);
+			const OffsetAllocator::Allocation allocation = allocator.Allocate(size);
+			if (!allocation.IsValid())
+				continue;
+
+			SELFTEST_CHECK(allocator.GetAllocationSize(allocation) == size);
+			SELFTEST_CHECK(allocation.Offset + size <= SIZE);
+
+			auto next = sizes.lower_bound(allocation.Offset);
+			if (next != sizes.end() && !SELFTEST_CHECK(allocation.Offset + size <= next->first))
+				return;
+			if (next != sizes.begin() && !SELFTEST_CHECK(std::prev(next)->first + std::prev(next)->second <= allocation.Offset))
+				return;
+
+			live[allocation.Offset] = allocation;
+			sizes[allocation.Offset] = size;
+			usedSize += size;
+		}
+		else
+		{
+			auto it = std::next(live.begin(), std::uniform_int_distribution<size_t>(0, live.size() - 1)(random));
+			usedSize -= sizes[it->first];
+			allocator.Free(it->second);
+			sizes.erase(it->first);
+			live.erase(it);
+		}
+
+		SELFTEST_CHECK(allocator.GetUsedSize() == usedSize);
+	}
+
+	// everything freed merges back in a single region
+	for (auto& [offset, allocation] : live)
+		allocator.Free(allocation);
+
+	const OffsetAllocator::StorageReport report = allocator.GetStorageReport();
+	SELFTEST_CHECK(report.TotalFreeSpace == SIZE);
+	SELFTEST_CHECK(report.LargestFreeRegion == SIZE);
+	SELFTEST_CHECK(report.NumFreeRegions == 1);
+	SELFTEST_CHECK(allocator.GetFragmentation() == 0.f);
+}
@@ -0,0 +1,103 @@
+#include "pch.h"
+#include "SelfTest.h"
+#include "FrameClock.h"
+
+#include <cmath>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+	// 1/64 s, the steps and half steps add up exactly in doubles and in nanoseconds
+	constexpr double STEP = 1.0 / 64.0;
+	constexpr std::chrono::nanoseconds HALF_STEP{ 7812500 };
+
+	bool IsFrame(const FrameClock& clock, uint64_t frameIndex, double time, double deltaTime)
+	{
+		return clock.GetFrameIndex() == frameIndex && clock.GetTime() == time && clock.GetDeltaTime() == deltaTime;
+	}
+}
+
+void SelfTest::TestFrameClock()
+{
+	FrameClock& clock = FrameClock::Get();
+	const FrameClockMode mode = clock.GetMode();
+	const double fixedStep = clock.GetFixedStep();
+	const FrameClock::Clock::time_point start = FrameClock::Clock::now();
+
+	// Deterministic: one step per frame whatever the time between the frames, from 0 after a reset
+	clock.SetMode(FrameClockMode::Deterministic, STEP);
+	clock.Reset();
+	clock.Tick(start);
+	SELFTEST_CHECK(IsFrame(clock, 0, 0.0, 0.0));
+	bool stepped = true;
+	for (uint64_t i = 1; i <= 1000; ++i)
+	{
+		clock.Tick(start + (i % 3) * 1s);
+		stepped &= IsFrame(clock, i, i * STEP, STEP);
+	}
+	SELFTEST_CHECK(stepped);
+
+	// the same frames give the same times, 10 s in 600 frames of 1/60 s within rounding
+	clock.SetMode(FrameClockMode::Deterministic, 0.0);
+	SELFTEST_CHECK(clock.GetFixedStep() == 1.0 / 60.0);
+	double times[2];
+	for (double& time : times)
+	{
+		clock.Reset();
+		for (int i = 0; i <= 600; ++i)
+			clock.Tick();
+		time = clock.GetTime();
+	}
+	SELFTEST_CHECK(times[0] == times[1] && std::abs(times[0] - 10.0) < 1e-9 && clock.GetFrameIndex() == 600);
+
+	// FixedStep: the time measured in whole steps, the rest carried to the next frames
+	clock.SetMode(FrameClockMode::FixedStep, STEP);
+	clock.Reset();
+	FrameClock::Clock::time_point now = start;
+	clock.Tick(now);
+	SELFTEST_CHECK(IsFrame(clock, 0, 0.0, 0.0));
+	clock.Tick(now += HALF_STEP);
+	SELFTEST_CHECK(IsFrame(clock, 1, 0.0, 0.0));
+	clock.Tick(now += 2 * HALF_STEP);
+	SELFTEST_CHECK(IsFrame(clock, 2, STEP, STEP));
+	clock.Tick(now += 5 * HALF_STEP);
+	SELFTEST_CHECK(IsFrame(clock, 3, 4 * STEP, 3 * STEP));
+	clock.Tick(now);
+	SELFTEST_CHECK(IsFrame(clock, 4, 4 * STEP, 0.0));
+
+	// a stall of 1 s takes MAX_STEPS_PER_FRAME steps, and one more step carried to the next frame
+	clock.Tick(now += 1s);
+	const double maxDeltaTime = FrameClock::MAX_STEPS_PER_FRAME * STEP;
+	SELFTEST_CHECK(IsFrame(clock, 5, 4 * STEP + maxDeltaTime, maxDeltaTime));
+	clock.Tick(now);
+	SELFTEST_CHECK(IsFrame(clock, 6, 5 * STEP + maxDeltaTime, STEP));
+	clock.Tick(now);
+	SELFTEST_CHECK(IsFrame(clock, 7, 5 * STEP + maxDeltaTime, 0.0));
+
+	// 60 frames of 1/60 s take 64 steps of 1/64 s, 1 s
+	clock.Reset();
+	clock.Tick(now);
+	double deltaTimes = 0.0;
+	for (int i = 1; i <= 60; ++i)
+	{
+		clock.Tick(now + std::chrono::duration_cast<FrameClock::Clock::duration>(std::chrono::duration<double>(i / 60.0)));
+		deltaTimes += clock.GetDeltaTime();
+	}
+	SELFTEST_CHECK(std::abs(clock.GetTime() - 1.0) <= STEP && clock.GetTime() == deltaTimes);
+	std::printf("  fixed step: %.6f s after 1 s of 60 Hz frames\n", clock.GetTime());
+
+	// RealTime: the measured time
+	clock.SetMode(FrameClockMode::RealTime, STEP);
+	clock.Reset();
+	clock.Tick(now);
+	clock.Tick(now + HALF_STEP);
+	SELFTEST_CHECK(IsFrame(clock, 1, STEP / 2, STEP / 2));
+
+	// a replayed frame sets the time as recorded
+	clock.SetTime(2.5, 0.25);
+	SELFTEST_CHECK(IsFrame(clock, 2, 2.5, 0.25));
+
+	clock.SetMode(mode, fixedStep);
+	clock.Reset();
+}
@@ -0,0 +1,136 @@
+#include "pch.h"
+#include "SelfTest.h"
+#include "GeometryGenerator.h"
+#include "Defines.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	using VertexBits = std::array<uint32_t, sizeof(Vertex) / sizeof(uint32_t)>;
+
+	VertexBits ToBits(const Vertex& vertex)
+	{
+		VertexBits bits;
+		std::memcpy(bits.data(), &vertex, sizeof(Vertex));
+		return bits;
+	}
+
+	using PositionBits = std::array<uint32_t, 3>;
+
+	PositionBits ToPositionBits(const Vertex& vertex)
+	{
+		PositionBits bits;
+		std::memcpy(bits.data(), &vertex.Position, sizeof(vertex.Position));
+		return bits;
+	}
+
+	template <typename Bits>
+	size_t CountDistinct(const std::vector<Vertex>& vertices, Bits (*toBits)(const Vertex&))
+	{
+		std::vector<Bits> bits(vertices.size());
+		std::transform(vertices.begin(), vertices.end(), bits.begin(), toBits);
+		std::sort(bits.begin(), bits.end());
+		return std::unique(bits.begin(), bits.end()) - bits.begin();
+	}
+
+	// GeometryGenerator::MidPoint
+	Vertex MidPoint(const Vertex& v0, const Vertex& v1)
+	{
+		Vertex v;
+		XMStoreFloat3(&v.Position, 0.5f * (XMLoadFloat3(&v0.Position) + XMLoadFloat3(&v1.Position)));
+		XMStoreFloat3(&v.Normal, XMVector3Normalize(0.5f * (XMLoadFloat3(&v0.Normal) + XMLoadFloat3(&v1.Normal))));
+		XMStoreFloat3(&v.TangentU, XMVector3Normalize(0.5f * (XMLoadFloat3(&v0.TangentU) + XMLoadFloat3(&v1.TangentU))));
+		XMStoreFloat2(&v.TexC, 0.5f * (XMLoadFloat2(&v0.TexC) + XMLoadFloat2(&v1.TexC)));
+		return v;
+	}
+
+	// The subdivision before the midpoints were shared: 3 corners per triangle, each triangle
+	// split in 4 with its own copies of the vertices and midpoints, in the same order.
+	std::vector<Vertex> SubdivideUnshared(const std::vector<Vertex>& corners)
+	{
+		std::vector<Vertex> result;
+		result.reserve(corners.size() * 4);
+		for (size_t i = 0; i + 2 < corners.size(); i += 3)
+		{
+			const Vertex& v0 = corners[i + 0];
+			const Vertex& v1 = corners[i + 1];
+			const Vertex& v2 = corners[i + 2];
+			const Vertex m0 = MidPoint(v0, v1);
+			const Vertex m1 = MidPoint(v1, v2);
+			const Vertex m2 = MidPoint(v0, v2);
+			for (const Vertex* v : { &v0, &m0, &m2, &m0, &m1, &m2, &m2, &m1, &v2, &m0, &v1, &m1 })
+				result.push_back(*v);
+		}
+		return result;
+	}
+
+	std::vector<Vertex> Corners(const GeometryGenerator::MeshData& mesh)
+	{
+		std::vector<Vertex> corners;
+		corners.reserve(mesh.Indices32.size());
+		for (uint32_t index : mesh.Indices32)
+			corners.push_back(mesh.Vertices[index]);
+		return corners;
+	}
+}
+
+void SelfTest::TestGeometryGenerator()
+{
+	GeometryGenerator generator;
+
+	// Box: nothing moves the vertices after the subdivision, the triangles are the same bits
+	// and the vertices are those of the unshared mesh without the duplicates
+	std::vector<Vertex> reference = Corners(generator.CreateBox(2.f, 1.f, 3.f, 0));
+	for (uint32_t level = 1; level <= std::min(MAX_PRIMITIVE_SUBDIVISIONS, 5u); ++level)
+	{
+		reference = SubdivideUnshared(reference);
+		const GeometryGenerator::MeshData box = generator.CreateBox(2.f, 1.f, 3.f, level);
+		const std::vector<Vertex> corners = Corners(box);
+		if (!SELFTEST_CHECK(corners.size() == reference.size()))
+			break;
+
+		bool sameTriangles = true;
+		for (size_t i = 0; i < corners.size(); ++i)
+			sameTriangles &= ToBits(corners[i]) == ToBits(reference[i]);
+		SELFTEST_CHECK(sameTriangles);
+
+		SELFTEST_CHECK(CountDistinct(box.Vertices, ToBits) == box.Vertices.size());
+		SELFTEST_CHECK(box.Vertices.size() == CountDistinct(reference, ToBits));
+		if (level == 5)
+			std::printf("  box /5: %zu vertices, %zu unshared\n", box.Vertices.size(), reference.size());
+	}
+
+	// Geosphere: the positions are projected on the sphere after the subdivision, from the
+	// icosahedron of level 0 they are within rounding of the unshared mesh projected the same way
+	reference = Corners(generator.CreateGeosphere(1.f, 0));
+	for (uint32_t level = 1; level <= 6; ++level)
+	{
+		reference = SubdivideUnshared(reference);
+		const GeometryGenerator::MeshData sphere = generator.CreateGeosphere(1.f, level);
+		const std::vector<Vertex> corners = Corners(sphere);
+		if (!SELFTEST_CHECK(corners.size() == reference.size()))
+			break;
+
+		float maxDistance = 0.f;
+		for (size_t i = 0; i < corners.size(); ++i)
+		{
+			const XMVECTOR expected = XMVector3Normalize(XMLoadFloat3(&reference[i].Position));
+			maxDistance = std::max(maxDistance, XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&corners[i].Position), expected))));
+		}
+		SELFTEST_CHECK(maxDistance < 1e-6f);
+
+		// the shared vertices have distinct positions, as many as the unshared mesh has
+		SELFTEST_CHECK(CountDistinct(sphere.Vertices, ToPositionBits) == sphere.Vertices.size());
+		SELFTEST_CHECK(sphere.Vertices.size() == CountDistinct(reference, ToPositionBits));
+		SELFTEST_CHECK(sphere.Vertices.size() == 10 * (size_t(1) << (2 * level)) + 2);
+		if (level == 6)
+			std::printf("  geosphere /6: %zu vertices, %zu unshared, %.1e max distance\n", sphere.Vertices.size(), reference.size(), maxDistance);
+	}
+}
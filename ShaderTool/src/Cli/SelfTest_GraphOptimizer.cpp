@@ -0,0 +1,142 @@
+#include "pch.h"
+#include "SelfTest.h"
+#include "Editor/Graph/GraphOptimizer.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	// A uinode and its float pins, created in the graph the way UiNode::OnCreate does
+	struct TestNode
+	{
+		int Id;
+		std::vector<int> Inputs;
+		std::vector<int> Outputs;
+	};
+
+	TestNode CreateNode(Graph& graph, NodeType type, int numInputs, int numOutputs, float value = 0.f)
+	{
+		TestNode node;
+		node.Id = graph.CreateNode(Node(type, NodeDirection::None));
+		for (int i = 0; i < numInputs; ++i)
+		{
+			node.Inputs.push_back(graph.CreateNode(Node(NodeType::Float, NodeDirection::In)));
+			graph.CreateEdge(node.Id, node.Inputs.back(), EdgeType::Internal);
+			graph.StoreNodeValue(node.Inputs.back(), std::make_shared<NodeValueFloat>(0.f));
+		}
+		for (int i = 0; i < numOutputs; ++i)
+		{
+			node.Outputs.push_back(graph.CreateNode(Node(NodeType::Float, NodeDirection::Out)));
+			graph.CreateEdge(node.Outputs.back(), node.Id, EdgeType::Internal);
+			graph.StoreNodeValue(node.Outputs.back(), std::make_shared<NodeValueFloat>(value));
+		}
+		return node;
+	}
+
+	// from the input pin to the output pin it reads, as the editor links them
+	void Link(Graph& graph, const TestNode& to, int input, const TestNode& from)
+	{
+		graph.CreateEdge(to.Inputs[input], from.Outputs[0], EdgeType::External);
+	}
+
+	size_t IndexOf(const std::vector<int>& ids, int id)
+	{
+		return std::find(ids.begin(), ids.end(), id) - ids.begin();
+	}
+}
+
+void SelfTest::TestGraphOptimizer()
+{
+	Graph graph;
+	const TestNode root = CreateNode(graph, NodeType::Draw, 3, 0);
+
+	// (2 + 3) * 4, constant
+	const TestNode two = CreateNode(graph, NodeType::Scalar, 0, 1, 2.f);
+	const TestNode three = CreateNode(graph, NodeType::Scalar, 0, 1, 3.f);
+	const TestNode four = CreateNode(graph, NodeType::Scalar, 0, 1, 4.f);
+	const TestNode add = CreateNode(graph, NodeType::Add, 2, 1);
+	const TestNode multiply = CreateNode(graph, NodeType::Multiply, 2, 1);
+	Link(graph, add, 0, two);
+	Link(graph, add, 1, three);
+	Link(graph, multiply, 0, add);
+	Link(graph, multiply, 1, four);
+	Link(graph, root, 0, multiply);
+
+	// sin(time) twice, the second sine is merged with the first one
+	const TestNode time = CreateNode(graph, NodeType::Time, 0, 1);
+	const TestNode sine = CreateNode(graph, NodeType::Sine, 1, 1);
+	const TestNode sameSine = CreateNode(graph, NodeType::Sine, 1, 1);
+	Link(graph, sine, 0, time);
+	Link(graph, sameSine, 0, time);
+	Link(graph, root, 1, sine);
+	Link(graph, root, 2, sameSine);
+
+	// not reaching the root
+	const TestNode unusedScalar = CreateNode(graph, NodeType::Scalar, 0, 1, 5.f);
+	const TestNode unusedAdd = CreateNode(graph, NodeType::Add, 2, 1);
+	Link(graph, unusedAdd, 0, unusedScalar);
+
+	std::vector<int> evaluated;
+	const EvaluationPlan plan = GraphOptimizer::Optimize(graph, root.Id, [&evaluated](int id) { evaluated.push_back(id); });
+
+	// the chain is folded, each node after its inputs, and evaluated once
+	SELFTEST_CHECK(plan.Folded.size() == 5);
+	SELFTEST_CHECK(evaluated == plan.Folded);
+	for (const TestNode* node : { &two, &three, &four, &add, &multiply })
+		SELFTEST_CHECK(IndexOf(plan.Folded, node->Id) < plan.Folded.size());
+	SELFTEST_CHECK(IndexOf(plan.Folded, two.Id) < IndexOf(plan.Folded, add.Id));
+	SELFTEST_CHECK(IndexOf(plan.Folded, three.Id) < IndexOf(plan.Folded, add.Id));
+	SELFTEST_CHECK(IndexOf(plan.Folded, add.Id) < IndexOf(plan.Folded, multiply.Id));
+	SELFTEST_CHECK(IndexOf(plan.Folded, four.Id) < IndexOf(plan.Folded, multiply.Id));
+
+	// time, the two sines and the root are evaluated every frame, the root last
+	std::vector<int> steps;
+	for (const EvaluationStep& step : plan.Steps)
+		steps.push_back(step.NodeId);
+	SELFTEST_CHECK(steps.size() == 4);
+	SELFTEST_CHECK(!steps.empty() && steps.back() == root.Id);
+	SELFTEST_CHECK(IndexOf(steps, time.Id) < IndexOf(steps, sine.Id));
+	SELFTEST_CHECK(IndexOf(steps, time.Id) < IndexOf(steps, sameSine.Id));
+	SELFTEST_CHECK(plan.Updated.size() == 4 && plan.Updated.count(time.Id) == 1 && plan.Updated.count(add.Id) == 0);
+
+	// the sine evaluated second copies the output of the first one
+	SELFTEST_CHECK(plan.NumMerged == 1);
+	const size_t first = std::min(IndexOf(steps, sine.Id), IndexOf(steps, sameSine.Id));
+	const size_t second = std::max(IndexOf(steps, sine.Id), IndexOf(steps, sameSine.Id));
+	if (SELFTEST_CHECK(second < steps.size()))
+	{
+		const EvaluationStep& merged = plan.Steps[second];
+		SELFTEST_CHECK(merged.MergedWith == steps[first]);
+		const int output = merged.NodeId == sine.Id ? sine.Outputs[0] : sameSine.Outputs[0];
+		const int firstOutput = merged.NodeId == sine.Id ? sameSine.Outputs[0] : sine.Outputs[0];
+		SELFTEST_CHECK(merged.MergedOutputs.size() == 1 && merged.MergedOutputs[0] == std::make_pair(output, firstOutput));
+		SELFTEST_CHECK(plan.Steps[first].MergedWith == INVALID_ID);
+	}
+
+	// the unreachable nodes are dead, neither folded nor evaluated
+	const size_t numDead = 11 - plan.Folded.size() - plan.Steps.size();
+	SELFTEST_CHECK(numDead == 2);
+	for (const TestNode* node : { &unusedScalar, &unusedAdd })
+	{
+		SELFTEST_CHECK(IndexOf(plan.Folded, node->Id) == plan.Folded.size());
+		SELFTEST_CHECK(IndexOf(steps, node->Id) == steps.size());
+	}
+
+	// the unoptimized traversal evaluates time once per sine
+	SELFTEST_CHECK(plan.NumTraversed == 10);
+
+	// a sine reading the other one isn't merged with it
+	for (const Edge& edge : graph.GetEdges())
+	{
+		if (edge.type == EdgeType::External && edge.from == sameSine.Inputs[0])
+		{
+			graph.EraseEdge(edge.id);
+			break;
+		}
+	}
+	Link(graph, sameSine, 0, sine);
+	const EvaluationPlan chained = GraphOptimizer::Optimize(graph, root.Id, [](int) {});
+	SELFTEST_CHECK(chained.NumMerged == 0);
+	SELFTEST_CHECK(chained.Steps.size() == 4 && chained.Folded.size() == 5);
+}
@@ -0,0 +1,191 @@
+#include "pch.h"
+#include "SelfTest.h"
+#include "Editor/Graph/HlslGenerator.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// A uinode and its float pins, as in SelfTest_GraphOptimizer
+	struct TestNode
+	{
+		int Id;
+		std::vector<int> Inputs;
+		std::vector<int> Outputs;
+	};
+
+	TestNode CreateNode(Graph& graph, NodeType type, int numInputs, int numOutputs)
+	{
+		TestNode node;
+		node.Id = graph.CreateNode(Node(type, NodeDirection::None));
+		for (int i = 0; i < numInputs; ++i)
+		{
+			node.Inputs.push_back(graph.CreateNode(Node(NodeType::Float, NodeDirection::In)));
+			graph.CreateEdge(node.Id, node.Inputs.back(), EdgeType::Internal);
+		}
+		for (int i = 0; i < numOutputs; ++i)
+		{
+			node.Outputs.push_back(graph.CreateNode(Node(NodeType::Float, NodeDirection::Out)));
+			graph.CreateEdge(node.Outputs.back(), node.Id, EdgeType::Internal);
+		}
+		return node;
+	}
+
+	void Link(Graph& graph, const TestNode& to, int input, const TestNode& from)
+	{
+		graph.CreateEdge(to.Inputs[input], from.Outputs[0], EdgeType::External);
+	}
+
+	bool Contains(const std::string& text, const std::string& part)
+	{
+		return text.find(part) != std::string::npos;
+	}
+
+	const char* SHADER_SOURCE =
+		"cbuffer cbPerObject : register(b0)\n"
+		"{\n"
+		"    float4x4 World;\n"
+		"};\n"
+		"\n"
+		"cbuffer cbPerFrame : register(b1)\n"
+		"{\n"
+		"    float4 Color;\n"
+		"    float3 Tint;\n"
+		"    float Speed;\n"
+		"    float Scale;\n"
+		"    float Offset;\n"
+		"};\n"
+		"\n"
+		"struct Wave { float Speed; };\n"
+		"\n"
+		"float4 PS(float4 position : SV_POSITION) : SV_Target\n"
+		"{\n"
+		"    Wave wave;\n"
+		"    wave.Speed = Speed;\n"
+		"    return Color * float4(Tint, 1.0) * Scale * wave.Speed + Offset;\n"
+		"}\n";
+}
+
+void SelfTest::TestHlslGenerator()
+{
+	Graph graph;
+	const TestNode draw = CreateNode(graph, NodeType::Draw, 5, 0);
+	const std::vector<HlslBinding> bindings = {
+		{ "Speed", "float", draw.Inputs[0] },
+		{ "Scale", "float", draw.Inputs[1] },
+		{ "Tint", "float3", draw.Inputs[2] },
+		{ "Offset", "float", draw.Inputs[3] },
+		{ "Color", "float4", draw.Inputs[4] },
+	};
+
+	// Speed = sin(time)
+	const TestNode time = CreateNode(graph, NodeType::Time, 0, 1);
+	const TestNode sine = CreateNode(graph, NodeType::Sine, 1, 1);
+	Link(graph, sine, 0, time);
+	Link(graph, draw, 0, sine);
+
+	// Scale = scalar * (0 + 0), the add is folded
+	const TestNode scalar = CreateNode(graph, NodeType::Scalar, 0, 1);
+	const TestNode zero = CreateNode(graph, NodeType::Add, 2, 1);
+	const TestNode multiply = CreateNode(graph, NodeType::Multiply, 2, 1);
+	Link(graph, multiply, 0, scalar);
+	Link(graph, multiply, 1, zero);
+	Link(graph, draw, 1, multiply);
+
+	// Tint = (sin(time), y, z), y and z typed in the node
+	const TestNode tintSine = CreateNode(graph, NodeType::Sine, 1, 1);
+	const TestNode vector = CreateNode(graph, NodeType::Vector3, 3, 1);
+	Link(graph, tintSine, 0, time);
+	Link(graph, vector, 0, tintSine);
+	Link(graph, draw, 2, vector);
+
+	// Offset = 0 + 0, a literal
+	const TestNode offset = CreateNode(graph, NodeType::Add, 2, 1);
+	Link(graph, draw, 3, offset);
+
+	// Color = color, no math, it stays in cbPerFrame
+	const TestNode color = CreateNode(graph, NodeType::Color, 0, 1);
+	Link(graph, draw, 4, color);
+
+	const GeneratedShader generated = HlslGenerator::Generate(graph, bindings, SHADER_SOURCE);
+	const std::string& source = generated.Source;
+	SELFTEST_CHECK(generated.Error.empty());
+	SELFTEST_CHECK(generated.GeneratedVars == std::vector<std::string>({ "Speed", "Scale", "Tint", "Offset" }));
+	SELFTEST_CHECK(generated.NumMathNodes == 6);
+	SELFTEST_CHECK(generated.NumInlinedConstants == 2);
+
+	// the inputs, the time once, packed in cbGenerated in the free default register
+	const std::string timeInput = "Time_" + std::to_string(time.Id);
+	const std::string scalarInput = "Scalar_" + std::to_string(scalar.Id);
+	const std::string vectorInput = "Vector3_" + std::to_string(vector.Id);
+	std::vector<std::string> inputs;
+	for (const HlslInput& input : generated.Inputs)
+		inputs.push_back(input.Name);
+	SELFTEST_CHECK(inputs == std::vector<std::string>({ timeInput, scalarInput, vectorInput + "_y", vectorInput + "_z" }));
+	SELFTEST_CHECK(generated.Inputs.size() == 4 && generated.Inputs[0].SourcePin == time.Outputs[0] && generated.Inputs[2].SourcePin == vector.Inputs[1]);
+	SELFTEST_CHECK(generated.CBufferRegister == GENERATED_CBUFFER_REGISTER);
+	SELFTEST_CHECK(Contains(source, "cbuffer cbGenerated : register(b" + std::to_string(GENERATED_CBUFFER_REGISTER) + ")\n{\n"
+		"    float " + timeInput + ";\n"
+		"    float " + scalarInput + ";\n"
+		"    float " + vectorInput + "_y;\n"
+		"    float " + vectorInput + "_z;\n"
+		"}\n"));
+
+	// largest first, the 4 floats fill the first 16 bytes register at offsets 0, 4, 8 and 12
+	UINT offset32 = 0;
+	bool packed = true;
+	for (size_t i = 0; i < generated.Inputs.size(); ++i)
+	{
+		const UINT size = HlslNodeType::Get()->GetNum32BitValues(generated.Inputs[i].TypeName);
+		packed &= i == 0 || size <= HlslNodeType::Get()->GetNum32BitValues(generated.Inputs[i - 1].TypeName);
+		if (offset32 / 4 != (offset32 + size - 1) / 4)
+			offset32 = (offset32 + 3) / 4 * 4;
+		offset32 += size;
+	}
+	SELFTEST_CHECK(packed && offset32 == 4);
+
+	// the functions, the folded add written as a literal
+	const std::string sineVar = "n" + std::to_string(sine.Id);
+	const std::string multiplyVar = "n" + std::to_string(multiply.Id);
+	const std::string tintSineVar = "n" + std::to_string(tintSine.Id);
+	const std::string vectorVar = "n" + std::to_string(vector.Id);
+	SELFTEST_CHECK(Contains(source, "\nfloat Generated_Speed()\n{\n    float " + sineVar + " = abs(sin(" + timeInput + "));\n    return " + sineVar + ";\n}\n"));
+	SELFTEST_CHECK(Contains(source, "\nfloat Generated_Scale()\n{\n    float " + multiplyVar + " = " + scalarInput + " * 0.0;\n    return " + multiplyVar + ";\n}\n"));
+	SELFTEST_CHECK(Contains(source, "\nfloat3 Generated_Tint()\n{\n    float " + tintSineVar + " = abs(sin(" + timeInput + "));\n"
+		"    float3 " + vectorVar + " = float3(" + tintSineVar + ", " + vectorInput + "_y, " + vectorInput + "_z);\n    return " + vectorVar + ";\n}\n"));
+	SELFTEST_CHECK(Contains(source, "\nfloat Generated_Offset()\n{\n    return 0.0;\n}\n"));
+
+	// the declarations commented out, the uses replaced but not the member with the same name
+	SELFTEST_CHECK(Contains(source, "    // float Speed; computed by Generated_Speed()\n"));
+	SELFTEST_CHECK(Contains(source, "    // float3 Tint; computed by Generated_Tint()\n"));
+	SELFTEST_CHECK(Contains(source, "    float4 Color;\n"));
+	SELFTEST_CHECK(Contains(source, "    wave.Speed = Generated_Speed();\n"));
+	SELFTEST_CHECK(Contains(source, "    return Color * float4(Generated_Tint(), 1.0) * Generated_Scale() * wave.Speed + Generated_Offset();\n"));
+	SELFTEST_CHECK(source.find("cbGenerated") > source.find("cbPerFrame") && source.find("Generated_Speed()\n{") < source.find("float4 PS("));
+
+	// the default register bound by an include, cbGenerated takes the first one free
+	const GeneratedShader moved = HlslGenerator::Generate(graph, bindings, SHADER_SOURCE, { GENERATED_CBUFFER_REGISTER, 8 });
+	SELFTEST_CHECK(moved.Error.empty() && moved.CBufferRegister == 2);
+	SELFTEST_CHECK(Contains(moved.Source, "cbuffer cbGenerated : register(b2)\n"));
+
+	// declared in the source
+	std::string declaredSource = SHADER_SOURCE;
+	declaredSource.replace(declaredSource.find("register(b1)"), 12, "register(b" + std::to_string(GENERATED_CBUFFER_REGISTER) + ")");
+	const GeneratedShader declared = HlslGenerator::Generate(graph, bindings, declaredSource);
+	SELFTEST_CHECK(declared.Error.empty() && declared.CBufferRegister == 1);
+
+	// no register left, nothing is generated
+	std::vector<uint32_t> allRegisters;
+	for (uint32_t r = 0; r < D3D12_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT; ++r)
+		allRegisters.push_back(r);
+	const GeneratedShader full = HlslGenerator::Generate(graph, bindings, SHADER_SOURCE, allRegisters);
+	SELFTEST_CHECK(!full.Error.empty());
+	SELFTEST_CHECK(full.GeneratedVars.empty() && full.Inputs.empty() && full.Source == SHADER_SOURCE);
+
+	// without inputs cbGenerated isn't declared and needs no register
+	const GeneratedShader literal = HlslGenerator::Generate(graph, { bindings[3] }, SHADER_SOURCE, allRegisters);
+	SELFTEST_CHECK(literal.Error.empty() && literal.GeneratedVars.size() == 1 && literal.Inputs.empty());
+	SELFTEST_CHECK(!Contains(literal.Source, "cbGenerated") && Contains(literal.Source, "Generated_Offset()"));
+}
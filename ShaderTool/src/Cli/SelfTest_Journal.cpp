@@ -0,0 +1,216 @@
+#include "pch.h"
+#include "SelfTest.h"
+#include "Journal.h"
+#include "Editor/UiNode/UiNode.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+	std::vector<char> ReadBytes(const std::string& path)
+	{
+		std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+		return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+	}
+
+	void WriteBytes(const std::string& path, const std::vector<char>& bytes, size_t size)
+	{
+		std::ofstream file(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		file.write(bytes.data(), size);
+	}
+
+	template<typename T>
+	void Append(std::vector<char>& bytes, const T& value)
+	{
+		const char* data = reinterpret_cast<const char*>(&value);
+		bytes.insert(bytes.end(), data, data + sizeof(T));
+	}
+
+	// magic, version and an empty project
+	std::vector<char> MakeHeader(uint32_t version)
+	{
+		std::vector<char> bytes(Journal::MAGIC, Journal::MAGIC + sizeof(Journal::MAGIC));
+		Append(bytes, version);
+		Append(bytes, uint64_t(0));
+		return bytes;
+	}
+
+	bool SameRecord(const JournalRecord& a, const JournalRecord& b)
+	{
+		return a.Type == b.Type && a.Id == b.Id && a.From == b.From && a.To == b.To && a.NodeType == b.NodeType &&
+			a.Value == b.Value && a.Path == b.Path && a.State == b.State;
+	}
+}
+
+void SelfTest::TestJournal()
+{
+	Journal& journal = Journal::Get();
+	journal.StopRecording();
+
+	const std::string path = (std::filesystem::temp_directory_path() / "shadertool_selftest.stj").string();
+	const std::string project = std::string("nodes\n\0binary", 13);
+
+	// nothing is written while not recording
+	journal.RecordFrame(1.0, 1.0);
+	journal.RecordDeleteNode(1);
+
+	std::vector<uint8_t> matrix(64), large(1000);
+	for (size_t i = 0; i < large.size(); ++i)
+		large[i] = (uint8_t)(i * 7);
+
+	if (!SELFTEST_CHECK(journal.StartRecording(path, project)))
+		return;
+	journal.RecordFrame(0.0, 0.0);
+	journal.RecordCreateNode(UiNodeType::Sine, 7);
+	journal.RecordCreateLink(10, 11, 12);
+	journal.RecordFrame(1.0 / 60.0, 1.0 / 60.0);
+	journal.RecordSetValue(10, matrix.data(), matrix.size());
+	journal.RecordSetValue(11, large.data(), large.size()); // over the 8 bit sizes of the version 2
+	journal.RecordDeleteLink(12);
+	journal.RecordFrame(2.0 / 60.0, 1.0 / 60.0);
+	journal.RecordLoadAsset(7, "models/a b.obj");
+	journal.RecordNodeState(7, "");
+	journal.RecordDeleteNode(7);
+	SELFTEST_CHECK(journal.GetNumFrames() == 3 && journal.GetNumRecords() == 8);
+	journal.StopRecording();
+	SELFTEST_CHECK(!journal.IsRecording());
+
+	// read back as written
+	JournalData data;
+	if (!SELFTEST_CHECK(Journal::Read(path, data)) || !SELFTEST_CHECK(data.Frames.size() == 3))
+		return;
+	SELFTEST_CHECK(data.Project == project && data.NumRecords == 8);
+	SELFTEST_CHECK(data.Frames[1].Time == 1.0 / 60.0 && data.Frames[2].DeltaTime == 1.0 / 60.0);
+
+	std::vector<JournalRecord> expected(8);
+	expected[0].Type = JournalRecordType::CreateNode;
+	expected[0].NodeType = UiNodeType::Sine;
+	expected[0].Id = 7;
+	expected[1].Type = JournalRecordType::CreateLink;
+	expected[1].From = 10;
+	expected[1].To = 11;
+	expected[1].Id = 12;
+	expected[2].Type = JournalRecordType::SetValue;
+	expected[2].Id = 10;
+	expected[2].Value = matrix;
+	expected[3].Type = JournalRecordType::SetValue;
+	expected[3].Id = 11;
+	expected[3].Value = large;
+	expected[4].Type = JournalRecordType::DeleteLink;
+	expected[4].Id = 12;
+	expected[5].Type = JournalRecordType::LoadAsset;
+	expected[5].Id = 7;
+	expected[5].Path = "models/a b.obj";
+	expected[6].Type = JournalRecordType::NodeState;
+	expected[6].Id = 7;
+	expected[7].Type = JournalRecordType::DeleteNode;
+	expected[7].Id = 7;
+
+	std::vector<JournalRecord> records;
+	for (const JournalFrame& frame : data.Frames)
+		records.insert(records.end(), frame.Records.begin(), frame.Records.end());
+	SELFTEST_CHECK(data.Frames[0].Records.size() == 2 && data.Frames[1].Records.size() == 3 && data.Frames[2].Records.size() == 3);
+	bool same = records.size() == expected.size();
+	for (size_t i = 0; same && i < records.size(); ++i)
+		same = SameRecord(records[i], expected[i]);
+	SELFTEST_CHECK(same);
+
+	// cut at each byte: the header is needed, after it the whole records before the cut are kept
+	const std::vector<char> bytes = ReadBytes(path);
+	const size_t headerSize = sizeof(Journal::MAGIC) + sizeof(uint32_t) + sizeof(uint64_t) + project.size();
+	bool headerRejected = true;
+	bool prefixKept = true;
+	size_t lastNumRecords = 0;
+	for (size_t size = 0; size < bytes.size(); ++size)
+	{
+		WriteBytes(path, bytes, size);
+		JournalData cut;
+		const bool read = Journal::Read(path, cut);
+		if (size < headerSize)
+		{
+			headerRejected &= !read;
+			continue;
+		}
+
+		size_t index = 0;
+		prefixKept &= read && cut.Frames.size() <= data.Frames.size() && cut.NumRecords >= lastNumRecords;
+		for (const JournalFrame& frame : cut.Frames)
+		{
+			for (const JournalRecord& record : frame.Records)
+				prefixKept &= index < expected.size() && SameRecord(record, expected[index++]);
+		}
+		prefixKept &= index == cut.NumRecords;
+		lastNumRecords = cut.NumRecords;
+	}
+	SELFTEST_CHECK(headerRejected);
+	SELFTEST_CHECK(prefixKept && lastNumRecords == 7);
+
+	// bad headers
+	JournalData bad;
+	std::vector<char> badMagic = bytes;
+	badMagic[0] = 'X';
+	WriteBytes(path, badMagic, badMagic.size());
+	SELFTEST_CHECK(!Journal::Read(path, bad));
+	for (uint32_t version : { 0u, Journal::VERSION + 1 })
+	{
+		const std::vector<char> header = MakeHeader(version);
+		WriteBytes(path, header, header.size());
+		SELFTEST_CHECK(!Journal::Read(path, bad));
+	}
+	std::vector<char> longProject = MakeHeader(Journal::VERSION);
+	longProject[sizeof(Journal::MAGIC) + sizeof(uint32_t)] = 1;
+	WriteBytes(path, longProject, longProject.size());
+	SELFTEST_CHECK(!Journal::Read(path, bad));
+
+	// a version 2 journal, with the 8 bit size of the values, an unknown record ends it
+	std::vector<char> version2 = MakeHeader(2);
+	Append(version2, JournalRecordType::Frame);
+	Append(version2, 0.5);
+	Append(version2, 0.25);
+	Append(version2, JournalRecordType::SetValue);
+	Append(version2, int32_t(3));
+	Append(version2, uint8_t(4));
+	Append(version2, 1.5f);
+	Append(version2, uint8_t(200));
+	Append(version2, int32_t(3));
+	WriteBytes(path, version2, version2.size());
+	JournalData old;
+	if (SELFTEST_CHECK(Journal::Read(path, old) && old.Frames.size() == 1 && old.NumRecords == 1))
+	{
+		const JournalRecord& record = old.Frames[0].Records[0];
+		float value = 0.f;
+		SELFTEST_CHECK(record.Type == JournalRecordType::SetValue && record.Id == 3 && record.Value.size() == 4);
+		if (record.Value.size() == 4)
+			std::memcpy(&value, record.Value.data(), 4);
+		SELFTEST_CHECK(value == 1.5f && old.Frames[0].Time == 0.5);
+	}
+
+	// a record before the first frame can't be replayed
+	std::vector<char> noFrame = MakeHeader(Journal::VERSION);
+	Append(noFrame, JournalRecordType::DeleteNode);
+	Append(noFrame, int32_t(3));
+	WriteBytes(path, noFrame, noFrame.size());
+	JournalData empty;
+	SELFTEST_CHECK(Journal::Read(path, empty) && empty.Frames.empty() && empty.NumRecords == 0);
+
+	// a value too large for the journal stops the recording, the records before it stay readable
+	if (SELFTEST_CHECK(journal.StartRecording(path, project)))
+	{
+		std::vector<uint8_t> tooLarge(UINT16_MAX + 1);
+		journal.RecordFrame(0.0, 0.0);
+		journal.RecordDeleteNode(7);
+		journal.RecordSetValue(10, tooLarge.data(), tooLarge.size());
+		SELFTEST_CHECK(!journal.IsRecording());
+		journal.RecordDeleteNode(8);
+
+		JournalData stopped;
+		SELFTEST_CHECK(Journal::Read(path, stopped) && stopped.Frames.size() == 1 && stopped.NumRecords == 1);
+	}
+	journal.StopRecording();
+
+	std::remove(path.c_str());
+	SELFTEST_CHECK(!Journal::Read(path, bad));
+}
@@ -0,0 +1,72 @@
+#include "pch.h"
+#include "SelfTest.h"
+
+#include <string>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+	// One call site, the messages logged and the number skipped before the last one
+	struct RateLimitRun
+	{
+		Log::CallSite Site;
+		uint32_t NumLogged{ 0 };
+		uint32_t LastSkipped{ 0 };
+		uint32_t TotalSkipped{ 0 }; // reported by the messages logged
+
+		bool Add(const std::string& message, Log::Clock::time_point now)
+		{
+			uint32_t numSkipped = 0;
+			if (!Log::RateLimit(Site, message, now, numSkipped))
+				return false;
+
+			++NumLogged;
+			LastSkipped = numSkipped;
+			TotalSkipped += numSkipped;
+			return true;
+		}
+	};
+}
+
+void SelfTest::TestLog()
+{
+	const Log::Clock::time_point start = Log::Clock::time_point() + 100s;
+
+	// a repeated message is logged once per interval, the next one has the number skipped
+	{
+		RateLimitRun run;
+		SELFTEST_CHECK(run.Add("a", start) && run.LastSkipped == 0);
+		for (int i = 0; i < 4; ++i)
+			SELFTEST_CHECK(!run.Add("a", start + 1ms));
+		SELFTEST_CHECK(run.Add("b", start + 2ms) && run.LastSkipped == 4);
+		SELFTEST_CHECK(run.Add("a", start + 3ms) && run.LastSkipped == 0);
+		SELFTEST_CHECK(run.NumLogged == 3);
+	}
+
+	// RATE_LIMIT different messages per interval, the interval starts at the first message logged
+	{
+		RateLimitRun run;
+		for (uint32_t i = 0; i < Log::RATE_LIMIT; ++i)
+			SELFTEST_CHECK(run.Add("message " + std::to_string(i), start + i * 1ms));
+		SELFTEST_CHECK(!run.Add("over the limit", start + 10ms));
+		SELFTEST_CHECK(!run.Add("over the limit too", start + Log::RATE_LIMIT_INTERVAL - 1ms));
+
+		// the next interval logs even the last message again, with the 2 skipped
+		const std::string last = "message " + std::to_string(Log::RATE_LIMIT - 1);
+		SELFTEST_CHECK(run.Add(last, start + Log::RATE_LIMIT_INTERVAL) && run.LastSkipped == 2);
+		SELFTEST_CHECK(!run.Add(last, start + Log::RATE_LIMIT_INTERVAL + 1ms));
+		SELFTEST_CHECK(run.Add(last, start + 10s) && run.LastSkipped == 1);
+		SELFTEST_CHECK(run.NumLogged == Log::RATE_LIMIT + 2);
+	}
+
+	// a call site flooding for 10 s logs RATE_LIMIT messages per interval, the skipped ones are all counted
+	{
+		RateLimitRun run;
+		uint32_t numMessages = 0;
+		for (auto t = 0ms; t < 10s; t += 1ms, ++numMessages)
+			run.Add("flood " + std::to_string(numMessages), start + t);
+		SELFTEST_CHECK(run.NumLogged == 10 * Log::RATE_LIMIT);
+		SELFTEST_CHECK(run.NumLogged + run.TotalSkipped + run.Site.NumSkipped == numMessages);
+	}
+}
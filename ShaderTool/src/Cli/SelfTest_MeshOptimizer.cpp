@@ -0,0 +1,131 @@
+#include "pch.h"
+#include "SelfTest.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+	using Triangle = std::array<DirectX::XMFLOAT3, 3>;
+
+	// The triangles by position, rotated to start with the smallest corner so the winding is kept
+	std::vector<Triangle> SortedTriangles(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	{
+		auto less = [](const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+		{
+			return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+		};
+
+		std::vector<Triangle> triangles;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			Triangle t = { vertices[indices[i]].Position, vertices[indices[i + 1]].Position, vertices[indices[i + 2]].Position };
+			while (less(t[1], t[0]) || less(t[2], t[0]))
+				std::rotate(t.begin(), t.begin() + 1, t.end());
+			triangles.push_back(t);
+		}
+
+		std::sort(triangles.begin(), triangles.end(), [&](const Triangle& a, const Triangle& b)
+		{
+			return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), less);
+		});
+		return triangles;
+	}
+
+	bool SameTriangles(const std::vector<Triangle>& a, const std::vector<Triangle>& b)
+	{
+		auto equal = [](const DirectX::XMFLOAT3& p, const DirectX::XMFLOAT3& q) { return p.x == q.x && p.y == q.y && p.z == q.z; };
+		return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [&](const Triangle& s, const Triangle& t)
+		{
+			return equal(s[0], t[0]) && equal(s[1], t[1]) && equal(s[2], t[2]);
+		});
+	}
+}
+
+void SelfTest::TestMeshOptimizer()
+{
+	// one triangle: 3 vertices transformed, each once
+	{
+		const MeshOptimizer::VertexCacheStats stats = MeshOptimizer::AnalyzeVertexCache({ 0, 1, 2 }, 3);
+		SELFTEST_CHECK(stats.VerticesTransformed == 3);
+		SELFTEST_CHECK(stats.ACMR == 3.f);
+		SELFTEST_CHECK(stats.ATVR == 1.f);
+	}
+
+	// A wavy 100x100 grid with its triangles shuffled, about the worst order there is
+	constexpr uint32_t N = 100;
+	std::vector<Vertex> vertices;
+	for (uint32_t y = 0; y <= N; ++y)
+	{
+		for (uint32_t x = 0; x <= N; ++x)
+			vertices.emplace_back((float)x, (float)y, std::sin(x * 0.1f) * std::cos(y * 0.1f), 0.f, 0.f, 1.f, 1.f, 0.f, 0.f, x / (float)N, y / (float)N);
+	}
+
+	std::vector<std::array<uint32_t, 3>> triangles;
+	for (uint32_t y = 0; y < N; ++y)
+	{
+		for (uint32_t x = 0; x < N; ++x)
+		{
+			const uint32_t a = y * (N + 1) + x;
+			const uint32_t c = a + N + 1;
+			triangles.push_back({ a, c, a + 1 });
+			triangles.push_back({ a + 1, c, c + 1 });
+		}
+	}
+	std::shuffle(triangles.begin(), triangles.end(), std::mt19937(29));
+
+	std::vector<uint32_t> indices;
+	for (const auto& t : triangles)
+		indices.insert(indices.end(), t.begin(), t.end());
+
+	const std::vector<Triangle> trianglesBefore = SortedTriangles(vertices, indices);
+	const MeshOptimizer::VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+	SELFTEST_CHECK(before.ACMR > 2.5f);
+
+	// the vertex cache pass alone gets close to the 0.5 of an ideal strip order
+	{
+		std::vector<uint32_t> cacheOrder = indices;
+		MeshOptimizer::OptimizeVertexCache(cacheOrder, vertices.size());
+		const MeshOptimizer::VertexCacheStats stats = MeshOptimizer::AnalyzeVertexCache(cacheOrder, vertices.size());
+		SELFTEST_CHECK(stats.ACMR < 0.75f);
+		SELFTEST_CHECK(stats.ATVR < 1.5f);
+		SELFTEST_CHECK(SameTriangles(SortedTriangles(vertices, cacheOrder), trianglesBefore));
+	}
+
+	// all the passes: the overdraw sort stays within its threshold, the triangles are the same
+	const MeshOptimizer::Report report = MeshOptimizer::Optimize(vertices, indices);
+	SELFTEST_CHECK(report.Before.ACMR == before.ACMR);
+	SELFTEST_CHECK(report.After.ACMR < 0.75f * MeshOptimizer::OVERDRAW_THRESHOLD);
+	SELFTEST_CHECK(report.After.ATVR < 1.5f * MeshOptimizer::OVERDRAW_THRESHOLD);
+	SELFTEST_CHECK(vertices.size() == (N + 1) * (N + 1));
+	SELFTEST_CHECK(SameTriangles(SortedTriangles(vertices, indices), trianglesBefore));
+
+	// after the fetch pass the vertices are in the order the indices first use them
+	uint32_t nextVertex = 0;
+	bool inFetchOrder = true;
+	for (uint32_t index : indices)
+	{
+		if (index > nextVertex)
+			inFetchOrder = false;
+		else if (index == nextVertex)
+			++nextVertex;
+	}
+	SELFTEST_CHECK(inFetchOrder);
+
+	// the vertices not referenced are dropped
+	{
+		std::vector<Vertex> sparse;
+		for (int i = 0; i < 10; ++i)
+			sparse.emplace_back((float)i, 0.f, 0.f, 0.f, 0.f, 1.f, 1.f, 0.f, 0.f, 0.f, 0.f);
+		std::vector<uint32_t> sparseIndices = { 7, 2, 5, 5, 2, 9 };
+
+		SELFTEST_CHECK(MeshOptimizer::OptimizeVertexFetch(sparse, sparseIndices) == 4);
+		SELFTEST_CHECK(sparse.size() == 4);
+		SELFTEST_CHECK((sparseIndices == std::vector<uint32_t>{ 0, 1, 2, 2, 1, 3 }));
+		SELFTEST_CHECK(sparse[0].Position.x == 7.f && sparse[1].Position.x == 2.f && sparse[2].Position.x == 5.f && sparse[3].Position.x == 9.f);
+	}
+}
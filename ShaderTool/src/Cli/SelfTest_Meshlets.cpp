@@ -0,0 +1,188 @@
+#include "pch.h"
+#include "SelfTest.h"
+#include "Meshlets.h"
+#include "GeometryGenerator.h"
+#include "Rendering/Frustum.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	struct Mesh
+	{
+		const char* Name;
+		bool Closed; // half of it faces away from any eye outside
+		std::vector<Vertex> Vertices;
+		std::vector<uint32_t> Indices;
+	};
+
+	// clockwise front faces, as the rasterizer culls them
+	bool IsFrontFacing(const std::vector<Vertex>& vertices, const uint32_t* triangle, FXMVECTOR eye)
+	{
+		const XMVECTOR p0 = XMLoadFloat3(&vertices[triangle[0]].Position);
+		const XMVECTOR p1 = XMLoadFloat3(&vertices[triangle[1]].Position);
+		const XMVECTOR p2 = XMLoadFloat3(&vertices[triangle[2]].Position);
+		const XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+		return XMVectorGetX(XMVector3Dot(normal, XMVectorSubtract(eye, p0))) > 0.f;
+	}
+
+	std::vector<std::array<uint32_t, 3>> SortedTriangles(const std::vector<uint32_t>& indices)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			std::array<uint32_t, 3> t = { indices[i], indices[i + 1], indices[i + 2] };
+			while (t[1] < t[0] || t[2] < t[0])
+				std::rotate(t.begin(), t.begin() + 1, t.end());
+			triangles.push_back(t);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	XMVECTOR RandomEye(std::mt19937& random, float minDistance, float maxDistance)
+	{
+		std::normal_distribution<float> normal;
+		const XMVECTOR direction = XMVector3Normalize(XMVectorSet(normal(random), normal(random), normal(random), 0.f));
+		return XMVectorScale(direction, std::uniform_real_distribution<float>(minDistance, maxDistance)(random));
+	}
+
+	XMMATRIX XM_CALLCONV ViewProjection(FXMVECTOR eye, FXMVECTOR target)
+	{
+		return XMMatrixLookAtLH(eye, target, XMVectorSet(0.f, 1.f, 0.1f, 0.f)) * XMMatrixPerspectiveFovLH(XM_PIDIV4, 1.f, 0.01f, 100.f);
+	}
+}
+
+void SelfTest::TestMeshlets()
+{
+	GeometryGenerator generator;
+	std::vector<Mesh> meshes;
+
+	GeometryGenerator::MeshData geosphere = generator.CreateGeosphere(1.f, 5);
+	meshes.push_back({ "geosphere", true, geosphere.Vertices, geosphere.Indices32 });
+
+	// a wavy terrain, its meshlets are neither flat nor convex
+	GeometryGenerator::MeshData grid = generator.CreateGrid(4.f, 4.f, 120, 120);
+	for (Vertex& vertex : grid.Vertices)
+		vertex.Position.y = 0.3f * std::sin(vertex.Position.x * 3.f) * std::cos(vertex.Position.z * 2.f);
+	meshes.push_back({ "terrain", false, grid.Vertices, grid.Indices32 });
+
+	std::mt19937 random(31);
+	for (Mesh& mesh : meshes)
+	{
+		const auto trianglesBefore = SortedTriangles(mesh.Indices);
+		const std::vector<Meshlet> meshlets = Meshlets::Build(mesh.Vertices, mesh.Indices);
+		SELFTEST_CHECK(!meshlets.empty());
+		SELFTEST_CHECK(SortedTriangles(mesh.Indices) == trianglesBefore);
+
+		// Contiguous and within the limits, the vertex count is the number of distinct vertices
+		uint32_t nextOffset = 0;
+		bool withinLimits = true;
+		bool spheresContain = true;
+		for (const Meshlet& meshlet : meshlets)
+		{
+			withinLimits &= meshlet.IndexOffset == nextOffset;
+			withinLimits &= meshlet.TriangleCount > 0 && meshlet.TriangleCount <= Meshlets::MAX_TRIANGLES;
+			withinLimits &= meshlet.VertexCount <= Meshlets::MAX_VERTICES;
+			nextOffset += meshlet.TriangleCount * 3;
+
+			std::vector<uint32_t> used(mesh.Indices.begin() + meshlet.IndexOffset, mesh.Indices.begin() + meshlet.IndexOffset + meshlet.TriangleCount * 3);
+			std::sort(used.begin(), used.end());
+			withinLimits &= std::unique(used.begin(), used.end()) - used.begin() == meshlet.VertexCount;
+
+			const XMVECTOR center = XMLoadFloat3(&meshlet.Center);
+			for (uint32_t v : used)
+			{
+				const float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&mesh.Vertices[v].Position), center)));
+				spheresContain &= distance <= meshlet.Radius * (1.f + 1e-5f) + 1e-6f;
+			}
+		}
+		SELFTEST_CHECK(nextOffset == mesh.Indices.size());
+		SELFTEST_CHECK(withinLimits);
+		SELFTEST_CHECK(spheresContain);
+
+		// Eyes around the mesh, near and far: a meshlet the cone culls has no front facing triangle
+		size_t numFrontCulled = 0;
+		size_t numConeCulled = 0;
+		size_t numTested = 0;
+		for (int i = 0; i < 200; ++i)
+		{
+			const XMVECTOR eye = RandomEye(random, 0.2f, 6.f);
+			for (const Meshlet& meshlet : meshlets)
+			{
+				++numTested;
+				if (meshlet.ConeCutoff > 1.f)
+					continue;
+
+				const XMVECTOR view = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&meshlet.ConeApex), eye));
+				if (XMVectorGetX(XMVector3Dot(view, XMLoadFloat3(&meshlet.ConeAxis))) < meshlet.ConeCutoff)
+					continue;
+
+				++numConeCulled;
+				for (uint32_t t = 0; t < meshlet.TriangleCount; ++t)
+					numFrontCulled += IsFrontFacing(mesh.Vertices, &mesh.Indices[meshlet.IndexOffset + t * 3], eye);
+			}
+		}
+		if (!SELFTEST_CHECK(numFrontCulled == 0))
+			std::printf("  %s: %zu front facing triangles culled\n", mesh.Name, numFrontCulled);
+		SELFTEST_CHECK(numConeCulled > numTested / 10); // the cones are tight enough to be worth it
+
+		// Cull keeps every front facing triangle with a vertex in the frustum, looking away it keeps nothing
+		for (int i = 0; i < 20; ++i)
+		{
+			const XMVECTOR eye = RandomEye(random, 2.5f, 6.f);
+			const XMMATRIX viewProjection = ViewProjection(eye, XMVectorZero());
+			const Frustum frustum(viewProjection);
+			const std::vector<MeshletRange> ranges = Meshlets::Cull(meshlets, viewProjection, eye);
+
+			std::vector<bool> drawn(mesh.Indices.size() / 3, false);
+			for (const MeshletRange& range : ranges)
+			{
+				SELFTEST_CHECK(range.IndexOffset + range.IndexCount <= mesh.Indices.size());
+				std::fill(drawn.begin() + range.IndexOffset / 3, drawn.begin() + (range.IndexOffset + range.IndexCount) / 3, true);
+			}
+
+			bool frontDrawn = true;
+			for (size_t t = 0; t < drawn.size(); ++t)
+			{
+				if (drawn[t] || !IsFrontFacing(mesh.Vertices, &mesh.Indices[t * 3], eye))
+					continue;
+				for (size_t v = t * 3; v < t * 3 + 3; ++v)
+					frontDrawn &= !frustum.IntersectsSphere(XMLoadFloat3(&mesh.Vertices[mesh.Indices[v]].Position), 0.f);
+			}
+			SELFTEST_CHECK(frontDrawn);
+			if (mesh.Closed)
+				SELFTEST_CHECK(std::count(drawn.begin(), drawn.end(), true) < (ptrdiff_t)drawn.size());
+
+			SELFTEST_CHECK(Meshlets::Cull(meshlets, ViewProjection(eye, XMVectorScale(eye, 2.f)), eye).empty());
+		}
+	}
+
+	// Cull throughput on a dense sphere, the camera orbiting it
+	{
+		GeometryGenerator::MeshData sphere = generator.CreateSphere(1.f, 512, 256);
+		const std::vector<Meshlet> meshlets = Meshlets::Build(sphere.Vertices, sphere.Indices32);
+
+		constexpr int NUM_CULLS = 1000;
+		size_t numRanges = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < NUM_CULLS; ++i)
+		{
+			const float angle = XM_2PI * i / NUM_CULLS;
+			const XMVECTOR eye = XMVectorSet(3.f * std::cos(angle), 1.f, 3.f * std::sin(angle), 0.f);
+			numRanges += Meshlets::Cull(meshlets, ViewProjection(eye, XMVectorZero()), eye).size();
+		}
+		const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / NUM_CULLS;
+
+		SELFTEST_CHECK(numRanges > 0);
+		std::printf("  Cull: %zu meshlets (%zu triangles) in %.1f us, %.1f M meshlets/s\n",
+			meshlets.size(), sphere.Indices32.size() / 3, us, meshlets.size() / us);
+	}
+}
@@ -0,0 +1,184 @@
+#include "pch.h"
+#include "SelfTest.h"
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	FloatImage CreateImage(uint32_t width, uint32_t height, float (*red)(uint32_t x, uint32_t y))
+	{
+		FloatImage image;
+		image.Width = width;
+		image.Height = height;
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+				image.Pixels.push_back(XMFLOAT4(red(x, y), 0.5f, 0.25f, 1.f));
+		}
+		return image;
+	}
+
+	float MeanRed(const FloatImage& image)
+	{
+		double sum = 0.0;
+		for (const XMFLOAT4& pixel : image.Pixels)
+			sum += pixel.x;
+		return (float)(sum / image.Pixels.size());
+	}
+
+	// the smallest and largest red of the pixels away from the left and right edges
+	void RedRange(const FloatImage& image, float& minimum, float& maximum)
+	{
+		minimum = 1e9f;
+		maximum = -1e9f;
+		for (uint32_t y = 0; y < image.Height; ++y)
+		{
+			for (uint32_t x = 4; x + 4 < image.Width; ++x)
+			{
+				minimum = std::min(minimum, image.Pixels[y * image.Width + x].x);
+				maximum = std::max(maximum, image.Pixels[y * image.Width + x].x);
+			}
+		}
+	}
+}
+
+void SelfTest::TestMipGenerator()
+{
+	SELFTEST_CHECK(MipGenerator::GetMipCount(1, 1) == 1);
+	SELFTEST_CHECK(MipGenerator::GetMipCount(2, 1) == 2);
+	SELFTEST_CHECK(MipGenerator::GetMipCount(257, 3) == 9);
+	SELFTEST_CHECK(MipGenerator::GetMipCount(1024, 1024) == 11);
+
+	// The box filter of an even size is the average of each 2x2 square
+	{
+		std::mt19937 random(45);
+		FloatImage source;
+		source.Width = 8;
+		source.Height = 6;
+		for (int i = 0; i < 48; ++i)
+			source.Pixels.push_back(XMFLOAT4((float)(random() % 100), 0.f, 0.f, 1.f));
+
+		FloatImage target;
+		MipGenerator::Downsample(source, MipFilter::Box, target);
+		SELFTEST_CHECK(target.Width == 4 && target.Height == 3);
+
+		bool averages = true;
+		for (uint32_t y = 0; y < 3; ++y)
+		{
+			for (uint32_t x = 0; x < 4; ++x)
+			{
+				const auto red = [&](uint32_t sx, uint32_t sy) { return source.Pixels[sy * 8 + sx].x; };
+				const float expected = (red(2 * x, 2 * y) + red(2 * x + 1, 2 * y) + red(2 * x, 2 * y + 1) + red(2 * x + 1, 2 * y + 1)) / 4.f;
+				averages &= std::abs(target.Pixels[y * 4 + x].x - expected) < 1e-4f;
+			}
+		}
+		SELFTEST_CHECK(averages);
+	}
+
+	// Odd sizes use the exact footprint: the box filter keeps the mean, both keep a constant
+	{
+		const FloatImage odd = CreateImage(7, 5, [](uint32_t x, uint32_t y) { return (float)((x * 37 + y * 11) % 100); });
+		for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser })
+		{
+			FloatImage target;
+			MipGenerator::Downsample(odd, filter, target);
+			SELFTEST_CHECK(target.Width == 3 && target.Height == 2);
+			SELFTEST_CHECK(std::all_of(target.Pixels.begin(), target.Pixels.end(), [](const XMFLOAT4& p) { return std::abs(p.y - 0.5f) < 1e-5f && std::abs(p.w - 1.f) < 1e-5f; }));
+			if (filter == MipFilter::Box)
+				SELFTEST_CHECK(std::abs(MeanRed(target) - MeanRed(odd)) < 1e-3f);
+		}
+	}
+
+	// The Kaiser filter removes most of what the smaller mip can't represent, the box filter aliases it
+	{
+		const FloatImage checker = CreateImage(64, 64, [](uint32_t x, uint32_t y) { return ((x + y) & 1) ? 1.f : 0.f; });
+		const FloatImage stripes = CreateImage(64, 8, [](uint32_t x, uint32_t) { return (x % 4) < 2 ? 1.f : 0.f; });
+
+		FloatImage box, kaiser;
+		float boxMin, boxMax, kaiserMin, kaiserMax;
+
+		MipGenerator::Downsample(checker, MipFilter::Kaiser, kaiser);
+		RedRange(kaiser, kaiserMin, kaiserMax);
+		SELFTEST_CHECK(kaiserMin > 0.45f && kaiserMax < 0.55f);
+
+		MipGenerator::Downsample(stripes, MipFilter::Box, box);
+		MipGenerator::Downsample(stripes, MipFilter::Kaiser, kaiser);
+		RedRange(box, boxMin, boxMax);
+		RedRange(kaiser, kaiserMin, kaiserMax);
+		SELFTEST_CHECK(boxMax - boxMin > 0.99f);
+		SELFTEST_CHECK(kaiserMax - kaiserMin < 0.8f);
+	}
+
+	// A full chain halves each side down to 1x1
+	{
+		std::vector<FloatImage> mips(1, CreateImage(257, 3, [](uint32_t x, uint32_t) { return x / 256.f; }));
+		MipGenerator::Generate(MipFilter::Kaiser, mips);
+		SELFTEST_CHECK(mips.size() == MipGenerator::GetMipCount(257, 3));
+
+		bool halved = true;
+		for (size_t i = 1; i < mips.size(); ++i)
+		{
+			halved &= mips[i].Width == std::max(mips[i - 1].Width / 2, 1u) && mips[i].Height == std::max(mips[i - 1].Height / 2, 1u);
+			halved &= mips[i].Pixels.size() == (size_t)mips[i].Width * mips[i].Height;
+		}
+		SELFTEST_CHECK(halved);
+		SELFTEST_CHECK(mips.back().Width == 1 && mips.back().Height == 1);
+	}
+
+	// sRGB is filtered in linear space: black and white average to 188, not 128
+	{
+		const uint8_t checker[16] = {
+			0, 0, 0, 255,  255, 255, 255, 255,
+			255, 255, 255, 255,  0, 0, 0, 255,
+		};
+		std::vector<FloatImage> mips(1);
+		MipGenerator::Load(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, checker, 8, 2, 2, mips[0]);
+		MipGenerator::Generate(MipFilter::Box, mips);
+
+		std::vector<uint8_t> stored;
+		MipGenerator::Store(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, mips[1], stored);
+		SELFTEST_CHECK(stored.size() == 4);
+		SELFTEST_CHECK(stored[0] == 188 && stored[1] == 188 && stored[2] == 188 && stored[3] == 255);
+	}
+
+	// The 8 bit formats load and store back the same bytes
+	{
+		std::mt19937 random(46);
+		std::vector<uint8_t> data(64 * 4 * 4);
+		for (uint8_t& value : data)
+			value = (uint8_t)random();
+
+		for (DXGI_FORMAT format : { DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_FORMAT_B8G8R8A8_UNORM_SRGB })
+		{
+			FloatImage image;
+			MipGenerator::Load(format, data.data(), 64 * 4, 64, 4, image);
+			std::vector<uint8_t> stored;
+			MipGenerator::Store(format, image, stored);
+			SELFTEST_CHECK(stored == data);
+		}
+	}
+
+	// The UNORM formats saturate, the float ones only clamp to 0
+	{
+		FloatImage image;
+		image.Width = 2;
+		image.Height = 1;
+		image.Pixels = { XMFLOAT4(1.5f, -2.f, 0.25f, 1.f), XMFLOAT4(100.f, 0.f, 0.f, 0.f) };
+
+		std::vector<uint8_t> stored;
+		MipGenerator::Store(DXGI_FORMAT_R8G8B8A8_UNORM, image, stored);
+		SELFTEST_CHECK(stored[0] == 255 && stored[1] == 0 && stored[4] == 255);
+
+		MipGenerator::Store(DXGI_FORMAT_R16G16B16A16_FLOAT, image, stored);
+		FloatImage loaded;
+		MipGenerator::Load(DXGI_FORMAT_R16G16B16A16_FLOAT, stored.data(), 2 * 8, 2, 1, loaded);
+		SELFTEST_CHECK(loaded.Pixels[0].x == 1.5f && loaded.Pixels[0].y == 0.f && loaded.Pixels[0].z == 0.25f);
+		SELFTEST_CHECK(loaded.Pixels[1].x == 100.f);
+	}
+}
@@ -0,0 +1,112 @@
+#include "pch.h"
+#include "SelfTest.h"
+#include "NodeCostTracker.h"
+
+#include <cmath>
+
+namespace
+{
+	// A node without a graph, only its id and type are read by the tracker
+	class TestNode : public UiNode
+	{
+	public:
+		TestNode(NodeId id) : UiNode(nullptr, UiNodeType::Sine) { Id = id; }
+
+		void OnEvent(Event*) override {}
+		void OnCreate() override {}
+		void OnLoad() override {}
+		void OnUpdate() override {}
+		void OnDelete() override {}
+		void OnRender() override {}
+		void OnEval() override {}
+	};
+
+	// a few microseconds the compiler can't drop
+	float Spin()
+	{
+		volatile float x = 0.f;
+		for (int i = 0; i < 10000; ++i)
+			x = x + std::sin((float)i);
+		return x;
+	}
+
+	void Measure(const UiNode& node, NodeCostKind kind)
+	{
+		NodeCostScope cost(&node, kind);
+		Spin();
+	}
+}
+
+void SelfTest::TestNodeCostTracker()
+{
+	NodeCostTracker& tracker = NodeCostTracker::Get();
+	const bool wasEnabled = tracker.IsEnabled();
+	tracker.SetEnabled(false);
+	tracker.Clear();
+
+	const TestNode node(1000);
+	const TestNode other(1001);
+
+	// disabled, the scopes add nothing and the frames fold nothing
+	Measure(node, NodeCostKind::Eval);
+	{
+		NodeCostScope cost(&node, NodeCostKind::Update);
+		Spin();
+		cost.Stop();
+		cost.Stop();
+	}
+	tracker.BeginFrame();
+	SELFTEST_CHECK(tracker.GetCost(node.Id) == nullptr);
+	SELFTEST_CHECK(tracker.GetHottest(10).empty());
+	SELFTEST_CHECK(tracker.GetHeat(node.Id) == 0.f);
+
+	// enabled, each scope adds its cycles to its kind once, Stop ends it early
+	tracker.SetEnabled(true);
+	Measure(node, NodeCostKind::Eval);
+	{
+		NodeCostScope cost(&other, NodeCostKind::Render);
+		Spin();
+		Spin();
+		cost.Stop();
+		Spin();
+	}
+	const NodeCost* cost = tracker.GetCost(node.Id);
+	if (SELFTEST_CHECK(cost != nullptr))
+	{
+		SELFTEST_CHECK(cost->NumCalls == 1);
+		SELFTEST_CHECK(cost->FrameCycles[(size_t)NodeCostKind::Eval] > 0);
+		SELFTEST_CHECK(cost->FrameCycles[(size_t)NodeCostKind::Update] == 0);
+	}
+	SELFTEST_CHECK(tracker.GetCost(other.Id) != nullptr && tracker.GetCost(other.Id)->NumCalls == 1);
+
+	tracker.BeginFrame();
+	cost = tracker.GetCost(node.Id);
+	if (SELFTEST_CHECK(cost != nullptr))
+	{
+		SELFTEST_CHECK(cost->FrameCycles[(size_t)NodeCostKind::Eval] == 0);
+		SELFTEST_CHECK(cost->AverageMs[(size_t)NodeCostKind::Eval] > 0.0);
+		SELFTEST_CHECK(cost->AverageMs[(size_t)NodeCostKind::Render] == 0.0);
+		SELFTEST_CHECK(cost->MaxMs > 0.0);
+		std::printf("  %.4f ms per spin\n", cost->MaxMs);
+	}
+	SELFTEST_CHECK(tracker.GetHottest(1).size() == 1 && tracker.GetHottest(1)[0].first == other.Id);
+	SELFTEST_CHECK(tracker.GetHeat(other.Id) == 1.f && tracker.GetHeat(node.Id) > 0.f && tracker.GetHeat(node.Id) < 1.f);
+
+	// disabled again, the averages stay as they are
+	tracker.SetEnabled(false);
+	const NodeCost before = *tracker.GetCost(node.Id);
+	Measure(node, NodeCostKind::Eval);
+	tracker.BeginFrame();
+	cost = tracker.GetCost(node.Id);
+	SELFTEST_CHECK(cost->NumCalls == before.NumCalls);
+	SELFTEST_CHECK(cost->FrameCycles[(size_t)NodeCostKind::Eval] == 0);
+	SELFTEST_CHECK(cost->AverageMs[(size_t)NodeCostKind::Eval] == before.AverageMs[(size_t)NodeCostKind::Eval]);
+
+	// enabled again, the stats start over
+	tracker.SetEnabled(true);
+	SELFTEST_CHECK(tracker.GetCost(node.Id) == nullptr && tracker.GetCost(other.Id) == nullptr);
+
+	tracker.SetEnabled(false);
+	tracker.Clear();
+	tracker.SetEnabled(wasEnabled);
+}
@@ -0,0 +1,166 @@
+#include "pch.h"
+#include "SelfTest.h"
+#include "Rendering/RootSignaturePlanner.h"
+#include "Defines.h"
+
+#include <stdexcept>
+
+namespace
+{
+	// a cbuffer of numValues floats, its size rounded up to 16 bytes as the reflection does
+	CBufferLayout MakeCBuffer(const char* name, UINT bindPoint, UINT numValues)
+	{
+		CBufferLayout cbuffer;
+		cbuffer.Name = name;
+		cbuffer.BindPoint = bindPoint;
+		cbuffer.Size = (numValues * 4 + 15) & ~15u;
+		for (UINT i = 0; i < numValues; ++i)
+			cbuffer.Vars.push_back({ "v" + std::to_string(i), "float", i * 4, 4 });
+		return cbuffer;
+	}
+
+	// The cbuffers of Shaders/default.fx and performance_test.fx as the reflection lays them out: a
+	// variable that would cross a 16 bytes register starts the next one, the size is rounded up to 16
+	std::vector<CBufferLayout> MakeDefaultShaderCBuffers()
+	{
+		return {
+			{ "cbPerObject", 0, 64, {
+				{ "World", "float4x4", 0, 64 } } },
+			{ "cbPerFrame", 1, 144, {
+				{ "View", "float4x4", 0, 64 },
+				{ "Proj", "float4x4", 64, 64 },
+				{ "Eye", "float3", 128, 12 } } },
+			{ "cbLight", 2, 48, {
+				{ "ModelColor", "float3", 0, 12 },
+				{ "LightColor", "float3", 16, 12 },
+				{ "LightDirection", "float3", 32, 12 },
+				{ "SpecularPower", "float", 44, 4 } } },
+		};
+	}
+}
+
+void SelfTest::TestRootSignaturePlanner()
+{
+	// default.fx, no texture: the light (12 values, SpecularPower packed after LightDirection) and the
+	// world matrix are root constants, the 35 values of the pass over MAX_ROOT_CONSTANTS_PER_CBUFFER spill
+	{
+		const RootSignatureLayout layout = RootSignaturePlanner::Plan(MakeDefaultShaderCBuffers(), 0);
+
+		SELFTEST_CHECK(layout.CBuffers.size() == 3);
+		SELFTEST_CHECK(layout.CBuffers[0].Binding == CBufferBinding::RootConstants);
+		SELFTEST_CHECK(layout.CBuffers[0].Num32BitValues == 16);
+		SELFTEST_CHECK(layout.CBuffers[1].Binding == CBufferBinding::RootDescriptor);
+		SELFTEST_CHECK(layout.CBuffers[1].Num32BitValues == 35);
+		SELFTEST_CHECK(layout.CBuffers[1].SizeInBytes == 256);
+		SELFTEST_CHECK(layout.CBuffers[2].Binding == CBufferBinding::RootConstants);
+		SELFTEST_CHECK(layout.CBuffers[2].Num32BitValues == 12);
+		SELFTEST_CHECK(layout.NumDWords == 16 + 2 + 12);
+		SELFTEST_CHECK(layout.NumSpilled == 1);
+	}
+
+	// performance_test.fx, the same cbuffers and the table of tex2d
+	{
+		const RootSignatureLayout layout = RootSignaturePlanner::Plan(MakeDefaultShaderCBuffers(), 1);
+
+		SELFTEST_CHECK(layout.CBuffers[0].Binding == CBufferBinding::RootConstants);
+		SELFTEST_CHECK(layout.CBuffers[1].Binding == CBufferBinding::RootDescriptor);
+		SELFTEST_CHECK(layout.CBuffers[2].Binding == CBufferBinding::RootConstants);
+		SELFTEST_CHECK(layout.NumDWords == 1 + 16 + 2 + 12);
+		SELFTEST_CHECK(layout.NumSpilled == 1);
+	}
+
+	// Their variants with cbGenerated (4 floats) also keep it as root constants, within the budget
+	{
+		std::vector<CBufferLayout> cbuffers = MakeDefaultShaderCBuffers();
+		cbuffers.push_back(MakeCBuffer(GENERATED_CBUFFER, GENERATED_CBUFFER_REGISTER, 4));
+		const RootSignatureLayout layout = RootSignaturePlanner::Plan(cbuffers, 1);
+
+		SELFTEST_CHECK(layout.CBuffers[1].Binding == CBufferBinding::RootDescriptor);
+		SELFTEST_CHECK(layout.CBuffers[3].Binding == CBufferBinding::RootConstants);
+		SELFTEST_CHECK(layout.CBuffers[3].Num32BitValues == 4);
+		SELFTEST_CHECK(layout.NumDWords == 1 + 16 + 2 + 12 + 4);
+		SELFTEST_CHECK(layout.NumDWords <= MAX_ROOT_SIGNATURE_DWORDS);
+		SELFTEST_CHECK(layout.NumSpilled == 1);
+	}
+
+	// With 40 tables the world matrix no longer fits the 64 DWORDs and spills too, the light still fits
+	{
+		const RootSignatureLayout layout = RootSignaturePlanner::Plan(MakeDefaultShaderCBuffers(), 40);
+
+		SELFTEST_CHECK(layout.CBuffers[0].Binding == CBufferBinding::RootDescriptor);
+		SELFTEST_CHECK(layout.CBuffers[0].SizeInBytes == 256);
+		SELFTEST_CHECK(layout.CBuffers[1].Binding == CBufferBinding::RootDescriptor);
+		SELFTEST_CHECK(layout.CBuffers[2].Binding == CBufferBinding::RootConstants);
+		SELFTEST_CHECK(layout.NumDWords == 40 + 2 + 2 + 12);
+		SELFTEST_CHECK(layout.NumSpilled == 2);
+	}
+
+	// A usual shader: the world matrix and the material fit as root constants, the pass constants spill
+	{
+		std::vector<CBufferLayout> cbuffers = {
+			MakeCBuffer("PerObject", 0, 16),
+			MakeCBuffer("PerPass", 1, 52),
+			MakeCBuffer("Material", 2, 5),
+		};
+		const RootSignatureLayout layout = RootSignaturePlanner::Plan(cbuffers, 2);
+
+		SELFTEST_CHECK(layout.CBuffers.size() == 3);
+		SELFTEST_CHECK(layout.CBuffers[0].Binding == CBufferBinding::RootConstants);
+		SELFTEST_CHECK(layout.CBuffers[0].Num32BitValues == 16);
+		SELFTEST_CHECK(layout.CBuffers[1].Binding == CBufferBinding::RootDescriptor);
+		SELFTEST_CHECK(layout.CBuffers[1].SizeInBytes == 256);
+		SELFTEST_CHECK(layout.CBuffers[2].Binding == CBufferBinding::RootConstants);
+		SELFTEST_CHECK(layout.CBuffers[2].Num32BitValues == 5); // not the 8 of the padded size
+		SELFTEST_CHECK(layout.NumDWords == 2 + 16 + 2 + 5);
+		SELFTEST_CHECK(layout.NumSpilled == 1);
+	}
+
+	// The smallest cbuffers are placed first, the largest one doesn't fit the budget left
+	{
+		std::vector<CBufferLayout> cbuffers = {
+			MakeCBuffer("A", 0, 16),
+			MakeCBuffer("B", 1, 10),
+			MakeCBuffer("C", 2, 4),
+		};
+		const RootSignatureLayout layout = RootSignaturePlanner::Plan(cbuffers, 40);
+
+		SELFTEST_CHECK(layout.CBuffers[0].Binding == CBufferBinding::RootDescriptor);
+		SELFTEST_CHECK(layout.CBuffers[1].Binding == CBufferBinding::RootConstants);
+		SELFTEST_CHECK(layout.CBuffers[2].Binding == CBufferBinding::RootConstants);
+		SELFTEST_CHECK(layout.NumDWords == 40 + 2 + 10 + 4);
+		SELFTEST_CHECK(layout.NumSpilled == 1);
+	}
+
+	// Equal sizes are placed in their order until the budget runs out, never over it
+	{
+		std::vector<CBufferLayout> cbuffers;
+		for (UINT i = 0; i < 8; ++i)
+			cbuffers.push_back(MakeCBuffer("Equal", i, 16));
+		const RootSignatureLayout layout = RootSignaturePlanner::Plan(cbuffers, 2);
+
+		for (UINT i = 0; i < 8; ++i)
+			SELFTEST_CHECK(layout.CBuffers[i].Binding == (i < 3 ? CBufferBinding::RootConstants : CBufferBinding::RootDescriptor));
+		SELFTEST_CHECK(layout.NumDWords == 2 + 3 * 16 + 5 * 2);
+		SELFTEST_CHECK(layout.NumDWords <= MAX_ROOT_SIGNATURE_DWORDS);
+		SELFTEST_CHECK(layout.NumSpilled == 5);
+	}
+
+	// Too many cbuffers for the root signature even as root CBVs, it logs the error and throws
+	{
+		std::vector<CBufferLayout> cbuffers;
+		for (UINT i = 0; i < MAX_ROOT_SIGNATURE_DWORDS / 2; ++i)
+			cbuffers.push_back(MakeCBuffer("Spilled", i, 64));
+
+		bool thrown = false;
+		try
+		{
+			RootSignaturePlanner::Plan(cbuffers, 1);
+		}
+		catch (const std::runtime_error&)
+		{
+			thrown = true;
+		}
+		SELFTEST_CHECK(thrown);
+		SELFTEST_CHECK(RootSignaturePlanner::Plan(cbuffers, 0).NumSpilled == MAX_ROOT_SIGNATURE_DWORDS / 2);
+	}
+}
@@ -0,0 +1,162 @@
+#include "pch.h"
+#include "SelfTest.h"
+#include "TextureDecoder.h"
+#include "TextureEncoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+namespace
+{
+	uint32_t Rgba(int r, int g, int b, int a)
+	{
+		auto channel = [](int value) { return (uint32_t)std::clamp(value, 0, 255); };
+		return channel(r) | (channel(g) << 8) | (channel(b) << 16) | (channel(a) << 24);
+	}
+
+	// Smooth gradients on every channel, the sizes aren't multiples of the blocks
+	DecodedImage CreateGradients(uint32_t width, uint32_t height)
+	{
+		DecodedImage image;
+		image.Width = width;
+		image.Height = height;
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				image.Pixels.push_back(Rgba(
+					(int)(128 + 100 * std::sin(x * 0.05)),
+					(int)(128 + 100 * std::cos(y * 0.07)),
+					(int)(128 + 120 * std::sin((x + y) * 0.02)),
+					(int)(x * 255 / width)));
+			}
+		}
+		return image;
+	}
+
+	// What the GPU samples from the source: BC1 has no alpha, BC5 only red and green
+	DecodedImage Expected(const DecodedImage& source, DXGI_FORMAT format)
+	{
+		DecodedImage expected = source;
+		for (uint32_t& pixel : expected.Pixels)
+		{
+			if (format == DXGI_FORMAT_BC1_UNORM)
+				pixel |= 0xFF000000;
+			else if (format == DXGI_FORMAT_BC5_UNORM)
+				pixel = (pixel & 0xFFFF) | 0xFF000000;
+		}
+		return expected;
+	}
+}
+
+void SelfTest::TestTextureCodec()
+{
+	// Known blocks: BC1 with the first interpolated color, BC4 with the 2nd of its 8 values (6 * 255 / 7 rounded)
+	{
+		const uint8_t bc1[8] = { 0x00, 0xF8, 0x1F, 0x00, 0xAA, 0xAA, 0xAA, 0xAA };
+		const uint8_t bc4[8] = { 0xFF, 0x00, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49 };
+		uint32_t pixels[16];
+
+		TextureDecoder::Decode(DXGI_FORMAT_BC1_UNORM, bc1, 8, 4, 4, pixels);
+		SELFTEST_CHECK(pixels[0] == 0xFF5500AA && pixels[15] == 0xFF5500AA);
+		TextureDecoder::Decode(DXGI_FORMAT_BC4_UNORM, bc4, 8, 4, 4, pixels);
+		SELFTEST_CHECK(pixels[0] == 0xFF0000DB && pixels[15] == 0xFF0000DB);
+	}
+
+	// Compare on a one channel difference
+	{
+		const DecodedImage a = CreateGradients(64, 64);
+		DecodedImage b = a;
+		b.Pixels[3] ^= 0x10;
+
+		const ImageDiff same = TextureDecoder::Compare(a, a);
+		SELFTEST_CHECK(same.MaxError == 0 && same.NumDifferentPixels == 0 && std::isinf(same.Psnr));
+
+		const ImageDiff diff = TextureDecoder::Compare(a, b);
+		SELFTEST_CHECK(diff.MaxError == 16 && diff.NumDifferentPixels == 1);
+		SELFTEST_CHECK(std::abs(diff.MeanSquaredError - 256.0 / (64 * 64 * 4)) < 1e-9);
+	}
+
+	// Encoded then decoded gradients, the PSNR of each format over the channels it keeps
+	struct FormatQuality
+	{
+		DXGI_FORMAT Format;
+		double MinPsnr;
+		size_t BlockSize;
+	};
+
+	const FormatQuality formats[] = {
+		{ DXGI_FORMAT_BC1_UNORM, 38.0, 8 },
+		{ DXGI_FORMAT_BC3_UNORM, 38.0, 16 },
+		{ DXGI_FORMAT_BC5_UNORM, 50.0, 16 },
+		{ DXGI_FORMAT_BC7_UNORM, 40.0, 16 },
+	};
+
+	constexpr uint32_t WIDTH = 509;
+	constexpr uint32_t HEIGHT = 263;
+	const DecodedImage source = CreateGradients(WIDTH, HEIGHT);
+	const size_t rowPitch = (WIDTH + 3) / 4;
+
+	double bc1Psnr = 0.0;
+	for (const FormatQuality& quality : formats)
+	{
+		SELFTEST_CHECK(TextureEncoder::IsSupported(quality.Format));
+		SELFTEST_CHECK(TextureEncoder::GetEncodedSize(quality.Format, WIDTH, HEIGHT) == rowPitch * ((HEIGHT + 3) / 4) * quality.BlockSize);
+
+		std::vector<uint8_t> data(TextureEncoder::GetEncodedSize(quality.Format, WIDTH, HEIGHT));
+		TextureEncoder::Encode(quality.Format, source.Pixels.data(), WIDTH, HEIGHT, data.data());
+
+		DecodedImage decoded;
+		decoded.Width = WIDTH;
+		decoded.Height = HEIGHT;
+		decoded.Pixels.resize(WIDTH * HEIGHT);
+		TextureDecoder::Decode(quality.Format, data.data(), rowPitch * quality.BlockSize, WIDTH, HEIGHT, decoded.Pixels.data());
+
+		const ImageDiff diff = TextureDecoder::Compare(Expected(source, quality.Format), decoded);
+		if (!SELFTEST_CHECK(diff.Psnr >= quality.MinPsnr))
+			std::printf("  format %d: %.2f dB\n", (int)quality.Format, diff.Psnr);
+
+		if (quality.Format == DXGI_FORMAT_BC1_UNORM)
+			bc1Psnr = diff.Psnr;
+		else if (quality.Format == DXGI_FORMAT_BC7_UNORM)
+			SELFTEST_CHECK(diff.Psnr > bc1Psnr); // the 7 bit endpoints and 16 weights of mode 6
+	}
+
+	// A solid block is exact in BC7, its alpha in BC3
+	{
+		std::vector<uint32_t> solid(16, 0x80402010u);
+		uint8_t block[16];
+		uint32_t pixels[16];
+
+		TextureEncoder::Encode(DXGI_FORMAT_BC7_UNORM, solid.data(), 4, 4, block);
+		TextureDecoder::Decode(DXGI_FORMAT_BC7_UNORM, block, 16, 4, 4, pixels);
+		SELFTEST_CHECK(std::all_of(pixels, pixels + 16, [](uint32_t pixel) { return pixel == 0x80402010u; }));
+
+		TextureEncoder::Encode(DXGI_FORMAT_BC3_UNORM, solid.data(), 4, 4, block);
+		TextureDecoder::Decode(DXGI_FORMAT_BC3_UNORM, block, 16, 4, 4, pixels);
+		SELFTEST_CHECK(std::all_of(pixels, pixels + 16, [](uint32_t pixel) { return (pixel >> 24) == 0x80; }));
+	}
+
+	// The DDS written reads back with the same mip
+	{
+		const std::string path = (std::filesystem::temp_directory_path() / "shadertool_selftest.dds").string();
+		std::vector<std::vector<uint8_t>> mips(1, std::vector<uint8_t>(TextureEncoder::GetEncodedSize(DXGI_FORMAT_BC7_UNORM, WIDTH, HEIGHT)));
+		TextureEncoder::Encode(DXGI_FORMAT_BC7_UNORM, source.Pixels.data(), WIDTH, HEIGHT, mips[0].data());
+
+		DDSFile file;
+		DecodedImage fromFile;
+		if (SELFTEST_CHECK(TextureEncoder::WriteDDS(path, DXGI_FORMAT_BC7_UNORM, WIDTH, HEIGHT, mips)) &&
+			SELFTEST_CHECK(TextureDecoder::ReadDDS(path, file)) &&
+			SELFTEST_CHECK(TextureDecoder::DecodeMip(file, 0, fromFile)))
+		{
+			std::vector<uint32_t> decoded(WIDTH * HEIGHT);
+			TextureDecoder::Decode(DXGI_FORMAT_BC7_UNORM, mips[0].data(), rowPitch * 16, WIDTH, HEIGHT, decoded.data());
+			SELFTEST_CHECK(file.Format == DXGI_FORMAT_BC7_UNORM && file.Width == WIDTH && file.Height == HEIGHT && file.MipOffsets.size() == 1);
+			SELFTEST_CHECK(fromFile.Pixels == decoded);
+		}
+		std::remove(path.c_str());
+	}
+}
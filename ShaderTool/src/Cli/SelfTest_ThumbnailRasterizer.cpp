@@ -0,0 +1,162 @@
+#include "pch.h"
+#include "SelfTest.h"
+#include "ThumbnailRasterizer.h"
+#include "Defines.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Unit UV sphere, the faces are clockwise seen from the outside
+	void CreateSphere(uint32_t slices, uint32_t stacks, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		for (uint32_t i = 0; i <= stacks; ++i)
+		{
+			const float phi = XM_PI * i / stacks;
+			for (uint32_t j = 0; j <= slices; ++j)
+			{
+				const float theta = XM_2PI * j / slices;
+				Vertex vertex;
+				vertex.Position = XMFLOAT3(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+				vertex.Normal = vertex.Position;
+				vertices.push_back(vertex);
+			}
+		}
+
+		for (uint32_t i = 0; i < stacks; ++i)
+		{
+			for (uint32_t j = 0; j < slices; ++j)
+			{
+				const uint32_t a = i * (slices + 1) + j;
+				const uint32_t c = a + slices + 1;
+				indices.insert(indices.end(), { a, a + 1, c, c, a + 1, c + 1 });
+			}
+		}
+	}
+
+	uint32_t Alpha(uint32_t pixel) { return pixel >> 24; }
+	uint32_t Red(uint32_t pixel) { return pixel & 0xFF; }
+
+	// no row has a gap between its first and last covered pixels
+	bool RowsWithoutHoles(const std::vector<uint32_t>& pixels, uint32_t size)
+	{
+		for (uint32_t y = 0; y < size; ++y)
+		{
+			int first = -1, last = -1, count = 0;
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				if (Alpha(pixels[y * size + x]))
+				{
+					if (first < 0)
+						first = x;
+					last = x;
+					++count;
+				}
+			}
+			if (count && count != last - first + 1)
+				return false;
+		}
+		return true;
+	}
+}
+
+void SelfTest::TestThumbnailRasterizer()
+{
+	constexpr uint32_t SIZE = 128;
+	std::vector<uint32_t> pixels(SIZE * SIZE);
+
+	// The camera distance fits the bounding sphere to the field of view, a sphere fills the disk inscribed in the image
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	CreateSphere(64, 64, vertices, indices);
+	const auto sphere = ThumbnailRasterizer::CreatePreviewMesh(vertices, indices, {});
+	SELFTEST_CHECK(sphere->Indices.size() == indices.size());
+	SELFTEST_CHECK(sphere->Positions.size() == vertices.size());
+
+	ThumbnailRasterizer::Render(*sphere, 0.6f, SIZE, pixels.data());
+
+	const float center = SIZE * 0.5f;
+	uint32_t numCovered = 0;
+	bool insideDisk = true;
+	bool opaqueGray = true;
+	for (uint32_t y = 0; y < SIZE; ++y)
+	{
+		for (uint32_t x = 0; x < SIZE; ++x)
+		{
+			const uint32_t pixel = pixels[y * SIZE + x];
+			if (!pixel)
+				continue;
+
+			++numCovered;
+			insideDisk &= std::hypot(x + 0.5f - center, y + 0.5f - center) <= center + 1.f;
+			// the ambient light is the darkest shade
+			opaqueGray &= Alpha(pixel) == 0xFF && Red(pixel) == ((pixel >> 8) & 0xFF) && Red(pixel) == ((pixel >> 16) & 0xFF) && Red(pixel) >= 51;
+		}
+	}
+
+	const float diskArea = XM_PI * center * center;
+	SELFTEST_CHECK(std::abs(numCovered - diskArea) < diskArea * 0.03f);
+	SELFTEST_CHECK(insideDisk);
+	SELFTEST_CHECK(opaqueGray);
+	SELFTEST_CHECK(RowsWithoutHoles(pixels, SIZE));
+	SELFTEST_CHECK(pixels[0] == 0 && pixels[SIZE - 1] == 0 && pixels[SIZE * SIZE - 1] == 0);
+
+	// lit from above the viewer: the top of the sphere is brighter than its bottom
+	const uint32_t top = pixels[(SIZE / 8) * SIZE + SIZE / 2];
+	const uint32_t bottom = pixels[(SIZE - SIZE / 8) * SIZE + SIZE / 2];
+	SELFTEST_CHECK(Alpha(top) && Alpha(bottom) && Red(top) > Red(bottom));
+
+	// the tiles rendered by the workers give the same image every time
+	{
+		std::vector<uint32_t> again(SIZE * SIZE);
+		ThumbnailRasterizer::Render(*sphere, 0.6f, SIZE, again.data());
+		SELFTEST_CHECK(again == pixels);
+	}
+
+	// A quad facing the camera: the 2 triangles share their diagonal without gaps, reversed they are culled
+	{
+		std::vector<Vertex> quad(4);
+		const XMFLOAT3 corners[4] = { { -1.f, -1.f, 0.f }, { -1.f, 1.f, 0.f }, { 1.f, 1.f, 0.f }, { 1.f, -1.f, 0.f } };
+		for (int i = 0; i < 4; ++i)
+		{
+			quad[i].Position = corners[i];
+			quad[i].Normal = XMFLOAT3(0.f, 0.f, -1.f);
+		}
+
+		std::vector<uint32_t> quadIndices = { 0, 1, 2, 0, 2, 3 };
+		ThumbnailRasterizer::Render(*ThumbnailRasterizer::CreatePreviewMesh(quad, quadIndices, {}), 0.f, SIZE, pixels.data());
+		size_t quadCovered = 0;
+		for (uint32_t pixel : pixels)
+			quadCovered += Alpha(pixel) != 0;
+		SELFTEST_CHECK(quadCovered > 0);
+		SELFTEST_CHECK(RowsWithoutHoles(pixels, SIZE));
+
+		quadIndices = { 0, 2, 1, 0, 3, 2 };
+		ThumbnailRasterizer::Render(*ThumbnailRasterizer::CreatePreviewMesh(quad, quadIndices, {}), 0.f, SIZE, pixels.data());
+		bool culled = true;
+		for (uint32_t pixel : pixels)
+			culled &= pixel == 0;
+		SELFTEST_CHECK(culled);
+	}
+
+	// Meshes over PREVIEW_MAX_TRIANGLES use their finest LOD that fits, with only the vertices it uses
+	{
+		std::vector<Vertex> denseVertices;
+		std::vector<uint32_t> denseIndices;
+		CreateSphere(256, 256, denseVertices, denseIndices);
+		SELFTEST_CHECK(denseIndices.size() / 3 > PREVIEW_MAX_TRIANGLES);
+
+		// the top half of the sphere
+		std::vector<MeshSimplifier::Lod> lods(1);
+		lods[0].Indices.assign(denseIndices.begin(), denseIndices.begin() + denseIndices.size() / 2);
+		SELFTEST_CHECK(lods[0].Indices.size() / 3 <= PREVIEW_MAX_TRIANGLES);
+
+		const auto preview = ThumbnailRasterizer::CreatePreviewMesh(denseVertices, denseIndices, lods);
+		SELFTEST_CHECK(preview->Indices.size() == lods[0].Indices.size());
+		SELFTEST_CHECK(preview->Positions.size() == 129 * 257);
+		SELFTEST_CHECK(preview->Sphere.Center.y > 0.f);
+	}
+}
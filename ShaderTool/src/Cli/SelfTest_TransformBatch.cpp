@@ -0,0 +1,85 @@
+#include "pch.h"
+#include "SelfTest.h"
+#include "TransformBatch.h"
+#include "Editor\UiNode\TransformNode.h"
+
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Same bits, except for the sign of the zeros: XMMatrixMultiply adds the +0 products of the
+	// identity entries where the batch keeps a -0
+	bool SameValues(const XMFLOAT4X4& a, const XMFLOAT4X4& b)
+	{
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				if (a.m[row][column] != b.m[row][column])
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+void SelfTest::TestTransformBatch()
+{
+	// The node evaluates on its own, without a graph
+	TransformNode node(nullptr);
+
+	// Enough transforms to be split between the threads, not a multiple of 4 so the last group is padded.
+	// The angles cover all the quadrants, whole turns and some large values.
+	constexpr size_t COUNT = 100003;
+	std::mt19937 random(36);
+	std::uniform_real_distribution<float> position(-100.f, 100.f);
+	std::uniform_real_distribution<float> angle(-7.f, 7.f);
+	std::uniform_real_distribution<float> scale(-4.f, 4.f);
+
+	std::vector<XMFLOAT3> positions(COUNT), rotations(COUNT), scales(COUNT);
+	for (size_t i = 0; i < COUNT; ++i)
+	{
+		positions[i] = XMFLOAT3(position(random), position(random), position(random));
+		rotations[i] = XMFLOAT3(angle(random), angle(random), angle(random));
+		scales[i] = XMFLOAT3(scale(random), scale(random), scale(random));
+	}
+	rotations[0] = XMFLOAT3(0.f, 0.f, 0.f);
+	rotations[1] = XMFLOAT3(XM_PIDIV2, -XM_PIDIV2, XM_PI);
+	rotations[2] = XMFLOAT3(XM_2PI, -XM_2PI, 1000.f);
+	rotations[3] = XMFLOAT3(-1000.f, 12345.f, -XM_PI);
+	scales[4] = XMFLOAT3(0.f, 0.f, 0.f);
+
+	TransformBatch batch;
+	for (size_t i = 0; i < COUNT; ++i)
+		SELFTEST_CHECK(batch.Add(positions[i], rotations[i], scales[i]) == i);
+	batch.Evaluate();
+	SELFTEST_CHECK(batch.GetSize() == COUNT);
+
+	size_t numMismatches = 0;
+	for (size_t i = 0; i < COUNT; ++i)
+	{
+		node.PositionNodeValue->Value = positions[i];
+		node.RotationNodeValue->Value = rotations[i];
+		node.ScaleNodeValue->Value = scales[i];
+		node.OnEval();
+
+		if (!SameValues(batch.GetWorld(i), node.OutputNodeValue->Value))
+			++numMismatches;
+	}
+	SELFTEST_CHECK(numMismatches == 0);
+
+	// a batch reused for fewer transforms, evaluated on the calling thread
+	batch.Clear();
+	SELFTEST_CHECK(batch.GetSize() == 0);
+	batch.Add(positions[5], rotations[5], scales[5]);
+	batch.Evaluate();
+
+	node.PositionNodeValue->Value = positions[5];
+	node.RotationNodeValue->Value = rotations[5];
+	node.ScaleNodeValue->Value = scales[5];
+	node.OnEval();
+	SELFTEST_CHECK(SameValues(batch.GetWorld(0), node.OutputNodeValue->Value));
+}
@@ -0,0 +1,113 @@
+#include "pch.h"
+#include "SelfTest.h"
+#include "Rendering/VertexFormat.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	XMFLOAT3 RandomDirection(std::mt19937& random)
+	{
+		std::normal_distribution<float> normal;
+		XMFLOAT3 direction;
+		XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(normal(random), normal(random), normal(random), 0.f)));
+		return direction;
+	}
+
+	// the chord between unit vectors, the same as the angle when it is small (acos isn't precise there)
+	float DirectionError(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&a), XMLoadFloat3(&b))));
+	}
+}
+
+void SelfTest::TestVertexFormat()
+{
+	SELFTEST_CHECK(VertexFormats::GetVertexStride(VertexFormat::Full) == 44);
+	SELFTEST_CHECK(VertexFormats::GetVertexStride(VertexFormat::Packed) == 20);
+	SELFTEST_CHECK(VertexFormats::CreateInputLayout(VertexFormat::Packed).size() == 4);
+	SELFTEST_CHECK(VertexFormats::CreateInputLayout(VertexFormat::Packed, true).size() == 8);
+
+	// Random vertices in a box, the decoded ones must be within the precision of each packed attribute
+	constexpr size_t COUNT = 100000;
+	std::mt19937 random(30);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+	std::vector<Vertex> vertices(COUNT);
+	for (Vertex& vertex : vertices)
+	{
+		vertex.Position = XMFLOAT3(-3.f + 6.f * unit(random), -1.f + 2.f * unit(random), 2.f + 10.f * unit(random));
+		vertex.Normal = RandomDirection(random);
+		vertex.TangentU = RandomDirection(random);
+		vertex.TexC = XMFLOAT2(unit(random), unit(random));
+	}
+	// the axes and the poles of the octahedron
+	vertices[0].Normal = XMFLOAT3(0.f, 0.f, -1.f);
+	vertices[1].Normal = XMFLOAT3(0.f, 0.f, 1.f);
+	vertices[2].Normal = XMFLOAT3(1.f, 0.f, 0.f);
+	vertices[3].Normal = XMFLOAT3(0.f, -1.f, 0.f);
+
+	const VertexQuantization quantization = VertexFormats::ComputeQuantization(vertices.data(), vertices.size());
+	std::vector<PackedVertex> packed(COUNT);
+	VertexFormats::EncodeVertices(vertices.data(), vertices.size(), quantization, packed.data());
+	std::vector<Vertex> decoded(COUNT);
+	VertexFormats::DecodeVertices(packed.data(), packed.size(), quantization, decoded.data());
+
+	// position: half a step of 16 bits over the extent of the mesh, plus the float rounding of coordinates up to 12
+	constexpr float FLOAT_ROUNDING = 12.f * FLT_EPSILON;
+	const XMFLOAT3 positionBound(
+		quantization.Extent.x * (0.5f / 65535.f) + FLOAT_ROUNDING,
+		quantization.Extent.y * (0.5f / 65535.f) + FLOAT_ROUNDING,
+		quantization.Extent.z * (0.5f / 65535.f) + FLOAT_ROUNDING);
+
+	float maxNormalError = 0.f;
+	float maxTexCError = 0.f;
+	bool positionsInBound = true;
+	for (size_t i = 0; i < COUNT; ++i)
+	{
+		const Vertex& a = vertices[i];
+		const Vertex& b = decoded[i];
+
+		positionsInBound &= std::abs(a.Position.x - b.Position.x) <= positionBound.x;
+		positionsInBound &= std::abs(a.Position.y - b.Position.y) <= positionBound.y;
+		positionsInBound &= std::abs(a.Position.z - b.Position.z) <= positionBound.z;
+
+		maxNormalError = std::max(maxNormalError, DirectionError(a.Normal, b.Normal));
+		maxNormalError = std::max(maxNormalError, DirectionError(a.TangentU, b.TangentU));
+
+		// half floats have 11 bits of mantissa, UVs in [0, 1] are within 2^-12
+		maxTexCError = std::max(maxTexCError, std::abs(a.TexC.x - b.TexC.x));
+		maxTexCError = std::max(maxTexCError, std::abs(a.TexC.y - b.TexC.y));
+	}
+
+	SELFTEST_CHECK(quantization.Min.x >= -3.f && quantization.Extent.x <= 6.f);
+	SELFTEST_CHECK(positionsInBound);
+	// 16 bit octahedral directions are within 0.01 degree
+	SELFTEST_CHECK(maxNormalError < XMConvertToRadians(0.01f));
+	SELFTEST_CHECK(maxTexCError <= 1.f / 4096.f);
+
+	// a flat mesh keeps its flat axis exactly
+	{
+		Vertex flat[2];
+		flat[0].Position = XMFLOAT3(1.f, 5.f, 2.f);
+		flat[1].Position = XMFLOAT3(3.f, 5.f, 4.f);
+		flat[0].Normal = flat[1].Normal = flat[0].TangentU = flat[1].TangentU = XMFLOAT3(0.f, 1.f, 0.f);
+		flat[0].TexC = flat[1].TexC = XMFLOAT2(0.f, 0.f);
+
+		const VertexQuantization flatQuantization = VertexFormats::ComputeQuantization(flat, 2);
+		SELFTEST_CHECK(flatQuantization.Extent.y == 0.f);
+
+		PackedVertex flatPacked[2];
+		Vertex flatDecoded[2];
+		VertexFormats::EncodeVertices(flat, 2, flatQuantization, flatPacked);
+		VertexFormats::DecodeVertices(flatPacked, 2, flatQuantization, flatDecoded);
+		SELFTEST_CHECK(flatDecoded[0].Position.y == 5.f && flatDecoded[1].Position.y == 5.f);
+		SELFTEST_CHECK(flatDecoded[1].Position.x == 3.f && flatDecoded[1].Position.z == 4.f);
+	}
+}
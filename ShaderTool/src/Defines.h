@@ -20,9 +20,87 @@ constexpr uint32_t RENDER_TARGET_HEIGHT = 1024;
 constexpr int NUM_BACK_BUFFERS = 3;
 constexpr int NUM_FRAMES = 3;
 
+// Staging memory available per frame in flight, bigger uploads get a dedicated upload heap
+constexpr uint64_t UPLOAD_RING_SIZE_PER_FRAME = 8 * 1024 * 1024;
+
+// Root signature budget: root constants cost one DWORD per value, root CBVs 2 and tables 1.
+// Cbuffers over MAX_ROOT_CONSTANTS_PER_CBUFFER values are always spilled to root CBVs.
+constexpr uint32_t MAX_ROOT_SIGNATURE_DWORDS = 64;
+constexpr uint32_t MAX_ROOT_CONSTANTS_PER_CBUFFER = 16;
+
+// Initial size of the shared vertex/index buffers, they grow when a model doesn't fit
+constexpr uint32_t GEOMETRY_POOL_VERTEX_CAPACITY = 256 * 1024;
+constexpr uint32_t GEOMETRY_POOL_INDEX_CAPACITY = 1024 * 1024;
+
+// Store the models as PackedVertex (quantized, about half the size), the shaders have to
+// decode the vertices with packed_vertex.hlsli
+constexpr bool PACKED_VERTICES = false;
+
+// Full resolution + simplified levels (50/25/12% of the triangles) generated at import
+constexpr uint32_t MAX_MODEL_LODS = 4;
+
+// Models covering at least this fraction of the viewport height use LOD 0, the next LOD
+// is used each time the size halves
+constexpr float LOD_SCREEN_SIZE = 0.5f;
+
+// Limits of the parameters of the primitive nodes and number of generated primitives
+// kept in the cache once no node uses them
+constexpr uint32_t MAX_PRIMITIVE_TESSELLATION = 1024;
+constexpr uint32_t MAX_PRIMITIVE_SUBDIVISIONS = 6;
+constexpr uint32_t MAX_GEOSPHERE_SUBDIVISIONS = 8;
+constexpr size_t PRIMITIVE_CACHE_CAPACITY = 16;
+
+// Node previews rendered on the CPU (ThumbnailRasterizer) into one atlas texture, the previews
+// use a copy of the finest LOD of each model with at most PREVIEW_MAX_TRIANGLES
+constexpr uint32_t THUMBNAIL_SIZE = 128;
+constexpr uint32_t THUMBNAIL_ATLAS_COLUMNS = 8; // 8x8 thumbnails
+constexpr uint32_t MAX_THUMBNAILS_PER_FRAME = 4;
+constexpr uint32_t PREVIEW_MAX_TRIANGLES = 64 * 1024;
+
+// PNG/TGA/HDR files opened by the texture nodes are converted to DDS in this folder (ImageImporter),
+// the color images to BC7 or, when false, to BC1/BC3 which encode faster
+constexpr char* TEXTURE_CACHE_DIR = "texture_cache";
+constexpr bool IMPORT_COLOR_AS_BC7 = true;
+
+// CPU zones (PROFILE_SCOPE) kept per thread for the profiler window (F4) and the trace export,
+// when false the zones compile to nothing. The ring size must be a power of 2.
+constexpr bool PROFILER_ENABLED = true;
+constexpr uint32_t PROFILER_RING_SIZE = 16 * 1024;
+constexpr uint32_t PROFILER_MAX_FRAMES = 256;
+constexpr char* PROFILER_TRACE_FILE = "profile_trace.json"; // chrome://tracing or ui.perfetto.dev
+
+// Node costs (F5): frames in the moving averages, nodes listed as the hottest and CSV export file
+constexpr uint32_t NODE_COST_AVERAGE_FRAMES = 60;
+constexpr uint32_t NODE_COST_TOP_N = 10;
+constexpr char* NODE_COST_CSV_FILE = "node_costs.csv";
+
+// Step of the FixedStep and Deterministic clock modes picked in the Clock menu
+constexpr double FRAME_CLOCK_FIXED_STEP = 1.0 / 60.0;
+
+// Graph edits recorded by the editor (F6) and replayed by the command line runner (--replay)
+constexpr char* JOURNAL_FILE = "journal.stj";
+
+// Instances generated by an InstancesNode, uploaded when they change (64 bytes each)
+constexpr uint32_t MAX_INSTANCES = 1024 * 1024;
+
 constexpr char* BACKBUFFER_VS = "backbuffer_vs.cso";
 constexpr char* DEFAULT_SHADER_FILE = "default.fx";
 constexpr char* DEFAULT_SHADER = "default";
+// Project saved by the editor (S/L keys) and loaded by the command line runner by default
+constexpr char* PROJECT_FILE = "node_graph.txt";
+constexpr char* EDITOR_STATE_FILE = "node_graph.ini"; // imnodes positions, editor only
+
+constexpr char* VERTEX_QUANTIZATION_CBUFFER = "cbVertexQuantization"; // filled by the app, not exposed as pins
+
+// Root constants read by the shader variants generated from the node graph (b8 is cbVertexQuantization),
+// in another register when the shader already binds this one
+constexpr char* GENERATED_CBUFFER = "cbGenerated";
+constexpr uint32_t GENERATED_CBUFFER_REGISTER = 7;
+
+// Shader variables the meshlet culling reads the camera from
+constexpr char* WORLD_MATRIX_VAR = "World";
+constexpr char* VIEW_MATRIX_VAR = "View";
+constexpr char* PROJECTION_MATRIX_VAR = "Proj";
 
 const static int INVALID_ID = -1;
 const static int NOT_LINKED = -1;
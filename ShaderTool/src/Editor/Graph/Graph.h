@@ -65,6 +65,7 @@ public:
     void DeleteNodeValue(int nodeId);
     void StoreNodeValue(int nodeId, std::shared_ptr<NodeValue> value);
     std::shared_ptr<NodeValue>& GetNodeValue(int nodeId);
+    const std::unordered_map<int, std::shared_ptr<NodeValue>>& GetNodeValues() const { return _NodeValueStorage; }
 
     
     friend std::ostream& operator<<(std::ostream& out, const Graph& g)
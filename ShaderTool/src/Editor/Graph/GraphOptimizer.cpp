@@ -0,0 +1,220 @@
+#include "pch.h"
+#include "GraphOptimizer.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+// the outputs only depend on the inputs, no time, camera or resources
+static bool IsPure(NodeType type)
+{
+    switch (type)
+    {
+    case NodeType::Add:
+    case NodeType::Multiply:
+    case NodeType::Sine:
+    case NodeType::Scalar:
+    case NodeType::Color:
+    case NodeType::Vector2:
+    case NodeType::Vector3:
+    case NodeType::Vector4:
+    case NodeType::Matrix4x4:
+    case NodeType::Transform:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// scalar and color have no inputs, each one is a value edited in the ui
+static bool IsMergeable(NodeType type)
+{
+    return IsPure(type) && type != NodeType::Scalar && type != NodeType::Color;
+}
+
+struct UiNodePins
+{
+    std::vector<int> Inputs;
+    std::vector<int> Outputs;
+};
+
+GraphStructure GraphOptimizer::GetStructure(const Graph& graph, int rootId)
+{
+    return { graph.GetCurrentId(), graph.GetNodesCount(), graph.GetEdgesCount(), rootId };
+}
+
+EvaluationPlan GraphOptimizer::Optimize(Graph& graph, int rootId, const std::function<void(int)>& evaluateFolded)
+{
+    EvaluationPlan plan;
+    if (rootId == INVALID_ID)
+        return plan;
+
+    // pins of each uinode, in creation order, and the output pin linked to each input pin
+    std::unordered_map<int, UiNodePins> pins;
+    std::unordered_map<int, int> pinOwner;   // output pin -> uinode
+    std::unordered_map<int, int> linkSource; // input pin -> output pin
+    for (const Edge& edge : graph.GetEdges())
+    {
+        if (edge.type == EdgeType::External)
+        {
+            linkSource[edge.from] = edge.to;
+        }
+        else if (graph.GetNode(edge.from).Direction == NodeDirection::None)
+        {
+            pins[edge.from].Inputs.push_back(edge.to);
+        }
+        else
+        {
+            pins[edge.to].Outputs.push_back(edge.from);
+            pinOwner[edge.from] = edge.to;
+        }
+    }
+
+    std::unordered_map<int, std::vector<int>> dependencies; // once per link, as the old traversal
+    for (auto& [id, nodePins] : pins)
+    {
+        std::sort(nodePins.Inputs.begin(), nodePins.Inputs.end());
+        std::sort(nodePins.Outputs.begin(), nodePins.Outputs.end());
+
+        auto& nodeDependencies = dependencies[id];
+        for (int pin : nodePins.Inputs)
+        {
+            auto source = linkSource.find(pin);
+            if (source == linkSource.end())
+                continue;
+            auto owner = pinOwner.find(source->second);
+            if (owner != pinOwner.end())
+                nodeDependencies.push_back(owner->second);
+        }
+    }
+
+    // Postorder from the root, every node after its dependencies and the unreachable ones left out.
+    // A link closing a cycle is ignored.
+    std::vector<int> order;
+    std::unordered_map<int, size_t> position;
+    {
+        std::unordered_set<int> visited{ rootId };
+        std::vector<std::pair<int, size_t>> stack{ { rootId, 0 } };
+        while (!stack.empty())
+        {
+            const int id = stack.back().first;
+            const auto& nodeDependencies = dependencies[id];
+            if (stack.back().second < nodeDependencies.size())
+            {
+                const int dependency = nodeDependencies[stack.back().second++];
+                if (visited.insert(dependency).second)
+                    stack.push_back({ dependency, 0 });
+                continue;
+            }
+
+            position[id] = order.size();
+            order.push_back(id);
+            stack.pop_back();
+        }
+    }
+
+    // The unoptimized traversal has no visited set, a node is evaluated once per path to the root
+    {
+        std::unordered_map<int, size_t> numPaths{ { rootId, 1 } };
+        for (auto it = order.rbegin(); it != order.rend(); ++it)
+        {
+            const size_t paths = numPaths[*it];
+            plan.NumTraversed += paths;
+            for (int dependency : dependencies[*it])
+            {
+                if (position[dependency] < position[*it])
+                    numPaths[dependency] += paths;
+            }
+        }
+    }
+
+    // Constant folding, pure nodes whose dependencies are all folded
+    std::unordered_set<int> folded;
+    for (int id : order)
+    {
+        bool constant = IsPure(graph.GetNode(id).Type);
+        for (int dependency : dependencies[id])
+            constant = constant && folded.count(dependency) > 0;
+
+        if (!constant)
+            continue;
+
+        folded.insert(id);
+        plan.Folded.push_back(id);
+        evaluateFolded(id);
+    }
+
+    // Merging, the key of a node is its type and, per input pin, the linked output pin (the pin of
+    // the node it was merged with), the value of a folded output or the value of the unlinked pin.
+    auto appendValue = [&graph](std::string& key, int pin)
+    {
+        auto& value = graph.GetNodeValue(pin);
+        if (!value)
+        {
+            key.append(reinterpret_cast<const char*>(&pin), sizeof(pin));
+            return;
+        }
+        const size_t size = HlslNodeType::Get()->GetNum32BitValues(graph.GetNode(pin).Type) * sizeof(uint32_t);
+        key.append(static_cast<const char*>(value->GetValuePtr()), size);
+    };
+
+    std::unordered_map<int, int> mergedPins;     // output pin of a merged node -> pin evaluated in its place
+    std::unordered_map<std::string, int> merged; // key -> first node evaluated with it
+    for (int id : order)
+    {
+        if (folded.count(id) > 0)
+            continue;
+
+        plan.Updated.insert(id);
+
+        EvaluationStep step{ id };
+        const NodeType type = graph.GetNode(id).Type;
+        if (IsMergeable(type))
+        {
+            std::string key(reinterpret_cast<const char*>(&type), sizeof(type));
+            for (int pin : pins[id].Inputs)
+            {
+                auto source = linkSource.find(pin);
+                if (source == linkSource.end())
+                {
+                    key += 'u';
+                    appendValue(key, pin);
+                    continue;
+                }
+
+                auto owner = pinOwner.find(source->second);
+                if (owner != pinOwner.end() && folded.count(owner->second) > 0)
+                {
+                    key += 'c';
+                    appendValue(key, source->second);
+                    continue;
+                }
+
+                auto mergedPin = mergedPins.find(source->second);
+                const int sourcePin = mergedPin != mergedPins.end() ? mergedPin->second : source->second;
+                key += 'l';
+                key.append(reinterpret_cast<const char*>(&sourcePin), sizeof(sourcePin));
+            }
+
+            auto [first, inserted] = merged.emplace(std::move(key), id);
+            if (!inserted)
+            {
+                step.MergedWith = first->second;
+
+                // nodes of the same type create their pins in the same order
+                const auto& outputs = pins[id].Outputs;
+                const auto& firstOutputs = pins[first->second].Outputs;
+                for (size_t i = 0; i < outputs.size() && i < firstOutputs.size(); ++i)
+                {
+                    step.MergedOutputs.push_back({ outputs[i], firstOutputs[i] });
+                    mergedPins[outputs[i]] = firstOutputs[i];
+                }
+                ++plan.NumMerged;
+            }
+        }
+
+        plan.Steps.push_back(std::move(step));
+    }
+
+    return plan;
+}
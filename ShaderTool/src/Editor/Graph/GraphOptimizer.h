@@ -0,0 +1,53 @@
+#pragma once
+
+#include <functional>
+#include <utility>
+#include <vector>
+#include <unordered_set>
+
+#include "Graph.h"
+#include "Defines.h"
+
+// The nodes and links of the graph, the plan is rebuilt when any of them changes
+struct GraphStructure
+{
+    int CurrentId{ -1 };
+    size_t NumNodes{ 0 };
+    size_t NumEdges{ 0 };
+    int RootId{ -1 };
+
+    bool operator==(const GraphStructure& rhs) const
+    {
+        return CurrentId == rhs.CurrentId && NumNodes == rhs.NumNodes && NumEdges == rhs.NumEdges && RootId == rhs.RootId;
+    }
+
+    bool operator!=(const GraphStructure& rhs) const { return !(*this == rhs); }
+};
+
+struct EvaluationStep
+{
+    int NodeId;
+    int MergedWith{ INVALID_ID }; // equivalent node evaluated before, its outputs are copied instead of evaluating this one
+    std::vector<std::pair<int, int>> MergedOutputs; // output pin, pin of MergedWith
+};
+
+// Uinodes to update and evaluate each frame, dependencies first
+struct EvaluationPlan
+{
+    std::vector<int> Folded;            // no time varying input, evaluated once when the plan is built
+    std::vector<EvaluationStep> Steps;  // evaluated every frame
+    std::unordered_set<int> Updated;    // reachable from the root and not folded, the others skip OnUpdate
+
+    size_t NumTraversed{ 0 };           // evaluations of the unoptimized traversal, shared nodes count once per path
+    size_t NumMerged{ 0 };
+};
+
+namespace GraphOptimizer
+{
+    GraphStructure GetStructure(const Graph& graph, int rootId);
+
+    // Dead nodes (not reaching the root) are dropped, the subgraphs made only of pure nodes without
+    // a time input are folded and pure nodes with the same inputs are merged.
+    // evaluateFolded is called for each folded node, in order, so its outputs are known when merging.
+    EvaluationPlan Optimize(Graph& graph, int rootId, const std::function<void(int)>& evaluateFolded);
+}
\ No newline at end of file
@@ -0,0 +1,486 @@
+#include "pch.h"
+#include "HlslGenerator.h"
+#include "Defines.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <regex>
+#include <unordered_map>
+#include <unordered_set>
+
+// Output of a node in the generated code
+struct HlslValue
+{
+    NodeType Type{ NodeType::None }; // Float to Float4
+    bool IsConstant{ false };
+    float Constant[4]{};
+    std::string Code;                // input or local variable when not constant
+    bool IsMath{ false };            // an input alone isn't worth a shader variant
+};
+
+static std::string GetTypeName(NodeType type)
+{
+    return HlslNodeType::Get()->GetHlslType(type).TypeName;
+}
+
+static std::string FormatFloat(float value)
+{
+    if (!std::isfinite(value))
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        std::stringstream ss;
+        ss << "asfloat(0x" << std::hex << bits << ")";
+        return ss.str();
+    }
+
+    // the shortest text read back as the same float
+    std::string text;
+    for (int precision = 6; precision <= 9; ++precision)
+    {
+        std::stringstream ss;
+        ss << std::setprecision(precision) << value;
+        text = ss.str();
+        if (std::strtof(text.c_str(), nullptr) == value)
+            break;
+    }
+
+    if (text.find_first_of(".e") == std::string::npos)
+        text += ".0";
+    return text;
+}
+
+// Statements of one generated function, a node linked to several pins is computed once
+class HlslFunctionBuilder
+{
+public:
+    explicit HlslFunctionBuilder(Graph& graph) : _Graph(graph) {}
+
+    // false when the subgraph has nodes that can't be translated or a cycle
+    bool Build(int outputPin, HlslValue& value);
+
+    // literal of a constant value, the variable otherwise
+    std::string Expression(const HlslValue& value);
+
+    const std::vector<std::string>& GetStatements() const { return _Statements; }
+    const std::vector<HlslInput>& GetInputs() const { return _Inputs; }
+    size_t GetNumMathNodes() const { return _NumMathNodes; }
+    size_t GetNumInlinedConstants() const { return _NumInlinedConstants; }
+
+private:
+    bool BuildNode(int node, int outputPin, HlslValue& value);
+
+private:
+    Graph& _Graph;
+    std::unordered_map<int, HlslValue> _Values; // uinode -> its output
+    std::unordered_set<int> _Visiting;
+    std::vector<std::string> _Statements;
+    std::vector<HlslInput> _Inputs;
+    size_t _NumMathNodes{ 0 };
+    size_t _NumInlinedConstants{ 0 };
+};
+
+bool HlslFunctionBuilder::Build(int outputPin, HlslValue& value)
+{
+    auto owners = _Graph.GetNeighbors(outputPin);
+    if (owners.size() != 1ull)
+        return false;
+
+    const int node = *owners.begin();
+    auto it = _Values.find(node);
+    if (it != _Values.end())
+    {
+        value = it->second;
+        return true;
+    }
+
+    if (!_Visiting.insert(node).second)
+        return false;
+
+    const bool built = BuildNode(node, outputPin, value);
+    _Visiting.erase(node);
+
+    if (built)
+        _Values[node] = value;
+    return built;
+}
+
+std::string HlslFunctionBuilder::Expression(const HlslValue& value)
+{
+    if (!value.IsConstant)
+        return value.Code;
+
+    ++_NumInlinedConstants;
+    const UINT numComponents = HlslNodeType::Get()->GetNum32BitValues(value.Type);
+    if (numComponents == 1)
+        return FormatFloat(value.Constant[0]);
+
+    std::string code = GetTypeName(value.Type) + "(";
+    for (UINT i = 0; i < numComponents; ++i)
+        code += (i > 0 ? ", " : "") + FormatFloat(value.Constant[i]);
+    return code + ")";
+}
+
+bool HlslFunctionBuilder::BuildNode(int node, int outputPin, HlslValue& value)
+{
+    const NodeType type = _Graph.GetNode(node).Type;
+    size_t numInputs = 0;
+    switch (type)
+    {
+    case NodeType::Time:
+    case NodeType::Scalar:
+    case NodeType::Color:
+    {
+        // they change every frame or from the ui, the shader reads them from root constants
+        value.Type = _Graph.GetNode(outputPin).Type;
+        value.Code = std::string(magic_enum::enum_name(type)) + "_" + std::to_string(node);
+        _Inputs.push_back({ value.Code, GetTypeName(value.Type), outputPin });
+        return true;
+    }
+    case NodeType::Sine:
+        numInputs = 1;
+        break;
+    case NodeType::Add:
+    case NodeType::Multiply:
+    case NodeType::Vector2:
+        numInputs = 2;
+        break;
+    case NodeType::Vector3:
+        numInputs = 3;
+        break;
+    case NodeType::Vector4:
+        numInputs = 4;
+        break;
+    default:
+        return false;
+    }
+
+    auto pinsSpan = _Graph.GetNeighbors(node);
+    std::vector<int> pins(pinsSpan.begin(), pinsSpan.end());
+    std::sort(pins.begin(), pins.end()); // creation order
+    if (pins.size() != numInputs)
+        return false;
+
+    // the nodes copying their inputs in OnEval read 0 from an unlinked pin, the others keep the typed value
+    const bool unlinkedIsZero = type != NodeType::Vector2 && type != NodeType::Vector3;
+
+    // a vector typed in the node is an input as it is, the node stays evaluated on the cpu
+    if (!unlinkedIsZero && std::all_of(pins.begin(), pins.end(), [this](int pin) { return _Graph.GetNeighbors(pin).size() == 0ull; }))
+    {
+        value.Type = _Graph.GetNode(outputPin).Type;
+        value.Code = std::string(magic_enum::enum_name(type)) + "_" + std::to_string(node);
+        _Inputs.push_back({ value.Code, GetTypeName(value.Type), outputPin });
+        return true;
+    }
+
+    std::vector<HlslValue> args(numInputs);
+    bool constant = true;
+    for (size_t i = 0; i < numInputs; ++i)
+    {
+        auto links = _Graph.GetNeighbors(pins[i]);
+        if (links.size() == 0ull && unlinkedIsZero)
+        {
+            args[i].Type = NodeType::Float;
+            args[i].IsConstant = true;
+            args[i].Constant[0] = 0.f;
+        }
+        else if (links.size() == 0ull)
+        {
+            // edited in the node, the shader reads the pin from root constants so the widget keeps working
+            args[i].Type = NodeType::Float;
+            args[i].Code = std::string(magic_enum::enum_name(type)) + "_" + std::to_string(node) + "_" + "xyzw"[i];
+            _Inputs.push_back({ args[i].Code, GetTypeName(NodeType::Float), pins[i] });
+        }
+        else if (!Build(*links.begin(), args[i]))
+        {
+            return false;
+        }
+
+        if (args[i].Type != NodeType::Float)
+            return false;
+        constant = constant && args[i].IsConstant;
+    }
+
+    ++_NumMathNodes;
+    value.IsMath = true;
+    value.IsConstant = constant;
+    value.Type = type == NodeType::Vector2 ? NodeType::Float2
+        : type == NodeType::Vector3 ? NodeType::Float3
+        : type == NodeType::Vector4 ? NodeType::Float4
+        : NodeType::Float;
+
+    // reduced here with the same float operations as the nodes
+    if (constant)
+    {
+        switch (type)
+        {
+        case NodeType::Add:
+            value.Constant[0] = args[0].Constant[0] + args[1].Constant[0];
+            break;
+        case NodeType::Multiply:
+            value.Constant[0] = args[0].Constant[0] * args[1].Constant[0];
+            break;
+        case NodeType::Sine:
+            value.Constant[0] = std::abs(std::sin(args[0].Constant[0]));
+            break;
+        default:
+            for (size_t i = 0; i < numInputs; ++i)
+                value.Constant[i] = args[i].Constant[0];
+            break;
+        }
+        return true;
+    }
+
+    std::string code;
+    switch (type)
+    {
+    case NodeType::Add:
+        code = Expression(args[0]) + " + " + Expression(args[1]);
+        break;
+    case NodeType::Multiply:
+        code = Expression(args[0]) + " * " + Expression(args[1]);
+        break;
+    case NodeType::Sine:
+        code = "abs(sin(" + Expression(args[0]) + "))";
+        break;
+    default:
+        code = GetTypeName(value.Type) + "(";
+        for (size_t i = 0; i < numInputs; ++i)
+            code += (i > 0 ? ", " : "") + Expression(args[i]);
+        code += ")";
+        break;
+    }
+
+    value.Code = "n" + std::to_string(node);
+    _Statements.push_back(GetTypeName(value.Type) + " " + value.Code + " = " + code + ";");
+    return true;
+}
+
+struct CBufferDeclaration
+{
+    size_t Line;
+    std::string TypeName;
+    std::string Name;
+    size_t CBuffer;
+};
+
+struct ShaderText
+{
+    std::vector<std::string> Lines;
+    std::vector<CBufferDeclaration> Declarations; // variables declared in the cbuffers, in order
+    size_t NumCBuffers{ 0 };
+    size_t LastCBufferEnd{ 0 };                   // line of the closing brace
+    std::vector<uint32_t> CBufferRegisters;       // register(bN) of the declarations
+};
+
+static ShaderText ParseShader(const std::string& source)
+{
+    ShaderText text;
+    std::stringstream ss(source);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        text.Lines.push_back(line);
+    }
+
+    static const std::regex cbufferRegex("\\bcbuffer\\b");
+    static const std::regex declarationRegex("^\\s*(\\w+)\\s+(\\w+)\\s*;\\s*$");
+    static const std::regex registerRegex("\\bregister\\s*\\(\\s*b(\\d+)");
+
+    bool inCBuffer = false;
+    int depth = 0;
+    for (size_t i = 0; i < text.Lines.size(); ++i)
+    {
+        const std::string code = text.Lines[i].substr(0, text.Lines[i].find("//"));
+        for (std::sregex_iterator it(code.begin(), code.end(), registerRegex); it != std::sregex_iterator(); ++it)
+            text.CBufferRegisters.push_back((uint32_t)std::stoul((*it)[1]));
+
+        if (!inCBuffer && std::regex_search(code, cbufferRegex))
+        {
+            inCBuffer = true;
+            depth = 0;
+        }
+
+        if (!inCBuffer)
+            continue;
+
+        std::smatch match;
+        if (std::regex_match(code, match, declarationRegex))
+            text.Declarations.push_back({ i, match[1], match[2], text.NumCBuffers });
+
+        for (char c : code)
+        {
+            if (c == '{')
+                ++depth;
+            else if (c == '}' && --depth == 0)
+            {
+                inCBuffer = false;
+                text.LastCBufferEnd = i;
+                ++text.NumCBuffers;
+            }
+        }
+    }
+    return text;
+}
+
+// Replaces the uses of a variable, not the members with the same name
+static void ReplaceIdentifier(std::string& line, const std::string& name, const std::string& replacement)
+{
+    auto isIdentifier = [](char c) { return std::isalnum((unsigned char)c) || c == '_'; };
+
+    size_t pos = 0;
+    while ((pos = line.find(name, pos)) != std::string::npos)
+    {
+        const size_t end = pos + name.size();
+        const bool startsWord = pos == 0 || (!isIdentifier(line[pos - 1]) && line[pos - 1] != '.');
+        const bool endsWord = end == line.size() || !isIdentifier(line[end]);
+        if (startsWord && endsWord)
+        {
+            line.replace(pos, name.size(), replacement);
+            pos += replacement.size();
+        }
+        else
+        {
+            pos = end;
+        }
+    }
+}
+
+// The offsets come from the reflection, HLSL starts a new 16 bytes register for a variable that would
+// cross one. The largest go first so the smaller fill the end of the registers.
+static std::vector<HlslInput> PackInputs(std::vector<HlslInput> inputs)
+{
+    auto getSize = [](const HlslInput& input) { return HlslNodeType::Get()->GetNum32BitValues(input.TypeName); };
+    std::stable_sort(inputs.begin(), inputs.end(), [&](const HlslInput& a, const HlslInput& b) { return getSize(a) > getSize(b); });
+    return inputs;
+}
+
+// GENERATED_CBUFFER_REGISTER when it's free, the first free register otherwise
+static bool FindFreeRegister(const std::vector<uint32_t>& usedRegisters, uint32_t& freeRegister)
+{
+    auto isUsed = [&](uint32_t r) { return std::find(usedRegisters.begin(), usedRegisters.end(), r) != usedRegisters.end(); };
+    if (!isUsed(GENERATED_CBUFFER_REGISTER))
+    {
+        freeRegister = GENERATED_CBUFFER_REGISTER;
+        return true;
+    }
+
+    for (uint32_t r = 0; r < D3D12_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT; ++r)
+    {
+        if (!isUsed(r))
+        {
+            freeRegister = r;
+            return true;
+        }
+    }
+    return false;
+}
+
+GeneratedShader HlslGenerator::Generate(Graph& graph, const std::vector<HlslBinding>& bindings, const std::string& source,
+    const std::vector<uint32_t>& usedRegisters)
+{
+    GeneratedShader generated;
+    generated.Source = source;
+
+    ShaderText text = ParseShader(source);
+    if (text.NumCBuffers == 0)
+        return generated;
+
+    std::stringstream functions;
+    std::vector<HlslInput> inputs;
+    std::unordered_set<int> inputPins;
+    for (const auto& binding : bindings)
+    {
+        // declared in an include or with a packoffset
+        auto declaration = std::find_if(text.Declarations.begin(), text.Declarations.end(),
+            [&](const CBufferDeclaration& d) { return d.Name == binding.VarName; });
+        if (declaration == text.Declarations.end() || declaration->TypeName != binding.VarTypeName)
+            continue;
+
+        auto links = graph.GetNeighbors(binding.PinId);
+        if (links.size() != 1ull)
+            continue;
+
+        HlslFunctionBuilder builder(graph);
+        HlslValue value;
+        if (!builder.Build(*links.begin(), value) || !value.IsMath || GetTypeName(value.Type) != binding.VarTypeName)
+            continue;
+
+        const std::string function = "Generated_" + binding.VarName;
+        functions << "\n" << binding.VarTypeName << " " << function << "()\n{\n";
+        for (const auto& statement : builder.GetStatements())
+            functions << "    " << statement << "\n";
+        functions << "    return " << builder.Expression(value) << ";\n}\n";
+
+        for (const auto& input : builder.GetInputs())
+        {
+            if (inputPins.insert(input.SourcePin).second)
+                inputs.push_back(input);
+        }
+
+        generated.GeneratedVars.push_back(binding.VarName);
+        generated.NumMathNodes += builder.GetNumMathNodes();
+        generated.NumInlinedConstants += builder.GetNumInlinedConstants();
+    }
+
+    if (generated.GeneratedVars.empty())
+        return generated;
+
+    generated.Inputs = PackInputs(inputs);
+
+    std::vector<uint32_t> registers = usedRegisters;
+    registers.insert(registers.end(), text.CBufferRegisters.begin(), text.CBufferRegisters.end());
+    if (!generated.Inputs.empty() && !FindFreeRegister(registers, generated.CBufferRegister))
+    {
+        generated = GeneratedShader();
+        generated.Source = source;
+        generated.Error = "no free cbuffer register for " + std::string(GENERATED_CBUFFER);
+        return generated;
+    }
+
+    // The declarations are commented out, the variables left in the cbuffer take their new offsets
+    // from the reflection of the variant.
+    for (const auto& declaration : text.Declarations)
+    {
+        if (std::find(generated.GeneratedVars.begin(), generated.GeneratedVars.end(), declaration.Name) == generated.GeneratedVars.end())
+            continue;
+
+        std::string& line = text.Lines[declaration.Line];
+        const std::string indent = line.substr(0, line.find_first_not_of(" \t"));
+        line = indent + "// " + line.substr(indent.size()) + " computed by Generated_" + declaration.Name + "()";
+    }
+
+    std::stringstream out;
+    for (size_t i = 0; i < text.Lines.size(); ++i)
+    {
+        std::string line = text.Lines[i];
+        if (i > text.LastCBufferEnd)
+        {
+            for (const auto& var : generated.GeneratedVars)
+                ReplaceIdentifier(line, var, "Generated_" + var + "()");
+        }
+        out << line << "\n";
+
+        if (i != text.LastCBufferEnd)
+            continue;
+
+        out << "\n// Generated from the node graph\n";
+        if (!generated.Inputs.empty())
+        {
+            out << "cbuffer " << GENERATED_CBUFFER << " : register(b" << generated.CBufferRegister << ")\n{\n";
+            for (const auto& input : generated.Inputs)
+                out << "    " << input.TypeName << " " << input.Name << ";\n";
+            out << "}\n";
+        }
+        out << functions.str();
+    }
+
+    generated.Source = out.str();
+    return generated;
+}
\ No newline at end of file
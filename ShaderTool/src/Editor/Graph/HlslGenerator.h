@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Graph.h"
+#include "Defines.h"
+
+// cbuffer variable of a shader and the draw node pin bound to it
+struct HlslBinding
+{
+    std::string VarName;
+    std::string VarTypeName;
+    int PinId;
+};
+
+// Variable of the generated cbuffer set as root constants: the output of a time, scalar or color node,
+// or of a vector node without links, or a component typed in a vector node (SourcePin is then its input pin)
+struct HlslInput
+{
+    std::string Name;
+    std::string TypeName;
+    int SourcePin;
+};
+
+struct GeneratedShader
+{
+    std::string Source;
+    std::vector<std::string> GeneratedVars; // cbuffer variables now computed by the shader
+    std::vector<HlslInput> Inputs;          // in declaration order, the largest first
+    uint32_t CBufferRegister{ GENERATED_CBUFFER_REGISTER }; // of cbGenerated, when there are inputs
+    std::string Error;                      // nothing is generated, the shader has no free cbuffer register
+    size_t NumMathNodes{ 0 };               // nodes no longer evaluated on the cpu
+    size_t NumInlinedConstants{ 0 };        // constant nodes and unlinked pins written as literals
+};
+
+// Translates the math nodes (add, multiply, sine and vectors) linked to the cbuffer variables of a
+// shader into HLSL functions. The subgraphs without time or ui inputs are reduced to literals, the values
+// edited in the nodes stay bound to their pins.
+// Only depends on the graph, the output is plain text.
+namespace HlslGenerator
+{
+    // The bindings that can't be translated, or are linked to an input without math, are left as they are.
+    // cbGenerated takes GENERATED_CBUFFER_REGISTER, or the first register neither in usedRegisters (the
+    // cbuffers of the reflection, with those of the includes) nor declared in the source.
+    GeneratedShader Generate(Graph& graph, const std::vector<HlslBinding>& bindings, const std::string& source,
+        const std::vector<uint32_t>& usedRegisters = {});
+}
\ No newline at end of file
@@ -35,7 +35,8 @@ enum class NodeType
     Matrix4x4,
     Model,
     Texture,
-    Transform
+    Transform,
+    Instances
 };
 
 // None for uinode ids
@@ -143,6 +144,7 @@ struct NodeValue
 
     virtual void SetValuePtr(void*) = 0;
     virtual void* GetValuePtr() = 0;
+    virtual size_t GetValueSize() const = 0; // bytes at GetValuePtr
 
     virtual std::ostream& Serialize(std::ostream& out) const
     {
@@ -181,6 +183,7 @@ public:
 
     virtual void SetValuePtr(void* newValue) override { Value = *(int*)newValue; }
     virtual void* GetValuePtr() override { return &Value; }
+    virtual size_t GetValueSize() const override { return sizeof(Value); }
 
     virtual std::ostream& Serialize(std::ostream& out) const override
     {
@@ -210,6 +213,7 @@ public:
 
     virtual void SetValuePtr(void* newValue) override { Value = *(float*)newValue; }
     virtual void* GetValuePtr() override { return &Value; }
+    virtual size_t GetValueSize() const override { return sizeof(Value); }
 
     virtual std::ostream& Serialize(std::ostream& out) const override
     {
@@ -240,6 +244,7 @@ public:
 
     virtual void SetValuePtr(void* newValue) override { Value = *(DirectX::XMFLOAT4X4*)newValue; }
     virtual void* GetValuePtr() override { return &Value; }
+    virtual size_t GetValueSize() const override { return sizeof(Value); }
 
     virtual std::ostream& Serialize(std::ostream& out) const override
     {
@@ -276,6 +281,7 @@ public:
 
     virtual void SetValuePtr(void* newValue) override { Value = *(DirectX::XMFLOAT4*)newValue; }
     virtual void* GetValuePtr() override { return &Value; }
+    virtual size_t GetValueSize() const override { return sizeof(Value); }
 
     virtual std::ostream& Serialize(std::ostream& out) const override
     {
@@ -306,6 +312,7 @@ public:
 
     virtual void SetValuePtr(void* newValue) override { Value = *(DirectX::XMFLOAT3*)newValue; }
     virtual void* GetValuePtr() override { return &Value; }
+    virtual size_t GetValueSize() const override { return sizeof(Value); }
 
     virtual std::ostream& Serialize(std::ostream& out) const override
     {
@@ -336,6 +343,7 @@ public:
 
     virtual void SetValuePtr(void* newValue) override { Value = *(DirectX::XMFLOAT2*)newValue; }
     virtual void* GetValuePtr() override { return &Value; }
+    virtual size_t GetValueSize() const override { return sizeof(Value); }
 
     virtual std::ostream& Serialize(std::ostream& out) const override
     {
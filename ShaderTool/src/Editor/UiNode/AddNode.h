@@ -73,7 +73,7 @@ public:
         CopyValueFromLinkedSource(LeftPin, (void*)&defaultValue);
         CopyValueFromLinkedSource(RightPin, (void*)&defaultValue);
 
-        OutputNodeValue->Value = LeftNodeValue->Value * RightNodeValue->Value;
+        OutputNodeValue->Value = LeftNodeValue->Value + RightNodeValue->Value;
     }
 
     virtual void OnRender() override
@@ -114,37 +114,20 @@ void CameraNode::OnEval()
     // U, L already ortho-normal, so no need to normalize cross product.
     R = XMVector3Cross(U, L);
 
-    // Fill in the view matrix entries.
-    float x = -XMVectorGetX(XMVector3Dot(P, R));
-    float y = -XMVectorGetX(XMVector3Dot(P, U));
-    float z = -XMVectorGetX(XMVector3Dot(P, L));
-
     XMStoreFloat3(&RightNodeValue->Value, R);
     XMStoreFloat3(&UpNodeValue->Value, U);
     XMStoreFloat3(&TargetOutNodeValue->Value, L);
 
-    ViewNodeValue->Value(0, 0) = RightNodeValue->Value.x;
-    ViewNodeValue->Value(1, 0) = RightNodeValue->Value.y;
-    ViewNodeValue->Value(2, 0) = RightNodeValue->Value.z;
-    ViewNodeValue->Value(3, 0) = x;
-
-    ViewNodeValue->Value(0, 1) = UpNodeValue->Value.x;
-    ViewNodeValue->Value(1, 1) = UpNodeValue->Value.y;
-    ViewNodeValue->Value(2, 1) = UpNodeValue->Value.z;
-    ViewNodeValue->Value(3, 1) = y;
-
-    ViewNodeValue->Value(0, 2) = TargetOutNodeValue->Value.x;
-    ViewNodeValue->Value(1, 2) = TargetOutNodeValue->Value.y;
-    ViewNodeValue->Value(2, 2) = TargetOutNodeValue->Value.z;
-    ViewNodeValue->Value(3, 2) = z;
-
-    ViewNodeValue->Value(0, 3) = 0.0f;
-    ViewNodeValue->Value(1, 3) = 0.0f;
-    ViewNodeValue->Value(2, 3) = 0.0f;
-    ViewNodeValue->Value(3, 3) = 1.0f;
+    // The view matrix has the axes as columns and -(P.R, P.U, P.L) as last row, the 3 dot products
+    // are done at once on the columns, summed in the same order as XMVector3Dot.
+    XMMATRIX view = XMMatrixTranspose(XMMATRIX(R, U, L, g_XMIdentityR3));
+    XMVECTOR eye = XMVectorMultiply(XMVectorSplatX(P), view.r[0]);
+    eye = XMVectorAdd(eye, XMVectorMultiply(XMVectorSplatY(P), view.r[1]));
+    eye = XMVectorAdd(eye, XMVectorMultiply(XMVectorSplatZ(P), view.r[2]));
+    view.r[3] = XMVectorSelect(g_XMIdentityR3, XMVectorNegate(eye), g_XMSelect1110);
 
-    XMMATRIX view = XMMatrixTranspose( XMLoadFloat4x4(&ViewNodeValue->Value) );
-    XMStoreFloat4x4(&ViewNodeValue->Value, view);
+    // stored transposed, like the other matrices read by the shaders
+    XMStoreFloat4x4(&ViewNodeValue->Value, XMMatrixTranspose(view));
 
     // Build the projection matrix
     auto aspectRatio = static_cast<float>(RENDER_TARGET_WIDTH) / RENDER_TARGET_HEIGHT;
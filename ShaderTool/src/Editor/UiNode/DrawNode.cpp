@@ -4,16 +4,20 @@
 #include "Rendering/ShaderManager.h"
 #include "Events/EventManager.h"
 #include "Events/Event.h"
+#include "NodeCostTracker.h"
+
+#include <algorithm>
 
 using namespace DirectX;
 
 DrawNode::DrawNode(Graph* graph)
-    : UiNode(graph, UiNodeType::Draw), ModelPin(INVALID_ID), ShaderPin(INVALID_ID), OutputPin(INVALID_ID)
+    : UiNode(graph, UiNodeType::Draw), ModelPin(INVALID_ID), ShaderPin(INVALID_ID), InstancesPin(INVALID_ID), OutputPin(INVALID_ID)
 {
     EVENT_MANAGER.Attach(this);
     
     ShaderNodeValue = std::make_shared<NodeValueInt>(INVALID_INDEX);
     ModelNodeValue = std::make_shared<NodeValueInt>(INVALID_INDEX);
+    InstancesNodeValue = std::make_shared<NodeValueInt>(INVALID_INDEX);
     OutputNodeValue = std::make_shared<NodeValueInt>(INVALID_INDEX);
 }
 
@@ -61,16 +65,19 @@ void DrawNode::OnCreate()
     const Node indexNodeIn(NodeType::Int, NodeDirection::In);
     ShaderPin = ParentGraph->CreateNode(indexNodeIn);
     ModelPin = ParentGraph->CreateNode(indexNodeIn);
+    InstancesPin = ParentGraph->CreateNode(indexNodeIn);
 
     const Node textureIndexNodeOut(NodeType::Int, NodeDirection::Out);
     OutputPin = ParentGraph->CreateNode(textureIndexNodeOut);
 
     ParentGraph->CreateEdge(Id, ShaderPin, EdgeType::Internal);
     ParentGraph->CreateEdge(Id, ModelPin, EdgeType::Internal);
+    ParentGraph->CreateEdge(Id, InstancesPin, EdgeType::Internal);
     ParentGraph->CreateEdge(OutputPin, Id, EdgeType::Internal);
 
     ParentGraph->StoreNodeValue(ShaderPin, ShaderNodeValue);
     ParentGraph->StoreNodeValue(ModelPin, ModelNodeValue);
+    ParentGraph->StoreNodeValue(InstancesPin, InstancesNodeValue);
     ParentGraph->StoreNodeValue(OutputPin, OutputNodeValue);
 }
 
@@ -78,6 +85,7 @@ void DrawNode::OnLoad()
 {
     ParentGraph->StoreNodeValue(ShaderPin, ShaderNodeValue);
     ParentGraph->StoreNodeValue(ModelPin, ModelNodeValue);
+    ParentGraph->StoreNodeValue(InstancesPin, InstancesNodeValue);
     ParentGraph->StoreNodeValue(OutputPin, OutputNodeValue);
 }
 
@@ -85,6 +93,7 @@ void DrawNode::OnDelete()
 {
     ParentGraph->EraseNode(ModelPin);
     ParentGraph->EraseNode(ShaderPin);
+    ParentGraph->EraseNode(InstancesPin);
     ParentGraph->EraseNode(OutputPin);
 
     ClearShaderBindings();
@@ -93,9 +102,14 @@ void DrawNode::OnDelete()
 void DrawNode::OnRender() 
 {
     const float node_width = 200.0f;
-    ImNodes::PushColorStyle(ImNodesCol_TitleBar, IM_COL32(11, 109, 191, 255));
-    ImNodes::PushColorStyle(ImNodesCol_TitleBarHovered, IM_COL32(81, 148, 204, 255));
-    ImNodes::PushColorStyle(ImNodesCol_TitleBarSelected, IM_COL32(81, 148, 204, 255));
+    // the title bar shows the cost of the node while it's measured
+    const bool showCost = NodeCostTracker::Get().IsEnabled();
+    if (!showCost)
+    {
+        ImNodes::PushColorStyle(ImNodesCol_TitleBar, IM_COL32(11, 109, 191, 255));
+        ImNodes::PushColorStyle(ImNodesCol_TitleBarHovered, IM_COL32(81, 148, 204, 255));
+        ImNodes::PushColorStyle(ImNodesCol_TitleBarSelected, IM_COL32(81, 148, 204, 255));
+    }
     //ImNodes::PushColorStyle(ImNodesCol_NodeOutline, IM_COL32(255, 255, 0, 255));
     ImNodes::BeginNode(Id);
 
@@ -133,6 +147,15 @@ void DrawNode::OnRender()
         ImNodes::EndInputAttribute();
     }
 
+    ImGui::Spacing();
+
+    {
+        // linked to an InstancesNode the model is drawn once per instance in a single draw
+        ImNodes::BeginInputAttribute(InstancesPin);
+        ImGui::TextUnformatted("instances");
+        ImNodes::EndInputAttribute();
+    }
+
     // SHADER BINDINGS
 
     ImGui::Spacing();
@@ -161,9 +184,12 @@ void DrawNode::OnRender()
     ImGui::Spacing();
 
     ImNodes::EndNode();
-    ImNodes::PopColorStyle();
-    ImNodes::PopColorStyle();
-    ImNodes::PopColorStyle();
+    if (!showCost)
+    {
+        ImNodes::PopColorStyle();
+        ImNodes::PopColorStyle();
+        ImNodes::PopColorStyle();
+    }
 }
 
 void DrawNode::OnUpdate()
@@ -181,6 +207,8 @@ void DrawNode::OnEval()
     if (!CopyValueFromLinkedSource(ModelPin, (void*)&INVALID_INDEX))
         isReadyToRender = false;
 
+    CopyValueFromLinkedSource(InstancesPin, (void*)&INVALID_INDEX); // optional
+
     // SHADER BINDING PINS
     for (auto& bindPin : ShaderBindingPins)
     {
@@ -254,6 +282,9 @@ void DrawNode::CreateShaderBindingPins(int shaderIndex)
     // get the constant buffer vars expected by the current shader
     for (auto& var : shader->GetBindingVars())
     {
+        if (var.BindName == VERTEX_QUANTIZATION_CBUFFER)
+            continue; // set from the model when drawing
+
         ShaderBindingPin bindPin;
         bindPin.Bind = var;
 
@@ -352,6 +383,40 @@ void DrawNode::CreateShaderBindingPins(int shaderIndex)
         ShaderBindingPinNameMap[var.VarName] = ShaderBindingPins.size() - 1;
         ShaderBindingPinIdMap[pinId] = ShaderBindingPins.size() - 1;
     }
+
+    SyncedShaderIndex = shaderIndex;
+}
+
+// The binds loaded with a project keep the root parameters and offsets they were saved with,
+// they are taken again from the shader the first time it is drawn
+void DrawNode::SyncShaderBindings(int shaderIndex)
+{
+    if (shaderIndex == SyncedShaderIndex)
+        return;
+
+    Shader* shader = ShaderManager::Get()->GetShader((size_t)shaderIndex);
+    if (!shader)
+        return;
+
+    auto& vars = shader->GetBindingVars();
+    for (auto& bindPin : ShaderBindingPins)
+    {
+        auto var = std::find_if(vars.begin(), vars.end(), [&bindPin](const ShaderBind& v) {
+            return v.VarName == bindPin.Bind.VarName && v.VarTypeName == bindPin.Bind.VarTypeName;
+        });
+
+        if (var != vars.end())
+        {
+            bindPin.Bind = *var;
+        }
+        else
+        {
+            LOG_WARN("Shader variable {0} ({1}) not found, the pin is not bound", bindPin.Bind.VarName, bindPin.Bind.VarTypeName);
+            bindPin.Bind.RootParameterIndex = UINT_MAX;
+        }
+    }
+
+    SyncedShaderIndex = shaderIndex;
 }
 
 void DrawNode::ClearShaderBindings()
@@ -365,6 +430,8 @@ void DrawNode::ClearShaderBindings()
     ShaderBindingPins.clear();
     ShaderBindingPinNameMap.clear();
     ShaderBindingPinIdMap.clear();
+    SyncedShaderIndex = INVALID_INDEX;
+    Constants.reset();
 }
 
 // `from` and `to` are backwards
@@ -2,6 +2,7 @@
 
 #include "UiNode.h"
 #include "Rendering/Shader.h"
+#include "Rendering/ConstantStaging.h"
 
 #include <vector>
 #include <unordered_map>
@@ -20,15 +21,18 @@ struct DrawNode : UiNode
 private:
     
 public:
-    NodeId ModelPin, ShaderPin, OutputPin;
+    NodeId ModelPin, ShaderPin, InstancesPin, OutputPin;
     
     std::shared_ptr<NodeValueInt> ShaderNodeValue;
     std::shared_ptr<NodeValueInt> ModelNodeValue;
+    std::shared_ptr<NodeValueInt> InstancesNodeValue; // InstancesNode id, a single draw when not linked
     std::shared_ptr<NodeValueInt> OutputNodeValue;
 
     std::vector<ShaderBindingPin>           ShaderBindingPins;
     std::unordered_map<std::string, size_t> ShaderBindingPinNameMap;
     std::unordered_map<NodeId, size_t>      ShaderBindingPinIdMap;
+    int                                     SyncedShaderIndex{ INVALID_INDEX }; // shader the binds were taken from
+    std::unique_ptr<ConstantStaging>        Constants; // values of the pins uploaded last, created when drawn
 
 public:
     DrawNode(Graph* graph);
@@ -44,15 +48,18 @@ public:
 
     void CreateShaderBindingPins(int shaderIndex);
     void ClearShaderBindings();
+    void SyncShaderBindings(int shaderIndex);
     void OnShaderLinkCreate(int from, int to);
     void OnShaderLinkDelete(int from, int to);
     void OnLinkedShaderUpdate(int newShaderIndex);
     void OnLinkedTextureUpdate(int newTextureIndex);
+
+    bool IsInstanced() const { return InstancesNodeValue->Value != INVALID_INDEX; }
     
     virtual std::ostream& Serialize(std::ostream& out) const
     {
         UiNode::Serialize(out);
-        out << " " << ModelPin << " " << ShaderPin << " " << OutputPin << " " << ShaderBindingPins.size();
+        out << " " << ModelPin << " " << ShaderPin << " " << InstancesPin << " " << OutputPin << " " << ShaderBindingPins.size();
         for (auto& bindPin : ShaderBindingPins)
         {
             out << "\n";
@@ -65,7 +72,7 @@ public:
     {
         Type = UiNodeType::Draw;
         size_t numShaderBindings;
-        in >> Id >> ModelPin >> ShaderPin >> OutputPin >> numShaderBindings;
+        in >> Id >> ModelPin >> ShaderPin >> InstancesPin >> OutputPin >> numShaderBindings;
         if (numShaderBindings > 0)
         {
             ShaderBindingPins.reserve(numShaderBindings);
@@ -0,0 +1,263 @@
+#pragma once
+
+#include "UiNode.h"
+#include "Instancing.h"
+#include "Rendering/InstanceBuffer.h"
+
+#include <algorithm>
+#include <vector>
+
+// Produces the world matrices of an instanced draw, the output is the id of this node so the
+// draw node can read the instances back when rendering.
+struct InstancesNode : UiNode
+{
+private:
+    InstanceParams _Params;
+    InstanceParams _GeneratedParams;
+    std::vector<DirectX::XMFLOAT4X4> _Instances;
+    bool _IsGenerated{ false };
+    uint64_t _Version{ 0 }; // incremented each time the instances are generated
+
+public:
+    NodeId OffsetPin, RotationPin, ScalePin, OutputPin;
+    std::shared_ptr<NodeValueFloat3> OffsetNodeValue;
+    std::shared_ptr<NodeValueFloat3> RotationNodeValue;
+    std::shared_ptr<NodeValueFloat> ScaleNodeValue;
+    std::shared_ptr<NodeValueInt> OutputNodeValue;
+    std::unique_ptr<InstanceBuffer> Buffer; // instances uploaded last, created when drawn
+
+public:
+    explicit InstancesNode(Graph* graph)
+        : UiNode(graph, UiNodeType::Instances),
+        OffsetPin(INVALID_ID), RotationPin(INVALID_ID), ScalePin(INVALID_ID), OutputPin(INVALID_ID)
+    {
+        _Params.Count = 100;
+        OffsetNodeValue = std::make_shared<NodeValueFloat3>(_Params.Offset);
+        RotationNodeValue = std::make_shared<NodeValueFloat3>(_Params.Rotation);
+        ScaleNodeValue = std::make_shared<NodeValueFloat>(_Params.Scale);
+        OutputNodeValue = std::make_shared<NodeValueInt>(INVALID_INDEX);
+    }
+
+    const std::vector<DirectX::XMFLOAT4X4>& GetInstances() const { return _Instances; }
+    const InstanceParams& GetParams() const { return _Params; }
+    uint64_t GetVersion() const { return _Version; }
+
+    virtual void OnEvent(Event* e) override {}
+
+    virtual void OnCreate() override
+    {
+        const Node idNode(NodeType::Instances, NodeDirection::None);
+        Id = ParentGraph->CreateNode(idNode);
+
+        const Node float3NodeIn(NodeType::Float3, NodeDirection::In);
+        OffsetPin = ParentGraph->CreateNode(float3NodeIn);
+        RotationPin = ParentGraph->CreateNode(float3NodeIn);
+
+        const Node floatNodeIn(NodeType::Float, NodeDirection::In);
+        ScalePin = ParentGraph->CreateNode(floatNodeIn);
+
+        const Node outputNode(NodeType::Int, NodeDirection::Out);
+        OutputPin = ParentGraph->CreateNode(outputNode);
+
+        ParentGraph->CreateEdge(Id, OffsetPin, EdgeType::Internal);
+        ParentGraph->CreateEdge(Id, RotationPin, EdgeType::Internal);
+        ParentGraph->CreateEdge(Id, ScalePin, EdgeType::Internal);
+        ParentGraph->CreateEdge(OutputPin, Id, EdgeType::Internal);
+
+        OutputNodeValue->Value = Id;
+
+        ParentGraph->StoreNodeValue(OffsetPin, OffsetNodeValue);
+        ParentGraph->StoreNodeValue(RotationPin, RotationNodeValue);
+        ParentGraph->StoreNodeValue(ScalePin, ScaleNodeValue);
+        ParentGraph->StoreNodeValue(OutputPin, OutputNodeValue);
+    }
+
+    virtual void OnLoad() override
+    {
+        OffsetNodeValue->Value = *(DirectX::XMFLOAT3*)ParentGraph->GetNodeValue(OffsetPin)->GetValuePtr();
+        RotationNodeValue->Value = *(DirectX::XMFLOAT3*)ParentGraph->GetNodeValue(RotationPin)->GetValuePtr();
+        ScaleNodeValue->Value = *(float*)ParentGraph->GetNodeValue(ScalePin)->GetValuePtr();
+        OutputNodeValue->Value = Id;
+        _IsGenerated = false;
+
+        ParentGraph->StoreNodeValue(OffsetPin, OffsetNodeValue);
+        ParentGraph->StoreNodeValue(RotationPin, RotationNodeValue);
+        ParentGraph->StoreNodeValue(ScalePin, ScaleNodeValue);
+        ParentGraph->StoreNodeValue(OutputPin, OutputNodeValue);
+    }
+
+    virtual void OnUpdate() override
+    {
+        CopyValueFromLinkedSource(OffsetPin, (void*)&OffsetNodeValue->Value);
+        CopyValueFromLinkedSource(RotationPin, (void*)&RotationNodeValue->Value);
+        CopyValueFromLinkedSource(ScalePin, (void*)&ScaleNodeValue->Value);
+    }
+
+    virtual void OnEval() override
+    {
+        _Params.Offset = OffsetNodeValue->Value;
+        _Params.Rotation = RotationNodeValue->Value;
+        _Params.Scale = ScaleNodeValue->Value;
+
+        // the graph is evaluated every frame, the instances only when an input has changed
+        if (_IsGenerated && _Params == _GeneratedParams)
+            return;
+
+        Instancing::Generate(_Params, _Instances);
+        _GeneratedParams = _Params;
+        _IsGenerated = true;
+        ++_Version;
+    }
+
+    virtual void OnDelete() override
+    {
+        ParentGraph->EraseNode(OffsetPin);
+        ParentGraph->EraseNode(RotationPin);
+        ParentGraph->EraseNode(ScalePin);
+        ParentGraph->EraseNode(OutputPin);
+        Buffer.reset();
+    }
+
+    virtual void OnRender() override
+    {
+        const float node_width = 170.0f;
+
+        ImNodes::BeginNode(Id);
+
+        ImNodes::BeginNodeTitleBar();
+        ImGui::TextUnformatted("INSTANCES");
+        ImNodes::EndNodeTitleBar();
+
+        const char* layouts[] = { "grid", "scatter", "array" };
+        int layout = static_cast<int>(_Params.Layout);
+        ImGui::PushItemWidth(node_width);
+        if (ImGui::Combo("##hidelabel0", &layout, layouts, IM_ARRAYSIZE(layouts)))
+            _Params.Layout = static_cast<InstanceLayout>(layout);
+        ImGui::PopItemWidth();
+
+        int count = (int)_Params.Count;
+        ImGui::PushItemWidth(node_width);
+        ImGui::TextUnformatted("count   "); ImGui::SameLine();
+        if (ImGui::DragInt("##hidelabel1", &count, 1.f, 0, (int)MAX_INSTANCES))
+            _Params.Count = (uint32_t)std::max(0, std::min(count, (int)MAX_INSTANCES));
+        ImGui::PopItemWidth();
+
+        if (_Params.Layout == InstanceLayout::Scatter)
+        {
+            int seed = (int)_Params.Seed;
+            ImGui::PushItemWidth(node_width);
+            ImGui::TextUnformatted("seed    "); ImGui::SameLine();
+            if (ImGui::DragInt("##hidelabel2", &seed))
+                _Params.Seed = (uint32_t)seed;
+            ImGui::PopItemWidth();
+        }
+
+        {
+            bool hasLink = ParentGraph->GetNumEdgesFromNode(OffsetPin) > 0ull;
+            if (hasLink) ImGui::PushDisabled();
+
+            ImNodes::BeginInputAttribute(OffsetPin);
+            ImGui::PushItemWidth(node_width);
+            ImGui::TextUnformatted("offset  "); ImGui::SameLine();
+            ImGui::DragFloat3("##hidelabel3", &OffsetNodeValue->Value.x, 0.01f);
+            ImGui::PopItemWidth();
+            ImNodes::EndInputAttribute();
+
+            if (hasLink) ImGui::PopDisabled();
+        }
+
+        {
+            bool hasLink = ParentGraph->GetNumEdgesFromNode(RotationPin) > 0ull;
+            if (hasLink) ImGui::PushDisabled();
+
+            ImNodes::BeginInputAttribute(RotationPin);
+            ImGui::PushItemWidth(node_width);
+            ImGui::TextUnformatted("rotation"); ImGui::SameLine();
+            ImGui::DragFloat3("##hidelabel4", &RotationNodeValue->Value.x, 0.01f);
+            ImGui::PopItemWidth();
+            ImNodes::EndInputAttribute();
+
+            if (hasLink) ImGui::PopDisabled();
+        }
+
+        {
+            bool hasLink = ParentGraph->GetNumEdgesFromNode(ScalePin) > 0ull;
+            if (hasLink) ImGui::PushDisabled();
+
+            ImNodes::BeginInputAttribute(ScalePin);
+            ImGui::PushItemWidth(node_width);
+            ImGui::TextUnformatted("scale   "); ImGui::SameLine();
+            ImGui::DragFloat("##hidelabel5", &ScaleNodeValue->Value, 0.01f);
+            ImGui::PopItemWidth();
+            ImNodes::EndInputAttribute();
+
+            if (hasLink) ImGui::PopDisabled();
+        }
+
+        ImNodes::BeginOutputAttribute(OutputPin);
+        const float label_width = ImGui::CalcTextSize("output").x;
+        ImGui::Indent(node_width - label_width);
+        ImGui::TextUnformatted("output");
+        ImNodes::EndOutputAttribute();
+
+        ImNodes::EndNode();
+    }
+
+    virtual std::string GetState() const override
+    {
+        std::ostringstream state;
+        state << static_cast<int>(_Params.Layout) << " " << _Params.Count << " " << _Params.Seed;
+        return state.str();
+    }
+
+    // the instances are generated again on the next evaluation
+    virtual void SetState(const std::string& state) override
+    {
+        std::istringstream in(state);
+        int layout;
+        in >> layout >> _Params.Count >> _Params.Seed;
+        _Params.Layout = static_cast<InstanceLayout>(layout);
+        _Params.Count = std::min(_Params.Count, MAX_INSTANCES);
+    }
+
+    virtual std::ostream& Serialize(std::ostream& out) const
+    {
+        UiNode::Serialize(out);
+        out << " " << OffsetPin
+            << " " << RotationPin
+            << " " << ScalePin
+            << " " << OutputPin
+            << " " << static_cast<int>(_Params.Layout)
+            << " " << _Params.Count
+            << " " << _Params.Seed;
+        return out;
+    }
+
+    virtual std::istream& Deserialize(std::istream& in)
+    {
+        Type = UiNodeType::Instances;
+        int layout;
+        in >> Id
+            >> OffsetPin
+            >> RotationPin
+            >> ScalePin
+            >> OutputPin
+            >> layout
+            >> _Params.Count
+            >> _Params.Seed;
+        _Params.Layout = static_cast<InstanceLayout>(layout);
+        _Params.Count = std::min(_Params.Count, MAX_INSTANCES);
+        OnLoad();
+        return in;
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, const InstancesNode& n)
+    {
+        return n.Serialize(out);
+    }
+
+    friend std::istream& operator>>(std::istream& in, InstancesNode& n)
+    {
+        return n.Deserialize(in);
+    }
+};
\ No newline at end of file
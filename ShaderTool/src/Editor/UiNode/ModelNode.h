@@ -2,12 +2,15 @@
 
 #include "UiNode.h"
 #include "AssetManager.h"
+#include "Journal.h"
 
 struct ModelNode : UiNode
 {
 private:
     std::string _Path;
     int _ModelIndex;
+    std::vector<int> _ModelIndices; // every mesh imported from the file
+    int _SelectedMesh{ 0 };
 
 public:
     NodeId OutputPin;
@@ -21,8 +24,22 @@ public:
     }
 
     const std::string GetPath() const { return _Path; }
+
     const std::string GetName() const { return _ModelIndex == INVALID_INDEX ? "" : AssetManager::Get().GetModel(_ModelIndex).Name; }
 
+    // the geometry goes back to the pool
+    void UnloadModels()
+    {
+        if (_ModelIndices.empty() && _ModelIndex != INVALID_INDEX)
+            AssetManager::Get().UnloadModel(_ModelIndex);
+
+        for (int index : _ModelIndices)
+            AssetManager::Get().UnloadModel(index);
+
+        _ModelIndices.clear();
+        _SelectedMesh = 0;
+    }
+
     virtual void OnEvent(Event* e) override {}
 
     virtual void OnCreate() override
@@ -39,26 +56,51 @@ public:
         ParentGraph->StoreNodeValue(OutputPin, OutputNodeValue);
     }
 
+    // The file is always imported again, the model slots of another session may hold other models
+    // (the primitives share them), only the selected mesh is kept.
     virtual void OnLoad() override
     {
-        Model model = AssetManager::Get().GetModel(_ModelIndex);
-        if(model.Name.empty())
-        {
-            _ModelIndex = AssetManager::Get().LoadModelFromFile(_Path);
-            if (_ModelIndex == INVALID_INDEX)
-            {
-                LOG_ERROR("Failed to load model {0}!", _Path);
-                _Path = "";
-                OutputNodeValue->Value = INVALID_INDEX;
-                ParentGraph->StoreNodeValue(OutputPin, OutputNodeValue);
-                return;
-            }
-        }
-        else
+        _ModelIndices = AssetManager::Get().LoadModelsFromFile(_Path);
+        _SelectedMesh = _ModelIndices.empty() ? 0 : std::clamp(_SelectedMesh, 0, (int)_ModelIndices.size() - 1);
+        _ModelIndex = _ModelIndices.empty() ? INVALID_INDEX : _ModelIndices[_SelectedMesh];
+        if (_ModelIndex == INVALID_INDEX)
         {
-            OutputNodeValue->Value = _ModelIndex;
+            LOG_ERROR("Failed to load model {0}!", _Path);
+            _Path = "";
+            OutputNodeValue->Value = INVALID_INDEX;
             ParentGraph->StoreNodeValue(OutputPin, OutputNodeValue);
+            return;
         }
+
+        OutputNodeValue->Value = _ModelIndex;
+        ParentGraph->StoreNodeValue(OutputPin, OutputNodeValue);
+    }
+
+    virtual void LoadFile(const std::string& path) override
+    {
+        Journal::Get().RecordLoadAsset(Id, path);
+
+        UnloadModels();
+
+        _Path = path;
+        _ModelIndex = INVALID_INDEX;
+        OnLoad();
+    }
+
+    virtual std::string GetState() const override
+    {
+        return std::to_string(_SelectedMesh);
+    }
+
+    virtual void SetState(const std::string& state) override
+    {
+        const int selectedMesh = std::atoi(state.c_str());
+        if (selectedMesh < 0 || selectedMesh >= (int)_ModelIndices.size())
+            return;
+
+        _SelectedMesh = selectedMesh;
+        _ModelIndex = _ModelIndices[_SelectedMesh];
+        OutputNodeValue->Value = _ModelIndex;
     }
 
     virtual void OnUpdate() override
@@ -73,6 +115,7 @@ public:
 
     virtual void OnDelete() override
     {
+        UnloadModels();
         ParentGraph->EraseNode(OutputPin);
     }
 
@@ -93,9 +136,7 @@ public:
 
             if (result == NFD_OKAY)
             {
-                _Path = std::string(outPath);
-                _ModelIndex = AssetManager::Get().LoadModelFromFile(_Path);
-                OnLoad();
+                LoadFile(std::string(outPath));
                 free(outPath);
             }
             else if (result == NFD_CANCEL)
@@ -110,6 +151,35 @@ public:
         if(_ModelIndex != INVALID_INDEX)
             ImGui::Text(GetName().c_str());
 
+        // files with several meshes, pick which one is output
+        if (_ModelIndices.size() > 1)
+        {
+            std::vector<std::string> names;
+            for (int index : _ModelIndices)
+                names.push_back(AssetManager::Get().GetModel(index).Name);
+
+            std::vector<const char*> items;
+            for (auto& name : names)
+                items.push_back(name.c_str());
+
+            ImGui::PushItemWidth(node_width);
+            if (ImGui::Combo("##hidelabel", &_SelectedMesh, items.data(), (int)items.size()))
+            {
+                _ModelIndex = _ModelIndices[_SelectedMesh];
+                OutputNodeValue->Value = _ModelIndex;
+            }
+            ImGui::PopItemWidth();
+        }
+
+        // preview rendered on the CPU, shows up once the thumbnail is ready
+        if (_ModelIndex != INVALID_INDEX)
+        {
+            const ThumbnailView thumbnail = AssetManager::Get().RequestThumbnail(_ModelIndex);
+            if (thumbnail.IsReady)
+                ImGui::Image((ImTextureID)thumbnail.Srv.ptr, ImVec2(node_width, node_width),
+                    ImVec2(thumbnail.Uv0.x, thumbnail.Uv0.y), ImVec2(thumbnail.Uv1.x, thumbnail.Uv1.y));
+        }
+
         ImNodes::BeginOutputAttribute(OutputPin);
         const float label_width = ImGui::CalcTextSize("output").x;
         ImGui::Indent(node_width - label_width);
@@ -122,14 +192,14 @@ public:
     virtual std::ostream& Serialize(std::ostream& out) const
     {
         UiNode::Serialize(out);
-        out << " " << OutputPin << " " << _ModelIndex << " " << _Path;
+        out << " " << OutputPin << " " << _SelectedMesh << " " << _Path;
         return out;
     }
 
     virtual std::istream& Deserialize(std::istream& in)
     {
         Type = UiNodeType::Model;
-        in >> Id >> OutputPin >> _ModelIndex >> _Path;
+        in >> Id >> OutputPin >> _SelectedMesh >> _Path;
         OnLoad();
         return in;
     }
@@ -1,31 +1,41 @@
 #pragma once
 
 #include "UiNode.h"
+#include "PrimitiveCache.h"
+#include "AssetManager.h"
 
 struct PrimitiveNode : UiNode
 {
 private:
-    std::vector<std::string> _PrimitiveNames;               // list of all primitives
-    std::unordered_map<size_t, int> _PrimitiveNameIndexMap; // maps internal vector index with model index
+    PrimitiveParams _Params;
+    int _ModelIndex;            // acquired from the primitive cache
+    PrimitiveParams _ModelParams; // parameters _ModelIndex was generated with
 
 public:
-    NodeId OutputPin;
+    NodeId SizePin, RadiusPin, TopRadiusPin, OutputPin;
+    std::shared_ptr<NodeValueFloat3> SizeNodeValue; // width, height, depth
+    std::shared_ptr<NodeValueFloat> RadiusNodeValue;
+    std::shared_ptr<NodeValueFloat> TopRadiusNodeValue;
     std::shared_ptr<NodeValueInt> OutputNodeValue;
 
 public:
-    explicit PrimitiveNode(Graph* graph, std::vector<int>& primitives)
-        : UiNode(graph, UiNodeType::Primitive), OutputPin(INVALID_ID)
+    explicit PrimitiveNode(Graph* graph)
+        : UiNode(graph, UiNodeType::Primitive), _ModelIndex(INVALID_INDEX),
+        SizePin(INVALID_ID), RadiusPin(INVALID_ID), TopRadiusPin(INVALID_ID), OutputPin(INVALID_ID)
     {
-        OutputNodeValue = std::make_shared<NodeValueInt>(0);
+        SizeNodeValue = std::make_shared<NodeValueFloat3>(DirectX::XMFLOAT3(_Params.Width, _Params.Height, _Params.Depth));
+        RadiusNodeValue = std::make_shared<NodeValueFloat>(_Params.Radius);
+        TopRadiusNodeValue = std::make_shared<NodeValueFloat>(_Params.TopRadius);
+        OutputNodeValue = std::make_shared<NodeValueInt>(INVALID_INDEX);
+    }
 
-        for (int p : primitives)
-        {
-            auto model = AssetManager::Get().GetModel(p);
-            _PrimitiveNames.push_back(model.Name);
-            _PrimitiveNameIndexMap[_PrimitiveNames.size()-1] = p;
-        }
+    virtual ~PrimitiveNode()
+    {
+        ReleaseModel();
     }
 
+    const PrimitiveParams& GetParams() const { return _Params; }
+
     virtual void OnEvent(Event* e) override {}
 
     virtual void OnCreate() override
@@ -33,49 +43,159 @@ public:
         const Node idNode(NodeType::Primitive, NodeDirection::None);
         Id = ParentGraph->CreateNode(idNode);
 
+        const Node float3NodeIn(NodeType::Float3, NodeDirection::In);
+        SizePin = ParentGraph->CreateNode(float3NodeIn);
+
+        const Node floatNodeIn(NodeType::Float, NodeDirection::In);
+        RadiusPin = ParentGraph->CreateNode(floatNodeIn);
+        TopRadiusPin = ParentGraph->CreateNode(floatNodeIn);
+
         const Node outputNode(NodeType::Int, NodeDirection::Out);
         OutputPin = ParentGraph->CreateNode(outputNode);
 
+        ParentGraph->CreateEdge(Id, SizePin, EdgeType::Internal);
+        ParentGraph->CreateEdge(Id, RadiusPin, EdgeType::Internal);
+        ParentGraph->CreateEdge(Id, TopRadiusPin, EdgeType::Internal);
         ParentGraph->CreateEdge(OutputPin, Id, EdgeType::Internal);
+
+        ParentGraph->StoreNodeValue(SizePin, SizeNodeValue);
+        ParentGraph->StoreNodeValue(RadiusPin, RadiusNodeValue);
+        ParentGraph->StoreNodeValue(TopRadiusPin, TopRadiusNodeValue);
         ParentGraph->StoreNodeValue(OutputPin, OutputNodeValue);
+
+        UpdateModel();
     }
 
     virtual void OnLoad() override
     {
-        OutputNodeValue->Value = *(int*)ParentGraph->GetNodeValue(OutputPin)->GetValuePtr();
+        SizeNodeValue->Value = *(DirectX::XMFLOAT3*)ParentGraph->GetNodeValue(SizePin)->GetValuePtr();
+        RadiusNodeValue->Value = *(float*)ParentGraph->GetNodeValue(RadiusPin)->GetValuePtr();
+        TopRadiusNodeValue->Value = *(float*)ParentGraph->GetNodeValue(TopRadiusPin)->GetValuePtr();
+
+        ParentGraph->StoreNodeValue(SizePin, SizeNodeValue);
+        ParentGraph->StoreNodeValue(RadiusPin, RadiusNodeValue);
+        ParentGraph->StoreNodeValue(TopRadiusPin, TopRadiusNodeValue);
         ParentGraph->StoreNodeValue(OutputPin, OutputNodeValue);
+
+        // the saved model index is from the previous session
+        ReleaseModel();
+        UpdateModel();
     }
 
     virtual void OnUpdate() override
     {
-        
+        CopyValueFromLinkedSource(SizePin, (void*)&SizeNodeValue->Value);
+        CopyValueFromLinkedSource(RadiusPin, (void*)&RadiusNodeValue->Value);
+        CopyValueFromLinkedSource(TopRadiusPin, (void*)&TopRadiusNodeValue->Value);
     }
     
     virtual void OnEval() override
     {
-        
+        UpdateModel();
     }
 
     virtual void OnDelete() override
     {
+        ParentGraph->EraseNode(SizePin);
+        ParentGraph->EraseNode(RadiusPin);
+        ParentGraph->EraseNode(TopRadiusPin);
         ParentGraph->EraseNode(OutputPin);
     }
 
     virtual void OnRender() override
     {
-        const float node_width = 100.0f;
+        const float node_width = 170.0f;
         ImNodes::BeginNode(Id);
         ImNodes::BeginNodeTitleBar();
         ImGui::TextUnformatted("PRIMITIVE");
         ImNodes::EndNodeTitleBar();
 
-        std::vector<const char*> items;
-        for (int i = 0; i < _PrimitiveNames.size(); ++i)
-            items.push_back(_PrimitiveNames[i].c_str());
+        const char* shapes[] = { "box", "sphere", "geosphere", "cylinder", "grid" };
+        int shape = static_cast<int>(_Params.Shape);
+        ImGui::PushItemWidth(node_width);
+        if (ImGui::Combo("##hidelabel0", &shape, shapes, IM_ARRAYSIZE(shapes)))
+            _Params.Shape = static_cast<PrimitiveShape>(shape);
+        ImGui::PopItemWidth();
+
+        // the pins the shape doesn't use are disabled
+        const bool usesSize = _Params.Shape == PrimitiveShape::Box || _Params.Shape == PrimitiveShape::Grid || _Params.Shape == PrimitiveShape::Cylinder;
+        const bool usesRadius = _Params.Shape != PrimitiveShape::Box && _Params.Shape != PrimitiveShape::Grid;
+        const bool usesTopRadius = _Params.Shape == PrimitiveShape::Cylinder;
+
+        {
+            bool disabled = !usesSize || ParentGraph->GetNumEdgesFromNode(SizePin) > 0ull;
+            if (disabled) ImGui::PushDisabled();
+
+            ImNodes::BeginInputAttribute(SizePin);
+            ImGui::PushItemWidth(node_width);
+            ImGui::TextUnformatted("size    "); ImGui::SameLine();
+            ImGui::DragFloat3("##hidelabel1", &SizeNodeValue->Value.x, 0.01f);
+            ImGui::PopItemWidth();
+            ImNodes::EndInputAttribute();
+
+            if (disabled) ImGui::PopDisabled();
+        }
+
+        {
+            bool disabled = !usesRadius || ParentGraph->GetNumEdgesFromNode(RadiusPin) > 0ull;
+            if (disabled) ImGui::PushDisabled();
+
+            ImNodes::BeginInputAttribute(RadiusPin);
+            ImGui::PushItemWidth(node_width);
+            ImGui::TextUnformatted("radius  "); ImGui::SameLine();
+            ImGui::DragFloat("##hidelabel2", &RadiusNodeValue->Value, 0.01f);
+            ImGui::PopItemWidth();
+            ImNodes::EndInputAttribute();
+
+            if (disabled) ImGui::PopDisabled();
+        }
+
+        {
+            bool disabled = !usesTopRadius || ParentGraph->GetNumEdgesFromNode(TopRadiusPin) > 0ull;
+            if (disabled) ImGui::PushDisabled();
+
+            ImNodes::BeginInputAttribute(TopRadiusPin);
+            ImGui::PushItemWidth(node_width);
+            ImGui::TextUnformatted("top     "); ImGui::SameLine();
+            ImGui::DragFloat("##hidelabel3", &TopRadiusNodeValue->Value, 0.01f);
+            ImGui::PopItemWidth();
+            ImNodes::EndInputAttribute();
+
+            if (disabled) ImGui::PopDisabled();
+        }
 
+        // tessellation, not linkable
         ImGui::PushItemWidth(node_width);
-        ImGui::Combo("##hidelabel", &OutputNodeValue->Value, items.data(), (int)items.size());
+        if (_Params.Shape == PrimitiveShape::Sphere || _Params.Shape == PrimitiveShape::Cylinder || _Params.Shape == PrimitiveShape::Grid)
+        {
+            int slices = (int)_Params.Slices;
+            ImGui::TextUnformatted("slices  "); ImGui::SameLine();
+            if (ImGui::DragInt("##hidelabel4", &slices, 1.f, 2, (int)MAX_PRIMITIVE_TESSELLATION))
+                _Params.Slices = (uint32_t)std::max(slices, 0);
+
+            int stacks = (int)_Params.Stacks;
+            ImGui::TextUnformatted("stacks  "); ImGui::SameLine();
+            if (ImGui::DragInt("##hidelabel5", &stacks, 1.f, 1, (int)MAX_PRIMITIVE_TESSELLATION))
+                _Params.Stacks = (uint32_t)std::max(stacks, 0);
+        }
+        else
+        {
+            const uint32_t maxSubdivisions = _Params.Shape == PrimitiveShape::Geosphere ? MAX_GEOSPHERE_SUBDIVISIONS : MAX_PRIMITIVE_SUBDIVISIONS;
+            int subdivisions = (int)_Params.Subdivisions;
+            ImGui::TextUnformatted("subdiv  "); ImGui::SameLine();
+            if (ImGui::DragInt("##hidelabel6", &subdivisions, 0.05f, 0, (int)maxSubdivisions))
+                _Params.Subdivisions = (uint32_t)std::max(subdivisions, 0);
+        }
         ImGui::PopItemWidth();
+
+        // preview rendered on the CPU, shows up once the thumbnail is ready
+        if (_ModelIndex != INVALID_INDEX)
+        {
+            const ThumbnailView thumbnail = AssetManager::Get().RequestThumbnail(_ModelIndex);
+            if (thumbnail.IsReady)
+                ImGui::Image((ImTextureID)thumbnail.Srv.ptr, ImVec2(node_width, node_width),
+                    ImVec2(thumbnail.Uv0.x, thumbnail.Uv0.y), ImVec2(thumbnail.Uv1.x, thumbnail.Uv1.y));
+        }
         
         ImNodes::BeginOutputAttribute(OutputPin);
         const float label_width = ImGui::CalcTextSize("output").x;
@@ -86,17 +206,50 @@ public:
         ImNodes::EndNode();
     }
 
+    virtual std::string GetState() const override
+    {
+        std::ostringstream state;
+        state << static_cast<int>(_Params.Shape) << " " << _Params.Slices << " " << _Params.Stacks << " " << _Params.Subdivisions;
+        return state.str();
+    }
+
+    // the model is updated on the next evaluation
+    virtual void SetState(const std::string& state) override
+    {
+        std::istringstream in(state);
+        int shape;
+        in >> shape >> _Params.Slices >> _Params.Stacks >> _Params.Subdivisions;
+        _Params.Shape = static_cast<PrimitiveShape>(shape);
+    }
+
     virtual std::ostream& Serialize(std::ostream& out) const
     {
         UiNode::Serialize(out);
-        out << " " << OutputPin;
+        out << " " << SizePin
+            << " " << RadiusPin
+            << " " << TopRadiusPin
+            << " " << OutputPin
+            << " " << static_cast<int>(_Params.Shape)
+            << " " << _Params.Slices
+            << " " << _Params.Stacks
+            << " " << _Params.Subdivisions;
         return out;
     }
 
     virtual std::istream& Deserialize(std::istream& in)
     {
         Type = UiNodeType::Primitive;
-        in >> Id >> OutputPin;
+        int shape;
+        in >> Id
+            >> SizePin
+            >> RadiusPin
+            >> TopRadiusPin
+            >> OutputPin
+            >> shape
+            >> _Params.Slices
+            >> _Params.Stacks
+            >> _Params.Subdivisions;
+        _Params.Shape = static_cast<PrimitiveShape>(shape);
         OnLoad();
         return in;
     }
@@ -110,4 +263,32 @@ public:
     {
         return n.Deserialize(in);
     }
+
+private:
+    // the cache returns the same model for the same parameters, only new ones are generated
+    void UpdateModel()
+    {
+        _Params.Width = SizeNodeValue->Value.x;
+        _Params.Height = SizeNodeValue->Value.y;
+        _Params.Depth = SizeNodeValue->Value.z;
+        _Params.Radius = RadiusNodeValue->Value;
+        _Params.TopRadius = TopRadiusNodeValue->Value;
+
+        const PrimitiveParams params = _Params.Normalized();
+        if (_ModelIndex != INVALID_INDEX && params == _ModelParams)
+            return;
+
+        ReleaseModel();
+        _ModelIndex = PrimitiveCache::Get().Acquire(params);
+        _ModelParams = params;
+        OutputNodeValue->Value = _ModelIndex;
+    }
+
+    void ReleaseModel()
+    {
+        if (_ModelIndex != INVALID_INDEX)
+            PrimitiveCache::Get().Release(_ModelIndex);
+        _ModelIndex = INVALID_INDEX;
+        OutputNodeValue->Value = INVALID_INDEX;
+    }
 };
\ No newline at end of file
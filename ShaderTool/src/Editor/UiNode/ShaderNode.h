@@ -1,6 +1,7 @@
 #pragma once
 
 #include "UiNode.h"
+#include "Journal.h"
 
 struct ShaderNode : UiNode
 {
@@ -59,6 +60,14 @@ public:
 
     }
 
+    virtual void LoadFile(const std::string& path) override
+    {
+        Journal::Get().RecordLoadAsset(Id, path);
+
+        OutputNodeValue->Value = ShaderManager::Get()->LoadShaderFromFile(path);
+        EVENT_MANAGER.Enqueue(std::make_shared<ShaderUpdatedEvent>(OutputNodeValue->Value));
+    }
+
     virtual void OnDelete() override
     {
         ParentGraph->EraseNode(OutputPin);
@@ -82,8 +91,7 @@ public:
 
             if (result == NFD_OKAY)
             {
-                OutputNodeValue->Value = ShaderManager::Get()->LoadShaderFromFile(std::string(outPath));
-                EVENT_MANAGER.Enqueue(std::make_shared<ShaderUpdatedEvent>(OutputNodeValue->Value));
+                LoadFile(std::string(outPath));
                 free(outPath);
             }
             else if (result == NFD_CANCEL)
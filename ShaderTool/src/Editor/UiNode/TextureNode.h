@@ -2,6 +2,7 @@
 
 #include "UiNode.h"
 #include "AssetManager.h"
+#include "Journal.h"
 
 struct TextureNode : UiNode
 {
@@ -67,6 +68,15 @@ public:
         ParentGraph->StoreNodeValue(OutputPin, OutputNodeValue);
     }
 
+    virtual void LoadFile(const std::string& path) override
+    {
+        Journal::Get().RecordLoadAsset(Id, path);
+
+        _Texture = AssetManager::Get().CreateTextureFromFile(path);
+        OutputNodeValue->Value = _Texture ? (int)_Texture->Index : INVALID_INDEX;
+        ParentGraph->StoreNodeValue(OutputPin, OutputNodeValue);
+    }
+
     virtual void OnUpdate() override
     {
 
@@ -95,13 +105,11 @@ public:
         if (ImGui::Button("Open"))
         {
             nfdchar_t* outPath = nullptr;
-            nfdresult_t result = NFD_OpenDialog("dds", NULL, &outPath);
+            nfdresult_t result = NFD_OpenDialog("dds,png,tga,hdr", NULL, &outPath);
 
             if (result == NFD_OKAY)
             {
-                _Texture = AssetManager::Get().CreateTextureFromFile(std::string(outPath));
-                OutputNodeValue->Value = (int)_Texture->Index;
-                ParentGraph->StoreNodeValue(OutputPin, OutputNodeValue);
+                LoadFile(std::string(outPath));
                 free(outPath);
             }
             else if (result == NFD_CANCEL)
@@ -114,16 +122,29 @@ public:
             }
         }
         
-        // TODO: temp dimensions
-        static int w = 256;
-        static int h = 256;
+        // preview decoded on the CPU, the GPU texture while it's not ready or when the format can't be decoded
+        const float preview_size = (float)THUMBNAIL_SIZE;
         ImNodes::BeginOutputAttribute(OutputPin);
-        if(_Texture) 
-            ImGui::Image((ImTextureID)_Texture->SrvGpuDescHandle.ptr, ImVec2((float)w, (float)h));
+        if (_Texture)
+        {
+            const ThumbnailView thumbnail = AssetManager::Get().RequestTextureThumbnail(_Texture->Index);
+            if (thumbnail.IsReady)
+                ImGui::Image((ImTextureID)thumbnail.Srv.ptr, ImVec2(preview_size, preview_size),
+                    ImVec2(thumbnail.Uv0.x, thumbnail.Uv0.y), ImVec2(thumbnail.Uv1.x, thumbnail.Uv1.y));
+            else
+                ImGui::Image((ImTextureID)_Texture->SrvGpuDescHandle.ptr, ImVec2(preview_size, preview_size));
+        }
         ImNodes::EndOutputAttribute();
 
         if (OutputNodeValue->Value != INVALID_INDEX)
+        {
             ImGui::Text(GetName().c_str());
+            if (_Texture && _Texture->Resource)
+            {
+                const D3D12_RESOURCE_DESC desc = _Texture->Resource->GetDesc();
+                ImGui::Text("%llu x %u, %u mips", desc.Width, desc.Height, desc.MipLevels);
+            }
+        }
 
         ImNodes::EndNode();
     }
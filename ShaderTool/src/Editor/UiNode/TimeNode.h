@@ -1,12 +1,11 @@
 #pragma once
 
 #include "UiNode.h"
+#include "FrameClock.h"
 
+// Seconds since the clock was reset, the same for every time node of a frame
 struct TimeNode : UiNode
 {
-private:
-    GameTimer _Timer;
-
 public:
     NodeId OutputPin;
     std::shared_ptr<NodeValueFloat> OutputNodeValue;
@@ -16,7 +15,6 @@ public:
         : UiNode(graph, UiNodeType::Time), OutputPin(INVALID_ID)
     {
         OutputNodeValue = std::make_shared<NodeValueFloat>(0.f);
-        _Timer.Start();
     }
 
     virtual void OnEvent(Event* e) override {}
@@ -43,14 +41,11 @@ public:
         ParentGraph->EraseNode(OutputPin);
     }
     
-    virtual void OnUpdate() override
-    {
-        _Timer.Tick();
-    }
+    virtual void OnUpdate() override {}
 
     virtual void OnEval() override
     {
-        OutputNodeValue->Value = _Timer.TotalTime();
+        OutputNodeValue->Value = (float)FrameClock::Get().GetTime();
     }
 
     virtual void OnRender() override
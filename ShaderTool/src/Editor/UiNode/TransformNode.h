@@ -71,6 +71,7 @@ public:
         CopyValueFromLinkedSource(ScalePin, (void*)&ScaleNodeValue->Value);
     }
 
+    // The graph evaluates all its transforms at once with TransformBatch, which gives the same result
     virtual void OnEval() override
     {
         auto position = DirectX::XMMatrixTranslation(PositionNodeValue->Value.x, PositionNodeValue->Value.y, PositionNodeValue->Value.z);
@@ -1,6 +1,5 @@
 #pragma once
 
-#include "GameTimer.h"
 #include "Defines.h"
 #include "Patterns/IObserver.h"
 
@@ -31,7 +30,8 @@ enum class UiNodeType
     Matrix4x4,
     Model,
     Texture,
-    Transform
+    Transform,
+    Instances
 };
 
 struct UiNode : public IObserver
@@ -58,6 +58,14 @@ public:
     virtual void OnDelete() = 0;
     virtual void OnRender() = 0;
     virtual void OnEval() = 0;
+
+    // file opened by the asset nodes, with the Open button or by a journal replay
+    virtual void LoadFile(const std::string& path) {}
+
+    // settings edited in the node that aren't pin values (a shape, a layout, a mesh of the file...),
+    // the journal records them when they change. Empty for the nodes without any.
+    virtual std::string GetState() const { return ""; }
+    virtual void SetState(const std::string& state) {}
     
     Graph* GetGraph() const { return ParentGraph; }
 
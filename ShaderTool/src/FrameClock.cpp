@@ -0,0 +1,73 @@
+#include "pch.h"
+#include "FrameClock.h"
+#include "Defines.h"
+
+#include <cmath>
+
+void FrameClock::SetMode(FrameClockMode mode, double fixedStep)
+{
+	_Mode = mode;
+	_FixedStep = fixedStep > 0.0 ? fixedStep : 1.0 / 60.0;
+	_Accumulator = 0.0;
+	_LastTick = Clock::now(); // the time goes on from where it is
+}
+
+void FrameClock::Reset()
+{
+	_IsReset = true;
+	_Accumulator = 0.0;
+	_Time = 0.0;
+	_DeltaTime = 0.0;
+	_FrameIndex = 0;
+}
+
+void FrameClock::SetTime(double time, double deltaTime)
+{
+	_IsReset = false;
+	_Accumulator = 0.0;
+	_Time = time;
+	_DeltaTime = deltaTime;
+	++_FrameIndex;
+}
+
+void FrameClock::Tick()
+{
+	Tick(Clock::now());
+}
+
+void FrameClock::Tick(Clock::time_point now)
+{
+	// the first frame after a reset is at time 0
+	if (_IsReset)
+	{
+		_IsReset = false;
+		_LastTick = now;
+		return;
+	}
+
+	++_FrameIndex;
+
+	// the wall clock isn't read, the same frames give the same times
+	if (_Mode == FrameClockMode::Deterministic)
+	{
+		_DeltaTime = _FixedStep;
+		_Time += _FixedStep;
+		return;
+	}
+
+	const double elapsed = std::chrono::duration<double>(now - _LastTick).count();
+	_LastTick = now;
+
+	if (_Mode == FrameClockMode::RealTime)
+	{
+		_DeltaTime = elapsed;
+		_Time += elapsed;
+		return;
+	}
+
+	_Accumulator += elapsed;
+	const double numSteps = std::min(std::floor(_Accumulator / _FixedStep), (double)MAX_STEPS_PER_FRAME);
+	_Accumulator = std::min(_Accumulator - numSteps * _FixedStep, _FixedStep);
+	_DeltaTime = numSteps * _FixedStep;
+	_Time += _DeltaTime;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+enum class FrameClockMode
+{
+	RealTime,      // the time measured between the frames
+	FixedStep,     // the measured time in whole fixed steps, the rest is carried to the next frames
+	Deterministic  // one fixed step per frame whatever the frame takes, the runs are reproducible
+};
+
+// Time of the frame read by the nodes, sampled once per frame by Tick so every node sees the same
+// value whatever the number of nodes. The time is in seconds since Reset.
+class FrameClock
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// Steps taken by a FixedStep frame at most, the rest is dropped after a long stall
+	static constexpr uint32_t MAX_STEPS_PER_FRAME = 8;
+
+	FrameClock(const FrameClock&) = delete;
+	FrameClock& operator=(const FrameClock&) = delete;
+
+	static FrameClock& Get()
+	{
+		static FrameClock instance;
+		return instance;
+	}
+
+	void SetMode(FrameClockMode mode, double fixedStep);
+	void Reset(); // time 0 in the next frame
+	void Tick();  // once per frame, before the nodes are updated
+	void Tick(Clock::time_point now); // the frame at the time now, Tick passes Clock::now()
+	void SetTime(double time, double deltaTime); // instead of Tick, the frame of a journal replay
+
+	FrameClockMode GetMode() const { return _Mode; }
+	double GetFixedStep() const { return _FixedStep; }
+	double GetTime() const { return _Time; }
+	double GetDeltaTime() const { return _DeltaTime; }
+	uint64_t GetFrameIndex() const { return _FrameIndex; }
+
+private:
+	FrameClock() = default;
+
+private:
+	FrameClockMode _Mode{ FrameClockMode::RealTime };
+	double _FixedStep{ 1.0 / 60.0 };
+
+	Clock::time_point _LastTick{};
+	bool _IsReset{ true };
+	double _Accumulator{ 0.0 }; // FixedStep, measured time not stepped yet
+
+	double _Time{ 0.0 };
+	double _DeltaTime{ 0.0 };
+	uint64_t _FrameIndex{ 0 };
+};
@@ -4,10 +4,41 @@
 
 #include "pch.h"
 #include "GeometryGenerator.h"
+#include "ThreadPool.h"
+#include "Defines.h"
 #include <algorithm>
 
 using namespace DirectX;
 
+// Vertices (or indices) generated by each task of the parallel loops
+static constexpr size_t ITEMS_PER_TASK = 16 * 1024;
+
+static size_t ItemsPerTask(size_t itemsPerRow)
+{
+	return std::max<size_t>(ITEMS_PER_TASK / std::max<size_t>(itemsPerRow, 1), 1);
+}
+
+void GeometryGenerator::ComputeSinCos(float step, uint32 count, std::vector<float>& sines, std::vector<float>& cosines)
+{
+	// 4 angles per XMVectorSinCos, the tables are padded to a multiple of 4 while filling them
+	sines.resize((count + 3) & ~3u);
+	cosines.resize(sines.size());
+
+	XMVECTOR index = XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f);
+	const XMVECTOR stepVector = XMVectorReplicate(step);
+	for (uint32 i = 0; i < count; i += 4)
+	{
+		XMVECTOR s, c;
+		XMVectorSinCos(&s, &c, XMVectorMultiply(index, stepVector));
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&sines[i]), s);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&cosines[i]), c);
+		index = XMVectorAdd(index, g_XMFour);
+	}
+
+	sines.resize(count);
+	cosines.resize(count);
+}
+
 GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float height, float depth, uint32 numSubdivisions)
 {
 	MeshData meshData;
@@ -117,7 +148,7 @@ GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float heig
 	meshData.Indices32.assign(&i[0], &i[36]);
 
 	// Put a cap on the number of subdivisions.
-	numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+	numSubdivisions = std::min<uint32>(numSubdivisions, MAX_PRIMITIVE_SUBDIVISIONS);
 
 	for (uint32 i = 0; i < numSubdivisions; ++i)
 		Subdivide(meshData);
@@ -139,47 +170,51 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 	Vertex topVertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
 	Vertex bottomVertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
 
-	meshData.Vertices.push_back(topVertex);
-
 	float phiStep = XM_PI / stackCount;
 	float thetaStep = 2.0f * XM_PI / sliceCount;
 
-	// Compute vertices for each stack ring (do not count the poles as rings).
-	for (uint32 i = 1; i <= stackCount - 1; ++i)
-	{
-		float phi = i * phiStep;
-
-		// Vertices of ring.
-		for (uint32 j = 0; j <= sliceCount; ++j)
-		{
-			float theta = j * thetaStep;
-
-			Vertex v;
-
-			// spherical to cartesian
-			v.Position.x = radius * sinf(phi) * cosf(theta);
-			v.Position.y = radius * cosf(phi);
-			v.Position.z = radius * sinf(phi) * sinf(theta);
-
-			// Partial derivative of P with respect to theta
-			v.TangentU.x = -radius * sinf(phi) * sinf(theta);
-			v.TangentU.y = 0.0f;
-			v.TangentU.z = +radius * sinf(phi) * cosf(theta);
-
-			XMVECTOR T = XMLoadFloat3(&v.TangentU);
-			XMStoreFloat3(&v.TangentU, XMVector3Normalize(T));
+	// Every ring uses the same angles around the y-axis.
+	std::vector<float> sinTheta, cosTheta;
+	ComputeSinCos(thetaStep, sliceCount + 1, sinTheta, cosTheta);
 
-			XMVECTOR p = XMLoadFloat3(&v.Position);
-			XMStoreFloat3(&v.Normal, XMVector3Normalize(p));
+	uint32 ringVertexCount = sliceCount + 1;
+	uint32 ringCount = stackCount - 1;
 
-			v.TexC.x = theta / XM_2PI;
-			v.TexC.y = phi / XM_PI;
+	meshData.Vertices.resize(2 + ringCount * ringVertexCount);
+	meshData.Vertices.front() = topVertex;
+	meshData.Vertices.back() = bottomVertex;
 
-			meshData.Vertices.push_back(v);
+	// Compute vertices for each stack ring (do not count the poles as rings).
+	// The rings don't depend on each other so they are computed in parallel.
+	ThreadPool::Get().ParallelFor(ringCount, ItemsPerTask(ringVertexCount), [&](size_t begin, size_t end)
+	{
+		for (uint32 i = (uint32)begin + 1; i <= (uint32)end; ++i)
+		{
+			float phi = i * phiStep;
+			float sinPhi, cosPhi;
+			XMScalarSinCos(&sinPhi, &cosPhi, phi);
+
+			// Vertices of ring.
+			Vertex* ring = &meshData.Vertices[1 + (i - 1) * ringVertexCount];
+			for (uint32 j = 0; j <= sliceCount; ++j)
+			{
+				Vertex& v = ring[j];
+
+				// spherical to cartesian, the normal is the position on the unit sphere
+				v.Normal = XMFLOAT3(sinPhi * cosTheta[j], cosPhi, sinPhi * sinTheta[j]);
+				v.Position = XMFLOAT3(radius * v.Normal.x, radius * v.Normal.y, radius * v.Normal.z);
+
+				// Partial derivative of P with respect to theta, normalized
+				v.TangentU = XMFLOAT3(-sinTheta[j], 0.0f, cosTheta[j]);
+
+				v.TexC.x = j * thetaStep / XM_2PI;
+				v.TexC.y = phi / XM_PI;
+			}
 		}
-	}
+	});
 
-	meshData.Vertices.push_back(bottomVertex);
+	meshData.Indices32.resize(6 * sliceCount * ringCount);
+	uint32* indices = meshData.Indices32.data();
 
 	//
 	// Compute indices for top stack.  The top stack was written first to the vertex buffer
@@ -188,9 +223,9 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 
 	for (uint32 i = 1; i <= sliceCount; ++i)
 	{
-		meshData.Indices32.push_back(0);
-		meshData.Indices32.push_back(i + 1);
-		meshData.Indices32.push_back(i);
+		*indices++ = 0;
+		*indices++ = i + 1;
+		*indices++ = i;
 	}
 
 	//
@@ -200,20 +235,25 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 	// Offset the indices to the index of the first vertex in the first ring.
 	// This is just skipping the top pole vertex.
 	uint32 baseIndex = 1;
-	uint32 ringVertexCount = sliceCount + 1;
-	for (uint32 i = 0; i < stackCount - 2; ++i)
+	uint32* innerIndices = indices;
+	ThreadPool::Get().ParallelFor(stackCount - 2, ItemsPerTask(6 * sliceCount), [&](size_t begin, size_t end)
 	{
-		for (uint32 j = 0; j < sliceCount; ++j)
+		for (uint32 i = (uint32)begin; i < (uint32)end; ++i)
 		{
-			meshData.Indices32.push_back(baseIndex + i * ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i * ringVertexCount + j + 1);
-			meshData.Indices32.push_back(baseIndex + (i + 1) * ringVertexCount + j);
-
-			meshData.Indices32.push_back(baseIndex + (i + 1) * ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i * ringVertexCount + j + 1);
-			meshData.Indices32.push_back(baseIndex + (i + 1) * ringVertexCount + j + 1);
+			uint32* quad = innerIndices + i * 6 * sliceCount;
+			for (uint32 j = 0; j < sliceCount; ++j, quad += 6)
+			{
+				quad[0] = baseIndex + i * ringVertexCount + j;
+				quad[1] = baseIndex + i * ringVertexCount + j + 1;
+				quad[2] = baseIndex + (i + 1) * ringVertexCount + j;
+
+				quad[3] = baseIndex + (i + 1) * ringVertexCount + j;
+				quad[4] = baseIndex + i * ringVertexCount + j + 1;
+				quad[5] = baseIndex + (i + 1) * ringVertexCount + j + 1;
+			}
 		}
-	}
+	});
+	indices += (stackCount - 2) * 6 * sliceCount;
 
 	//
 	// Compute indices for bottom stack.  The bottom stack was written last to the vertex buffer
@@ -228,9 +268,9 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 
 	for (uint32 i = 0; i < sliceCount; ++i)
 	{
-		meshData.Indices32.push_back(southPoleIndex);
-		meshData.Indices32.push_back(baseIndex + i);
-		meshData.Indices32.push_back(baseIndex + i + 1);
+		*indices++ = southPoleIndex;
+		*indices++ = baseIndex + i;
+		*indices++ = baseIndex + i + 1;
 	}
 
 	return meshData;
@@ -238,12 +278,6 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 
 void GeometryGenerator::Subdivide(MeshData& meshData)
 {
-	// Save a copy of the input geometry.
-	MeshData inputCopy = meshData;
-
-	meshData.Vertices.resize(0);
-	meshData.Indices32.resize(0);
-
 	//       v1
 	//       *
 	//      / \
@@ -254,47 +288,73 @@ void GeometryGenerator::Subdivide(MeshData& meshData)
 	// *-----*-----*
 	// v0    m2     v2
 
-	uint32 numTris = (uint32)inputCopy.Indices32.size() / 3;
-	for (uint32 i = 0; i < numTris; ++i)
+	// The input vertices are kept and the midpoints appended, every edge gets a single
+	// midpoint shared by the triangles on both sides.
+	std::vector<uint32> inputIndices;
+	inputIndices.swap(meshData.Indices32);
+
+	const size_t numTris = inputIndices.size() / 3;
+
+	// a closed mesh has 3/2 edges per triangle, open ones (box faces) grow a bit more
+	const size_t numEdges = numTris * 3 / 2;
+	meshData.Vertices.reserve(meshData.Vertices.size() + numEdges);
+	meshData.Indices32.resize(numTris * 12);
+
+	// Edge -> midpoint index, open addressing with linear probing in a table kept at most half full.
+	// A node based map spends more time allocating than subdividing at the deep levels.
+	uint32 tableBits = 1;
+	while ((size_t(1) << tableBits) < numEdges * 2)
+		++tableBits;
+	const size_t tableMask = (size_t(1) << tableBits) - 1;
+	const uint64_t emptyKey = ~0ull;
+	std::vector<uint64_t> edgeKeys(tableMask + 1, emptyKey);
+	std::vector<uint32> edgeMidPoints(tableMask + 1);
+
+	auto getMidPoint = [&](uint32 a, uint32 b)
+	{
+		const uint64_t key = a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+		size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ull) >> (64 - tableBits));
+		while (edgeKeys[slot] != emptyKey)
+		{
+			if (edgeKeys[slot] == key)
+				return edgeMidPoints[slot];
+			slot = (slot + 1) & tableMask;
+		}
+
+		const Vertex m = MidPoint(meshData.Vertices[a], meshData.Vertices[b]);
+		const uint32 index = (uint32)meshData.Vertices.size();
+		meshData.Vertices.push_back(m);
+		edgeKeys[slot] = key;
+		edgeMidPoints[slot] = index;
+		return index;
+	};
+
+	uint32* indices = meshData.Indices32.data();
+	for (size_t i = 0; i < numTris; ++i)
 	{
-		Vertex v0 = inputCopy.Vertices[inputCopy.Indices32[i * 3 + 0]];
-		Vertex v1 = inputCopy.Vertices[inputCopy.Indices32[i * 3 + 1]];
-		Vertex v2 = inputCopy.Vertices[inputCopy.Indices32[i * 3 + 2]];
-
-		//
-		// Generate the midpoints.
-		//
-
-		Vertex m0 = MidPoint(v0, v1);
-		Vertex m1 = MidPoint(v1, v2);
-		Vertex m2 = MidPoint(v0, v2);
-
-		//
-		// Add new geometry.
-		//
-
-		meshData.Vertices.push_back(v0); // 0
-		meshData.Vertices.push_back(v1); // 1
-		meshData.Vertices.push_back(v2); // 2
-		meshData.Vertices.push_back(m0); // 3
-		meshData.Vertices.push_back(m1); // 4
-		meshData.Vertices.push_back(m2); // 5
-
-		meshData.Indices32.push_back(i * 6 + 0);
-		meshData.Indices32.push_back(i * 6 + 3);
-		meshData.Indices32.push_back(i * 6 + 5);
-
-		meshData.Indices32.push_back(i * 6 + 3);
-		meshData.Indices32.push_back(i * 6 + 4);
-		meshData.Indices32.push_back(i * 6 + 5);
-
-		meshData.Indices32.push_back(i * 6 + 5);
-		meshData.Indices32.push_back(i * 6 + 4);
-		meshData.Indices32.push_back(i * 6 + 2);
-
-		meshData.Indices32.push_back(i * 6 + 3);
-		meshData.Indices32.push_back(i * 6 + 1);
-		meshData.Indices32.push_back(i * 6 + 4);
+		const uint32 v0 = inputIndices[i * 3 + 0];
+		const uint32 v1 = inputIndices[i * 3 + 1];
+		const uint32 v2 = inputIndices[i * 3 + 2];
+
+		const uint32 m0 = getMidPoint(v0, v1);
+		const uint32 m1 = getMidPoint(v1, v2);
+		const uint32 m2 = getMidPoint(v0, v2);
+
+		*indices++ = v0;
+		*indices++ = m0;
+		*indices++ = m2;
+
+		*indices++ = m0;
+		*indices++ = m1;
+		*indices++ = m2;
+
+		*indices++ = m2;
+		*indices++ = m1;
+		*indices++ = v2;
+
+		*indices++ = m0;
+		*indices++ = v1;
+		*indices++ = m1;
 	}
 }
 
@@ -332,8 +392,8 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uin
 {
 	MeshData meshData;
 
-	// Put a cap on the number of subdivisions.
-	numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+	// Put a cap on the number of subdivisions, 655k vertices and 1.3M triangles at the last level.
+	numSubdivisions = std::min<uint32>(numSubdivisions, MAX_GEOSPHERE_SUBDIVISIONS);
 
 	// Approximate a sphere by tessellating an icosahedron.
 
@@ -366,37 +426,41 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uin
 		Subdivide(meshData);
 
 	// Project vertices onto sphere and scale.
-	for (uint32 i = 0; i < meshData.Vertices.size(); ++i)
+	Vertex* vertices = meshData.Vertices.data();
+	ThreadPool::Get().ParallelFor(meshData.Vertices.size(), ITEMS_PER_TASK, [&](size_t begin, size_t end)
 	{
-		// Project onto unit sphere.
-		XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&meshData.Vertices[i].Position));
+		for (size_t i = begin; i < end; ++i)
+		{
+			// Project onto unit sphere.
+			XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&vertices[i].Position));
 
-		// Project onto sphere.
-		XMVECTOR p = radius * n;
+			// Project onto sphere.
+			XMVECTOR p = radius * n;
 
-		XMStoreFloat3(&meshData.Vertices[i].Position, p);
-		XMStoreFloat3(&meshData.Vertices[i].Normal, n);
+			XMStoreFloat3(&vertices[i].Position, p);
+			XMStoreFloat3(&vertices[i].Normal, n);
 
-		// Derive texture coordinates from spherical coordinates.
-		float theta = atan2f(meshData.Vertices[i].Position.z, meshData.Vertices[i].Position.x);
+			// Derive texture coordinates from spherical coordinates.
+			float theta = atan2f(vertices[i].Position.z, vertices[i].Position.x);
 
-		// Put in [0, 2pi].
-		if (theta < 0.0f)
-			theta += XM_2PI;
+			// Put in [0, 2pi].
+			if (theta < 0.0f)
+				theta += XM_2PI;
 
-		float phi = acosf(meshData.Vertices[i].Position.y / radius);
+			float phi = acosf(vertices[i].Position.y / radius);
 
-		meshData.Vertices[i].TexC.x = theta / XM_2PI;
-		meshData.Vertices[i].TexC.y = phi / XM_PI;
+			vertices[i].TexC.x = theta / XM_2PI;
+			vertices[i].TexC.y = phi / XM_PI;
 
-		// Partial derivative of P with respect to theta
-		meshData.Vertices[i].TangentU.x = -radius * sinf(phi) * sinf(theta);
-		meshData.Vertices[i].TangentU.y = 0.0f;
-		meshData.Vertices[i].TangentU.z = +radius * sinf(phi) * cosf(theta);
+			// Partial derivative of P with respect to theta
+			vertices[i].TangentU.x = -radius * sinf(phi) * sinf(theta);
+			vertices[i].TangentU.y = 0.0f;
+			vertices[i].TangentU.z = +radius * sinf(phi) * cosf(theta);
 
-		XMVECTOR T = XMLoadFloat3(&meshData.Vertices[i].TangentU);
-		XMStoreFloat3(&meshData.Vertices[i].TangentU, XMVector3Normalize(T));
-	}
+			XMVECTOR T = XMLoadFloat3(&vertices[i].TangentU);
+			XMStoreFloat3(&vertices[i].TangentU, XMVector3Normalize(T));
+		}
+	});
 
 	return meshData;
 }
@@ -416,78 +480,91 @@ GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius
 
 	uint32 ringCount = stackCount + 1;
 
+	// Add one because we duplicate the first and last vertex per ring
+	// since the texture coordinates are different.
+	uint32 ringVertexCount = sliceCount + 1;
+
+	// Every ring uses the same angles around the y-axis.
+	float dTheta = 2.0f * XM_PI / sliceCount;
+	std::vector<float> sinTheta, cosTheta;
+	ComputeSinCos(dTheta, ringVertexCount, sinTheta, cosTheta);
+
+	// Cylinder can be parameterized as follows, where we introduce v
+	// parameter that goes in the same direction as the v tex-coord
+	// so that the bitangent goes in the same direction as the v tex-coord.
+	//   Let r0 be the bottom radius and let r1 be the top radius.
+	//   y(v) = h - hv for v in [0,1].
+	//   r(v) = r1 + (r0-r1)v
+	//
+	//   x(t, v) = r(v)*cos(t)
+	//   y(t, v) = h - hv
+	//   z(t, v) = r(v)*sin(t)
+	//
+	//  dx/dt = -r(v)*sin(t)
+	//  dy/dt = 0
+	//  dz/dt = +r(v)*cos(t)
+	//
+	//  dx/dv = (r0-r1)*cos(t)
+	//  dy/dv = -h
+	//  dz/dv = (r0-r1)*sin(t)
+	//
+	// The normal is cross(dP/dt, dP/dv) = (h*cos(t), r0-r1, h*sin(t)), its length
+	// doesn't depend on t.
+	float dr = bottomRadius - topRadius;
+	float normalScale = 1.0f / sqrtf(height * height + dr * dr);
+
+	meshData.Vertices.resize(ringCount * ringVertexCount);
+
 	// Compute vertices for each stack ring starting at the bottom and moving up.
-	for (uint32 i = 0; i < ringCount; ++i)
+	// The rings don't depend on each other so they are computed in parallel.
+	ThreadPool::Get().ParallelFor(ringCount, ItemsPerTask(ringVertexCount), [&](size_t begin, size_t end)
 	{
-		float y = -0.5f * height + i * stackHeight;
-		float r = bottomRadius + i * radiusStep;
-
-		// vertices of ring
-		float dTheta = 2.0f * XM_PI / sliceCount;
-		for (uint32 j = 0; j <= sliceCount; ++j)
+		for (uint32 i = (uint32)begin; i < (uint32)end; ++i)
 		{
-			Vertex vertex;
-
-			float c = cosf(j * dTheta);
-			float s = sinf(j * dTheta);
-
-			vertex.Position = XMFLOAT3(r * c, y, r * s);
-
-			vertex.TexC.x = (float)j / sliceCount;
-			vertex.TexC.y = 1.0f - (float)i / stackCount;
-
-			// Cylinder can be parameterized as follows, where we introduce v
-			// parameter that goes in the same direction as the v tex-coord
-			// so that the bitangent goes in the same direction as the v tex-coord.
-			//   Let r0 be the bottom radius and let r1 be the top radius.
-			//   y(v) = h - hv for v in [0,1].
-			//   r(v) = r1 + (r0-r1)v
-			//
-			//   x(t, v) = r(v)*cos(t)
-			//   y(t, v) = h - hv
-			//   z(t, v) = r(v)*sin(t)
-			//
-			//  dx/dt = -r(v)*sin(t)
-			//  dy/dt = 0
-			//  dz/dt = +r(v)*cos(t)
-			//
-			//  dx/dv = (r0-r1)*cos(t)
-			//  dy/dv = -h
-			//  dz/dv = (r0-r1)*sin(t)
-
-			// This is unit length.
-			vertex.TangentU = XMFLOAT3(-s, 0.0f, c);
-
-			float dr = bottomRadius - topRadius;
-			XMFLOAT3 bitangent(dr * c, -height, dr * s);
-
-			XMVECTOR T = XMLoadFloat3(&vertex.TangentU);
-			XMVECTOR B = XMLoadFloat3(&bitangent);
-			XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
-			XMStoreFloat3(&vertex.Normal, N);
-
-			meshData.Vertices.push_back(vertex);
-		}
-	}
+			float y = -0.5f * height + i * stackHeight;
+			float r = bottomRadius + i * radiusStep;
 
-	// Add one because we duplicate the first and last vertex per ring
-	// since the texture coordinates are different.
-	uint32 ringVertexCount = sliceCount + 1;
+			// vertices of ring
+			Vertex* ring = &meshData.Vertices[i * ringVertexCount];
+			for (uint32 j = 0; j <= sliceCount; ++j)
+			{
+				Vertex& vertex = ring[j];
+
+				float c = cosTheta[j];
+				float s = sinTheta[j];
+
+				vertex.Position = XMFLOAT3(r * c, y, r * s);
+
+				vertex.TexC.x = (float)j / sliceCount;
+				vertex.TexC.y = 1.0f - (float)i / stackCount;
+
+				// This is unit length.
+				vertex.TangentU = XMFLOAT3(-s, 0.0f, c);
+
+				vertex.Normal = XMFLOAT3(height * c * normalScale, dr * normalScale, height * s * normalScale);
+			}
+		}
+	});
 
 	// Compute indices for each stack.
-	for (uint32 i = 0; i < stackCount; ++i)
+	meshData.Indices32.resize(6 * sliceCount * stackCount);
+	ThreadPool::Get().ParallelFor(stackCount, ItemsPerTask(6 * sliceCount), [&](size_t begin, size_t end)
 	{
-		for (uint32 j = 0; j < sliceCount; ++j)
+		for (uint32 i = (uint32)begin; i < (uint32)end; ++i)
 		{
-			meshData.Indices32.push_back(i * ringVertexCount + j);
-			meshData.Indices32.push_back((i + 1) * ringVertexCount + j);
-			meshData.Indices32.push_back((i + 1) * ringVertexCount + j + 1);
-
-			meshData.Indices32.push_back(i * ringVertexCount + j);
-			meshData.Indices32.push_back((i + 1) * ringVertexCount + j + 1);
-			meshData.Indices32.push_back(i * ringVertexCount + j + 1);
+			uint32* quad = &meshData.Indices32[i * 6 * sliceCount];
+			for (uint32 j = 0; j < sliceCount; ++j, quad += 6)
+			{
+				quad[0] = i * ringVertexCount + j;
+				quad[1] = (i + 1) * ringVertexCount + j;
+				quad[2] = (i + 1) * ringVertexCount + j + 1;
+
+				quad[3] = i * ringVertexCount + j;
+				quad[4] = (i + 1) * ringVertexCount + j + 1;
+				quad[5] = i * ringVertexCount + j + 1;
+			}
 		}
-	}
+	});
 
 	BuildCylinderTopCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
 	BuildCylinderBottomCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
@@ -502,12 +579,14 @@ void GeometryGenerator::BuildCylinderTopCap(float bottomRadius, float topRadius,
 
 	float y = 0.5f * height;
 	float dTheta = 2.0f * XM_PI / sliceCount;
+	std::vector<float> sinTheta, cosTheta;
+	ComputeSinCos(dTheta, sliceCount + 1, sinTheta, cosTheta);
 
 	// Duplicate cap ring vertices because the texture coordinates and normals differ.
 	for (uint32 i = 0; i <= sliceCount; ++i)
 	{
-		float x = topRadius * cosf(i * dTheta);
-		float z = topRadius * sinf(i * dTheta);
+		float x = topRadius * cosTheta[i];
+		float z = topRadius * sinTheta[i];
 
 		// Scale down by the height to try and make top cap texture coord area
 		// proportional to base.
@@ -543,10 +622,12 @@ void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadi
 
 	// vertices of ring
 	float dTheta = 2.0f * XM_PI / sliceCount;
+	std::vector<float> sinTheta, cosTheta;
+	ComputeSinCos(dTheta, sliceCount + 1, sinTheta, cosTheta);
 	for (uint32 i = 0; i <= sliceCount; ++i)
 	{
-		float x = bottomRadius * cosf(i * dTheta);
-		float z = bottomRadius * sinf(i * dTheta);
+		float x = bottomRadius * cosTheta[i];
+		float z = bottomRadius * sinTheta[i];
 
 		// Scale down by the height to try and make top cap texture coord area
 		// proportional to base.
@@ -590,23 +671,27 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 	float du = 1.0f / (n - 1);
 	float dv = 1.0f / (m - 1);
 
+	// The rows are independent, they are computed in parallel.
 	meshData.Vertices.resize(vertexCount);
-	for (uint32 i = 0; i < m; ++i)
+	ThreadPool::Get().ParallelFor(m, ItemsPerTask(n), [&](size_t begin, size_t end)
 	{
-		float z = halfDepth - i * dz;
-		for (uint32 j = 0; j < n; ++j)
+		for (uint32 i = (uint32)begin; i < (uint32)end; ++i)
 		{
-			float x = -halfWidth + j * dx;
-
-			meshData.Vertices[i * n + j].Position = XMFLOAT3(x, 0.0f, z);
-			meshData.Vertices[i * n + j].Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-			meshData.Vertices[i * n + j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			// Stretch texture over grid.
-			meshData.Vertices[i * n + j].TexC.x = j * du;
-			meshData.Vertices[i * n + j].TexC.y = i * dv;
+			float z = halfDepth - i * dz;
+			for (uint32 j = 0; j < n; ++j)
+			{
+				float x = -halfWidth + j * dx;
+
+				meshData.Vertices[i * n + j].Position = XMFLOAT3(x, 0.0f, z);
+				meshData.Vertices[i * n + j].Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+				meshData.Vertices[i * n + j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
+
+				// Stretch texture over grid.
+				meshData.Vertices[i * n + j].TexC.x = j * du;
+				meshData.Vertices[i * n + j].TexC.y = i * dv;
+			}
 		}
-	}
+	});
 
 	//
 	// Create the indices.
@@ -615,22 +700,25 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 	meshData.Indices32.resize(faceCount * 3); // 3 indices per face
 
 	// Iterate over each quad and compute indices.
-	uint32 k = 0;
-	for (uint32 i = 0; i < m - 1; ++i)
+	ThreadPool::Get().ParallelFor(m - 1, ItemsPerTask(6 * (n - 1)), [&](size_t begin, size_t end)
 	{
-		for (uint32 j = 0; j < n - 1; ++j)
+		for (uint32 i = (uint32)begin; i < (uint32)end; ++i)
 		{
-			meshData.Indices32[k] = i * n + j;
-			meshData.Indices32[k + 1] = i * n + j + 1;
-			meshData.Indices32[k + 2] = (i + 1) * n + j;
-
-			meshData.Indices32[k + 3] = (i + 1) * n + j;
-			meshData.Indices32[k + 4] = i * n + j + 1;
-			meshData.Indices32[k + 5] = (i + 1) * n + j + 1;
-
-			k += 6; // next quad
+			uint32 k = i * (n - 1) * 6;
+			for (uint32 j = 0; j < n - 1; ++j)
+			{
+				meshData.Indices32[k] = i * n + j;
+				meshData.Indices32[k + 1] = i * n + j + 1;
+				meshData.Indices32[k + 2] = (i + 1) * n + j;
+
+				meshData.Indices32[k + 3] = (i + 1) * n + j;
+				meshData.Indices32[k + 4] = i * n + j + 1;
+				meshData.Indices32[k + 5] = (i + 1) * n + j + 1;
+
+				k += 6; // next quad
+			}
 		}
-	}
+	});
 
 	return meshData;
 }
@@ -0,0 +1,252 @@
+#include "pch.h"
+#include "ImageImporter.h"
+#include "ImageLoader.h"
+#include "TextureEncoder.h"
+#include "TextureDecoder.h"
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+#include "Defines.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+
+namespace ImageImporter
+{
+	// hashed with the file, changing them converts the cached files again
+	static constexpr uint64_t IMPORTER_VERSION = 2;
+	static constexpr MipFilter IMPORT_MIP_FILTER = MipFilter::Kaiser;
+
+	static std::string ToLower(std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		return text;
+	}
+
+	static std::string GetExtension(const std::string& path)
+	{
+		return ToLower(std::filesystem::path(path).extension().string());
+	}
+
+	static bool IsNormalMap(const std::string& path)
+	{
+		const std::string name = ToLower(std::filesystem::path(path).stem().string());
+		for (const char* suffix : { "_n", "_nrm", "_norm", "_normal" })
+		{
+			const size_t length = std::strlen(suffix);
+			if (name.size() > length && name.compare(name.size() - length, length, suffix) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	static bool ReadImageFile(const std::string& path, std::vector<uint8_t>& data)
+	{
+		std::ifstream in(path, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+		if (!in.is_open())
+			return false;
+
+		data.resize((size_t)in.tellg());
+		in.seekg(0);
+		in.read((char*)data.data(), data.size());
+		return in.good();
+	}
+
+	// FNV-1a of the file and the settings the result depends on
+	static uint64_t HashFile(const std::vector<uint8_t>& data)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		auto add = [&hash](uint8_t byte)
+		{
+			hash ^= byte;
+			hash *= 1099511628211ull;
+		};
+
+		for (uint8_t byte : data)
+			add(byte);
+		for (uint32_t i = 0; i < 8; ++i)
+			add((uint8_t)(IMPORTER_VERSION >> (8 * i)));
+		add(IMPORT_COLOR_AS_BC7 ? 1 : 0);
+		add((uint8_t)IMPORT_MIP_FILTER);
+		return hash;
+	}
+
+	static std::string GetCachePath(const std::string& path, const std::vector<uint8_t>& data)
+	{
+		std::ostringstream cachePath;
+		cachePath << TEXTURE_CACHE_DIR << "/" << std::filesystem::path(path).stem().string() << "_"
+			<< std::hex << std::setw(16) << std::setfill('0') << HashFile(data) << ".dds";
+		return cachePath.str();
+	}
+
+	// Written next to the final path and renamed, an interrupted import isn't taken as cached
+	static bool WriteCache(const std::string& cachePath, DXGI_FORMAT format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& mips)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(TEXTURE_CACHE_DIR, error);
+		const std::string tempPath = cachePath + ".tmp";
+		if (!TextureEncoder::WriteDDS(tempPath, format, width, height, mips))
+			return false;
+
+		std::filesystem::rename(tempPath, cachePath, error);
+		if (error)
+		{
+			LOG_ERROR("Failed to write {0}: {1}", cachePath, error.message());
+			return false;
+		}
+		return true;
+	}
+
+	static bool DecodeImage(const std::string& path, const std::vector<uint8_t>& data, DecodedImage& image, FloatImage& hdrImage)
+	{
+		const std::string extension = GetExtension(path);
+		if (extension == ".hdr")
+			return ImageLoader::LoadHDR(data, hdrImage);
+		if (extension == ".tga")
+			return ImageLoader::LoadTGA(data, image);
+		return ImageLoader::LoadPNG(data, image);
+	}
+
+	bool IsImportable(const std::string& path)
+	{
+		const std::string extension = GetExtension(path);
+		return extension == ".png" || extension == ".tga" || extension == ".hdr";
+	}
+
+	DXGI_FORMAT ChooseFormat(const std::string& path, bool hasAlpha, bool isHdr)
+	{
+		if (isHdr)
+			return DXGI_FORMAT_R16G16B16A16_FLOAT;
+		if (IsNormalMap(path))
+			return DXGI_FORMAT_BC5_UNORM;
+		if (IMPORT_COLOR_AS_BC7)
+			return DXGI_FORMAT_BC7_UNORM_SRGB;
+		return hasAlpha ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM_SRGB;
+	}
+
+	std::string Import(const std::string& path)
+	{
+		std::vector<uint8_t> data;
+		if (!ReadImageFile(path, data))
+		{
+			LOG_ERROR("Failed to read image {0}", path);
+			return "";
+		}
+
+		const std::string cachePath = GetCachePath(path, data);
+		if (std::filesystem::exists(cachePath))
+		{
+			LOG_TRACE("Image {0} already imported to {1}", path, cachePath);
+			return cachePath;
+		}
+
+		const auto startTime = std::chrono::steady_clock::now();
+
+		DecodedImage image;
+		FloatImage hdrImage;
+		if (!DecodeImage(path, data, image, hdrImage))
+		{
+			LOG_ERROR("Failed to decode image {0}", path);
+			return "";
+		}
+
+		const bool isHdr = !hdrImage.Pixels.empty();
+		const bool hasAlpha = std::any_of(image.Pixels.begin(), image.Pixels.end(), [](uint32_t p) { return (p >> 24) != 0xff; });
+		const DXGI_FORMAT format = ChooseFormat(path, hasAlpha, isHdr);
+
+		// filtered in linear space, then stored as RGBA8 (in sRGB for the sRGB formats) for the encoder
+		const DXGI_FORMAT pixelFormat = isHdr ? DXGI_FORMAT_R16G16B16A16_FLOAT
+			: (MipGenerator::IsSRGB(format) ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM);
+		std::vector<FloatImage> levels(1);
+		if (isHdr)
+			levels[0] = std::move(hdrImage);
+		else
+			MipGenerator::Load(pixelFormat, (const uint8_t*)image.Pixels.data(), image.Width * sizeof(uint32_t), image.Width, image.Height, levels[0]);
+		MipGenerator::Generate(IMPORT_MIP_FILTER, levels);
+
+		std::vector<std::vector<uint8_t>> mips(levels.size());
+		std::vector<uint8_t> pixels;
+		for (size_t i = 0; i < levels.size(); ++i)
+		{
+			const FloatImage& level = levels[i];
+			if (isHdr)
+			{
+				MipGenerator::Store(pixelFormat, level, mips[i]);
+				continue;
+			}
+
+			MipGenerator::Store(pixelFormat, level, pixels);
+			mips[i].resize(TextureEncoder::GetEncodedSize(format, level.Width, level.Height));
+			TextureEncoder::Encode(format, (const uint32_t*)pixels.data(), level.Width, level.Height, mips[i].data());
+		}
+
+		const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime);
+		const uint32_t width = levels[0].Width;
+		const uint32_t height = levels[0].Height;
+		LOG_INFO("Imported [{0}]: {1}x{2}, {3} mips, {4} in {5:.2f} ms ({6:.1f} MPix/s, {7} threads)",
+			path, width, height, mips.size(), magic_enum::enum_name(format), elapsed.count(),
+			width * (double)height / (elapsed.count() * 1000.0), ThreadPool::Get().GetNumThreads());
+
+		if (!isHdr)
+		{
+			// quality of the finest mip against what was encoded (BC5 keeps only red and green)
+			DecodedImage reference;
+			reference.Width = width;
+			reference.Height = height;
+			MipGenerator::Store(pixelFormat, levels[0], pixels);
+			reference.Pixels.assign((const uint32_t*)pixels.data(), (const uint32_t*)pixels.data() + (size_t)width * height);
+			if (format == DXGI_FORMAT_BC5_UNORM)
+			{
+				for (uint32_t& p : reference.Pixels)
+					p = (p & 0xffff) | 0xff000000;
+			}
+
+			DecodedImage decoded;
+			decoded.Width = width;
+			decoded.Height = height;
+			decoded.Pixels.resize(reference.Pixels.size());
+			const uint32_t rowPitch = (uint32_t)(mips[0].size() / std::max(1u, (height + 3) / 4));
+			TextureDecoder::Decode(format, mips[0].data(), rowPitch, width, height, decoded.Pixels.data());
+
+			const ImageDiff diff = TextureDecoder::Compare(reference, decoded);
+			LOG_INFO("Imported [{0}]: PSNR {1:.2f} dB, max error {2}", path, diff.Psnr, diff.MaxError);
+		}
+
+		return WriteCache(cachePath, format, width, height, mips) ? cachePath : "";
+	}
+
+	std::string ImportDDS(const std::string& path)
+	{
+		DDSFile file;
+		if (!TextureDecoder::ReadDDS(path, file) || file.MipOffsets.size() > 1 || file.NumSlices > 1 ||
+			(file.Width == 1 && file.Height == 1) || !MipGenerator::IsSupported(file.Format))
+			return path;
+
+		const std::string cachePath = GetCachePath(path, file.Data);
+		if (std::filesystem::exists(cachePath))
+		{
+			LOG_TRACE("Mips of {0} already generated in {1}", path, cachePath);
+			return cachePath;
+		}
+
+		const auto startTime = std::chrono::steady_clock::now();
+
+		std::vector<FloatImage> levels(1);
+		MipGenerator::Load(file.Format, file.Data.data() + file.MipOffsets[0], (size_t)file.Width * MipGenerator::GetPixelBytes(file.Format), file.Width, file.Height, levels[0]);
+		MipGenerator::Generate(IMPORT_MIP_FILTER, levels);
+
+		std::vector<std::vector<uint8_t>> mips(levels.size());
+		for (size_t i = 0; i < levels.size(); ++i)
+			MipGenerator::Store(file.Format, levels[i], mips[i]);
+
+		const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime);
+		LOG_INFO("Generated {0} mips of [{1}] ({2}x{3} {4}) in {5:.2f} ms ({6:.1f} MPix/s, {7} threads)",
+			mips.size(), path, file.Width, file.Height, magic_enum::enum_name(file.Format), elapsed.count(),
+			file.Width * (double)file.Height / (elapsed.count() * 1000.0), ThreadPool::Get().GetNumThreads());
+
+		return WriteCache(cachePath, file.Format, file.Width, file.Height, mips) ? cachePath : path;
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <dxgiformat.h>
+#include <string>
+
+// Converts the PNG, TGA and HDR files opened by the texture nodes to block compressed DDS files
+// with a full mip chain, which DDSTextureLoader then loads like any other DDS. The result is cached
+// in TEXTURE_CACHE_DIR under the hash of the source file, so an image is only converted again when
+// it changes. The format is chosen from the file name and contents:
+//   .hdr                                      -> R16G16B16A16_FLOAT
+//   name ending with _n, _nrm, _norm, _normal -> BC5_UNORM (X and Y in red and green, Z rebuilt in the shader)
+//   anything else                             -> BC7_UNORM_SRGB, or BC1/BC3_UNORM_SRGB without IMPORT_COLOR_AS_BC7
+// The mips are filtered by MipGenerator (Kaiser). DDS files with a single mip in a format it
+// handles get the same treatment: a copy with the full chain in the cache, in the same format.
+namespace ImageImporter
+{
+	bool IsImportable(const std::string& path);
+
+	DXGI_FORMAT ChooseFormat(const std::string& path, bool hasAlpha, bool isHdr);
+
+	// Path of the converted DDS, empty when the image can't be read or the cache can't be written
+	std::string Import(const std::string& path);
+
+	// Path of the copy with the mips, the path itself when the DDS already has mips or can't get them
+	std::string ImportDDS(const std::string& path);
+}
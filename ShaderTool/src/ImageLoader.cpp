@@ -0,0 +1,726 @@
+#include "pch.h"
+#include "ImageLoader.h"
+#include "Defines.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace ImageLoader
+{
+	// Inflate, a canonical Huffman decoder reading one bit at a time like zlib's puff
+
+	static constexpr uint32_t MAX_CODE_BITS = 15;
+	static constexpr uint32_t NUM_LENGTH_SYMBOLS = 288;
+	static constexpr uint32_t NUM_DISTANCE_SYMBOLS = 30;
+
+	static constexpr uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static constexpr uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static constexpr uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	static constexpr uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	static constexpr uint8_t CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	struct BitStream
+	{
+		const uint8_t* Data;
+		size_t Size;
+		size_t Position{ 0 };
+		uint32_t Buffer{ 0 };
+		uint32_t NumBits{ 0 };
+		bool IsOverrun{ false };
+
+		uint32_t Read(uint32_t count)
+		{
+			while (NumBits < count)
+			{
+				if (Position >= Size)
+				{
+					IsOverrun = true;
+					return 0;
+				}
+				Buffer |= (uint32_t)Data[Position++] << NumBits;
+				NumBits += 8;
+			}
+
+			const uint32_t value = Buffer & ((1u << count) - 1);
+			Buffer >>= count;
+			NumBits -= count;
+			return value;
+		}
+	};
+
+	struct Huffman
+	{
+		uint16_t Counts[MAX_CODE_BITS + 1]; // number of codes of each length
+		uint16_t Symbols[NUM_LENGTH_SYMBOLS]; // ordered by code
+	};
+
+	// false when the lengths describe more codes than the bits allow, incomplete codes are valid
+	static bool BuildHuffman(Huffman& huffman, const uint8_t* lengths, uint32_t numSymbols)
+	{
+		std::memset(huffman.Counts, 0, sizeof(huffman.Counts));
+		for (uint32_t i = 0; i < numSymbols; ++i)
+			++huffman.Counts[lengths[i]];
+
+		int left = 1;
+		for (uint32_t len = 1; len <= MAX_CODE_BITS; ++len)
+		{
+			left = (left << 1) - huffman.Counts[len];
+			if (left < 0)
+				return false;
+		}
+
+		uint16_t offsets[MAX_CODE_BITS + 1];
+		offsets[1] = 0;
+		for (uint32_t len = 1; len < MAX_CODE_BITS; ++len)
+			offsets[len + 1] = offsets[len] + huffman.Counts[len];
+
+		for (uint32_t i = 0; i < numSymbols; ++i)
+		{
+			if (lengths[i] != 0)
+				huffman.Symbols[offsets[lengths[i]]++] = (uint16_t)i;
+		}
+		return true;
+	}
+
+	// -1 on a code that isn't in the table or at the end of the data
+	static int DecodeSymbol(BitStream& bits, const Huffman& huffman)
+	{
+		int code = 0;  // bits read so far
+		int first = 0; // first code of the current length
+		int index = 0; // symbol of the first code of the current length
+		for (uint32_t len = 1; len <= MAX_CODE_BITS; ++len)
+		{
+			code |= (int)bits.Read(1);
+			if (bits.IsOverrun)
+				return -1;
+
+			const int count = huffman.Counts[len];
+			if (code - first < count)
+				return huffman.Symbols[index + (code - first)];
+
+			index += count;
+			first = (first + count) << 1;
+			code <<= 1;
+		}
+		return -1;
+	}
+
+	// the decoding stops without error once maxSize bytes are out, the rest of the stream is not read
+	static bool InflateCodes(BitStream& bits, const Huffman& lengthCodes, const Huffman& distanceCodes, std::vector<uint8_t>& out, size_t maxSize)
+	{
+		while (out.size() < maxSize)
+		{
+			int symbol = DecodeSymbol(bits, lengthCodes);
+			if (symbol < 0)
+				return false;
+
+			if (symbol < 256)
+			{
+				out.push_back((uint8_t)symbol);
+				continue;
+			}
+
+			if (symbol == 256) // end of block
+				return true;
+
+			symbol -= 257;
+			if (symbol >= 29)
+				return false;
+			const size_t length = std::min<size_t>(LENGTH_BASE[symbol] + bits.Read(LENGTH_EXTRA[symbol]), maxSize - out.size());
+
+			const int distanceSymbol = DecodeSymbol(bits, distanceCodes);
+			if (distanceSymbol < 0 || distanceSymbol >= (int)NUM_DISTANCE_SYMBOLS)
+				return false;
+			const size_t distance = DISTANCE_BASE[distanceSymbol] + bits.Read(DISTANCE_EXTRA[distanceSymbol]);
+			if (bits.IsOverrun || distance > out.size())
+				return false;
+
+			// the copy can overlap the bytes it writes
+			const size_t from = out.size() - distance;
+			for (size_t i = 0; i < length; ++i)
+			{
+				const uint8_t value = out[from + i];
+				out.push_back(value);
+			}
+		}
+		return true;
+	}
+
+	static bool InflateStored(BitStream& bits, std::vector<uint8_t>& out, size_t maxSize)
+	{
+		// the length starts on the next byte
+		bits.Buffer = 0;
+		bits.NumBits = 0;
+		if (bits.Position + 4 > bits.Size)
+			return false;
+
+		const uint32_t length = bits.Data[bits.Position] | (bits.Data[bits.Position + 1] << 8);
+		const uint32_t complement = bits.Data[bits.Position + 2] | (bits.Data[bits.Position + 3] << 8);
+		bits.Position += 4;
+		if (length != (~complement & 0xffff) || bits.Position + length > bits.Size)
+			return false;
+
+		out.insert(out.end(), bits.Data + bits.Position, bits.Data + bits.Position + std::min<size_t>(length, maxSize - out.size()));
+		bits.Position += length;
+		return true;
+	}
+
+	static bool InflateFixed(BitStream& bits, std::vector<uint8_t>& out, size_t maxSize)
+	{
+		static Huffman lengthCodes, distanceCodes;
+		static const bool isBuilt = [] {
+			uint8_t lengths[NUM_LENGTH_SYMBOLS];
+			std::fill(lengths, lengths + 144, (uint8_t)8);
+			std::fill(lengths + 144, lengths + 256, (uint8_t)9);
+			std::fill(lengths + 256, lengths + 280, (uint8_t)7);
+			std::fill(lengths + 280, lengths + NUM_LENGTH_SYMBOLS, (uint8_t)8);
+			BuildHuffman(lengthCodes, lengths, NUM_LENGTH_SYMBOLS);
+
+			std::fill(lengths, lengths + NUM_DISTANCE_SYMBOLS, (uint8_t)5);
+			BuildHuffman(distanceCodes, lengths, NUM_DISTANCE_SYMBOLS);
+			return true;
+		}();
+
+		return isBuilt && InflateCodes(bits, lengthCodes, distanceCodes, out, maxSize);
+	}
+
+	static bool InflateDynamic(BitStream& bits, std::vector<uint8_t>& out, size_t maxSize)
+	{
+		const uint32_t numLengths = bits.Read(5) + 257;
+		const uint32_t numDistances = bits.Read(5) + 1;
+		const uint32_t numCodeLengths = bits.Read(4) + 4;
+		if (numLengths > 286 || numDistances > NUM_DISTANCE_SYMBOLS)
+			return false;
+
+		uint8_t lengths[NUM_LENGTH_SYMBOLS + NUM_DISTANCE_SYMBOLS] = {};
+		for (uint32_t i = 0; i < numCodeLengths; ++i)
+			lengths[CODE_LENGTH_ORDER[i]] = (uint8_t)bits.Read(3);
+
+		Huffman lengthCodes, distanceCodes;
+		if (!BuildHuffman(lengthCodes, lengths, 19))
+			return false;
+
+		// lengths of the literal/length and distance codes, run length encoded
+		std::memset(lengths, 0, 19);
+		uint32_t index = 0;
+		while (index < numLengths + numDistances)
+		{
+			const int symbol = DecodeSymbol(bits, lengthCodes);
+			if (symbol < 0)
+				return false;
+
+			if (symbol < 16)
+			{
+				lengths[index++] = (uint8_t)symbol;
+				continue;
+			}
+
+			uint8_t value = 0;
+			uint32_t repeat;
+			if (symbol == 16)
+			{
+				if (index == 0)
+					return false;
+				value = lengths[index - 1];
+				repeat = 3 + bits.Read(2);
+			}
+			else if (symbol == 17)
+				repeat = 3 + bits.Read(3);
+			else
+				repeat = 11 + bits.Read(7);
+
+			if (index + repeat > numLengths + numDistances)
+				return false;
+			while (repeat--)
+				lengths[index++] = value;
+		}
+
+		if (lengths[256] == 0) // no end of block code
+			return false;
+
+		if (!BuildHuffman(lengthCodes, lengths, numLengths) || !BuildHuffman(distanceCodes, lengths + numLengths, numDistances))
+			return false;
+
+		return InflateCodes(bits, lengthCodes, distanceCodes, out, maxSize);
+	}
+
+	bool Inflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out, size_t maxSize)
+	{
+		// zlib header: deflate, no preset dictionary
+		if (size < 2 || (data[0] & 0x0f) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20))
+			return false;
+
+		BitStream bits{ data + 2, size - 2 };
+		bool isLast = false;
+		while (!isLast && out.size() < maxSize)
+		{
+			isLast = bits.Read(1) != 0;
+			const uint32_t type = bits.Read(2);
+
+			bool isValid = false;
+			if (type == 0)
+				isValid = InflateStored(bits, out, maxSize);
+			else if (type == 1)
+				isValid = InflateFixed(bits, out, maxSize);
+			else if (type == 2)
+				isValid = InflateDynamic(bits, out, maxSize);
+
+			if (!isValid || bits.IsOverrun)
+				return false;
+		}
+		return true;
+	}
+
+	// PNG
+
+	static uint32_t ReadBigEndian32(const uint8_t* data)
+	{
+		return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+	}
+
+	static uint8_t PaethPredictor(int a, int b, int c)
+	{
+		const int p = a + b - c;
+		const int pa = std::abs(p - a);
+		const int pb = std::abs(p - b);
+		const int pc = std::abs(p - c);
+		if (pa <= pb && pa <= pc)
+			return (uint8_t)a;
+		return (uint8_t)(pb <= pc ? b : c);
+	}
+
+	bool LoadPNG(const std::vector<uint8_t>& data, DecodedImage& image)
+	{
+		static constexpr uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+		if (data.size() < sizeof(SIGNATURE) || std::memcmp(data.data(), SIGNATURE, sizeof(SIGNATURE)) != 0)
+		{
+			LOG_ERROR("Not a PNG file");
+			return false;
+		}
+
+		uint32_t width = 0, height = 0;
+		uint8_t bitDepth = 0, colorType = 0, interlace = 0;
+		uint8_t palette[256][4] = {};
+		int transparentGray = -1;
+		uint32_t transparentColor[3] = {};
+		bool hasTransparentColor = false;
+		std::vector<uint8_t> compressed;
+
+		size_t offset = sizeof(SIGNATURE);
+		while (offset + 12 <= data.size())
+		{
+			const uint32_t length = ReadBigEndian32(&data[offset]);
+			const uint8_t* type = &data[offset + 4];
+			const uint8_t* chunk = &data[offset + 8];
+			if (offset + 12 + (size_t)length > data.size())
+				break;
+
+			if (std::memcmp(type, "IHDR", 4) == 0 && length >= 13)
+			{
+				width = ReadBigEndian32(chunk);
+				height = ReadBigEndian32(chunk + 4);
+				bitDepth = chunk[8];
+				colorType = chunk[9];
+				interlace = chunk[12];
+			}
+			else if (std::memcmp(type, "PLTE", 4) == 0)
+			{
+				for (uint32_t i = 0; i < std::min(length / 3, 256u); ++i)
+				{
+					palette[i][0] = chunk[3 * i];
+					palette[i][1] = chunk[3 * i + 1];
+					palette[i][2] = chunk[3 * i + 2];
+					palette[i][3] = 255;
+				}
+			}
+			else if (std::memcmp(type, "tRNS", 4) == 0)
+			{
+				if (colorType == 3)
+				{
+					for (uint32_t i = 0; i < std::min(length, 256u); ++i)
+						palette[i][3] = chunk[i];
+				}
+				else if (colorType == 0 && length >= 2)
+					transparentGray = (chunk[0] << 8) | chunk[1];
+				else if (colorType == 2 && length >= 6)
+				{
+					for (uint32_t c = 0; c < 3; ++c)
+						transparentColor[c] = (chunk[2 * c] << 8) | chunk[2 * c + 1];
+					hasTransparentColor = true;
+				}
+			}
+			else if (std::memcmp(type, "IDAT", 4) == 0)
+				compressed.insert(compressed.end(), chunk, chunk + length);
+			else if (std::memcmp(type, "IEND", 4) == 0)
+				break;
+
+			offset += 12 + (size_t)length;
+		}
+
+		uint32_t numChannels = 0;
+		switch (colorType)
+		{
+		case 0: numChannels = 1; break; // gray
+		case 2: numChannels = 3; break; // RGB
+		case 3: numChannels = 1; break; // palette
+		case 4: numChannels = 2; break; // gray, alpha
+		case 6: numChannels = 4; break; // RGBA
+		}
+
+		const bool isValidDepth = bitDepth == 8 || (bitDepth == 16 && colorType != 3) || ((colorType == 0 || colorType == 3) && bitDepth < 8 && bitDepth != 0 && (8 % bitDepth) == 0);
+		if (width == 0 || height == 0 || width > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION || height > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION || numChannels == 0 || !isValidDepth)
+		{
+			LOG_ERROR("PNG: unsupported image ({0}x{1}, color type {2}, {3} bits)", width, height, colorType, bitDepth);
+			return false;
+		}
+
+		if (interlace != 0)
+		{
+			LOG_ERROR("PNG: interlaced images are not supported");
+			return false;
+		}
+
+		std::vector<uint8_t> filtered;
+		const size_t rowBytes = ((size_t)width * numChannels * bitDepth + 7) / 8;
+		const size_t filteredSize = (rowBytes + 1) * height;
+		filtered.reserve(filteredSize);
+		if (!Inflate(compressed.data(), compressed.size(), filtered, filteredSize) || filtered.size() < filteredSize)
+		{
+			LOG_ERROR("PNG: corrupted image data");
+			return false;
+		}
+
+		// each row starts with its filter type, the filters predict from the same channel of the previous pixel
+		const size_t pixelBytes = std::max<size_t>(1, numChannels * bitDepth / 8);
+		std::vector<uint8_t> rows(rowBytes * height);
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			const uint8_t filter = filtered[y * (rowBytes + 1)];
+			const uint8_t* in = &filtered[y * (rowBytes + 1) + 1];
+			uint8_t* row = &rows[y * rowBytes];
+			const uint8_t* prior = y > 0 ? row - rowBytes : nullptr;
+
+			for (size_t i = 0; i < rowBytes; ++i)
+			{
+				const int left = i >= pixelBytes ? row[i - pixelBytes] : 0;
+				const int up = prior ? prior[i] : 0;
+				const int upLeft = prior && i >= pixelBytes ? prior[i - pixelBytes] : 0;
+				switch (filter)
+				{
+				case 0: row[i] = in[i]; break;
+				case 1: row[i] = (uint8_t)(in[i] + left); break;
+				case 2: row[i] = (uint8_t)(in[i] + up); break;
+				case 3: row[i] = (uint8_t)(in[i] + ((left + up) >> 1)); break;
+				case 4: row[i] = (uint8_t)(in[i] + PaethPredictor(left, up, upLeft)); break;
+				default:
+					LOG_ERROR("PNG: unknown filter {0}", filter);
+					return false;
+				}
+			}
+		}
+
+		image.Width = width;
+		image.Height = height;
+		image.Pixels.resize((size_t)width * height);
+
+		// samples of the row, 16 bit ones are reduced to their high byte
+		const uint32_t sampleMax = (1u << std::min<uint32_t>(bitDepth, 16)) - 1;
+		auto sample = [&](const uint8_t* row, size_t index) -> uint32_t
+		{
+			if (bitDepth == 8)
+				return row[index];
+			if (bitDepth == 16)
+				return (row[2 * index] << 8) | row[2 * index + 1];
+
+			const size_t bit = index * bitDepth;
+			return (row[bit / 8] >> (8 - bitDepth - bit % 8)) & sampleMax;
+		};
+		auto to8 = [&](uint32_t value) -> uint32_t
+		{
+			return bitDepth == 16 ? value >> 8 : value * 255 / sampleMax;
+		};
+
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			const uint8_t* row = &rows[y * rowBytes];
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				uint32_t r, g, b, a = 255;
+				switch (colorType)
+				{
+				case 0:
+				{
+					const uint32_t gray = sample(row, x);
+					r = g = b = to8(gray);
+					if ((int)gray == transparentGray)
+						a = 0;
+					break;
+				}
+				case 2:
+				{
+					const uint32_t values[3] = { sample(row, 3 * x), sample(row, 3 * x + 1), sample(row, 3 * x + 2) };
+					r = to8(values[0]);
+					g = to8(values[1]);
+					b = to8(values[2]);
+					if (hasTransparentColor && values[0] == transparentColor[0] && values[1] == transparentColor[1] && values[2] == transparentColor[2])
+						a = 0;
+					break;
+				}
+				case 3:
+				{
+					const uint8_t* entry = palette[sample(row, x)];
+					r = entry[0];
+					g = entry[1];
+					b = entry[2];
+					a = entry[3];
+					break;
+				}
+				case 4:
+					r = g = b = to8(sample(row, 2 * x));
+					a = to8(sample(row, 2 * x + 1));
+					break;
+				default:
+					r = to8(sample(row, 4 * x));
+					g = to8(sample(row, 4 * x + 1));
+					b = to8(sample(row, 4 * x + 2));
+					a = to8(sample(row, 4 * x + 3));
+					break;
+				}
+				image.Pixels[(size_t)y * width + x] = r | (g << 8) | (b << 16) | (a << 24);
+			}
+		}
+		return true;
+	}
+
+	// TGA
+
+	bool LoadTGA(const std::vector<uint8_t>& data, DecodedImage& image)
+	{
+		static constexpr size_t HEADER_SIZE = 18;
+		if (data.size() < HEADER_SIZE)
+		{
+			LOG_ERROR("Not a TGA file");
+			return false;
+		}
+
+		const uint8_t idLength = data[0];
+		const uint8_t colorMapType = data[1];
+		const uint8_t imageType = data[2];
+		const uint32_t width = data[12] | (data[13] << 8);
+		const uint32_t height = data[14] | (data[15] << 8);
+		const uint32_t pixelBits = data[16];
+		const uint8_t descriptor = data[17];
+
+		const bool isRle = imageType == 10 || imageType == 11;
+		const bool isGray = imageType == 3 || imageType == 11;
+		const bool isValidType = imageType == 2 || imageType == 3 || isRle;
+		const bool isValidDepth = isGray ? pixelBits == 8 : (pixelBits == 24 || pixelBits == 32);
+		if (colorMapType != 0 || !isValidType || !isValidDepth || width == 0 || height == 0)
+		{
+			LOG_ERROR("TGA: unsupported image (type {0}, {1} bits, color map {2})", imageType, pixelBits, colorMapType);
+			return false;
+		}
+
+		if (width > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION || height > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION)
+		{
+			LOG_ERROR("TGA: {0}x{1} is larger than the biggest texture ({2})", width, height, D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION);
+			return false;
+		}
+
+		// 32 bit images without alpha bits in the descriptor keep garbage in the 4th byte
+		const bool hasAlpha = pixelBits == 32 && (descriptor & 0x0f) != 0;
+		const uint32_t pixelBytes = pixelBits / 8;
+		auto readPixel = [&](const uint8_t* p) -> uint32_t
+		{
+			if (isGray)
+				return p[0] | (p[0] << 8) | (p[0] << 16) | 0xff000000;
+
+			const uint32_t a = hasAlpha ? p[3] : 255;
+			return p[2] | (p[1] << 8) | (p[0] << 16) | (a << 24);
+		};
+
+		image.Width = width;
+		image.Height = height;
+		image.Pixels.resize((size_t)width * height);
+
+		const size_t numPixels = (size_t)width * height;
+		size_t offset = HEADER_SIZE + idLength;
+		size_t index = 0;
+		while (index < numPixels)
+		{
+			if (!isRle)
+			{
+				if (offset + pixelBytes > data.size())
+					break;
+				image.Pixels[index++] = readPixel(&data[offset]);
+				offset += pixelBytes;
+				continue;
+			}
+
+			if (offset >= data.size())
+				break;
+
+			// packets of up to 128 pixels, either one repeated or stored one by one
+			const uint8_t packet = data[offset++];
+			const size_t count = std::min<size_t>((packet & 0x7f) + 1, numPixels - index);
+			if (packet & 0x80)
+			{
+				if (offset + pixelBytes > data.size())
+					break;
+				const uint32_t pixel = readPixel(&data[offset]);
+				offset += pixelBytes;
+				std::fill_n(&image.Pixels[index], count, pixel);
+			}
+			else
+			{
+				if (offset + count * pixelBytes > data.size())
+					break;
+				for (size_t i = 0; i < count; ++i, offset += pixelBytes)
+					image.Pixels[index + i] = readPixel(&data[offset]);
+			}
+			index += count;
+		}
+
+		if (index < numPixels)
+		{
+			LOG_ERROR("TGA: truncated image data");
+			return false;
+		}
+
+		// the rows are stored bottom up unless the origin is on the top
+		if (!(descriptor & 0x20))
+		{
+			for (uint32_t y = 0; y < height / 2; ++y)
+				std::swap_ranges(&image.Pixels[(size_t)y * width], &image.Pixels[(size_t)y * width] + width, &image.Pixels[(size_t)(height - 1 - y) * width]);
+		}
+
+		if (descriptor & 0x10) // right to left
+		{
+			for (uint32_t y = 0; y < height; ++y)
+				std::reverse(&image.Pixels[(size_t)y * width], &image.Pixels[(size_t)y * width] + width);
+		}
+		return true;
+	}
+
+	// Radiance HDR
+
+	static bool ReadLine(const std::vector<uint8_t>& data, size_t& offset, std::string& line)
+	{
+		line.clear();
+		while (offset < data.size() && data[offset] != '\n')
+			line.push_back((char)data[offset++]);
+
+		if (offset >= data.size())
+			return false;
+
+		++offset;
+		return true;
+	}
+
+	bool LoadHDR(const std::vector<uint8_t>& data, FloatImage& image)
+	{
+		size_t offset = 0;
+		std::string line;
+		if (!ReadLine(data, offset, line) || (line != "#?RADIANCE" && line != "#?RGBE"))
+		{
+			LOG_ERROR("Not a Radiance HDR file");
+			return false;
+		}
+
+		// variables until an empty line, then the resolution
+		while (ReadLine(data, offset, line) && !line.empty())
+		{
+			if (line.compare(0, 7, "FORMAT=") == 0 && line != "FORMAT=32-bit_rle_rgbe")
+			{
+				LOG_ERROR("HDR: unsupported {0}", line);
+				return false;
+			}
+		}
+
+		int width = 0, height = 0;
+		std::string axisY, axisX;
+		if (ReadLine(data, offset, line))
+		{
+			std::istringstream resolution(line);
+			resolution >> axisY >> height >> axisX >> width;
+		}
+
+		if (axisY != "-Y" || axisX != "+X" || width <= 0 || height <= 0)
+		{
+			LOG_ERROR("HDR: unsupported resolution {0}, only -Y h +X w is read", line);
+			return false;
+		}
+
+		if (width > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION || height > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION)
+		{
+			LOG_ERROR("HDR: {0}x{1} is larger than the biggest texture ({2})", width, height, D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION);
+			return false;
+		}
+
+		image.Width = (uint32_t)width;
+		image.Height = (uint32_t)height;
+		image.Pixels.resize((size_t)width * height);
+
+		std::vector<uint8_t> scanline((size_t)width * 4);
+		for (int y = 0; y < height; ++y)
+		{
+			// the run length encoded scanlines start with 2, 2 and the width, each channel is encoded separately
+			const bool isRle = width >= 8 && width < 32768 && offset + 4 <= data.size() &&
+				data[offset] == 2 && data[offset + 1] == 2 && ((data[offset + 2] << 8) | data[offset + 3]) == width;
+
+			if (isRle)
+			{
+				offset += 4;
+				for (int c = 0; c < 4; ++c)
+				{
+					int x = 0;
+					while (x < width)
+					{
+						if (offset >= data.size())
+						{
+							LOG_ERROR("HDR: truncated image data");
+							return false;
+						}
+
+						int count = data[offset++];
+						const bool isRun = count > 128;
+						if (isRun)
+							count -= 128;
+
+						if (count == 0 || x + count > width || offset + (isRun ? 1 : count) > data.size())
+						{
+							LOG_ERROR("HDR: corrupted image data");
+							return false;
+						}
+
+						for (int i = 0; i < count; ++i, ++x)
+							scanline[(size_t)x * 4 + c] = isRun ? data[offset] : data[offset + i];
+						offset += isRun ? 1 : count;
+					}
+				}
+			}
+			else
+			{
+				if (offset + scanline.size() > data.size())
+				{
+					LOG_ERROR("HDR: truncated image data");
+					return false;
+				}
+				std::memcpy(scanline.data(), &data[offset], scanline.size());
+				offset += scanline.size();
+			}
+
+			// shared exponent, the mantissas are 8 bits
+			for (int x = 0; x < width; ++x)
+			{
+				const uint8_t* rgbe = &scanline[(size_t)x * 4];
+				const float scale = rgbe[3] ? std::ldexp(1.f, rgbe[3] - (128 + 8)) : 0.f;
+				image.Pixels[(size_t)y * width + x] = XMFLOAT4(rgbe[0] * scale, rgbe[1] * scale, rgbe[2] * scale, 1.f);
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "TextureDecoder.h"
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// Linear float pixels, top row first
+struct FloatImage
+{
+	uint32_t Width{ 0 };
+	uint32_t Height{ 0 };
+	std::vector<DirectX::XMFLOAT4> Pixels;
+};
+
+// Readers of the image files the texture node imports besides DDS, from the file in memory.
+// PNG (1 to 16 bits, gray/RGB/palette, with or without alpha, not interlaced) and TGA (true color
+// or grayscale, RLE or not) are read to RGBA8, Radiance HDR (RGBE) to floats.
+namespace ImageLoader
+{
+	bool LoadPNG(const std::vector<uint8_t>& data, DecodedImage& image);
+	bool LoadTGA(const std::vector<uint8_t>& data, DecodedImage& image);
+	bool LoadHDR(const std::vector<uint8_t>& data, FloatImage& image);
+
+	// zlib stream (RFC 1950 and 1951), the IDAT chunks of a PNG, at most maxSize bytes are appended to out
+	bool Inflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out, size_t maxSize);
+}
@@ -0,0 +1,131 @@
+#include "pch.h"
+#include "Instancing.h"
+#include "ThreadPool.h"
+
+using namespace DirectX;
+
+namespace Instancing
+{
+	// small enough for the generation of a few thousand instances to be worth a task
+	constexpr size_t INSTANCES_PER_TASK = 4096;
+
+	// lowbias32, every instance gets its own random numbers whatever the thread computing it
+	static uint32_t Hash(uint32_t x)
+	{
+		x ^= x >> 16;
+		x *= 0x7feb352du;
+		x ^= x >> 15;
+		x *= 0x846ca68bu;
+		x ^= x >> 16;
+		return x;
+	}
+
+	// 4 random numbers in [-1, 1)
+	static XMVECTOR RandomVector(uint32_t seed, uint32_t instance, uint32_t stream)
+	{
+		const uint32_t base = seed + instance * 8u + stream * 4u;
+		const XMUINT4 bits(Hash(base) >> 8, Hash(base + 1) >> 8, Hash(base + 2) >> 8, Hash(base + 3) >> 8);
+		const XMVECTOR unit = XMConvertVectorUIntToFloat(XMLoadUInt4(&bits), 24);
+		return XMVectorMultiplyAdd(unit, g_XMTwo, g_XMNegativeOne);
+	}
+
+	static XMMATRIX XM_CALLCONV RotationXYZ(FXMVECTOR angles)
+	{
+		return XMMatrixMultiply(
+			XMMatrixRotationX(XMVectorGetX(angles)),
+			XMMatrixMultiply(XMMatrixRotationY(XMVectorGetY(angles)), XMMatrixRotationZ(XMVectorGetZ(angles))));
+	}
+
+	static XMMATRIX XM_CALLCONV WithTranslation(FXMMATRIX m, FXMVECTOR position)
+	{
+		XMMATRIX result = m;
+		result.r[3] = XMVectorSelect(g_XMIdentityR3, position, g_XMSelect1110);
+		return result;
+	}
+
+	static XMMATRIX XM_CALLCONV Power(FXMMATRIX m, uint32_t exponent)
+	{
+		XMMATRIX result = XMMatrixIdentity();
+		XMMATRIX square = m;
+		while (exponent > 0)
+		{
+			if (exponent & 1)
+				result = XMMatrixMultiply(result, square);
+			square = XMMatrixMultiply(square, square);
+			exponent >>= 1;
+		}
+		return result;
+	}
+
+	static void GenerateGrid(const InstanceParams& params, XMFLOAT4X4* worlds, size_t begin, size_t end)
+	{
+		uint32_t side = 1;
+		while ((uint64_t)side * side * side < params.Count)
+			++side;
+
+		const XMMATRIX scale = XMMatrixScaling(params.Scale, params.Scale, params.Scale);
+		const XMVECTOR offset = XMLoadFloat3(&params.Offset);
+		const XMVECTOR center = XMVectorReplicate((side - 1) * 0.5f);
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			const uint32_t index = (uint32_t)i;
+			const XMVECTOR cell = XMVectorSet(float(index % side), float((index / side) % side), float(index / (side * side)), 0.f);
+			const XMVECTOR position = XMVectorMultiply(XMVectorSubtract(cell, center), offset);
+			XMStoreFloat4x4(&worlds[i], WithTranslation(scale, position));
+		}
+	}
+
+	static void GenerateScatter(const InstanceParams& params, XMFLOAT4X4* worlds, size_t begin, size_t end)
+	{
+		const XMMATRIX scale = XMMatrixScaling(params.Scale, params.Scale, params.Scale);
+		const XMVECTOR offset = XMLoadFloat3(&params.Offset);
+		const XMVECTOR rotation = XMLoadFloat3(&params.Rotation);
+		const uint32_t seed = Hash(params.Seed);
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			const XMVECTOR position = XMVectorMultiply(RandomVector(seed, (uint32_t)i, 0), offset);
+			const XMVECTOR angles = XMVectorMultiply(RandomVector(seed, (uint32_t)i, 1), rotation);
+			XMStoreFloat4x4(&worlds[i], WithTranslation(XMMatrixMultiply(scale, RotationXYZ(angles)), position));
+		}
+	}
+
+	static void GenerateArray(const InstanceParams& params, XMFLOAT4X4* worlds, size_t begin, size_t end)
+	{
+		const XMMATRIX scale = XMMatrixScaling(params.Scale, params.Scale, params.Scale);
+		const XMMATRIX step = WithTranslation(RotationXYZ(XMLoadFloat3(&params.Rotation)), XMLoadFloat3(&params.Offset));
+
+		// step^i, restarted for every chunk so the rounding errors don't pile up over the whole array
+		XMMATRIX transform = Power(step, (uint32_t)begin);
+		for (size_t i = begin; i < end; ++i)
+		{
+			XMStoreFloat4x4(&worlds[i], XMMatrixMultiply(scale, transform));
+			transform = XMMatrixMultiply(transform, step);
+		}
+	}
+
+	void Generate(const InstanceParams& params, std::vector<XMFLOAT4X4>& worlds)
+	{
+		worlds.resize(params.Count);
+		if (params.Count == 0)
+			return;
+
+		XMFLOAT4X4* data = worlds.data();
+		ThreadPool::Get().ParallelFor(params.Count, INSTANCES_PER_TASK, [&](size_t begin, size_t end)
+		{
+			switch (params.Layout)
+			{
+			case InstanceLayout::Grid:
+				GenerateGrid(params, data, begin, end);
+				break;
+			case InstanceLayout::Scatter:
+				GenerateScatter(params, data, begin, end);
+				break;
+			case InstanceLayout::Array:
+				GenerateArray(params, data, begin, end);
+				break;
+			}
+		});
+	}
+}
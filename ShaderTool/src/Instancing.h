@@ -0,0 +1,39 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+enum class InstanceLayout
+{
+	Grid,	 // cube of Count cells, Offset apart
+	Scatter, // random positions inside +-Offset, random rotation up to +-Rotation
+	Array	 // each instance is the previous one moved by Offset and rotated by Rotation
+};
+
+struct InstanceParams
+{
+	InstanceLayout Layout{ InstanceLayout::Grid };
+	uint32_t Count{ 1 };
+	DirectX::XMFLOAT3 Offset{ 2.f, 2.f, 2.f };
+	DirectX::XMFLOAT3 Rotation{ 0.f, 0.f, 0.f }; // radians, x then y then z like TransformNode
+	float Scale{ 1.f };
+	uint32_t Seed{ 0 };
+
+	bool operator==(const InstanceParams& rhs) const
+	{
+		return Layout == rhs.Layout && Count == rhs.Count && Scale == rhs.Scale && Seed == rhs.Seed
+			&& Offset.x == rhs.Offset.x && Offset.y == rhs.Offset.y && Offset.z == rhs.Offset.z
+			&& Rotation.x == rhs.Rotation.x && Rotation.y == rhs.Rotation.y && Rotation.z == rhs.Rotation.z;
+	}
+
+	bool operator!=(const InstanceParams& rhs) const { return !(*this == rhs); }
+};
+
+namespace Instancing
+{
+	// Per instance world matrices, row vector convention and not transposed: they are read by
+	// the input assembler (Shaders/instancing.hlsli) and not from a constant buffer.
+	// The instances are generated in parallel, the result only depends on params.
+	void Generate(const InstanceParams& params, std::vector<DirectX::XMFLOAT4X4>& worlds);
+}
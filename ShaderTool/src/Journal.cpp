@@ -0,0 +1,280 @@
+#include "pch.h"
+#include "Journal.h"
+
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+	// bounds checked reads of the journal file
+	struct JournalReader
+	{
+		const char* Data;
+		size_t Size;
+		size_t Offset{ 0 };
+
+		bool Read(void* dest, size_t size)
+		{
+			if (Size - Offset < size)
+				return false;
+			std::memcpy(dest, Data + Offset, size);
+			Offset += size;
+			return true;
+		}
+
+		template<typename T>
+		bool Read(T& value)
+		{
+			return Read(&value, sizeof(T));
+		}
+
+		bool ReadString(std::string& value, size_t size)
+		{
+			if (Size - Offset < size)
+				return false;
+			value.assign(Data + Offset, size);
+			Offset += size;
+			return true;
+		}
+
+		bool IsEnd() const { return Offset == Size; }
+	};
+
+	bool ReadRecord(JournalReader& reader, uint32_t version, JournalRecord& record)
+	{
+		switch (record.Type)
+		{
+		case JournalRecordType::CreateNode:
+		{
+			int32_t type;
+			if (!reader.Read(type) || !reader.Read(record.Id))
+				return false;
+			record.NodeType = static_cast<UiNodeType>(type);
+			return true;
+		}
+		case JournalRecordType::DeleteNode:
+		case JournalRecordType::DeleteLink:
+			return reader.Read(record.Id);
+		case JournalRecordType::CreateLink:
+			return reader.Read(record.From) && reader.Read(record.To) && reader.Read(record.Id);
+		case JournalRecordType::SetValue:
+		{
+			uint16_t size;
+			uint8_t size8;
+			if (!reader.Read(record.Id) || !(version >= 3 ? reader.Read(size) : reader.Read(size8)))
+				return false;
+			if (version < 3)
+				size = size8;
+			record.Value.resize(size);
+			return reader.Read(record.Value.data(), size);
+		}
+		case JournalRecordType::LoadAsset:
+		{
+			uint32_t size;
+			return reader.Read(record.Id) && reader.Read(size) && reader.ReadString(record.Path, size);
+		}
+		case JournalRecordType::NodeState:
+		{
+			uint32_t size;
+			return reader.Read(record.Id) && reader.Read(size) && reader.ReadString(record.State, size);
+		}
+		default:
+			return false;
+		}
+	}
+}
+
+bool Journal::StartRecording(const std::string& path, const std::string& project)
+{
+	StopRecording();
+
+	_File.open(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	if (!_File.is_open())
+	{
+		LOG_ERROR("Failed to write file {0}", path);
+		return false;
+	}
+
+	_Path = path;
+	_NumFrames = 0;
+	_NumRecords = 0;
+
+	_File.write(MAGIC, sizeof(MAGIC));
+	Write(VERSION);
+	Write(static_cast<uint64_t>(project.size()));
+	_File.write(project.data(), project.size());
+
+	LOG_INFO("Recording the graph edits to {0}", path);
+	return true;
+}
+
+void Journal::StopRecording()
+{
+	if (!IsRecording())
+		return;
+
+	_File.close();
+	LOG_INFO("Journal {0} written ({1} frames, {2} edits)", _Path, _NumFrames, _NumRecords);
+}
+
+void Journal::WriteRecordType(JournalRecordType type)
+{
+	Write(type);
+	if (type != JournalRecordType::Frame)
+		++_NumRecords;
+}
+
+void Journal::RecordFrame(double time, double deltaTime)
+{
+	if (!IsRecording())
+		return;
+
+	WriteRecordType(JournalRecordType::Frame);
+	Write(time);
+	Write(deltaTime);
+	++_NumFrames;
+}
+
+void Journal::RecordCreateNode(UiNodeType type, int id)
+{
+	if (!IsRecording())
+		return;
+
+	WriteRecordType(JournalRecordType::CreateNode);
+	Write(static_cast<int32_t>(type));
+	Write(static_cast<int32_t>(id));
+}
+
+void Journal::RecordDeleteNode(int id)
+{
+	if (!IsRecording())
+		return;
+
+	WriteRecordType(JournalRecordType::DeleteNode);
+	Write(static_cast<int32_t>(id));
+}
+
+void Journal::RecordCreateLink(int from, int to, int id)
+{
+	if (!IsRecording())
+		return;
+
+	WriteRecordType(JournalRecordType::CreateLink);
+	Write(static_cast<int32_t>(from));
+	Write(static_cast<int32_t>(to));
+	Write(static_cast<int32_t>(id));
+}
+
+void Journal::RecordDeleteLink(int id)
+{
+	if (!IsRecording())
+		return;
+
+	WriteRecordType(JournalRecordType::DeleteLink);
+	Write(static_cast<int32_t>(id));
+}
+
+void Journal::RecordSetValue(int pin, const void* value, size_t size)
+{
+	if (!IsRecording())
+		return;
+
+	// a 4x4 matrix at most in the nodes, the replay would differ without the value
+	if (size > UINT16_MAX)
+	{
+		LOG_ERROR("Value of {0} bytes of the pin {1} can't be recorded, the recording of the journal stops", size, pin);
+		StopRecording();
+		return;
+	}
+
+	WriteRecordType(JournalRecordType::SetValue);
+	Write(static_cast<int32_t>(pin));
+	Write(static_cast<uint16_t>(size));
+	_File.write(static_cast<const char*>(value), size);
+}
+
+void Journal::RecordLoadAsset(int id, const std::string& path)
+{
+	if (!IsRecording())
+		return;
+
+	WriteRecordType(JournalRecordType::LoadAsset);
+	Write(static_cast<int32_t>(id));
+	Write(static_cast<uint32_t>(path.size()));
+	_File.write(path.data(), path.size());
+}
+
+void Journal::RecordNodeState(int id, const std::string& state)
+{
+	if (!IsRecording())
+		return;
+
+	WriteRecordType(JournalRecordType::NodeState);
+	Write(static_cast<int32_t>(id));
+	Write(static_cast<uint32_t>(state.size()));
+	_File.write(state.data(), state.size());
+}
+
+bool Journal::Read(const std::string& path, JournalData& data)
+{
+	std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+	if (!file.is_open())
+	{
+		LOG_ERROR("Failed to load file {0}", path);
+		return false;
+	}
+
+	const std::vector<char> bytes{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+	JournalReader reader{ bytes.data(), bytes.size() };
+
+	char magic[sizeof(MAGIC)];
+	uint32_t version;
+	uint64_t projectSize;
+	if (!reader.Read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+		!reader.Read(version) || version == 0 || version > VERSION)
+	{
+		LOG_ERROR("{0} is not a journal of version {1} or older", path, VERSION);
+		return false;
+	}
+
+	if (!reader.Read(projectSize) || !reader.ReadString(data.Project, projectSize))
+	{
+		LOG_ERROR("The project of the journal {0} is cut short", path);
+		return false;
+	}
+
+	data.Frames.clear();
+	data.NumRecords = 0;
+
+	// the records before the first frame can't be replayed, there are none in the files written by Journal
+	while (!reader.IsEnd())
+	{
+		const size_t recordOffset = reader.Offset;
+		JournalRecord record;
+		bool valid = reader.Read(record.Type);
+		if (valid && record.Type == JournalRecordType::Frame)
+		{
+			JournalFrame frame;
+			valid = reader.Read(frame.Time) && reader.Read(frame.DeltaTime);
+			if (valid)
+				data.Frames.push_back(std::move(frame));
+		}
+		else if (valid)
+		{
+			valid = !data.Frames.empty() && ReadRecord(reader, version, record);
+			if (valid)
+			{
+				data.Frames.back().Records.push_back(std::move(record));
+				++data.NumRecords;
+			}
+		}
+
+		if (!valid)
+		{
+			LOG_WARN("The journal {0} is cut short at byte {1}, replaying the frames before it", path, recordOffset);
+			break;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+enum class UiNodeType;
+
+enum class JournalRecordType : uint8_t
+{
+	Frame,       // time of the frame, the records up to the next frame are applied after its evaluation
+	CreateNode,  // ui node type and id
+	DeleteNode,  // ui node id
+	CreateLink,  // input pin, output pin and edge id
+	DeleteLink,  // edge id
+	SetValue,    // pin id and the bytes of its value
+	LoadAsset,   // ui node id and the path of the file opened by the node
+	NodeState    // ui node id and the settings of the node that aren't pin values (UiNode::GetState)
+};
+
+struct JournalRecord
+{
+	JournalRecordType Type;
+	int Id{ 0 };              // ui node, edge or pin
+	int From{ 0 };            // CreateLink
+	int To{ 0 };              // CreateLink
+	UiNodeType NodeType{};    // CreateNode
+	std::vector<uint8_t> Value; // SetValue
+	std::string Path;         // LoadAsset
+	std::string State;        // NodeState
+};
+
+struct JournalFrame
+{
+	double Time;
+	double DeltaTime;
+	std::vector<JournalRecord> Records;
+};
+
+struct JournalData
+{
+	std::string Project; // as saved by the editor when the recording started
+	std::vector<JournalFrame> Frames;
+	size_t NumRecords{ 0 };
+};
+
+// Graph edits made in the editor, recorded from the project as it was when the recording started so
+// the command line runner can replay them with the same frame times. The file is binary, little endian:
+// the magic and the version, the size and the text of the project, then one byte per record type
+// followed by its fields.
+class Journal
+{
+public:
+	static constexpr char MAGIC[4] = { 'S', 'T', 'J', 'L' };
+	// 2 has 8 bit SetValue sizes, 1 no NodeState records either, they're read as well
+	static constexpr uint32_t VERSION = 3;
+
+	Journal(const Journal&) = delete;
+	Journal& operator=(const Journal&) = delete;
+
+	static Journal& Get()
+	{
+		static Journal instance;
+		return instance;
+	}
+
+	bool StartRecording(const std::string& path, const std::string& project);
+	void StopRecording();
+	bool IsRecording() const { return _File.is_open(); }
+	uint64_t GetNumFrames() const { return _NumFrames; }
+	uint64_t GetNumRecords() const { return _NumRecords; }
+
+	// nothing is written while not recording
+	void RecordFrame(double time, double deltaTime);
+	void RecordCreateNode(UiNodeType type, int id);
+	void RecordDeleteNode(int id);
+	void RecordCreateLink(int from, int to, int id);
+	void RecordDeleteLink(int id);
+	void RecordSetValue(int pin, const void* value, size_t size); // stops the recording over UINT16_MAX bytes
+	void RecordLoadAsset(int id, const std::string& path);
+	void RecordNodeState(int id, const std::string& state);
+
+	// the whole file, the frames of a journal cut short are kept
+	static bool Read(const std::string& path, JournalData& data);
+
+private:
+	Journal() = default;
+
+	template<typename T>
+	void Write(const T& value)
+	{
+		_File.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	void WriteRecordType(JournalRecordType type);
+
+private:
+	std::ofstream _File;
+	std::string _Path;
+	uint64_t _NumFrames{ 0 };
+	uint64_t _NumRecords{ 0 };
+};
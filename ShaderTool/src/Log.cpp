@@ -1,11 +1,59 @@
 #include "pch.h"
+#include "spdlog/async.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 
 std::shared_ptr<spdlog::logger> Log::s_coreLogger;
-		
+
 void Log::Init()
 {
 	spdlog::set_pattern("%^[%T] %n: %v%$");
-	s_coreLogger = spdlog::stdout_color_mt("LOG");
+
+	// written by a thread of its own, the frame doesn't wait for the console
+	spdlog::init_thread_pool(QUEUE_SIZE, 1);
+	s_coreLogger = spdlog::create_async_nb<spdlog::sinks::stdout_color_sink_mt>("LOG");
 	s_coreLogger->set_level(spdlog::level::trace);
+	s_coreLogger->flush_on(spdlog::level::err);
+}
+
+void Log::Shutdown()
+{
+	spdlog::shutdown();
+
+	// for the messages of the static destructors
+	s_coreLogger = std::make_shared<spdlog::logger>("LOG", std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+	s_coreLogger->set_pattern("%^[%T] %n: %v%$");
+}
+
+bool Log::RateLimit(CallSite& site, const std::string& message, Clock::time_point now, uint32_t& numSkipped)
+{
+	if (now - site.IntervalStart >= RATE_LIMIT_INTERVAL)
+	{
+		site.IntervalStart = now;
+		site.NumLogged = 0;
+	}
+	else if (site.NumLogged >= RATE_LIMIT || message == site.LastMessage)
+	{
+		++site.NumSkipped;
+		return false;
+	}
+
+	numSkipped = site.NumSkipped;
+	site.LastMessage = message;
+	site.NumSkipped = 0;
+	++site.NumLogged;
+	return true;
+}
+
+void Log::LogLimited(CallSite& site, spdlog::level::level_enum level, std::string&& message)
+{
+	std::lock_guard<std::mutex> lock(site.Mutex);
+
+	uint32_t numSkipped = 0;
+	if (!RateLimit(site, message, Clock::now(), numSkipped))
+		return;
+
+	if (numSkipped > 0)
+		s_coreLogger->log(level, "{0} ({1} messages of this call site skipped)", message, numSkipped);
+	else
+		s_coreLogger->log(level, message);
 }
@@ -3,18 +3,90 @@
 #include "spdlog/spdlog.h"
 #include "spdlog/fmt/ostr.h"
 
+#include <chrono>
+#include <mutex>
+
+// Messages below this level are compiled out, their arguments aren't evaluated.
+// Release keeps the warnings and the errors, it can be set in the project defines.
+#if !defined(LOG_ACTIVE_LEVEL)
+#if defined(_DEBUG)
+#define LOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+#else
+#define LOG_ACTIVE_LEVEL SPDLOG_LEVEL_WARN
+#endif
+#endif
+
 class Log
 {
 public:
+	// Messages queued for the logging thread, the oldest are dropped when it can't keep up
+	static constexpr size_t QUEUE_SIZE = 8192;
+
+	// Messages logged by a LOG_WARN/LOG_ERROR call site per interval, a message repeated by the
+	// call site is logged once per interval. The next message logged has the number skipped.
+	static constexpr uint32_t RATE_LIMIT = 5;
+	static constexpr std::chrono::seconds RATE_LIMIT_INTERVAL{ 1 };
+
+	using Clock = std::chrono::steady_clock;
+
+	struct CallSite
+	{
+		std::mutex Mutex;
+		std::string LastMessage;
+		Clock::time_point IntervalStart;
+		uint32_t NumLogged{ 0 };
+		uint32_t NumSkipped{ 0 };
+	};
+
 	static void Init();
+	static void Shutdown(); // writes the queued messages, called once the app is destroyed
 	inline static std::shared_ptr<spdlog::logger>& GetCoreLogger() { return s_coreLogger; }
 
+	template<typename FormatString, typename... Args>
+	static void LogLimited(CallSite& site, spdlog::level::level_enum level, const FormatString& format, const Args&... args)
+	{
+		std::string message;
+		try
+		{
+			message = fmt::format(format, args...);
+		}
+		catch (const std::exception& e)
+		{
+			message = std::string("bad log format: ") + e.what();
+		}
+		LogLimited(site, level, std::move(message));
+	}
+
+	// Whether the call site logs the message at the time now, with the number of messages it skipped
+	// since the last one logged. LogLimited calls it under the mutex of the site with Clock::now(), the
+	// tests with their own times.
+	static bool RateLimit(CallSite& site, const std::string& message, Clock::time_point now, uint32_t& numSkipped);
+
 private:
+	static void LogLimited(CallSite& site, spdlog::level::level_enum level, std::string&& message);
+
 	static std::shared_ptr<spdlog::logger> s_coreLogger;
 };
 
+#define LOG_LIMITED(level, ...)	do { static ::Log::CallSite logCallSite; ::Log::LogLimited(logCallSite, level, __VA_ARGS__); } while (0)
+
+#if LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_TRACE
 #define LOG_TRACE(...)		::Log::GetCoreLogger()->trace(__VA_ARGS__)
+#else
+#define LOG_TRACE(...)		(void)0
+#endif
+
+#if LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_INFO
 #define LOG_INFO(...)		::Log::GetCoreLogger()->info(__VA_ARGS__)
-#define LOG_WARN(...)		::Log::GetCoreLogger()->warn(__VA_ARGS__)
-#define LOG_ERROR(...)		::Log::GetCoreLogger()->error(__VA_ARGS__)
+#else
+#define LOG_INFO(...)		(void)0
+#endif
+
+#if LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_WARN
+#define LOG_WARN(...)		LOG_LIMITED(spdlog::level::warn, __VA_ARGS__)
+#else
+#define LOG_WARN(...)		(void)0
+#endif
+
+#define LOG_ERROR(...)		LOG_LIMITED(spdlog::level::err, __VA_ARGS__)
 #define LOG_CRITICAL(...)	::Log::GetCoreLogger()->critical(__VA_ARGS__)
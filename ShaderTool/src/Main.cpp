@@ -17,7 +17,10 @@ int WINAPI WinMain(
 	int nCmdShow
 )
 {
-	ShaderToolApp app(hInstance);
-	app.Run();
+	{
+		ShaderToolApp app(hInstance);
+		app.Run();
+	}
+	Log::Shutdown();
 	return 0;
 }
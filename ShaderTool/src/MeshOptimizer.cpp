@@ -0,0 +1,349 @@
+#include "pch.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace MeshOptimizer
+{
+	// Cache size the Forsyth scoring assumes, bigger than the FIFO the results are measured with
+	constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+	constexpr uint32_t FORSYTH_MAX_VALENCE = 32;
+
+	struct ForsythScoreTable
+	{
+		float Cache[FORSYTH_CACHE_SIZE];
+		float Valence[FORSYTH_MAX_VALENCE];
+
+		ForsythScoreTable()
+		{
+			// the last triangle's vertices get a fixed score so it isn't reused straight away
+			for (uint32_t i = 0; i < FORSYTH_CACHE_SIZE; ++i)
+				Cache[i] = i < 3 ? 0.75f : std::pow(1.f - (i - 3) / float(FORSYTH_CACHE_SIZE - 3), 1.5f);
+
+			// vertices with few triangles left are boosted to get rid of them
+			Valence[0] = 0.f;
+			for (uint32_t i = 1; i < FORSYTH_MAX_VALENCE; ++i)
+				Valence[i] = 2.f / std::sqrt(float(i));
+		}
+	};
+
+	static float VertexScore(const ForsythScoreTable& table, int cachePosition, uint32_t liveTriangles)
+	{
+		if (liveTriangles == 0)
+			return 0.f;
+
+		const float cacheScore = cachePosition >= 0 ? table.Cache[cachePosition] : 0.f;
+		const float valenceScore = liveTriangles < FORSYTH_MAX_VALENCE ? table.Valence[liveTriangles] : 2.f / std::sqrt(float(liveTriangles));
+		return cacheScore + valenceScore;
+	}
+
+	// FIFO cache simulation, a vertex is in the cache if less than cacheSize misses happened since it was loaded
+	struct FifoCache
+	{
+		std::vector<uint32_t> Timestamps;
+		uint32_t Timestamp;
+		uint32_t Size;
+
+		FifoCache(size_t vertexCount, uint32_t size) : Timestamps(vertexCount, 0), Timestamp(size + 1), Size(size) {}
+
+		bool Load(uint32_t index)
+		{
+			if (Timestamp - Timestamps[index] <= Size)
+				return false;
+
+			Timestamps[index] = Timestamp++;
+			return true;
+		}
+
+		void Flush() { Timestamp += Size + 1; }
+
+		uint32_t LoadTriangle(const uint32_t* triangle)
+		{
+			return (uint32_t)Load(triangle[0]) + (uint32_t)Load(triangle[1]) + (uint32_t)Load(triangle[2]);
+		}
+	};
+
+	VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+	{
+		VertexCacheStats stats;
+		if (indices.empty() || vertexCount == 0)
+			return stats;
+
+		FifoCache cache(vertexCount, cacheSize);
+		for (uint32_t index : indices)
+			stats.VerticesTransformed += cache.Load(index) ? 1 : 0;
+
+		stats.ACMR = stats.VerticesTransformed / float(indices.size() / 3);
+		stats.ATVR = stats.VerticesTransformed / float(vertexCount);
+		return stats;
+	}
+
+	void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+	{
+		const size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+			return;
+
+		static const ForsythScoreTable table;
+
+		// triangles that use each vertex, the live ones are kept at the front of each list
+		std::vector<uint32_t> liveTriangles(vertexCount, 0);
+		for (uint32_t index : indices)
+			++liveTriangles[index];
+
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; ++v)
+			adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+		std::vector<uint32_t> adjacency(indices.size());
+		{
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); ++i)
+				adjacency[fill[indices[i]]++] = uint32_t(i / 3);
+		}
+
+		std::vector<float> vertexScores(vertexCount);
+		for (size_t v = 0; v < vertexCount; ++v)
+			vertexScores[v] = VertexScore(table, -1, liveTriangles[v]);
+
+		std::vector<float> triangleScores(triangleCount);
+		std::vector<bool> emitted(triangleCount, false);
+		for (size_t t = 0; t < triangleCount; ++t)
+			triangleScores[t] = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+		uint32_t bestTriangle = uint32_t(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+
+		std::vector<uint32_t> cache;
+		std::vector<uint32_t> newCache;
+		cache.reserve(FORSYTH_CACHE_SIZE + 3);
+		newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+		size_t scanCursor = 0;
+
+		for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+		{
+			const uint32_t* triangle = &indices[bestTriangle * 3];
+			result.insert(result.end(), triangle, triangle + 3);
+			emitted[bestTriangle] = true;
+
+			// the emitted triangle goes to the back of the live part of its vertices' lists
+			for (int c = 0; c < 3; ++c)
+			{
+				const uint32_t v = triangle[c];
+				uint32_t* list = &adjacency[adjacencyOffsets[v]];
+				for (uint32_t i = 0; i < liveTriangles[v]; ++i)
+				{
+					if (list[i] == bestTriangle)
+					{
+						std::swap(list[i], list[liveTriangles[v] - 1]);
+						--liveTriangles[v];
+						break;
+					}
+				}
+			}
+
+			// LRU: the triangle's vertices move to the front
+			newCache.clear();
+			for (int c = 0; c < 3; ++c)
+			{
+				if (std::find(newCache.begin(), newCache.end(), triangle[c]) == newCache.end())
+					newCache.push_back(triangle[c]);
+			}
+
+			const size_t numTriangleVertices = newCache.size();
+			for (uint32_t v : cache)
+			{
+				if (std::find(newCache.begin(), newCache.begin() + numTriangleVertices, v) == newCache.begin() + numTriangleVertices)
+					newCache.push_back(v);
+			}
+
+			// rescore the vertices that moved in the cache and the triangles that use them
+			float bestScore = -1.f;
+			for (size_t i = 0; i < newCache.size(); ++i)
+			{
+				const uint32_t v = newCache[i];
+				const int cachePosition = i < FORSYTH_CACHE_SIZE ? int(i) : -1;
+
+				const float score = VertexScore(table, cachePosition, liveTriangles[v]);
+				const float delta = score - vertexScores[v];
+				vertexScores[v] = score;
+
+				const uint32_t* list = &adjacency[adjacencyOffsets[v]];
+				for (uint32_t j = 0; j < liveTriangles[v]; ++j)
+				{
+					const uint32_t t = list[j];
+					triangleScores[t] += delta;
+					if (triangleScores[t] > bestScore)
+					{
+						bestScore = triangleScores[t];
+						bestTriangle = t;
+					}
+				}
+			}
+
+			if (newCache.size() > FORSYTH_CACHE_SIZE)
+				newCache.resize(FORSYTH_CACHE_SIZE);
+			std::swap(cache, newCache);
+
+			// nothing in the cache has triangles left, continue with the next one in the original order
+			if (bestScore < 0.f)
+			{
+				while (scanCursor < triangleCount && emitted[scanCursor])
+					++scanCursor;
+				bestTriangle = uint32_t(scanCursor);
+			}
+		}
+
+		indices.swap(result);
+	}
+
+	void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold)
+	{
+		const size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+			return;
+
+		// hard boundaries: triangles that miss the cache on every vertex start a new region
+		std::vector<uint32_t> clusters;
+		{
+			FifoCache cache(vertices.size(), VERTEX_CACHE_SIZE);
+			for (size_t t = 0; t < triangleCount; ++t)
+			{
+				if (cache.LoadTriangle(&indices[t * 3]) == 3 || t == 0)
+					clusters.push_back(uint32_t(t));
+			}
+		}
+
+		// soft boundaries: a region is split further where restarting with an empty cache
+		// doesn't make its ACMR worse than threshold
+		std::vector<uint32_t> softClusters;
+		{
+			FifoCache cache(vertices.size(), VERTEX_CACHE_SIZE);
+			for (size_t c = 0; c < clusters.size(); ++c)
+			{
+				const uint32_t begin = clusters[c];
+				const uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : uint32_t(triangleCount);
+
+				cache.Flush();
+				uint32_t misses = 0;
+				for (uint32_t t = begin; t < end; ++t)
+					misses += cache.LoadTriangle(&indices[t * 3]);
+				const float clusterACMR = misses / float(end - begin);
+
+				softClusters.push_back(begin);
+
+				cache.Flush();
+				misses = 0;
+				uint32_t start = begin;
+				for (uint32_t t = begin; t < end; ++t)
+				{
+					misses += cache.LoadTriangle(&indices[t * 3]);
+
+					if (t + 1 < end && misses / float(t + 1 - start) <= clusterACMR * threshold)
+					{
+						softClusters.push_back(t + 1);
+						cache.Flush();
+						misses = 0;
+						start = t + 1;
+					}
+				}
+			}
+		}
+
+		// clusters facing away from the mesh center and far from it are drawn first, they occlude the rest
+		XMVECTOR meshCentroid = XMVectorZero();
+		for (const Vertex& vertex : vertices)
+			meshCentroid += XMLoadFloat3(&vertex.Position);
+		meshCentroid /= float(vertices.size());
+
+		struct ClusterKey
+		{
+			float Key;
+			uint32_t Cluster;
+		};
+
+		std::vector<ClusterKey> keys(softClusters.size());
+		for (size_t c = 0; c < softClusters.size(); ++c)
+		{
+			const uint32_t begin = softClusters[c];
+			const uint32_t end = c + 1 < softClusters.size() ? softClusters[c + 1] : uint32_t(triangleCount);
+
+			// area weighted centroid and normal
+			XMVECTOR centroid = XMVectorZero();
+			XMVECTOR normal = XMVectorZero();
+			float area = 0.f;
+			for (uint32_t t = begin; t < end; ++t)
+			{
+				const XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t * 3 + 0]].Position);
+				const XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t * 3 + 1]].Position);
+				const XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t * 3 + 2]].Position);
+
+				const XMVECTOR n = XMVector3Cross(p1 - p0, p2 - p0);
+				const float triangleArea = XMVectorGetX(XMVector3Length(n));
+
+				centroid += (p0 + p1 + p2) * (triangleArea / 3.f);
+				normal += n;
+				area += triangleArea;
+			}
+
+			if (area > 0.f)
+				centroid /= area;
+
+			const XMVECTOR direction = XMVector3Normalize(normal);
+			keys[c] = { XMVectorGetX(XMVector3Dot(centroid - meshCentroid, direction)), uint32_t(c) };
+		}
+
+		std::stable_sort(keys.begin(), keys.end(), [](const ClusterKey& a, const ClusterKey& b) { return a.Key > b.Key; });
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+		for (const ClusterKey& key : keys)
+		{
+			const uint32_t begin = softClusters[key.Cluster];
+			const uint32_t end = key.Cluster + 1 < softClusters.size() ? softClusters[key.Cluster + 1] : uint32_t(triangleCount);
+			result.insert(result.end(), indices.begin() + begin * 3, indices.begin() + end * 3);
+		}
+
+		indices.swap(result);
+	}
+
+	size_t OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		constexpr uint32_t UNUSED = ~0u;
+		std::vector<uint32_t> remap(vertices.size(), UNUSED);
+		std::vector<Vertex> result;
+		result.reserve(vertices.size());
+
+		for (uint32_t& index : indices)
+		{
+			if (remap[index] == UNUSED)
+			{
+				remap[index] = uint32_t(result.size());
+				result.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		vertices.swap(result);
+		return vertices.size();
+	}
+
+	Report Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		Report report;
+		report.Before = AnalyzeVertexCache(indices, vertices.size());
+
+		OptimizeVertexCache(indices, vertices.size());
+		OptimizeOverdraw(indices, vertices);
+		OptimizeVertexFetch(vertices, indices);
+
+		report.After = AnalyzeVertexCache(indices, vertices.size());
+		return report;
+	}
+}
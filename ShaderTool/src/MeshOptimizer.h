@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Rendering/Vertex.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// CPU passes that reorder the index/vertex data of a mesh so the GPU does less work drawing it:
+//   1. vertex cache: triangles reordered to reuse the post-transform cache (Forsyth)
+//   2. overdraw: the cache friendly order is split in clusters that are sorted front to back
+//      from the outside of the mesh (Sander et al., Tipsify)
+//   3. vertex fetch: vertices reordered in the order the indices first use them
+namespace MeshOptimizer
+{
+	// FIFO size used to measure the results, close to what the hardware has
+	constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+	// How much the ACMR can get worse to allow for a finer overdraw sort
+	constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+	struct VertexCacheStats
+	{
+		uint32_t VerticesTransformed{ 0 };
+		float ACMR{ 0.f }; // transformed vertices per triangle, 0.5 at best
+		float ATVR{ 0.f }; // transformed vertices per vertex, 1.0 at best
+	};
+
+	struct Report
+	{
+		VertexCacheStats Before;
+		VertexCacheStats After;
+	};
+
+	VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+	void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+	void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold = OVERDRAW_THRESHOLD);
+
+	// Drops the vertices that are not referenced, returns the new vertex count
+	size_t OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	// Runs all the passes in order
+	Report Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+}
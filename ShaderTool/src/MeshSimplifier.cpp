@@ -0,0 +1,308 @@
+#include "pch.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "Defines.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+
+namespace MeshSimplifier
+{
+	struct Vector3
+	{
+		double X, Y, Z;
+
+		Vector3 operator-(const Vector3& rhs) const { return { X - rhs.X, Y - rhs.Y, Z - rhs.Z }; }
+		double Dot(const Vector3& rhs) const { return X * rhs.X + Y * rhs.Y + Z * rhs.Z; }
+		Vector3 Cross(const Vector3& rhs) const { return { Y * rhs.Z - Z * rhs.Y, Z * rhs.X - X * rhs.Z, X * rhs.Y - Y * rhs.X }; }
+	};
+
+	// Symmetric 4x4 matrix, error(p) = p.A.p + 2 b.p + c
+	struct Quadric
+	{
+		double A00{ 0 }, A11{ 0 }, A22{ 0 }, A01{ 0 }, A02{ 0 }, A12{ 0 };
+		double B0{ 0 }, B1{ 0 }, B2{ 0 };
+		double C{ 0 };
+		double Weight{ 0 }; // sum of the plane weights
+
+		void AddPlane(const Vector3& n, double d, double weight)
+		{
+			Weight += weight;
+			A00 += weight * n.X * n.X; A11 += weight * n.Y * n.Y; A22 += weight * n.Z * n.Z;
+			A01 += weight * n.X * n.Y; A02 += weight * n.X * n.Z; A12 += weight * n.Y * n.Z;
+			B0 += weight * n.X * d; B1 += weight * n.Y * d; B2 += weight * n.Z * d;
+			C += weight * d * d;
+		}
+
+		void Add(const Quadric& q)
+		{
+			A00 += q.A00; A11 += q.A11; A22 += q.A22; A01 += q.A01; A02 += q.A02; A12 += q.A12;
+			B0 += q.B0; B1 += q.B1; B2 += q.B2;
+			C += q.C;
+			Weight += q.Weight;
+		}
+
+		double Error(const Vector3& p) const
+		{
+			const double rx = A00 * p.X + A01 * p.Y + A02 * p.Z;
+			const double ry = A01 * p.X + A11 * p.Y + A12 * p.Z;
+			const double rz = A02 * p.X + A12 * p.Y + A22 * p.Z;
+			const double error = rx * p.X + ry * p.Y + rz * p.Z + 2.0 * (B0 * p.X + B1 * p.Y + B2 * p.Z) + C;
+			return error > 0.0 ? error : 0.0;
+		}
+
+		// Weighted mean of the squared distances to the planes, in the units of the mesh whatever the weights
+		double DistanceSq(const Vector3& p) const
+		{
+			return Weight > 0.0 ? Error(p) / Weight : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t From;
+		uint32_t To;
+		double Error;
+	};
+
+	// The triangles around v, with v replaced by the collapse target, must keep their orientation
+	static bool CollapseFlipsTriangles(
+		uint32_t from, uint32_t to,
+		const std::vector<Vector3>& positions,
+		const std::vector<uint32_t>& indices,
+		const std::vector<uint32_t>& adjacencyOffsets,
+		const std::vector<uint32_t>& adjacency)
+	{
+		for (uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; ++i)
+		{
+			const uint32_t* triangle = &indices[adjacency[i] * 3];
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+				continue; // collapsed away
+
+			const Vector3& p0 = positions[triangle[0]];
+			const Vector3& p1 = positions[triangle[1]];
+			const Vector3& p2 = positions[triangle[2]];
+			const Vector3 before = (p1 - p0).Cross(p2 - p0);
+
+			const Vector3& q0 = positions[triangle[0] == from ? to : triangle[0]];
+			const Vector3& q1 = positions[triangle[1] == from ? to : triangle[1]];
+			const Vector3& q2 = positions[triangle[2] == from ? to : triangle[2]];
+			const Vector3 after = (q1 - q0).Cross(q2 - q0);
+
+			if (before.Dot(after) <= 0.0)
+				return true;
+		}
+		return false;
+	}
+
+	std::vector<uint32_t> Simplify(
+		const std::vector<Vertex>& vertices,
+		const std::vector<uint32_t>& indices,
+		size_t targetIndexCount,
+		float* error)
+	{
+		const size_t vertexCount = vertices.size();
+		std::vector<uint32_t> result = indices;
+		double maxError = 0.0;
+
+		std::vector<Vector3> positions(vertexCount);
+		Vector3 minimum{ DBL_MAX, DBL_MAX, DBL_MAX };
+		Vector3 maximum{ -DBL_MAX, -DBL_MAX, -DBL_MAX };
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			const auto& p = vertices[v].Position;
+			positions[v] = { p.x, p.y, p.z };
+			minimum = { std::min(minimum.X, (double)p.x), std::min(minimum.Y, (double)p.y), std::min(minimum.Z, (double)p.z) };
+			maximum = { std::max(maximum.X, (double)p.x), std::max(maximum.Y, (double)p.y), std::max(maximum.Z, (double)p.z) };
+		}
+		const Vector3 extent = maximum - minimum;
+		const double scale = std::max(extent.X, std::max(extent.Y, extent.Z));
+
+		// open edges are used by a single triangle, their vertices stay where they are
+		std::vector<bool> locked(vertexCount, false);
+		{
+			std::unordered_map<uint64_t, uint32_t> edges;
+			edges.reserve(result.size());
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				for (int e = 0; e < 3; ++e)
+				{
+					const uint64_t a = result[i + e];
+					const uint64_t b = result[i + (e + 1) % 3];
+					++edges[a < b ? (a << 32) | b : (b << 32) | a];
+				}
+			}
+
+			for (auto& edge : edges)
+			{
+				if (edge.second == 1)
+				{
+					locked[edge.first >> 32] = true;
+					locked[edge.first & 0xffffffffu] = true;
+				}
+			}
+		}
+
+		// plane of every triangle, weighted by its area. The areas grow with the square of the mesh
+		// size, the collapse errors are divided by the summed weights so they don't
+		std::vector<Quadric> quadrics(vertexCount);
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			const Vector3& p0 = positions[result[i + 0]];
+			const Vector3 normal = (positions[result[i + 1]] - p0).Cross(positions[result[i + 2]] - p0);
+			const double length = std::sqrt(normal.Dot(normal));
+			if (length == 0.0)
+				continue;
+
+			const Vector3 n = { normal.X / length, normal.Y / length, normal.Z / length };
+			const double d = -n.Dot(p0);
+			for (int c = 0; c < 3; ++c)
+				quadrics[result[i + c]].AddPlane(n, d, length * 0.5);
+		}
+
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+		std::vector<uint32_t> adjacency;
+		std::vector<Collapse> collapses;
+		std::vector<bool> touched(vertexCount);
+		std::vector<uint32_t> remap(vertexCount);
+
+		while (result.size() > targetIndexCount)
+		{
+			const size_t triangleCount = result.size() / 3;
+
+			std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+			for (uint32_t index : result)
+				++adjacencyOffsets[index + 1];
+			for (size_t v = 0; v < vertexCount; ++v)
+				adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+			adjacency.resize(result.size());
+			{
+				std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+				for (size_t i = 0; i < result.size(); ++i)
+					adjacency[fill[result[i]]++] = uint32_t(i / 3);
+			}
+
+			// every edge in the direction that costs less, locked vertices can only be collapse targets
+			collapses.clear();
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				for (int e = 0; e < 3; ++e)
+				{
+					const uint32_t a = result[i + e];
+					const uint32_t b = result[i + (e + 1) % 3];
+					if (a > b)
+						continue; // the other triangle of the edge handles it
+
+					Quadric q = quadrics[a];
+					q.Add(quadrics[b]);
+
+					const double errorToB = locked[a] ? DBL_MAX : q.DistanceSq(positions[b]);
+					const double errorToA = locked[b] ? DBL_MAX : q.DistanceSq(positions[a]);
+					if (errorToB == DBL_MAX && errorToA == DBL_MAX)
+						continue;
+
+					if (errorToB <= errorToA)
+						collapses.push_back({ a, b, errorToB });
+					else
+						collapses.push_back({ b, a, errorToA });
+				}
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) { return lhs.Error < rhs.Error; });
+
+			// an edge collapse removes about 2 triangles, the vertices around a collapse
+			// are not touched again in the same pass so the flip checks stay valid
+			const size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+			size_t removedTriangles = 0;
+			size_t numCollapses = 0;
+
+			std::fill(touched.begin(), touched.end(), false);
+			for (size_t v = 0; v < vertexCount; ++v)
+				remap[v] = uint32_t(v);
+
+			for (const Collapse& collapse : collapses)
+			{
+				if (removedTriangles >= trianglesToRemove)
+					break;
+
+				if (touched[collapse.From] || touched[collapse.To])
+					continue;
+
+				if (CollapseFlipsTriangles(collapse.From, collapse.To, positions, result, adjacencyOffsets, adjacency))
+					continue;
+
+				remap[collapse.From] = collapse.To;
+				quadrics[collapse.To].Add(quadrics[collapse.From]);
+				maxError = std::max(maxError, collapse.Error);
+				++numCollapses;
+
+				for (uint32_t i = adjacencyOffsets[collapse.From]; i < adjacencyOffsets[collapse.From + 1]; ++i)
+				{
+					const uint32_t* triangle = &result[adjacency[i] * 3];
+					touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+					if (triangle[0] == collapse.To || triangle[1] == collapse.To || triangle[2] == collapse.To)
+						++removedTriangles;
+				}
+			}
+
+			if (numCollapses == 0)
+				break;
+
+			// drop the triangles that became degenerate
+			size_t writeIndex = 0;
+			for (size_t t = 0; t < triangleCount; ++t)
+			{
+				const uint32_t a = remap[result[t * 3 + 0]];
+				const uint32_t b = remap[result[t * 3 + 1]];
+				const uint32_t c = remap[result[t * 3 + 2]];
+				if (a == b || b == c || a == c)
+					continue;
+
+				result[writeIndex++] = a;
+				result[writeIndex++] = b;
+				result[writeIndex++] = c;
+			}
+			result.resize(writeIndex);
+		}
+
+		if (error)
+			*error = scale > 0.0 ? float(std::sqrt(maxError) / scale) : 0.f;
+
+		return result;
+	}
+
+	std::vector<Lod> BuildLodChain(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t maxLods)
+	{
+		// not worth it below that
+		constexpr size_t MIN_LOD_TRIANGLES = 64;
+
+		std::vector<Lod> lods;
+		lods.reserve(maxLods);
+		const std::vector<uint32_t>* previous = &indices;
+
+		while (lods.size() < maxLods && previous->size() / 3 >= MIN_LOD_TRIANGLES * 2)
+		{
+			const size_t targetIndexCount = (previous->size() / 6) * 3;
+
+			Lod lod;
+			lod.Indices = Simplify(vertices, *previous, targetIndexCount, &lod.Error);
+
+			// simplifying the previous level, the errors add up
+			if (!lods.empty())
+				lod.Error += lods.back().Error;
+
+			// most of the mesh is locked (borders, seams)
+			if (lod.Indices.size() > previous->size() * 9 / 10)
+				break;
+
+			MeshOptimizer::OptimizeVertexCache(lod.Indices, vertices.size());
+			lods.push_back(std::move(lod));
+			previous = &lods.back().Indices;
+		}
+
+		return lods;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Rendering/Vertex.h"
+
+#include <cstdint>
+#include <vector>
+
+// Quadric error metric simplification (Garland/Heckbert). Edges are collapsed onto one of their
+// vertices so the simplified indices keep using the original vertex buffer, open edges (borders
+// and attribute seams) are locked.
+namespace MeshSimplifier
+{
+	struct Lod
+	{
+		std::vector<uint32_t> Indices;
+		float Error{ 0.f }; // relative to the mesh size
+	};
+
+	// Collapses edges, cheapest first, until the index count is at most targetIndexCount or no edge
+	// can be collapsed. error receives the largest collapse error relative to the mesh size.
+	std::vector<uint32_t> Simplify(
+		const std::vector<Vertex>& vertices,
+		const std::vector<uint32_t>& indices,
+		size_t targetIndexCount,
+		float* error = nullptr);
+
+	// Each level halves the triangles of the previous one (50/25/12%), stops early when the
+	// simplification can't make progress. The full resolution mesh is not included.
+	std::vector<Lod> BuildLodChain(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t maxLods);
+}
@@ -0,0 +1,262 @@
+#include "pch.h"
+#include "Meshlets.h"
+#include "MeshOptimizer.h"
+#include "Rendering/Frustum.h"
+#include "Defines.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace Meshlets
+{
+	static void ComputeBounds(Meshlet& meshlet, const std::vector<Vertex>& vertices, const uint32_t* indices)
+	{
+		const uint32_t indexCount = meshlet.TriangleCount * 3;
+
+		XMVECTOR minimum = XMLoadFloat3(&vertices[indices[0]].Position);
+		XMVECTOR maximum = minimum;
+		for (uint32_t i = 1; i < indexCount; ++i)
+		{
+			const XMVECTOR p = XMLoadFloat3(&vertices[indices[i]].Position);
+			minimum = XMVectorMin(minimum, p);
+			maximum = XMVectorMax(maximum, p);
+		}
+
+		const XMVECTOR center = XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f);
+		XMVECTOR radius = XMVectorZero();
+		for (uint32_t i = 0; i < indexCount; ++i)
+			radius = XMVectorMax(radius, XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&vertices[indices[i]].Position), center)));
+
+		XMStoreFloat3(&meshlet.Center, center);
+		meshlet.Radius = std::sqrt(XMVectorGetX(radius));
+
+		// the cone axis is the average triangle normal, its angle covers all of them
+		std::vector<XMFLOAT3> normals(meshlet.TriangleCount);
+		XMVECTOR axis = XMVectorZero();
+		for (uint32_t t = 0; t < meshlet.TriangleCount; ++t)
+		{
+			const XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t * 3 + 0]].Position);
+			const XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t * 3 + 1]].Position);
+			const XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t * 3 + 2]].Position);
+
+			// clockwise front faces
+			const XMVECTOR normal = XMVector3Normalize(XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0)));
+			XMStoreFloat3(&normals[t], normal);
+			axis = XMVectorAdd(axis, normal);
+		}
+		axis = XMVector3Normalize(axis);
+
+		float minDot = 1.f;
+		for (const XMFLOAT3& normal : normals)
+			minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(axis, XMLoadFloat3(&normal))));
+
+		// wider than ~85 degrees (or degenerate), the cone would never cull anything
+		if (minDot <= 0.1f || XMVector3Equal(axis, XMVectorZero()))
+		{
+			meshlet.ConeCutoff = 2.f;
+			return;
+		}
+
+		// the apex is moved back along the axis until every triangle plane is in front of it,
+		// that keeps the test valid for any eye position and not just far away
+		float maxT = 0.f;
+		for (uint32_t t = 0; t < meshlet.TriangleCount; ++t)
+		{
+			const XMVECTOR normal = XMLoadFloat3(&normals[t]);
+			const XMVECTOR toCenter = XMVectorSubtract(center, XMLoadFloat3(&vertices[indices[t * 3]].Position));
+			const float distance = XMVectorGetX(XMVector3Dot(toCenter, normal));
+			const float cosine = XMVectorGetX(XMVector3Dot(axis, normal));
+			maxT = std::max(maxT, distance / cosine);
+		}
+
+		XMStoreFloat3(&meshlet.ConeApex, XMVectorSubtract(center, XMVectorScale(axis, maxT)));
+		XMStoreFloat3(&meshlet.ConeAxis, axis);
+		meshlet.ConeCutoff = std::sqrt(1.f - minDot * minDot);
+	}
+
+	std::vector<Meshlet> Build(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		std::vector<Meshlet> meshlets;
+
+		const size_t vertexCount = vertices.size();
+		const size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+			return meshlets;
+
+		// triangles using each vertex, the unassigned ones are kept at the front of each list
+		std::vector<uint32_t> liveTriangles(vertexCount, 0);
+		for (uint32_t index : indices)
+			++liveTriangles[index];
+
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; ++v)
+			adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+		std::vector<uint32_t> adjacency(indices.size());
+		{
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); ++i)
+				adjacency[fill[indices[i]]++] = uint32_t(i / 3);
+		}
+
+		std::vector<bool> assigned(triangleCount, false);
+		std::vector<bool> inMeshlet(vertexCount, false);
+		std::vector<uint32_t> localVertices(vertexCount, 0); // index in meshletVertices
+		std::vector<uint32_t> meshletVertices;
+		meshletVertices.reserve(MAX_VERTICES);
+		std::vector<uint32_t> localIndices;
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+
+		auto newVertices = [&](uint32_t t)
+		{
+			const uint32_t* triangle = &indices[t * 3];
+			uint32_t count = 0;
+			for (int c = 0; c < 3; ++c)
+			{
+				if (!inMeshlet[triangle[c]] && std::find(triangle, triangle + c, triangle[c]) == triangle + c)
+					++count;
+			}
+			return count;
+		};
+
+		// best unassigned triangle around the vertices given, INVALID when none fits
+		constexpr uint32_t INVALID_TRIANGLE = ~0u;
+		auto findCandidate = [&](const uint32_t* candidates, size_t numCandidates)
+		{
+			uint32_t best = INVALID_TRIANGLE;
+			uint32_t bestCost = 4;
+			for (size_t i = 0; i < numCandidates && bestCost > 0; ++i)
+			{
+				const uint32_t v = candidates[i];
+				const uint32_t* list = &adjacency[adjacencyOffsets[v]];
+				for (uint32_t j = 0; j < liveTriangles[v]; ++j)
+				{
+					const uint32_t t = list[j];
+					const uint32_t cost = newVertices(t);
+					if (meshletVertices.size() + cost > MAX_VERTICES)
+						continue;
+
+					if (cost < bestCost || (cost == bestCost && t < best))
+					{
+						bestCost = cost;
+						best = t;
+					}
+				}
+			}
+			return best;
+		};
+
+		Meshlet meshlet;
+		size_t scanCursor = 0;
+
+		auto finishMeshlet = [&]()
+		{
+			// the triangles are picked for the fewest new vertices, they are ordered again for the
+			// vertex cache inside the meshlet, the order of MeshOptimizer doesn't survive the grouping
+			uint32_t* meshletIndices = &result[meshlet.IndexOffset];
+			localIndices.resize(meshlet.TriangleCount * 3);
+			for (size_t i = 0; i < localIndices.size(); ++i)
+				localIndices[i] = localVertices[meshletIndices[i]];
+			MeshOptimizer::OptimizeVertexCache(localIndices, meshletVertices.size());
+			for (size_t i = 0; i < localIndices.size(); ++i)
+				meshletIndices[i] = meshletVertices[localIndices[i]];
+
+			meshlet.VertexCount = (uint32_t)meshletVertices.size();
+			ComputeBounds(meshlet, vertices, &result[meshlet.IndexOffset]);
+			meshlets.push_back(meshlet);
+
+			for (uint32_t v : meshletVertices)
+				inMeshlet[v] = false;
+			meshletVertices.clear();
+
+			meshlet = Meshlet();
+			meshlet.IndexOffset = (uint32_t)result.size();
+		};
+
+		for (size_t emitted = 0; emitted < triangleCount; ++emitted)
+		{
+			uint32_t next = INVALID_TRIANGLE;
+			if (meshlet.TriangleCount > 0 && meshlet.TriangleCount < MAX_TRIANGLES)
+			{
+				// neighbours of the last triangle first, then of the whole meshlet
+				next = findCandidate(&result[result.size() - 3], 3);
+				if (next == INVALID_TRIANGLE)
+					next = findCandidate(meshletVertices.data(), meshletVertices.size());
+			}
+
+			if (next == INVALID_TRIANGLE)
+			{
+				if (meshlet.TriangleCount > 0)
+					finishMeshlet();
+
+				while (assigned[scanCursor])
+					++scanCursor;
+				next = (uint32_t)scanCursor;
+			}
+
+			const uint32_t* triangle = &indices[next * 3];
+			result.insert(result.end(), triangle, triangle + 3);
+			assigned[next] = true;
+			++meshlet.TriangleCount;
+
+			for (int c = 0; c < 3; ++c)
+			{
+				const uint32_t v = triangle[c];
+				if (!inMeshlet[v])
+				{
+					inMeshlet[v] = true;
+					localVertices[v] = (uint32_t)meshletVertices.size();
+					meshletVertices.push_back(v);
+				}
+
+				uint32_t* list = &adjacency[adjacencyOffsets[v]];
+				for (uint32_t i = 0; i < liveTriangles[v]; ++i)
+				{
+					if (list[i] == next)
+					{
+						std::swap(list[i], list[liveTriangles[v] - 1]);
+						--liveTriangles[v];
+						break;
+					}
+				}
+			}
+		}
+		finishMeshlet();
+
+		indices.swap(result);
+		return meshlets;
+	}
+
+	std::vector<MeshletRange> XM_CALLCONV Cull(const std::vector<Meshlet>& meshlets, FXMMATRIX worldViewProj, FXMVECTOR eye)
+	{
+		const Frustum frustum(worldViewProj);
+
+		std::vector<MeshletRange> ranges;
+		for (const Meshlet& meshlet : meshlets)
+		{
+			bool visible = frustum.IntersectsSphere(XMLoadFloat3(&meshlet.Center), meshlet.Radius);
+
+			if (visible && meshlet.ConeCutoff <= 1.f)
+			{
+				const XMVECTOR view = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&meshlet.ConeApex), eye));
+				visible = XMVectorGetX(XMVector3Dot(view, XMLoadFloat3(&meshlet.ConeAxis))) < meshlet.ConeCutoff;
+			}
+
+			if (!visible)
+				continue;
+
+			// consecutive meshlets are merged in a single draw
+			const uint32_t indexCount = meshlet.TriangleCount * 3;
+			if (!ranges.empty() && ranges.back().IndexOffset + ranges.back().IndexCount == meshlet.IndexOffset)
+				ranges.back().IndexCount += indexCount;
+			else
+				ranges.push_back({ meshlet.IndexOffset, indexCount });
+		}
+
+		return ranges;
+	}
+}
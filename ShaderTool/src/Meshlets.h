@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Rendering/Vertex.h"
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// A small cluster of triangles, contiguous in the index buffer of its model so it can be drawn
+// (or skipped) with a sub range of the model indices.
+struct Meshlet
+{
+	uint32_t IndexOffset{ 0 }; // relative to the first index of the model
+	uint32_t TriangleCount{ 0 };
+	uint32_t VertexCount{ 0 };
+
+	// bounding sphere, object space
+	DirectX::XMFLOAT3 Center{ 0.f, 0.f, 0.f };
+	float Radius{ 0.f };
+
+	// every triangle faces away from the viewer when dot(normalize(ConeApex - eye), ConeAxis) >= ConeCutoff
+	DirectX::XMFLOAT3 ConeApex{ 0.f, 0.f, 0.f };
+	DirectX::XMFLOAT3 ConeAxis{ 0.f, 0.f, 0.f };
+	float ConeCutoff{ 1.f };
+};
+
+// Index range made of consecutive visible meshlets
+struct MeshletRange
+{
+	uint32_t IndexOffset;
+	uint32_t IndexCount;
+};
+
+namespace Meshlets
+{
+	constexpr uint32_t MAX_VERTICES = 64;
+	constexpr uint32_t MAX_TRIANGLES = 124;
+
+	// Groups the triangles in meshlets, growing each one with the neighbours that add the fewest
+	// new vertices. The indices are reordered so every meshlet is contiguous, each meshlet in the
+	// vertex cache order of its own triangles.
+	std::vector<Meshlet> Build(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	// Frustum and backface cone test in object space: worldViewProj is the row vector matrix the
+	// model is drawn with and eye the camera position in object space.
+	std::vector<MeshletRange> XM_CALLCONV Cull(const std::vector<Meshlet>& meshlets, DirectX::FXMMATRIX worldViewProj, DirectX::FXMVECTOR eye);
+}
@@ -0,0 +1,307 @@
+#include "pch.h"
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+#include "Defines.h"
+
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace MipGenerator
+{
+	static constexpr size_t PIXELS_PER_TASK = 16 * 1024;
+	static constexpr float KAISER_WIDTH = 3.f; // each side, in target pixels
+	static constexpr float KAISER_ALPHA = 4.f;
+
+	// Source pixels and weights of each target pixel along one axis, NumTaps per pixel padded with zero weights
+	struct FilterTaps
+	{
+		uint32_t NumTaps{ 0 };
+		std::vector<uint32_t> Indices;
+		std::vector<float> Weights;
+	};
+
+	// Modified Bessel function of the first kind, order 0 (power series)
+	static float BesselI0(float x)
+	{
+		const float y = x * x * 0.25f;
+		float sum = 1.f;
+		float term = 1.f;
+		for (uint32_t k = 1; k < 32 && term > sum * 1e-8f; ++k)
+		{
+			term *= y / (float)(k * k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	static float KaiserSinc(float x)
+	{
+		if (std::fabs(x) >= KAISER_WIDTH)
+			return 0.f;
+
+		const float t = x / KAISER_WIDTH;
+		const float window = BesselI0(KAISER_ALPHA * std::sqrt(1.f - t * t)) / BesselI0(KAISER_ALPHA);
+		const float px = XM_PI * x;
+		return (std::fabs(px) < 1e-5f ? 1.f : std::sin(px) / px) * window;
+	}
+
+	static FilterTaps BuildTaps(uint32_t sourceSize, uint32_t targetSize, MipFilter filter)
+	{
+		const float scale = (float)sourceSize / targetSize;
+		const float radius = (filter == MipFilter::Box ? 0.5f : KAISER_WIDTH) * scale;
+
+		// weights of the span around each target pixel, then trimmed of the zeros at both ends
+		const uint32_t span = (uint32_t)std::ceil(2.f * radius) + 1;
+		std::vector<int> first(targetSize);
+		std::vector<float> weights((size_t)targetSize * span);
+		std::vector<uint32_t> begin(targetSize), end(targetSize);
+		uint32_t numTaps = 1;
+		for (uint32_t x = 0; x < targetSize; ++x)
+		{
+			const float center = (x + 0.5f) * scale;
+			first[x] = (int)std::floor(center - radius);
+
+			float* w = &weights[(size_t)x * span];
+			float sum = 0.f;
+			for (uint32_t t = 0; t < span; ++t)
+			{
+				const float i = (float)(first[x] + (int)t);
+				if (filter == MipFilter::Box)
+					w[t] = std::max(0.f, std::min(i + 1.f, center + radius) - std::max(i, center - radius));
+				else
+					w[t] = KaiserSinc((i + 0.5f - center) / scale);
+				sum += w[t];
+			}
+
+			begin[x] = 0;
+			end[x] = span;
+			for (uint32_t t = 0; t < span; ++t)
+				w[t] /= sum;
+			while (begin[x] + 1 < end[x] && w[begin[x]] == 0.f)
+				++begin[x];
+			while (end[x] - 1 > begin[x] && w[end[x] - 1] == 0.f)
+				--end[x];
+			numTaps = std::max(numTaps, end[x] - begin[x]);
+		}
+
+		FilterTaps taps;
+		taps.NumTaps = numTaps;
+		taps.Indices.assign((size_t)targetSize * numTaps, 0);
+		taps.Weights.assign((size_t)targetSize * numTaps, 0.f);
+		for (uint32_t x = 0; x < targetSize; ++x)
+		{
+			for (uint32_t t = begin[x]; t < end[x]; ++t)
+			{
+				const size_t tap = (size_t)x * numTaps + t - begin[x];
+				taps.Indices[tap] = (uint32_t)std::clamp(first[x] + (int)t, 0, (int)sourceSize - 1);
+				taps.Weights[tap] = weights[(size_t)x * span + t];
+			}
+		}
+		return taps;
+	}
+
+	// targetWidth x source.Height
+	static void FilterRows(const FloatImage& source, const FilterTaps& taps, uint32_t targetWidth, FloatImage& target)
+	{
+		target.Width = targetWidth;
+		target.Height = source.Height;
+		target.Pixels.resize((size_t)target.Width * target.Height);
+		ThreadPool::Get().ParallelFor(source.Height, std::max<size_t>(1, PIXELS_PER_TASK / source.Width), [&](size_t begin, size_t end)
+		{
+			for (size_t y = begin; y < end; ++y)
+			{
+				const XMFLOAT4* row = &source.Pixels[y * source.Width];
+				XMFLOAT4* out = &target.Pixels[y * target.Width];
+				for (uint32_t x = 0; x < target.Width; ++x)
+				{
+					const uint32_t* indices = &taps.Indices[(size_t)x * taps.NumTaps];
+					const float* weights = &taps.Weights[(size_t)x * taps.NumTaps];
+					XMVECTOR sum = XMVectorZero();
+					for (uint32_t t = 0; t < taps.NumTaps; ++t)
+						sum = XMVectorMultiplyAdd(XMLoadFloat4(&row[indices[t]]), XMVectorReplicate(weights[t]), sum);
+					XMStoreFloat4(&out[x], sum);
+				}
+			}
+		});
+	}
+
+	// source.Width x targetHeight, each tap adds a whole source row
+	static void FilterColumns(const FloatImage& source, const FilterTaps& taps, uint32_t targetHeight, FloatImage& target)
+	{
+		target.Width = source.Width;
+		target.Height = targetHeight;
+		target.Pixels.resize((size_t)target.Width * target.Height);
+		ThreadPool::Get().ParallelFor(targetHeight, std::max<size_t>(1, PIXELS_PER_TASK / (source.Width * taps.NumTaps)), [&](size_t begin, size_t end)
+		{
+			for (size_t y = begin; y < end; ++y)
+			{
+				XMFLOAT4* out = &target.Pixels[y * target.Width];
+				for (uint32_t t = 0; t < taps.NumTaps; ++t)
+				{
+					const XMFLOAT4* row = &source.Pixels[(size_t)taps.Indices[y * taps.NumTaps + t] * source.Width];
+					const XMVECTOR weight = XMVectorReplicate(taps.Weights[y * taps.NumTaps + t]);
+					for (uint32_t x = 0; x < target.Width; ++x)
+					{
+						const XMVECTOR sum = t == 0 ? XMVectorZero() : XMLoadFloat4(&out[x]);
+						XMStoreFloat4(&out[x], XMVectorMultiplyAdd(XMLoadFloat4(&row[x]), weight, sum));
+					}
+				}
+			}
+		});
+	}
+
+	bool IsSupported(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8X8_UNORM:
+		case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	bool IsSRGB(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+		case DXGI_FORMAT_BC2_UNORM_SRGB:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	uint32_t GetPixelBytes(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			return 8;
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			return 16;
+		default:
+			return 4;
+		}
+	}
+
+	uint32_t GetMipCount(uint32_t width, uint32_t height)
+	{
+		uint32_t count = 1;
+		for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+			++count;
+		return count;
+	}
+
+	void Load(DXGI_FORMAT format, const uint8_t* data, size_t rowPitch, uint32_t width, uint32_t height, FloatImage& image)
+	{
+		assert(IsSupported(format) && "Format can't be filtered");
+
+		const bool isSRGB = IsSRGB(format);
+		const bool isBGRA = format == DXGI_FORMAT_B8G8R8A8_UNORM || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB ||
+			format == DXGI_FORMAT_B8G8R8X8_UNORM || format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+		const bool isOpaque = format == DXGI_FORMAT_B8G8R8X8_UNORM || format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+
+		image.Width = width;
+		image.Height = height;
+		image.Pixels.resize((size_t)width * height);
+		ThreadPool::Get().ParallelFor(height, std::max<size_t>(1, PIXELS_PER_TASK / width), [&](size_t begin, size_t end)
+		{
+			for (size_t y = begin; y < end; ++y)
+			{
+				const uint8_t* row = data + y * rowPitch;
+				XMFLOAT4* out = &image.Pixels[y * width];
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					XMVECTOR color;
+					if (format == DXGI_FORMAT_R16G16B16A16_FLOAT)
+						color = XMLoadHalf4((const XMHALF4*)row + x);
+					else if (format == DXGI_FORMAT_R32G32B32A32_FLOAT)
+						color = XMLoadFloat4((const XMFLOAT4*)row + x);
+					else
+					{
+						color = XMVectorScale(XMLoadUByte4((const XMUBYTE4*)row + x), 1.f / 255.f);
+						if (isBGRA)
+							color = XMVectorSwizzle<2, 1, 0, 3>(color);
+						if (isOpaque)
+							color = XMVectorSetW(color, 1.f);
+						if (isSRGB)
+							color = XMColorSRGBToRGB(color);
+					}
+					XMStoreFloat4(&out[x], color);
+				}
+			}
+		});
+	}
+
+	void Store(DXGI_FORMAT format, const FloatImage& image, std::vector<uint8_t>& data)
+	{
+		assert(IsSupported(format) && "Format can't be filtered");
+
+		const bool isSRGB = IsSRGB(format);
+		const bool isBGRA = format == DXGI_FORMAT_B8G8R8A8_UNORM || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB ||
+			format == DXGI_FORMAT_B8G8R8X8_UNORM || format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+		data.resize(image.Pixels.size() * GetPixelBytes(format));
+		ThreadPool::Get().ParallelFor(image.Pixels.size(), PIXELS_PER_TASK, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				XMVECTOR color = XMLoadFloat4(&image.Pixels[i]);
+				if (format == DXGI_FORMAT_R16G16B16A16_FLOAT)
+					XMStoreHalf4((XMHALF4*)data.data() + i, XMVectorMax(color, XMVectorZero()));
+				else if (format == DXGI_FORMAT_R32G32B32A32_FLOAT)
+					XMStoreFloat4((XMFLOAT4*)data.data() + i, XMVectorMax(color, XMVectorZero()));
+				else
+				{
+					color = XMVectorSaturate(color);
+					if (isSRGB)
+						color = XMColorRGBToSRGB(color);
+					if (isBGRA)
+						color = XMVectorSwizzle<2, 1, 0, 3>(color);
+					XMStoreUByte4((XMUBYTE4*)data.data() + i, XMVectorFloor(XMVectorMultiplyAdd(color, XMVectorReplicate(255.f), XMVectorReplicate(0.5f))));
+				}
+			}
+		});
+	}
+
+	void Downsample(const FloatImage& source, MipFilter filter, FloatImage& target)
+	{
+		const uint32_t width = std::max(1u, source.Width / 2);
+		const uint32_t height = std::max(1u, source.Height / 2);
+
+		FloatImage rows;
+		FilterRows(source, BuildTaps(source.Width, width, filter), width, rows);
+		FilterColumns(rows, BuildTaps(source.Height, height, filter), height, target);
+	}
+
+	void Generate(MipFilter filter, std::vector<FloatImage>& mips)
+	{
+		assert(!mips.empty() && "The base level is missing");
+
+		const uint32_t mipCount = GetMipCount(mips[0].Width, mips[0].Height);
+		mips.reserve(mipCount);
+		while (mips.size() < mipCount)
+		{
+			FloatImage next;
+			Downsample(mips.back(), filter, next);
+			mips.push_back(std::move(next));
+		}
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "ImageLoader.h"
+
+#include <dxgiformat.h>
+#include <cstdint>
+#include <vector>
+
+enum class MipFilter
+{
+	Box,    // average of the covered pixels
+	Kaiser  // Kaiser windowed sinc, 3 target pixels on each side (6 wide), sharper
+};
+
+// Mip chains filtered in linear space (the sRGB formats are converted on load and store).
+// The filters are separable, a horizontal then a vertical pass with the taps of each column and
+// row computed once per mip, the rows split between the workers and the 4 channels in an XMVECTOR.
+// Odd sizes are filtered with the exact footprint, the taps outside the image repeat the edge.
+namespace MipGenerator
+{
+	// RGBA8 and BGRA8 (UNORM and SRGB), RGBA16F and RGBA32F
+	bool IsSupported(DXGI_FORMAT format);
+	bool IsSRGB(DXGI_FORMAT format);
+	uint32_t GetPixelBytes(DXGI_FORMAT format);
+
+	// Including the base level, down to 1x1
+	uint32_t GetMipCount(uint32_t width, uint32_t height);
+
+	// width x height pixels from rows rowPitch bytes apart
+	void Load(DXGI_FORMAT format, const uint8_t* data, size_t rowPitch, uint32_t width, uint32_t height, FloatImage& image);
+
+	// Tightly packed rows, the UNORM formats are saturated and the float ones clamped to 0
+	void Store(DXGI_FORMAT format, const FloatImage& image, std::vector<uint8_t>& data);
+
+	// Half the size of the source, at least 1
+	void Downsample(const FloatImage& source, MipFilter filter, FloatImage& target);
+
+	// mips[0] is the base level, the smaller ones are appended
+	void Generate(MipFilter filter, std::vector<FloatImage>& mips);
+}
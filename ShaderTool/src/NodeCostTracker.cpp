@@ -0,0 +1,115 @@
+#include "pch.h"
+#include "NodeCostTracker.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+
+double NodeCost::GetTotalMs() const
+{
+	double total = 0.0;
+	for (double ms : AverageMs)
+		total += ms;
+	return total;
+}
+
+void NodeCostTracker::SetEnabled(bool enabled)
+{
+	if (enabled && !_Enabled)
+		Clear();
+	_Enabled = enabled;
+}
+
+void NodeCostTracker::Add(const UiNode* node, NodeCostKind kind, uint64_t cycles)
+{
+	NodeCost& cost = _Costs.try_emplace(node->Id, NodeCost{ node->Type }).first->second;
+	cost.FrameCycles[(size_t)kind] += cycles;
+	++cost.NumCalls;
+}
+
+void NodeCostTracker::Remove(NodeId id)
+{
+	_Costs.erase(id);
+}
+
+void NodeCostTracker::Clear()
+{
+	_Costs.clear();
+	_MaxTotalMs = 0.0;
+}
+
+void NodeCostTracker::BeginFrame()
+{
+	if (!_Enabled)
+		return;
+
+	_MaxTotalMs = 0.0;
+	for (auto& [id, cost] : _Costs)
+	{
+		double frameMs = 0.0;
+		for (size_t i = 0; i < (size_t)NodeCostKind::Count; ++i)
+		{
+			// the profiler ticks are TSC cycles as well
+			const double ms = Profiler::TicksToMs((int64_t)cost.FrameCycles[i]);
+			cost.AverageMs[i] += (ms - cost.AverageMs[i]) / NODE_COST_AVERAGE_FRAMES;
+			cost.FrameCycles[i] = 0;
+			frameMs += ms;
+		}
+
+		cost.MaxMs = std::max(cost.MaxMs, frameMs);
+		_MaxTotalMs = std::max(_MaxTotalMs, cost.GetTotalMs());
+	}
+}
+
+const NodeCost* NodeCostTracker::GetCost(NodeId id) const
+{
+	auto it = _Costs.find(id);
+	return it != _Costs.end() ? &it->second : nullptr;
+}
+
+float NodeCostTracker::GetHeat(NodeId id) const
+{
+	const NodeCost* cost = GetCost(id);
+	if (!cost || _MaxTotalMs <= 0.0)
+		return 0.0f;
+	return (float)std::min(cost->GetTotalMs() / _MaxTotalMs, 1.0);
+}
+
+std::vector<std::pair<NodeId, const NodeCost*>> NodeCostTracker::GetHottest(size_t count) const
+{
+	std::vector<std::pair<NodeId, const NodeCost*>> hottest;
+	hottest.reserve(_Costs.size());
+	for (const auto& [id, cost] : _Costs)
+		hottest.emplace_back(id, &cost);
+
+	count = std::min(count, hottest.size());
+	std::partial_sort(hottest.begin(), hottest.begin() + count, hottest.end(), [](const auto& a, const auto& b)
+	{
+		return a.second->GetTotalMs() > b.second->GetTotalMs();
+	});
+	hottest.resize(count);
+	return hottest;
+}
+
+bool NodeCostTracker::WriteCsv(const std::string& path) const
+{
+	std::ofstream csv(path, std::ios_base::out | std::ios_base::trunc);
+	if (!csv.is_open())
+	{
+		LOG_ERROR("Failed to write file {0}", path);
+		return false;
+	}
+
+	csv << "node,type,update_ms,eval_ms,render_ms,total_ms,max_ms,calls\n";
+	for (const auto& [id, cost] : GetHottest(_Costs.size()))
+	{
+		csv << id << "," << magic_enum::enum_name(cost->Type)
+			<< "," << cost->AverageMs[(size_t)NodeCostKind::Update]
+			<< "," << cost->AverageMs[(size_t)NodeCostKind::Eval]
+			<< "," << cost->AverageMs[(size_t)NodeCostKind::Render]
+			<< "," << cost->GetTotalMs() << "," << cost->MaxMs << "," << cost->NumCalls << "\n";
+	}
+
+	LOG_INFO("Node costs written to {0} ({1} nodes)", path, _Costs.size());
+	return true;
+}
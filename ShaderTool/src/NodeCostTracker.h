@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Editor\UiNode\UiNode.h"
+
+#include <intrin.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class NodeCostKind
+{
+	Update,  // OnUpdate
+	Eval,    // OnEval
+	Render,  // RenderToTexture of a draw node
+	Count
+};
+
+struct NodeCost
+{
+	UiNodeType Type;
+	uint64_t FrameCycles[(size_t)NodeCostKind::Count]{}; // of the frame being recorded
+	double AverageMs[(size_t)NodeCostKind::Count]{};     // per frame, exponential moving average
+	double MaxMs{ 0.0 };                                 // worst frame, all kinds
+	uint64_t NumCalls{ 0 };
+
+	double GetTotalMs() const;
+};
+
+// Time spent in each node, measured with the cycle counter while enabled (F5 in the editor).
+// The cycles of a frame are added up per node and folded into the averages by BeginFrame, the
+// cycles are converted with the TSC rate of the profiler (Profiler::TicksToMs).
+class NodeCostTracker
+{
+public:
+	NodeCostTracker(const NodeCostTracker&) = delete;
+	NodeCostTracker& operator=(const NodeCostTracker&) = delete;
+
+	static NodeCostTracker& Get()
+	{
+		static NodeCostTracker instance;
+		return instance;
+	}
+
+	bool IsEnabled() const { return _Enabled; }
+	void SetEnabled(bool enabled); // the stats are cleared when enabled
+
+	void Add(const UiNode* node, NodeCostKind kind, uint64_t cycles);
+	void Remove(NodeId id);
+	void Clear();
+
+	// Folds the cycles of the last frame into the averages
+	void BeginFrame();
+
+	const NodeCost* GetCost(NodeId id) const;
+	// Average cost of the node relative to the most expensive one, in [0, 1]
+	float GetHeat(NodeId id) const;
+	// The most expensive nodes first
+	std::vector<std::pair<NodeId, const NodeCost*>> GetHottest(size_t count) const;
+
+	bool WriteCsv(const std::string& path) const;
+
+private:
+	NodeCostTracker() = default;
+
+private:
+	bool _Enabled{ false };
+	std::unordered_map<NodeId, NodeCost> _Costs;
+	double _MaxTotalMs{ 0.0 };
+};
+
+// Adds the cycles spent until the end of the scope (or Stop) to the node, nothing is read while disabled
+class NodeCostScope
+{
+public:
+	NodeCostScope(const UiNode* node, NodeCostKind kind) : _Node(node), _Kind(kind)
+	{
+		if (NodeCostTracker::Get().IsEnabled())
+			_Start = __rdtsc();
+	}
+
+	~NodeCostScope() { Stop(); }
+
+	void Stop()
+	{
+		if (_Start == 0)
+			return;
+
+		NodeCostTracker::Get().Add(_Node, _Kind, __rdtsc() - _Start);
+		_Start = 0;
+	}
+
+	NodeCostScope(const NodeCostScope&) = delete;
+	NodeCostScope& operator=(const NodeCostScope&) = delete;
+
+private:
+	const UiNode* _Node;
+	NodeCostKind _Kind;
+	uint64_t _Start{ 0 };
+};
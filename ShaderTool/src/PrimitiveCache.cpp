@@ -0,0 +1,200 @@
+#include "pch.h"
+#include "PrimitiveCache.h"
+#include "AssetManager.h"
+#include "MeshOptimizer.h"
+#include "Defines.h"
+
+#include <algorithm>
+#include <functional>
+
+PrimitiveParams PrimitiveParams::Normalized() const
+{
+	PrimitiveParams params;
+	params.Shape = Shape;
+	params.Width = 0.f;
+	params.Height = 0.f;
+	params.Depth = 0.f;
+	params.Radius = 0.f;
+	params.TopRadius = 0.f;
+	params.Slices = 0;
+	params.Stacks = 0;
+	params.Subdivisions = 0;
+
+	switch (Shape)
+	{
+	case PrimitiveShape::Box:
+		params.Width = Width;
+		params.Height = Height;
+		params.Depth = Depth;
+		params.Subdivisions = std::min(Subdivisions, MAX_PRIMITIVE_SUBDIVISIONS);
+		break;
+
+	case PrimitiveShape::Sphere:
+		params.Radius = Radius;
+		params.Slices = std::clamp(Slices, 3u, MAX_PRIMITIVE_TESSELLATION);
+		params.Stacks = std::clamp(Stacks, 2u, MAX_PRIMITIVE_TESSELLATION);
+		break;
+
+	case PrimitiveShape::Geosphere:
+		params.Radius = Radius;
+		params.Subdivisions = std::min(Subdivisions, MAX_GEOSPHERE_SUBDIVISIONS);
+		break;
+
+	case PrimitiveShape::Cylinder:
+		params.Radius = Radius;
+		params.TopRadius = TopRadius;
+		params.Height = Height;
+		params.Slices = std::clamp(Slices, 3u, MAX_PRIMITIVE_TESSELLATION);
+		params.Stacks = std::clamp(Stacks, 1u, MAX_PRIMITIVE_TESSELLATION);
+		break;
+
+	case PrimitiveShape::Grid:
+		params.Width = Width;
+		params.Depth = Depth;
+		params.Slices = std::clamp(Slices, 2u, MAX_PRIMITIVE_TESSELLATION);
+		params.Stacks = std::clamp(Stacks, 2u, MAX_PRIMITIVE_TESSELLATION);
+		break;
+	}
+
+	return params;
+}
+
+size_t PrimitiveParamsHash::operator()(const PrimitiveParams& params) const
+{
+	size_t hash = std::hash<int>()(static_cast<int>(params.Shape));
+	auto combine = [&hash](size_t value) { hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+
+	combine(std::hash<float>()(params.Width));
+	combine(std::hash<float>()(params.Height));
+	combine(std::hash<float>()(params.Depth));
+	combine(std::hash<float>()(params.Radius));
+	combine(std::hash<float>()(params.TopRadius));
+	combine(std::hash<uint32_t>()(params.Slices));
+	combine(std::hash<uint32_t>()(params.Stacks));
+	combine(std::hash<uint32_t>()(params.Subdivisions));
+	return hash;
+}
+
+GeometryGenerator::MeshData PrimitiveCache::Generate(const PrimitiveParams& requested)
+{
+	const PrimitiveParams params = requested.Normalized();
+
+	GeometryGenerator geoGen;
+	switch (params.Shape)
+	{
+	case PrimitiveShape::Box:
+		return geoGen.CreateBox(params.Width, params.Height, params.Depth, params.Subdivisions);
+	case PrimitiveShape::Sphere:
+		return geoGen.CreateSphere(params.Radius, params.Slices, params.Stacks);
+	case PrimitiveShape::Geosphere:
+		return geoGen.CreateGeosphere(params.Radius, params.Subdivisions);
+	case PrimitiveShape::Cylinder:
+		return geoGen.CreateCylinder(params.Radius, params.TopRadius, params.Height, params.Slices, params.Stacks);
+	case PrimitiveShape::Grid:
+		return geoGen.CreateGrid(params.Width, params.Depth, params.Stacks, params.Slices);
+	}
+	return GeometryGenerator::MeshData();
+}
+
+// unique name of the model, it shows in the node tooltips and logs
+static std::string GetPrimitiveName(const PrimitiveParams& params)
+{
+	std::stringstream ss;
+	ss << magic_enum::enum_name(params.Shape);
+	switch (params.Shape)
+	{
+	case PrimitiveShape::Box:
+		ss << " " << params.Width << "x" << params.Height << "x" << params.Depth << " /" << params.Subdivisions;
+		break;
+	case PrimitiveShape::Sphere:
+		ss << " r" << params.Radius << " " << params.Slices << "x" << params.Stacks;
+		break;
+	case PrimitiveShape::Geosphere:
+		ss << " r" << params.Radius << " /" << params.Subdivisions;
+		break;
+	case PrimitiveShape::Cylinder:
+		ss << " r" << params.Radius << "-" << params.TopRadius << " h" << params.Height << " " << params.Slices << "x" << params.Stacks;
+		break;
+	case PrimitiveShape::Grid:
+		ss << " " << params.Width << "x" << params.Depth << " " << params.Slices << "x" << params.Stacks;
+		break;
+	}
+	return ss.str();
+}
+
+int PrimitiveCache::Acquire(const PrimitiveParams& requested)
+{
+	const PrimitiveParams params = requested.Normalized();
+
+	auto it = _Entries.find(params);
+	if (it != _Entries.end())
+	{
+		++it->second.RefCount;
+		it->second.LastUse = ++_UseCounter;
+		return it->second.ModelIndex;
+	}
+
+	// unused meshes go first, their geometry pool space is reused by this one
+	EvictUnused();
+
+	const auto startTime = std::chrono::steady_clock::now();
+	const std::string name = GetPrimitiveName(params);
+
+	GeometryGenerator::MeshData meshData = Generate(params);
+	MeshOptimizer::Report report = MeshOptimizer::Optimize(meshData.Vertices, meshData.Indices32);
+
+	int modelIndex = AssetManager::Get().CreateModel(name, meshData.Vertices, meshData.Indices32);
+	if (modelIndex == INVALID_INDEX)
+	{
+		LOG_ERROR("Failed to create primitive {0}", name);
+		return INVALID_INDEX;
+	}
+
+	const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime);
+	LOG_TRACE("Primitive [{0}] {1} vertices, {2} triangles in {3:.2f} ms, ACMR {4:.3f} -> {5:.3f}, ATVR {6:.3f} -> {7:.3f}",
+		name, meshData.Vertices.size(), meshData.Indices32.size() / 3, elapsed.count(),
+		report.Before.ACMR, report.After.ACMR, report.Before.ATVR, report.After.ATVR);
+
+	_Entries[params] = { modelIndex, 1, ++_UseCounter };
+	_ModelParams[modelIndex] = params;
+	return modelIndex;
+}
+
+void PrimitiveCache::Release(int modelIndex)
+{
+	auto params = _ModelParams.find(modelIndex);
+	if (params == _ModelParams.end())
+	{
+		LOG_WARN("Releasing primitive {0} not in the cache", modelIndex);
+		return;
+	}
+
+	Entry& entry = _Entries[params->second];
+	if (entry.RefCount > 0)
+		--entry.RefCount;
+}
+
+void PrimitiveCache::EvictUnused()
+{
+	size_t numUnused = 0;
+	for (auto& entry : _Entries)
+	{
+		if (entry.second.RefCount == 0)
+			++numUnused;
+	}
+
+	while (numUnused >= PRIMITIVE_CACHE_CAPACITY)
+	{
+		auto oldest = _Entries.end();
+		for (auto it = _Entries.begin(); it != _Entries.end(); ++it)
+		{
+			if (it->second.RefCount == 0 && (oldest == _Entries.end() || it->second.LastUse < oldest->second.LastUse))
+				oldest = it;
+		}
+
+		AssetManager::Get().UnloadModel(oldest->second.ModelIndex);
+		_ModelParams.erase(oldest->second.ModelIndex);
+		_Entries.erase(oldest);
+		--numUnused;
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+enum class PrimitiveShape
+{
+	Box,
+	Sphere,
+	Geosphere,
+	Cylinder,
+	Grid
+};
+
+// GeometryGenerator parameters of a primitive, only the ones used by Shape are meaningful
+struct PrimitiveParams
+{
+	PrimitiveShape Shape{ PrimitiveShape::Box };
+	float Width{ 1.f };			// box, grid
+	float Height{ 1.f };		// box, cylinder
+	float Depth{ 1.f };			// box, grid
+	float Radius{ 1.f };		// sphere, geosphere, cylinder bottom
+	float TopRadius{ 1.f };		// cylinder
+	uint32_t Slices{ 20 };		// sphere, cylinder, grid columns
+	uint32_t Stacks{ 20 };		// sphere, cylinder, grid rows
+	uint32_t Subdivisions{ 0 };	// box, geosphere
+
+	// The unused parameters are reset and the counts clamped to what the generator supports,
+	// so two requests for the same mesh always have the same key.
+	PrimitiveParams Normalized() const;
+
+	bool operator==(const PrimitiveParams& rhs) const
+	{
+		return Shape == rhs.Shape && Width == rhs.Width && Height == rhs.Height && Depth == rhs.Depth
+			&& Radius == rhs.Radius && TopRadius == rhs.TopRadius
+			&& Slices == rhs.Slices && Stacks == rhs.Stacks && Subdivisions == rhs.Subdivisions;
+	}
+
+	bool operator!=(const PrimitiveParams& rhs) const { return !(*this == rhs); }
+};
+
+struct PrimitiveParamsHash
+{
+	size_t operator()(const PrimitiveParams& params) const;
+};
+
+// Models generated from PrimitiveParams, shared by every node asking for the same parameters.
+// The models nobody uses anymore stay in the cache (up to PRIMITIVE_CACHE_CAPACITY) and the least
+// recently used are unloaded first, their geometry pool range and model slot are reused by the next
+// primitives, so a primitive whose size is animated keeps a bounded number of models.
+class PrimitiveCache
+{
+public:
+	PrimitiveCache(const PrimitiveCache&) = delete;
+	PrimitiveCache& operator=(const PrimitiveCache&) = delete;
+
+	static PrimitiveCache& Get()
+	{
+		static PrimitiveCache instance;
+		return instance;
+	}
+
+	// Model index of the primitive, generated on the first request. Every Acquire is matched by a Release.
+	int Acquire(const PrimitiveParams& params);
+	void Release(int modelIndex);
+
+	// Mesh of the parameters as Acquire generates it before the optimization, params normalized or not
+	static GeometryGenerator::MeshData Generate(const PrimitiveParams& params);
+
+	size_t GetNumEntries() const { return _Entries.size(); }
+
+private:
+	PrimitiveCache() = default;
+
+	void EvictUnused();
+
+private:
+	struct Entry
+	{
+		int ModelIndex;
+		uint32_t RefCount;
+		uint64_t LastUse;
+	};
+
+	std::unordered_map<PrimitiveParams, Entry, PrimitiveParamsHash> _Entries;
+	std::unordered_map<int, PrimitiveParams> _ModelParams;
+	uint64_t _UseCounter{ 0 };
+};
@@ -0,0 +1,275 @@
+#include "pch.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Profiler
+{
+	static_assert((PROFILER_RING_SIZE & (PROFILER_RING_SIZE - 1)) == 0, "PROFILER_RING_SIZE must be a power of 2");
+
+	struct Registry
+	{
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<ThreadRing>> Rings; // never removed, the zones outlive their thread
+	};
+
+	static Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	thread_local ThreadRing* t_Ring = nullptr;
+
+	static int64_t s_Frames[PROFILER_MAX_FRAMES];
+	static std::atomic<uint64_t> s_NumFrames{ 0 };
+
+	static int64_t QueryCounter()
+	{
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		return counter.QuadPart;
+	}
+
+	// TSC and QueryPerformanceCounter read together at the start, the longer the interval since
+	// then the more precise the TSC frequency
+	struct Calibration
+	{
+		int64_t StartTicks{ Now() };
+		int64_t StartCounter{ QueryCounter() };
+		double MsPerCounterTick{ 0.0 };
+		std::atomic<double> MsPerTick{ 0.0 };
+
+		Calibration()
+		{
+			LARGE_INTEGER frequency;
+			QueryPerformanceFrequency(&frequency);
+			MsPerCounterTick = 1000.0 / (double)frequency.QuadPart;
+		}
+	};
+
+	static Calibration s_Calibration;
+
+	static double Calibrate()
+	{
+		int64_t ticks;
+		double ms;
+		do
+		{
+			ticks = Now();
+			ms = (QueryCounter() - s_Calibration.StartCounter) * s_Calibration.MsPerCounterTick;
+		} while (ms < 1.0);
+
+		const double msPerTick = ms / (double)(ticks - s_Calibration.StartTicks);
+		s_Calibration.MsPerTick.store(msPerTick, std::memory_order_relaxed);
+		return msPerTick;
+	}
+
+	ThreadRing* RegisterThread()
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.Mutex);
+		auto ring = std::make_unique<ThreadRing>();
+		ring->Id = (uint32_t)registry.Rings.size();
+		ring->Name = "Thread " + std::to_string(ring->Id);
+		t_Ring = ring.get();
+		registry.Rings.push_back(std::move(ring));
+		return t_Ring;
+	}
+
+	static void CopyZones(const ThreadRing& ring, std::vector<ProfileZone>& zones)
+	{
+		const uint64_t end = ring.Count.load(std::memory_order_acquire);
+		uint64_t begin = end > PROFILER_RING_SIZE ? end - PROFILER_RING_SIZE : 0;
+
+		const size_t first = zones.size();
+		for (uint64_t i = begin; i < end; ++i)
+			zones.push_back(ring.Zones[i & (PROFILER_RING_SIZE - 1)]);
+
+		// the zone being written when the count was read again may be in the slot of the oldest one
+		const uint64_t count = ring.Count.load(std::memory_order_acquire);
+		if (count + 1 > begin + PROFILER_RING_SIZE)
+		{
+			const uint64_t overwritten = std::min(count + 1 - PROFILER_RING_SIZE - begin, end - begin);
+			zones.erase(zones.begin() + first, zones.begin() + first + (size_t)overwritten);
+		}
+	}
+
+	// The zones of a thread are nested, the parents are still open when a zone starts
+	static void ComputeDepths(std::vector<ProfileZone>& zones)
+	{
+		std::sort(zones.begin(), zones.end(), [](const ProfileZone& a, const ProfileZone& b)
+		{
+			return a.Start != b.Start ? a.Start < b.Start : a.End > b.End;
+		});
+
+		std::vector<int64_t> openEnds;
+		for (ProfileZone& zone : zones)
+		{
+			while (!openEnds.empty() && openEnds.back() <= zone.Start)
+				openEnds.pop_back();
+			zone.Depth = (uint32_t)openEnds.size();
+			openEnds.push_back(zone.End);
+		}
+	}
+
+	static std::string EscapeJson(const char* text)
+	{
+		std::string escaped;
+		for (; *text; ++text)
+		{
+			if (*text == '"' || *text == '\\')
+				escaped += '\\';
+			escaped += *text;
+		}
+		return escaped;
+	}
+
+	double TicksToMs(int64_t ticks)
+	{
+		double msPerTick = s_Calibration.MsPerTick.load(std::memory_order_relaxed);
+		if (msPerTick == 0.0)
+			msPerTick = Calibrate();
+		return ticks * msPerTick;
+	}
+
+	void SetThreadName(const char* name)
+	{
+		if constexpr (!PROFILER_ENABLED)
+			return;
+
+		ThreadRing* ring = t_Ring ? t_Ring : RegisterThread();
+		std::lock_guard<std::mutex> lock(GetRegistry().Mutex);
+		ring->Name = name;
+	}
+
+	void BeginFrame()
+	{
+		if constexpr (!PROFILER_ENABLED)
+			return;
+
+		Calibrate();
+
+		const uint64_t count = s_NumFrames.load(std::memory_order_relaxed);
+		s_Frames[count % PROFILER_MAX_FRAMES] = Now();
+		s_NumFrames.store(count + 1, std::memory_order_release);
+	}
+
+	std::vector<int64_t> GetFrames()
+	{
+		const uint64_t count = s_NumFrames.load(std::memory_order_acquire);
+		std::vector<int64_t> frames;
+		for (uint64_t i = count > PROFILER_MAX_FRAMES ? count - PROFILER_MAX_FRAMES : 0; i < count; ++i)
+			frames.push_back(s_Frames[i % PROFILER_MAX_FRAMES]);
+		return frames;
+	}
+
+	void Capture(int64_t start, int64_t end, std::vector<ProfileThread>& threads)
+	{
+		threads.clear();
+
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.Mutex);
+		for (const auto& ring : registry.Rings)
+		{
+			ProfileThread thread{ ring->Id, ring->Name, {} };
+			CopyZones(*ring, thread.Zones);
+
+			thread.Zones.erase(std::remove_if(thread.Zones.begin(), thread.Zones.end(), [start, end](const ProfileZone& zone)
+			{
+				return zone.End <= start || zone.Start >= end;
+			}), thread.Zones.end());
+
+			ComputeDepths(thread.Zones);
+			threads.push_back(std::move(thread));
+		}
+	}
+
+	bool WriteChromeTrace(const std::string& path)
+	{
+		std::vector<ProfileThread> threads;
+		Capture(INT64_MIN, INT64_MAX, threads);
+		const std::vector<int64_t> frames = GetFrames();
+
+		int64_t origin = INT64_MAX;
+		for (const auto& thread : threads)
+		{
+			if (!thread.Zones.empty())
+				origin = std::min(origin, thread.Zones.front().Start);
+		}
+		if (origin == INT64_MAX)
+		{
+			LOG_WARN("No profiler zone recorded, {0} not written", path);
+			return false;
+		}
+
+		std::ofstream out(path, std::ios_base::out | std::ios_base::trunc);
+		if (!out.is_open())
+		{
+			LOG_ERROR("Failed to write file {0}", path);
+			return false;
+		}
+
+		// timestamps in microseconds
+		auto toUs = [origin](int64_t ticks) { return TicksToMs(ticks - origin) * 1000.0; };
+
+		size_t numZones = 0;
+		out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+		out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"ShaderTool\"}}";
+		for (const auto& thread : threads)
+		{
+			out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.Id
+				<< ",\"args\":{\"name\":\"" << EscapeJson(thread.Name.c_str()) << "\"}}";
+
+			for (const auto& zone : thread.Zones)
+			{
+				out << ",\n{\"name\":\"" << EscapeJson(zone.Name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.Id
+					<< ",\"ts\":" << toUs(zone.Start) << ",\"dur\":" << toUs(zone.End) - toUs(zone.Start) << "}";
+			}
+			numZones += thread.Zones.size();
+		}
+
+		for (int64_t frame : frames)
+		{
+			if (frame >= origin)
+				out << ",\n{\"name\":\"Frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":" << toUs(frame) << "}";
+		}
+		out << "\n]}\n";
+
+		if (!out.good())
+		{
+			LOG_ERROR("Failed to write file {0}", path);
+			return false;
+		}
+
+		LOG_INFO("Profiler trace written to {0}: {1} zones, {2} threads", path, numZones, threads.size());
+		return true;
+	}
+
+	double MeasureOverhead(uint32_t numZones)
+	{
+		double nsPerZone = 0.0;
+		std::thread thread([numZones, &nsPerZone]()
+		{
+			auto ring = std::make_unique<ThreadRing>(); // not registered, the zones aren't shown anywhere
+			t_Ring = ring.get();
+
+			const int64_t start = Now();
+			for (uint32_t i = 0; i < numZones; ++i)
+			{
+				PROFILE_SCOPE("Overhead");
+			}
+			nsPerZone = TicksToMs(Now() - start) * 1e6 / numZones;
+
+			t_Ring = nullptr;
+		});
+		thread.join();
+		return nsPerZone;
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Defines.h"
+
+#include <atomic>
+#include <cstdint>
+#include <intrin.h>
+#include <string>
+#include <vector>
+
+// Zone recorded by a ProfileScope, the times are TSC ticks (__rdtsc), see TicksToMs
+struct ProfileZone
+{
+	const char* Name; // string literal, only the pointer is stored
+	int64_t Start;
+	int64_t End;
+	uint32_t Depth;   // nesting level in its thread, computed when captured
+};
+
+struct ProfileThread
+{
+	uint32_t Id;      // in registration order, the main thread is usually 0
+	std::string Name;
+	std::vector<ProfileZone> Zones; // by start time
+};
+
+namespace Profiler
+{
+	// Written only by its thread: the zone is stored, then the count is published. A reader copies
+	// the zones and drops the ones the writer may have overwritten meanwhile (count read again).
+	struct ThreadRing
+	{
+		ProfileZone Zones[PROFILER_RING_SIZE];
+		std::atomic<uint64_t> Count{ 0 };
+		uint32_t Id{ 0 };
+		std::string Name; // under the registry mutex
+	};
+
+	// Ring of the calling thread, created and registered by its first zone
+	extern thread_local ThreadRing* t_Ring;
+	ThreadRing* RegisterThread();
+}
+
+// CPU frame profiler: each thread writes its zones to its own ring of PROFILER_RING_SIZE zones
+// without locking (the oldest ones are overwritten), the rings are read by the profiler window
+// and the trace export. Recording a zone costs two TSC reads and a store, the ticks are converted
+// when the zones are shown or exported.
+namespace Profiler
+{
+	// A few ns where QueryPerformanceCounter costs ~25, the TSC runs at a constant rate on the CPUs
+	// the tool targets (NodeCostTracker relies on it as well)
+	inline int64_t Now()
+	{
+		return (int64_t)__rdtsc();
+	}
+
+	// The TSC frequency is measured against QueryPerformanceCounter since the start, at least 1 ms
+	// (the first call may wait for it) and refined at each BeginFrame
+	double TicksToMs(int64_t ticks);
+
+	// Inline in the ProfileScope destructor, no call on the fast path
+	inline void RecordZone(const char* name, int64_t start, int64_t end)
+	{
+		ThreadRing* ring = t_Ring ? t_Ring : RegisterThread();
+		const uint64_t count = ring->Count.load(std::memory_order_relaxed);
+		ring->Zones[count & (PROFILER_RING_SIZE - 1)] = { name, start, end, 0 };
+		ring->Count.store(count + 1, std::memory_order_release);
+	}
+
+	// Shown in the profiler window and the trace, the threads are named "Thread N" otherwise
+	void SetThreadName(const char* name);
+
+	// Marks the start of a frame, called by the main thread
+	void BeginFrame();
+
+	// Start of the last PROFILER_MAX_FRAMES frames, oldest first
+	std::vector<int64_t> GetFrames();
+
+	// Copy of the zones of each thread that overlap [start, end)
+	void Capture(int64_t start, int64_t end, std::vector<ProfileThread>& threads);
+
+	// Every zone still in the rings in the Chrome trace event format (chrome://tracing, Perfetto)
+	bool WriteChromeTrace(const std::string& path);
+
+	// Average cost of a zone in nanoseconds, recorded by a temporary thread in a ring of its own
+	double MeasureOverhead(uint32_t numZones);
+}
+
+// Records the time spent until the end of the scope, see PROFILE_SCOPE
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name) : _Name(name)
+	{
+		if constexpr (PROFILER_ENABLED)
+			_Start = Profiler::Now();
+	}
+
+	~ProfileScope()
+	{
+		if constexpr (PROFILER_ENABLED)
+			Profiler::RecordZone(_Name, _Start, Profiler::Now());
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* _Name;
+	int64_t _Start{ 0 };
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
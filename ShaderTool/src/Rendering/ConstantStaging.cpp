@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "ConstantStaging.h"
+
+ConstantStaging::ConstantStaging(ID3D12Device* device, UploadRing& uploadRing)
+	: _Device(device), _UploadRing(uploadRing)
+{
+}
+
+ConstantStaging::~ConstantStaging()
+{
+	// the frames in flight may still read it
+	if (_Buffer)
+		_UploadRing.DeferRelease(_Buffer);
+}
+
+void ConstantStaging::SetShader(int shaderIndex, const Shader& shader)
+{
+	_ShaderIndex = shaderIndex;
+	_Blocks.clear();
+	_BlockIndices.clear();
+
+	if (_Buffer)
+	{
+		_UploadRing.DeferRelease(_Buffer);
+		_Buffer.Reset();
+		_MappedData = nullptr;
+	}
+
+	UINT64 bufferSize = 0;
+	for (auto& rp : shader.GetRootParameters())
+	{
+		_BlockIndices.push_back(INVALID_INDEX);
+
+		Block block;
+		block.RootParameterIndex = rp->Index;
+		if (rp->ParameterType == D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS)
+		{
+			block.IsRootDescriptor = false;
+			block.Data.resize(((RootParameterConstants*)rp.get())->Num32BitValues * 4, 0);
+		}
+		else if (rp->ParameterType == D3D12_ROOT_PARAMETER_TYPE_CBV)
+		{
+			block.IsRootDescriptor = true;
+			block.Data.resize(((RootParameterConstantBufferView*)rp.get())->SizeInBytes, 0);
+			block.BufferOffset = bufferSize;
+			bufferSize += block.Data.size() * NUM_FRAMES;
+		}
+		else
+		{
+			continue;
+		}
+
+		_BlockIndices[rp->Index] = (int)_Blocks.size();
+		_Blocks.push_back(std::move(block));
+	}
+
+	if (bufferSize == 0)
+		return;
+
+	ThrowIfFailed(
+		_Device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(bufferSize),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(_Buffer.GetAddressOf())));
+
+	_Buffer->SetName(L"ConstantStaging");
+	ThrowIfFailed(_Buffer->Map(0, nullptr, reinterpret_cast<void**>(&_MappedData)));
+}
+
+void ConstantStaging::Stage(const ShaderBind& bind, const void* data)
+{
+	if (bind.RootParameterIndex >= _BlockIndices.size() || _BlockIndices[bind.RootParameterIndex] == INVALID_INDEX)
+		return;
+
+	auto& block = _Blocks[_BlockIndices[bind.RootParameterIndex]];
+	const size_t offset = bind.VarNum32BitValuesOffset * 4ull;
+	const size_t size = bind.VarNum32BitValues * 4ull;
+	if (offset + size > block.Data.size())
+		return;
+
+	if (memcmp(&block.Data[offset], data, size) != 0)
+	{
+		memcpy(&block.Data[offset], data, size);
+		block.IsDirty = true;
+	}
+}
+
+void ConstantStaging::Bind(ID3D12GraphicsCommandList* cmdList, ConstantUploadStats& stats)
+{
+	for (auto& block : _Blocks)
+	{
+		++stats.NumRootParameters;
+
+		if (!block.IsRootDescriptor)
+		{
+			cmdList->SetGraphicsRoot32BitConstants(block.RootParameterIndex, (UINT)block.Data.size() / 4, block.Data.data(), 0);
+			stats.RootConstantBytes += block.Data.size();
+			block.IsDirty = false;
+			continue;
+		}
+
+		if (block.IsDirty)
+		{
+			block.Copy = (block.Copy + 1) % NUM_FRAMES;
+			memcpy(_MappedData + block.BufferOffset + block.Copy * block.Data.size(), block.Data.data(), block.Data.size());
+			stats.UploadedBytes += block.Data.size();
+			block.IsDirty = false;
+		}
+		else
+		{
+			stats.SkippedBytes += block.Data.size();
+		}
+
+		cmdList->SetGraphicsRootConstantBufferView(
+			block.RootParameterIndex,
+			_Buffer->GetGPUVirtualAddress() + block.BufferOffset + block.Copy * block.Data.size());
+	}
+}
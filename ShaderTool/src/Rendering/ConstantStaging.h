@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Shader.h"
+#include "UploadRing.h"
+#include "Defines.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <vector>
+
+// Constant data of the draws of a frame, in bytes
+struct ConstantUploadStats
+{
+	UINT64 UploadedBytes{ 0 };     // spilled cbuffers that changed, written to the GPU
+	UINT64 SkippedBytes{ 0 };      // spilled cbuffers that didn't change, the previous copy is bound again
+	UINT64 RootConstantBytes{ 0 }; // set every draw, root arguments don't outlive the command list
+	UINT NumRootParameters{ 0 };   // SetGraphicsRoot32BitConstants/SetGraphicsRootConstantBufferView calls
+};
+
+// Packed copy of the constant data of a draw node, one block per cbuffer root parameter laid out
+// with the offsets of the reflection. Each value is compared when staged and its block is only
+// written to the GPU again when a byte changed, with one call or copy per block.
+// The spilled cbuffers keep NUM_FRAMES copies in a persistent upload buffer: a changed block is
+// written to the copy after the one bound last, which no frame in flight reads anymore.
+class ConstantStaging
+{
+public:
+	ConstantStaging(ID3D12Device* device, UploadRing& uploadRing);
+	ConstantStaging(const ConstantStaging&) = delete;
+	ConstantStaging& operator=(const ConstantStaging&) = delete;
+	~ConstantStaging();
+
+	// Lays out the blocks for the root parameters of the shader, zeroed and dirty
+	void SetShader(int shaderIndex, const Shader& shader);
+	int GetShaderIndex() const { return _ShaderIndex; }
+
+	void Stage(const ShaderBind& bind, const void* data);
+
+	// Must be called once per frame, after SetGraphicsRootSignature
+	void Bind(ID3D12GraphicsCommandList* cmdList, ConstantUploadStats& stats);
+
+private:
+	struct Block
+	{
+		UINT RootParameterIndex;
+		bool IsRootDescriptor;
+		std::vector<BYTE> Data;
+		bool IsDirty{ true };
+		UINT64 BufferOffset{ 0 }; // first copy in _Buffer, root descriptors only
+		UINT Copy{ 0 };           // copy bound last
+	};
+
+	ID3D12Device* _Device;
+	UploadRing& _UploadRing;
+	int _ShaderIndex{ INVALID_INDEX };
+	std::vector<Block> _Blocks;
+	std::vector<int> _BlockIndices; // root parameter -> block, INVALID_INDEX for the tables
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> _Buffer;
+	BYTE* _MappedData{ nullptr };
+};
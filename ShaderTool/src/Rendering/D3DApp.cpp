@@ -34,6 +34,9 @@ D3DApp::~D3DApp()
 {
     //LOG_TRACE("D3DApp::~D3DApp()");
     FlushCommandQueue();
+
+    if (_IsHeadless)
+        return;
     
     ImNodes::DestroyContext();
 
@@ -102,6 +105,14 @@ ComPtr<IDXGIAdapter4> GetAdapter(bool useWarp)
                 ThrowIfFailed(dxgiAdapter1.As(&dxgiAdapter4));
             }
         }
+
+        // machines without a D3D12 GPU (CI agents, remote sessions) still run on the software rasterizer
+        if (!dxgiAdapter4)
+        {
+            LOG_WARN("No hardware adapter supports D3D12, using WARP");
+            ThrowIfFailed(dxgiFactory->EnumWarpAdapter(IID_PPV_ARGS(&dxgiAdapter1)));
+            ThrowIfFailed(dxgiAdapter1.As(&dxgiAdapter4));
+        }
     }
 
     // Log the chosen adapter 
@@ -173,7 +184,7 @@ void D3DApp::CreateRTVAndDSVDescriptorHeaps()
     // Used by ImGui
     D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
     srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-    srvHeapDesc.NumDescriptors = 3; // TODO: fixed for now: 3 = imgui + render target + texture
+    srvHeapDesc.NumDescriptors = 4; // TODO: fixed for now: 4 = imgui + render target + texture + thumbnail atlas
     srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
     ThrowIfFailed(_Device->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&_ImGuiSrvDescriptorHeap)));
         
@@ -317,7 +328,7 @@ bool D3DApp::InitMainWindow()
     return true;
 }
 
-bool D3DApp::InitDirect3D()
+void D3DApp::CreateDevice()
 {
 #if defined(_DEBUG)
     {
@@ -327,14 +338,19 @@ bool D3DApp::InitDirect3D()
     }
 #endif
 
-    _TearingSupport = ::CheckTearingSupport();
-
     ComPtr<IDXGIAdapter4> adapter = ::GetAdapter(false);
     ThrowIfFailed(D3D12CreateDevice(adapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&_Device)));
 
     _RtvDescriptorSize = _Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
     _DsvDescriptorSize = _Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
     _CbvSrvUavDescriptorSize = _Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+bool D3DApp::InitDirect3D()
+{
+    _TearingSupport = ::CheckTearingSupport();
+
+    CreateDevice();
 
     // Check 4X MSAA quality support for our back buffer format.
     // All Direct3D 11 capable devices support 4X MSAA for all render
@@ -364,6 +380,8 @@ bool D3DApp::InitDirect3D()
 
     ThrowIfFailed(_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&_Fence)));
 
+    _UploadRing = std::make_unique<UploadRing>(_Device.Get(), UPLOAD_RING_SIZE_PER_FRAME, NUM_FRAMES);
+
     CreateDSVBuffer();
     SetViewportAndScissor();
 
@@ -397,6 +415,37 @@ bool D3DApp::Init()
 	return true;
 }
 
+// Device, queue, frame resources and descriptor heaps only, nothing is presented.
+// The command list is left closed like after Init.
+bool D3DApp::InitHeadless()
+{
+    LOG_TRACE("D3DApp::InitHeadless()");
+
+    _IsHeadless = true;
+
+    CreateDevice();
+
+    for (int i = 0; i < NUM_FRAMES; ++i)
+        _FrameResources[i] = std::make_unique<FrameResource>(_Device.Get(), 1, 2);
+
+    CreateCommandObjects();
+
+    // the render texture and the textures still need their views
+    CreateRTVAndDSVDescriptorHeaps();
+
+    ThrowIfFailed(_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&_Fence)));
+
+    _UploadRing = std::make_unique<UploadRing>(_Device.Get(), UPLOAD_RING_SIZE_PER_FRAME, NUM_FRAMES);
+
+    ThrowIfFailed(_CommandList->Close());
+    ID3D12CommandList* cmdsLists[] = { _CommandList.Get() };
+    _CommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+
+    FlushCommandQueue();
+
+    return true;
+}
+
 bool D3DApp::InitGUI()
 {
     LOG_TRACE("D3DApp::InitImGui()");
@@ -9,6 +9,7 @@
 #include "Window.h"
 #include "Defines.h"
 #include "FrameResource.h"
+#include "UploadRing.h"
 
 #include <stdint.h>
 #include <array>
@@ -35,6 +36,7 @@ public:
 	ID3D12Device* GetDevice() const { return _Device.Get(); }
 	ID3D12DescriptorHeap* GetSRVDescriptorHeap() const { return _ImGuiSrvDescriptorHeap.Get(); }
 	ID3D12GraphicsCommandList* GetCommandList() const { return _CommandList.Get(); }
+	UploadRing* GetUploadRing() const { return _UploadRing.get(); }
 	DXGI_FORMAT GetBackBufferFormat() const { return _BackBufferFormat; }
 	DXGI_FORMAT GetDepthStencilFormat() const { return _DepthStencilFormat; }
 	UINT Get4xMsaaQuality() const { return _4xMsaaQuality; }
@@ -45,6 +47,7 @@ public:
 
 protected:
 	bool Init();
+	bool InitHeadless();
 
 	virtual void OnResize(uint32_t width, uint32_t height);
 	virtual void OnKeyDown(WPARAM key) {}
@@ -55,6 +58,7 @@ private:
 	bool InitDirect3D();
 	bool InitGUI();
 
+	void CreateDevice();
 	void CreateCommandObjects();
 	void CreateRenderTargetViews();
 	void CreateSwapChain(HWND hWnd, uint32_t width, uint32_t height);
@@ -87,6 +91,7 @@ protected:
 	UINT _4xMsaaQuality{ 0 };
 	bool _TearingSupport{ false };
 	bool _VSync{ false };
+	bool _IsHeadless{ false }; // no window, swap chain or ImGui
 	uint16_t _CurrentBackBufferIndex{ 0 };
 	uint32_t _RtvDescriptorSize{ 0 };
 	uint32_t _DsvDescriptorSize{ 0 };
@@ -101,4 +106,6 @@ protected:
 	std::array<std::unique_ptr<FrameResource>, NUM_FRAMES> _FrameResources;
 	FrameResource* _CurrFrameResource{ nullptr };
 	int _CurrFrameResourceIndex{ 0 };
+
+	std::unique_ptr<UploadRing> _UploadRing;
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "D3DUtil.h"
+#include "UploadRing.h"
 
 #include <comdef.h>
 
@@ -110,7 +111,7 @@ ComPtr<ID3D12Resource> D3DUtil::CreateDefaultBuffer(
     ID3D12GraphicsCommandList* cmdList,
     const void* initData,
     UINT64 byteSize,
-    ComPtr<ID3D12Resource>& uploadBuffer)
+    UploadRing& uploadRing)
 {
     ComPtr<ID3D12Resource> defaultBuffer;
 
@@ -125,27 +126,12 @@ ComPtr<ID3D12Resource> D3DUtil::CreateDefaultBuffer(
 
     defaultBuffer->SetName(L"DefaultBuffer");
 
-    // In order to copy CPU memory data into our default buffer, we need to create
-    // an intermediate upload heap. 
-    ThrowIfFailed(device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-        D3D12_HEAP_FLAG_NONE,
-        &CD3DX12_RESOURCE_DESC::Buffer(byteSize),
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(uploadBuffer.GetAddressOf())));
+    // In order to copy CPU memory data into our default buffer, we need an intermediate
+    // upload memory. It's suballocated from the upload ring and recycled once the frame
+    // recording this copy has been executed by the GPU.
+    UploadRing::Allocation upload = uploadRing.Allocate(byteSize);
+    CopyMemory(upload.CpuAddress, initData, byteSize);
 
-    uploadBuffer->SetName(L"UploadBuffer");
-
-    // Describe the data we want to copy into the default buffer.
-    D3D12_SUBRESOURCE_DATA subResourceData = {};
-    subResourceData.pData = initData;
-    subResourceData.RowPitch = byteSize;
-    subResourceData.SlicePitch = subResourceData.RowPitch;
-
-    // Schedule to copy the data to the default buffer resource.  At a high level, the helper function UpdateSubresources
-    // will copy the CPU memory into the intermediate upload heap.  Then, using ID3D12CommandList::CopySubresourceRegion,
-    // the intermediate upload heap data will be copied to mBuffer.
     cmdList->ResourceBarrier(
         1, 
         &CD3DX12_RESOURCE_BARRIER::Transition(
@@ -154,7 +140,7 @@ ComPtr<ID3D12Resource> D3DUtil::CreateDefaultBuffer(
             D3D12_RESOURCE_STATE_COPY_DEST)
     );
     
-    UpdateSubresources<1>(cmdList, defaultBuffer.Get(), uploadBuffer.Get(), 0, 0, 1, &subResourceData);
+    cmdList->CopyBufferRegion(defaultBuffer.Get(), 0, upload.Resource, upload.Offset, byteSize);
     
     cmdList->ResourceBarrier(
         1, 
@@ -164,10 +150,6 @@ ComPtr<ID3D12Resource> D3DUtil::CreateDefaultBuffer(
             D3D12_RESOURCE_STATE_GENERIC_READ)
     );
 
-    // Note: uploadBuffer has to be kept alive after the above function calls because
-    // the command list has not been executed yet that performs the actual copy.
-    // The caller can Release the uploadBuffer after it knows the copy has been executed.
-
     return defaultBuffer;
 }
 
@@ -11,6 +11,8 @@
 #include <DirectXMath.h>
 #include <DirectXColors.h>
 
+class UploadRing;
+
 namespace D3DUtil
 {
 	bool CompileShader(
@@ -60,7 +62,7 @@ namespace D3DUtil
 		ID3D12GraphicsCommandList* cmdList,
 		const void* initData,
 		UINT64 byteSize,
-		Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
+		UploadRing& uploadRing);
 	
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
 
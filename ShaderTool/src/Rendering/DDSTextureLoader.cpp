@@ -25,6 +25,7 @@
 #include <wrl.h>
 
 #include "DDSTextureLoader.h" 
+#include "UploadRing.h"
 
 using namespace Microsoft::WRL;
 
@@ -1242,7 +1243,7 @@ static HRESULT CreateD3DResources12(
 	_In_ bool isCubeMap,
 	_In_reads_opt_(mipCount*arraySize) D3D12_SUBRESOURCE_DATA* initData,
 	ComPtr<ID3D12Resource>& texture,
-	ComPtr<ID3D12Resource>& textureUploadHeap
+	UploadRing& uploadRing
 	)
 {
 	if (device == nullptr)
@@ -1289,29 +1290,17 @@ static HRESULT CreateD3DResources12(
 			const UINT num2DSubresources = texDesc.DepthOrArraySize * texDesc.MipLevels;
 			const UINT64 uploadBufferSize = GetRequiredIntermediateSize(texture.Get(), 0, num2DSubresources);
 
-			hr = device->CreateCommittedResource(
-				&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-				D3D12_HEAP_FLAG_NONE,
-				&CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
-				D3D12_RESOURCE_STATE_GENERIC_READ,
-				nullptr,
-				IID_PPV_ARGS(&textureUploadHeap));
-			if (FAILED(hr))
-			{
-				texture = nullptr;
-				return hr;
-			}
-			else
-			{
-				cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(),
-					D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+			// Staging memory comes from the upload ring, texture data placement requires 512 bytes alignment
+			UploadRing::Allocation upload = uploadRing.Allocate(uploadBufferSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
 
-				// Use Heap-allocating UpdateSubresources implementation for variable number of subresources (which is the case for textures).
-				UpdateSubresources(cmdList, texture.Get(), textureUploadHeap.Get(), 0, 0, num2DSubresources, initData);
+			cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(),
+				D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
 
-				cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(),
-					D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
-			}
+			// Use Heap-allocating UpdateSubresources implementation for variable number of subresources (which is the case for textures).
+			UpdateSubresources(cmdList, texture.Get(), upload.Resource, upload.Offset, 0, num2DSubresources, initData);
+
+			cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(),
+				D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
 		}
 	} break;
 	}
@@ -1679,7 +1668,7 @@ static HRESULT CreateTextureFromDDS12(
 	_In_ size_t maxsize,
 	_In_ bool forceSRGB,
 	ComPtr<ID3D12Resource>& texture,
-	ComPtr<ID3D12Resource>& textureUploadHeap)
+	UploadRing& uploadRing)
 {
 	HRESULT hr = S_OK;
 
@@ -1868,7 +1857,7 @@ static HRESULT CreateTextureFromDDS12(
 			isCubeMap,
 			initData.get(),
 			texture, 
-			textureUploadHeap);
+			uploadRing);
 	}
 
 	return hr;
@@ -1925,7 +1914,7 @@ HRESULT DirectX::CreateDDSTextureFromMemory12(
 	_In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
 	_In_ size_t ddsDataSize,
 	ComPtr<ID3D12Resource>& texture,
-	ComPtr<ID3D12Resource>& textureUploadHeap,
+	UploadRing& uploadRing,
 	_In_ size_t maxsize,
 	_Out_opt_ DDS_ALPHA_MODE* alphaMode
 	)
@@ -1980,7 +1969,7 @@ HRESULT DirectX::CreateDDSTextureFromMemory12(
 		maxsize,
 		false,
 		texture,
-		textureUploadHeap
+		uploadRing
 		);
 
 	if (SUCCEEDED(hr))
@@ -2139,7 +2128,7 @@ HRESULT DirectX::CreateDDSTextureFromFile12(_In_ ID3D12Device* device,
 	_In_ ID3D12GraphicsCommandList* cmdList,
 	_In_z_ const wchar_t* szFileName,
 	_Out_ ComPtr<ID3D12Resource>& texture,
-	_Out_ ComPtr<ID3D12Resource>& textureUploadHeap,
+	_In_ UploadRing& uploadRing,
 	_In_ size_t maxsize,
 	_Out_opt_ DDS_ALPHA_MODE* alphaMode)
 {
@@ -2147,10 +2136,6 @@ HRESULT DirectX::CreateDDSTextureFromFile12(_In_ ID3D12Device* device,
 	{
 		texture = nullptr;
 	}
-	if (textureUploadHeap)
-	{
-		textureUploadHeap = nullptr;
-	}
 	if (alphaMode)
 	{
 		*alphaMode = DDS_ALPHA_MODE_UNKNOWN;
@@ -2173,7 +2158,7 @@ HRESULT DirectX::CreateDDSTextureFromFile12(_In_ ID3D12Device* device,
 	}
 
 	hr = CreateTextureFromDDS12(device, cmdList, header,
-		bitData, bitSize, maxsize, false, texture, textureUploadHeap);
+		bitData, bitSize, maxsize, false, texture, uploadRing);
 
 	if (SUCCEEDED(hr))
 	{
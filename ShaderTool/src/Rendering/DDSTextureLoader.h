@@ -44,6 +44,8 @@
 #define _Use_decl_annotations_
 #endif
 
+class UploadRing;
+
 namespace DirectX
 {
     enum DDS_ALPHA_MODE
@@ -70,7 +72,7 @@ namespace DirectX
 		                                 _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
 		                                 _In_ size_t ddsDataSize,
 		                                 _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& texture,
-		                                 _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& textureUploadHeap,
+		                                 _In_ UploadRing& uploadRing,
 		                                 _In_ size_t maxsize = 0,
 		                                 _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
 		                                 );
@@ -87,7 +89,7 @@ namespace DirectX
 		                               _In_ ID3D12GraphicsCommandList* cmdList,
 		                               _In_z_ const wchar_t* szFileName,
 		                               _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& texture,
-		                               _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& textureUploadHeap,
+		                               _In_ UploadRing& uploadRing,
 		                               _In_ size_t maxsize = 0,
 		                               _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
 		                               );
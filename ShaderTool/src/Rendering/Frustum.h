@@ -0,0 +1,34 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// Clip planes of a row vector (world) view projection matrix, extracted from its columns
+// (Gribb/Hartmann). The planes are in the space the matrix transforms from and point inside,
+// D3D clip space z is [0, w].
+struct Frustum
+{
+	DirectX::XMVECTOR Planes[6];
+
+	explicit Frustum(const DirectX::XMMATRIX& viewProjection)
+	{
+		using namespace DirectX;
+
+		const XMMATRIX columns = XMMatrixTranspose(viewProjection);
+		Planes[0] = XMPlaneNormalize(XMVectorAdd(columns.r[3], columns.r[0]));
+		Planes[1] = XMPlaneNormalize(XMVectorSubtract(columns.r[3], columns.r[0]));
+		Planes[2] = XMPlaneNormalize(XMVectorAdd(columns.r[3], columns.r[1]));
+		Planes[3] = XMPlaneNormalize(XMVectorSubtract(columns.r[3], columns.r[1]));
+		Planes[4] = XMPlaneNormalize(columns.r[2]);
+		Planes[5] = XMPlaneNormalize(XMVectorSubtract(columns.r[3], columns.r[2]));
+	}
+
+	bool XM_CALLCONV IntersectsSphere(DirectX::FXMVECTOR center, float radius) const
+	{
+		for (int p = 0; p < 6; ++p)
+		{
+			if (DirectX::XMVectorGetX(DirectX::XMPlaneDotCoord(Planes[p], center)) < -radius)
+				return false;
+		}
+		return true;
+	}
+};
@@ -0,0 +1,249 @@
+#include "pch.h"
+#include "GeometryPool.h"
+#include "D3DUtil.h"
+#include "Defines.h"
+
+#include <algorithm>
+
+using Microsoft::WRL::ComPtr;
+
+GeometryPool::GeometryPool(ID3D12Device* device, UINT vertexStride, UINT vertexCapacity, UINT indexCapacity)
+	: _Device(device), _VertexStride(vertexStride), _VertexAllocator(vertexCapacity), _IndexAllocator(indexCapacity)
+{
+	_VertexBuffer = CreateBuffer((UINT64)vertexCapacity * _VertexStride, L"GeometryPoolVertices");
+	_IndexBuffer = CreateBuffer((UINT64)indexCapacity * sizeof(uint32_t), L"GeometryPoolIndices");
+}
+
+GeometryPool::~GeometryPool()
+{
+}
+
+ComPtr<ID3D12Resource> GeometryPool::CreateBuffer(UINT64 byteSize, const wchar_t* name)
+{
+	ComPtr<ID3D12Resource> buffer;
+	ThrowIfFailed(
+		_Device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(buffer.GetAddressOf())));
+
+	buffer->SetName(name);
+	return buffer;
+}
+
+int GeometryPool::Allocate(
+	ID3D12GraphicsCommandList* cmdList,
+	UploadRing& uploadRing,
+	const void* vertices,
+	UINT vertexCount,
+	const uint32_t* indices,
+	UINT indexCount)
+{
+	GeometryRange range;
+	range.VertexCount = vertexCount;
+	range.IndexCount = indexCount;
+	range.Vertices = _VertexAllocator.Allocate(vertexCount);
+	range.Indices = _IndexAllocator.Allocate(indexCount);
+
+	if (!range.IsValid())
+	{
+		_VertexAllocator.Free(range.Vertices);
+		_IndexAllocator.Free(range.Indices);
+		return INVALID_INDEX;
+	}
+
+	const UINT64 vbByteSize = (UINT64)vertexCount * _VertexStride;
+	const UINT64 ibByteSize = (UINT64)indexCount * sizeof(uint32_t);
+
+	UploadRing::Allocation vbUpload = uploadRing.Allocate(vbByteSize);
+	CopyMemory(vbUpload.CpuAddress, vertices, vbByteSize);
+
+	UploadRing::Allocation ibUpload = uploadRing.Allocate(ibByteSize);
+	CopyMemory(ibUpload.CpuAddress, indices, ibByteSize);
+
+	D3D12_RESOURCE_BARRIER barriers[] = {
+		CD3DX12_RESOURCE_BARRIER::Transition(_VertexBuffer.Get(), _BufferState, D3D12_RESOURCE_STATE_COPY_DEST),
+		CD3DX12_RESOURCE_BARRIER::Transition(_IndexBuffer.Get(), _BufferState, D3D12_RESOURCE_STATE_COPY_DEST)
+	};
+	cmdList->ResourceBarrier(_countof(barriers), barriers);
+
+	cmdList->CopyBufferRegion(
+		_VertexBuffer.Get(), (UINT64)range.Vertices.Offset * _VertexStride,
+		vbUpload.Resource, vbUpload.Offset,
+		vbByteSize);
+
+	cmdList->CopyBufferRegion(
+		_IndexBuffer.Get(), (UINT64)range.Indices.Offset * sizeof(uint32_t),
+		ibUpload.Resource, ibUpload.Offset,
+		ibByteSize);
+
+	for (auto& barrier : barriers)
+	{
+		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_GENERIC_READ;
+	}
+	cmdList->ResourceBarrier(_countof(barriers), barriers);
+
+	// the buffers stay readable by the input assembler between uploads
+	_BufferState = D3D12_RESOURCE_STATE_GENERIC_READ;
+
+	int rangeId;
+	if (!_FreeRangeIds.empty())
+	{
+		rangeId = _FreeRangeIds.back();
+		_FreeRangeIds.pop_back();
+		_Ranges[rangeId] = range;
+	}
+	else
+	{
+		rangeId = (int)_Ranges.size();
+		_Ranges.push_back(range);
+	}
+
+	return rangeId;
+}
+
+void GeometryPool::Free(int rangeId)
+{
+	assert(rangeId != INVALID_INDEX && rangeId < _Ranges.size() && "Geometry range out of bounds");
+
+	GeometryRange& range = _Ranges[rangeId];
+	if (!range.IsValid())
+		return;
+
+	_VertexAllocator.Free(range.Vertices);
+	_IndexAllocator.Free(range.Indices);
+	range = GeometryRange();
+
+	_FreeRangeIds.push_back(rangeId);
+}
+
+bool GeometryPool::Defragment(ID3D12GraphicsCommandList* cmdList, UploadRing& uploadRing, UINT vertexCapacity, UINT indexCapacity)
+{
+	assert(vertexCapacity >= _VertexAllocator.GetUsedSize() && indexCapacity >= _IndexAllocator.GetUsedSize());
+
+	// Fresh allocators hand out contiguous ranges from the start, but each request is rounded up to
+	// its bin: the space left when a range is placed must be its rounded up size, not just its size
+	UINT vertexOffset = 0;
+	UINT indexOffset = 0;
+	for (const auto& range : _Ranges)
+	{
+		if (!range.IsValid())
+			continue;
+
+		vertexCapacity = std::max(vertexCapacity, vertexOffset + OffsetAllocator::RoundUpToBinSize(range.VertexCount));
+		indexCapacity = std::max(indexCapacity, indexOffset + OffsetAllocator::RoundUpToBinSize(range.IndexCount));
+		vertexOffset += range.VertexCount;
+		indexOffset += range.IndexCount;
+	}
+
+	// place every range before recording anything, the pool is left as it was if one doesn't fit
+	OffsetAllocator vertexAllocator(vertexCapacity);
+	OffsetAllocator indexAllocator(indexCapacity);
+	std::vector<GeometryRange> ranges = _Ranges;
+	for (auto& range : ranges)
+	{
+		if (!range.IsValid())
+			continue;
+
+		range.Vertices = vertexAllocator.Allocate(range.VertexCount);
+		range.Indices = indexAllocator.Allocate(range.IndexCount);
+		if (!range.IsValid())
+		{
+			LOG_ERROR("Failed to defragment the geometry pool, a range of {0} vertices and {1} indices doesn't fit {2}/{3}",
+				range.VertexCount, range.IndexCount, vertexCapacity, indexCapacity);
+			return false;
+		}
+	}
+
+	ComPtr<ID3D12Resource> vertexBuffer = CreateBuffer((UINT64)vertexCapacity * _VertexStride, L"GeometryPoolVertices");
+	ComPtr<ID3D12Resource> indexBuffer = CreateBuffer((UINT64)indexCapacity * sizeof(uint32_t), L"GeometryPoolIndices");
+
+	{
+		D3D12_RESOURCE_BARRIER barriers[] = {
+			CD3DX12_RESOURCE_BARRIER::Transition(_VertexBuffer.Get(), _BufferState, D3D12_RESOURCE_STATE_COPY_SOURCE),
+			CD3DX12_RESOURCE_BARRIER::Transition(_IndexBuffer.Get(), _BufferState, D3D12_RESOURCE_STATE_COPY_SOURCE),
+			CD3DX12_RESOURCE_BARRIER::Transition(vertexBuffer.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST),
+			CD3DX12_RESOURCE_BARRIER::Transition(indexBuffer.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST)
+		};
+		cmdList->ResourceBarrier(_countof(barriers), barriers);
+	}
+
+	for (size_t i = 0; i < ranges.size(); ++i)
+	{
+		const GeometryRange& from = _Ranges[i];
+		const GeometryRange& to = ranges[i];
+		if (!to.IsValid())
+			continue;
+
+		cmdList->CopyBufferRegion(
+			vertexBuffer.Get(), (UINT64)to.Vertices.Offset * _VertexStride,
+			_VertexBuffer.Get(), (UINT64)from.Vertices.Offset * _VertexStride,
+			(UINT64)from.VertexCount * _VertexStride);
+
+		cmdList->CopyBufferRegion(
+			indexBuffer.Get(), (UINT64)to.Indices.Offset * sizeof(uint32_t),
+			_IndexBuffer.Get(), (UINT64)from.Indices.Offset * sizeof(uint32_t),
+			(UINT64)from.IndexCount * sizeof(uint32_t));
+	}
+
+	{
+		D3D12_RESOURCE_BARRIER barriers[] = {
+			CD3DX12_RESOURCE_BARRIER::Transition(vertexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ),
+			CD3DX12_RESOURCE_BARRIER::Transition(indexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ)
+		};
+		cmdList->ResourceBarrier(_countof(barriers), barriers);
+	}
+
+	// frames in flight may still be drawing from the old buffers
+	uploadRing.DeferRelease(_VertexBuffer);
+	uploadRing.DeferRelease(_IndexBuffer);
+
+	_VertexBuffer = vertexBuffer;
+	_IndexBuffer = indexBuffer;
+	_BufferState = D3D12_RESOURCE_STATE_GENERIC_READ;
+
+	_VertexAllocator = std::move(vertexAllocator);
+	_IndexAllocator = std::move(indexAllocator);
+	_Ranges = std::move(ranges);
+
+	LogStats();
+	return true;
+}
+
+const GeometryRange& GeometryPool::GetRange(int rangeId) const
+{
+	assert(rangeId != INVALID_INDEX && rangeId < _Ranges.size() && "Geometry range out of bounds");
+	return _Ranges[rangeId];
+}
+
+D3D12_VERTEX_BUFFER_VIEW GeometryPool::VertexBufferView() const
+{
+	D3D12_VERTEX_BUFFER_VIEW vbv;
+	vbv.BufferLocation = _VertexBuffer->GetGPUVirtualAddress();
+	vbv.StrideInBytes = _VertexStride;
+	vbv.SizeInBytes = _VertexAllocator.GetSize() * _VertexStride;
+	return vbv;
+}
+
+D3D12_INDEX_BUFFER_VIEW GeometryPool::IndexBufferView() const
+{
+	D3D12_INDEX_BUFFER_VIEW ibv;
+	ibv.BufferLocation = _IndexBuffer->GetGPUVirtualAddress();
+	ibv.Format = DXGI_FORMAT_R32_UINT;
+	ibv.SizeInBytes = _IndexAllocator.GetSize() * sizeof(uint32_t);
+	return ibv;
+}
+
+void GeometryPool::LogStats() const
+{
+	const OffsetAllocator::StorageReport vertices = _VertexAllocator.GetStorageReport();
+	const OffsetAllocator::StorageReport indices = _IndexAllocator.GetStorageReport();
+
+	LOG_TRACE("GeometryPool vertices {0}/{1} free regions {2} fragmentation {3:.2f} | indices {4}/{5} free regions {6} fragmentation {7:.2f}",
+		_VertexAllocator.GetUsedSize(), _VertexAllocator.GetSize(), vertices.NumFreeRegions, _VertexAllocator.GetFragmentation(),
+		_IndexAllocator.GetUsedSize(), _IndexAllocator.GetSize(), indices.NumFreeRegions, _IndexAllocator.GetFragmentation());
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "OffsetAllocator.h"
+#include "UploadRing.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <vector>
+
+struct GeometryRange
+{
+	OffsetAllocator::Allocation Vertices;
+	OffsetAllocator::Allocation Indices;
+	UINT VertexCount{ 0 };
+	UINT IndexCount{ 0 };
+
+	bool IsValid() const { return Vertices.IsValid() && Indices.IsValid(); }
+};
+
+// Shared vertex and index buffers that every model lives in. A model is a range of vertices and
+// indices drawn with BaseVertexLocation/StartIndexLocation, the ranges are handed out by two
+// offset allocators (in vertex and index units).
+class GeometryPool
+{
+public:
+	GeometryPool(ID3D12Device* device, UINT vertexStride, UINT vertexCapacity, UINT indexCapacity);
+	GeometryPool(const GeometryPool&) = delete;
+	GeometryPool& operator=(const GeometryPool&) = delete;
+	~GeometryPool();
+
+	// Returns the range id or INVALID_INDEX if the pool is out of space
+	int Allocate(
+		ID3D12GraphicsCommandList* cmdList,
+		UploadRing& uploadRing,
+		const void* vertices,
+		UINT vertexCount,
+		const uint32_t* indices,
+		UINT indexCount);
+
+	void Free(int rangeId);
+
+	// Moves the live ranges to the start of new buffers (optionally bigger) so the free space
+	// becomes contiguous again. The range offsets change, draw arguments have to be refreshed.
+	// The capacities are raised if the ranges need more once rounded up to their bins. Returns
+	// false, with the pool unchanged, if a range can't be placed.
+	bool Defragment(ID3D12GraphicsCommandList* cmdList, UploadRing& uploadRing, UINT vertexCapacity, UINT indexCapacity);
+
+	const GeometryRange& GetRange(int rangeId) const;
+	UINT GetVertexCapacity() const { return _VertexAllocator.GetSize(); }
+	UINT GetIndexCapacity() const { return _IndexAllocator.GetSize(); }
+	const OffsetAllocator& GetVertexAllocator() const { return _VertexAllocator; }
+	const OffsetAllocator& GetIndexAllocator() const { return _IndexAllocator; }
+
+	D3D12_VERTEX_BUFFER_VIEW VertexBufferView() const;
+	D3D12_INDEX_BUFFER_VIEW IndexBufferView() const;
+
+	void LogStats() const;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(UINT64 byteSize, const wchar_t* name);
+
+private:
+	ID3D12Device* _Device;
+	UINT _VertexStride;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> _VertexBuffer;
+	Microsoft::WRL::ComPtr<ID3D12Resource> _IndexBuffer;
+	D3D12_RESOURCE_STATES _BufferState{ D3D12_RESOURCE_STATE_COMMON };
+
+	OffsetAllocator _VertexAllocator;
+	OffsetAllocator _IndexAllocator;
+
+	std::vector<GeometryRange> _Ranges;
+	std::vector<int> _FreeRangeIds;
+};
@@ -0,0 +1,74 @@
+#include "pch.h"
+#include "InstanceBuffer.h"
+#include "D3DUtil.h"
+
+using namespace DirectX;
+
+InstanceBuffer::InstanceBuffer(ID3D12Device* device, UploadRing& uploadRing)
+	: _Device(device), _UploadRing(uploadRing)
+{
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+	// the frames in flight may still read it
+	if (_Buffer)
+		_UploadRing.DeferRelease(_Buffer);
+}
+
+UINT64 InstanceBuffer::Update(ID3D12GraphicsCommandList* cmdList, const XMFLOAT4X4* instances, UINT count, uint64_t version)
+{
+	if (_IsUploaded && version == _Version)
+		return 0;
+
+	if (count > _Capacity)
+	{
+		if (_Buffer)
+			_UploadRing.DeferRelease(_Buffer);
+
+		UINT capacity = 1;
+		while (capacity < count)
+			capacity *= 2;
+
+		ThrowIfFailed(
+			_Device->CreateCommittedResource(
+				&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+				D3D12_HEAP_FLAG_NONE,
+				&CD3DX12_RESOURCE_DESC::Buffer((UINT64)capacity * sizeof(XMFLOAT4X4)),
+				D3D12_RESOURCE_STATE_COMMON,
+				nullptr,
+				IID_PPV_ARGS(_Buffer.ReleaseAndGetAddressOf())));
+
+		_Buffer->SetName(L"Instances");
+		_BufferState = D3D12_RESOURCE_STATE_COMMON;
+		_Capacity = capacity;
+	}
+
+	_Count = count;
+	_Version = version;
+	_IsUploaded = true;
+
+	const UINT64 byteSize = (UINT64)count * sizeof(XMFLOAT4X4);
+	if (byteSize == 0)
+		return 0;
+
+	UploadRing::Allocation upload = _UploadRing.Allocate(byteSize, 16);
+	CopyMemory(upload.CpuAddress, instances, byteSize);
+
+	// the draws of the frames in flight are before the copy in the queue
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(_Buffer.Get(), _BufferState, D3D12_RESOURCE_STATE_COPY_DEST));
+	cmdList->CopyBufferRegion(_Buffer.Get(), 0, upload.Resource, upload.Offset, byteSize);
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(_Buffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER));
+	_BufferState = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
+
+	return byteSize;
+}
+
+D3D12_VERTEX_BUFFER_VIEW InstanceBuffer::View() const
+{
+	D3D12_VERTEX_BUFFER_VIEW view;
+	view.BufferLocation = _Buffer ? _Buffer->GetGPUVirtualAddress() : 0;
+	view.SizeInBytes = _Count * (UINT)sizeof(XMFLOAT4X4);
+	view.StrideInBytes = (UINT)sizeof(XMFLOAT4X4);
+	return view;
+}
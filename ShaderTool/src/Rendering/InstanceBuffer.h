@@ -0,0 +1,36 @@
+#pragma once
+
+#include "UploadRing.h"
+
+#include <DirectXMath.h>
+#include <d3d12.h>
+#include <wrl.h>
+
+// World matrices of the instanced draws of a node in a default heap buffer. They are copied from
+// the upload ring only when the instances change (a new version), every other frame binds the
+// copy made before. The buffer grows to the next power of 2 instances and never shrinks.
+class InstanceBuffer
+{
+public:
+	InstanceBuffer(ID3D12Device* device, UploadRing& uploadRing);
+	InstanceBuffer(const InstanceBuffer&) = delete;
+	InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+	~InstanceBuffer();
+
+	// Records the copy of the instances unless version is the one uploaded last, returns the bytes uploaded
+	UINT64 Update(ID3D12GraphicsCommandList* cmdList, const DirectX::XMFLOAT4X4* instances, UINT count, uint64_t version);
+
+	D3D12_VERTEX_BUFFER_VIEW View() const;
+	UINT GetCount() const { return _Count; }
+
+private:
+	ID3D12Device* _Device;
+	UploadRing& _UploadRing;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> _Buffer;
+	D3D12_RESOURCE_STATES _BufferState{ D3D12_RESOURCE_STATE_COMMON };
+	UINT _Capacity{ 0 }; // instances
+	UINT _Count{ 0 };
+	uint64_t _Version{ 0 };
+	bool _IsUploaded{ false };
+};
@@ -1,5 +1,20 @@
 #pragma once
 
+#include "Defines.h"
+#include "VertexFormat.h"
+#include "Meshlets.h"
+#include "ThumbnailRasterizer.h"
+
+#include <DirectXCollision.h>
+#include <memory>
+
+struct ModelLod
+{
+	UINT IndexOffset{ 0 }; // relative to StartIndexLocation
+	UINT IndexCount{ 0 };
+	float Error{ 0.f }; // simplification error relative to the model size
+};
+
 struct Model
 {
 	std::string Name;
@@ -8,4 +23,12 @@ struct Model
 	UINT IndexCount;
 	UINT StartIndexLocation;
 	UINT BaseVertexLocation;
+	int GeometryRangeId{ INVALID_INDEX }; // range in the geometry pool
+	VertexQuantization Quantization; // used by the packed vertex format
+	std::shared_ptr<const std::vector<Meshlet>> Meshlets; // only for imported models, LOD 0
+	std::shared_ptr<const PreviewMesh> Preview; // CPU copy for the node thumbnails
+	DirectX::BoundingBox Bounds; // object space
+	DirectX::BoundingSphere Sphere;
+	ModelLod Lods[MAX_MODEL_LODS]; // share the vertices of the model
+	UINT NumLods{ 0 };
 };
\ No newline at end of file
@@ -0,0 +1,378 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Two-level segregated fit (TLSF) allocator of offsets inside a range owned by someone else
+// (vertices and indices of the geometry pool). Free blocks are binned by size using a 3 bit
+// mantissa float, so finding a block is two bitmask scans and freed blocks are merged with their
+// free neighbours right away. It only deals with integers so it can be used without a device.
+class OffsetAllocator
+{
+public:
+	static constexpr uint32_t NO_SPACE = UINT32_MAX;
+
+	struct Allocation
+	{
+		uint32_t Offset{ NO_SPACE };
+		uint32_t Metadata{ NO_SPACE };
+
+		bool IsValid() const { return Offset != NO_SPACE; }
+	};
+
+	struct StorageReport
+	{
+		uint32_t TotalFreeSpace;
+		uint32_t LargestFreeRegion;
+		uint32_t NumFreeRegions;
+	};
+
+	explicit OffsetAllocator(uint32_t size = 0) { Reset(size); }
+
+	void Reset(uint32_t size)
+	{
+		_Size = size;
+		_FreeStorage = 0;
+		_NumFreeRegions = 0;
+		_UsedBinsTop = 0;
+		for (uint32_t i = 0; i < NUM_TOP_BINS; ++i)
+			_UsedBins[i] = 0;
+		for (uint32_t i = 0; i < NUM_LEAF_BINS; ++i)
+			_BinHeads[i] = UNUSED;
+
+		_Blocks.clear();
+		_FreeBlockSlots.clear();
+
+		if (size > 0)
+			InsertIntoBin(NewBlock(0, size));
+	}
+
+	Allocation Allocate(uint32_t size)
+	{
+		if (size == 0 || size > _FreeStorage)
+			return {};
+
+		// Round up, any block of the found bin is big enough
+		const uint32_t minBin = SizeToBinRoundUp(size);
+		const uint32_t minTop = minBin >> TOP_BIN_SHIFT;
+		const uint32_t minLeaf = minBin & LEAF_BIN_MASK;
+
+		uint32_t top = minTop;
+		uint32_t leaf = NO_SPACE;
+
+		if (_UsedBinsTop & (1u << top))
+			leaf = FindLowestSetBitAfter(_UsedBins[top], minLeaf);
+
+		if (leaf == NO_SPACE)
+		{
+			top = FindLowestSetBitAfter(_UsedBinsTop, minTop + 1);
+			if (top == NO_SPACE)
+				return {};
+
+			leaf = CountTrailingZeros(_UsedBins[top]);
+		}
+
+		const uint32_t blockIndex = _BinHeads[(top << TOP_BIN_SHIFT) | leaf];
+		RemoveFromBin(blockIndex);
+
+		const uint32_t remainder = _Blocks[blockIndex].Size - size;
+		if (remainder > 0)
+		{
+			const uint32_t splitIndex = NewBlock(_Blocks[blockIndex].Offset + size, remainder);
+
+			Block& split = _Blocks[splitIndex];
+			Block& block = _Blocks[blockIndex];
+			split.PrevPhys = blockIndex;
+			split.NextPhys = block.NextPhys;
+			if (block.NextPhys != UNUSED)
+				_Blocks[block.NextPhys].PrevPhys = splitIndex;
+			block.NextPhys = splitIndex;
+			block.Size = size;
+
+			InsertIntoBin(splitIndex);
+		}
+
+		_Blocks[blockIndex].Used = true;
+
+		Allocation allocation;
+		allocation.Offset = _Blocks[blockIndex].Offset;
+		allocation.Metadata = blockIndex;
+		return allocation;
+	}
+
+	void Free(const Allocation& allocation)
+	{
+		if (!allocation.IsValid())
+			return;
+
+		const uint32_t blockIndex = allocation.Metadata;
+		assert(blockIndex < _Blocks.size() && _Blocks[blockIndex].Used && "Invalid or double freed allocation");
+
+		uint32_t offset = _Blocks[blockIndex].Offset;
+		uint32_t size = _Blocks[blockIndex].Size;
+
+		// merge with the free neighbours
+		const uint32_t prev = _Blocks[blockIndex].PrevPhys;
+		if (prev != UNUSED && !_Blocks[prev].Used)
+		{
+			RemoveFromBin(prev);
+			offset = _Blocks[prev].Offset;
+			size += _Blocks[prev].Size;
+
+			_Blocks[blockIndex].PrevPhys = _Blocks[prev].PrevPhys;
+			if (_Blocks[prev].PrevPhys != UNUSED)
+				_Blocks[_Blocks[prev].PrevPhys].NextPhys = blockIndex;
+
+			ReleaseBlock(prev);
+		}
+
+		const uint32_t next = _Blocks[blockIndex].NextPhys;
+		if (next != UNUSED && !_Blocks[next].Used)
+		{
+			RemoveFromBin(next);
+			size += _Blocks[next].Size;
+
+			_Blocks[blockIndex].NextPhys = _Blocks[next].NextPhys;
+			if (_Blocks[next].NextPhys != UNUSED)
+				_Blocks[_Blocks[next].NextPhys].PrevPhys = blockIndex;
+
+			ReleaseBlock(next);
+		}
+
+		_Blocks[blockIndex].Offset = offset;
+		_Blocks[blockIndex].Size = size;
+		_Blocks[blockIndex].Used = false;
+		InsertIntoBin(blockIndex);
+	}
+
+	uint32_t GetAllocationSize(const Allocation& allocation) const
+	{
+		return allocation.IsValid() ? _Blocks[allocation.Metadata].Size : 0;
+	}
+
+	uint32_t GetSize() const { return _Size; }
+	uint32_t GetUsedSize() const { return _Size - _FreeStorage; }
+
+	StorageReport GetStorageReport() const
+	{
+		StorageReport report{ _FreeStorage, 0, _NumFreeRegions };
+
+		// the largest block is in the highest used bin, but a bin covers a size range
+		if (_UsedBinsTop)
+		{
+			const uint32_t top = 31 - CountLeadingZeros(_UsedBinsTop);
+			const uint32_t leaf = 31 - CountLeadingZeros(_UsedBins[top]);
+			for (uint32_t i = _BinHeads[(top << TOP_BIN_SHIFT) | leaf]; i != UNUSED; i = _Blocks[i].NextFree)
+				if (_Blocks[i].Size > report.LargestFreeRegion)
+					report.LargestFreeRegion = _Blocks[i].Size;
+		}
+		return report;
+	}
+
+	// 0 when all the free space is contiguous, close to 1 when it's scattered in small regions
+	float GetFragmentation() const
+	{
+		const StorageReport report = GetStorageReport();
+		if (report.TotalFreeSpace == 0)
+			return 0.f;
+		return 1.f - static_cast<float>(report.LargestFreeRegion) / report.TotalFreeSpace;
+	}
+
+	// Bin size mapping, exposed for debugging. Values below 8 are exact, above that
+	// they are stored as a float with a 3 bit mantissa.
+	static uint32_t SizeToBinRoundUp(uint32_t size)
+	{
+		if (size < MANTISSA_VALUE)
+			return size;
+
+		const uint32_t highestSetBit = 31 - CountLeadingZeros(size);
+		const uint32_t mantissaStartBit = highestSetBit - MANTISSA_BITS;
+		const uint32_t exp = mantissaStartBit + 1;
+		uint32_t mantissa = (size >> mantissaStartBit) & MANTISSA_MASK;
+
+		if (size & ((1u << mantissaStartBit) - 1))
+			++mantissa; // may carry into the exponent, that's the next bin
+
+		return (exp << MANTISSA_BITS) + mantissa;
+	}
+
+	static uint32_t SizeToBinRoundDown(uint32_t size)
+	{
+		if (size < MANTISSA_VALUE)
+			return size;
+
+		const uint32_t highestSetBit = 31 - CountLeadingZeros(size);
+		const uint32_t mantissaStartBit = highestSetBit - MANTISSA_BITS;
+		const uint32_t exp = mantissaStartBit + 1;
+		const uint32_t mantissa = (size >> mantissaStartBit) & MANTISSA_MASK;
+
+		return (exp << MANTISSA_BITS) | mantissa;
+	}
+
+	static uint32_t BinToSize(uint32_t bin)
+	{
+		const uint32_t exp = bin >> MANTISSA_BITS;
+		const uint32_t mantissa = bin & MANTISSA_MASK;
+		if (exp == 0)
+			return mantissa;
+		return (mantissa | MANTISSA_VALUE) << (exp - 1);
+	}
+
+	// The smallest free region sure to take an allocation of size: the request is rounded up to
+	// its bin and free blocks are binned rounded down, so a fresh allocator of exactly size may fail.
+	static uint32_t RoundUpToBinSize(uint32_t size)
+	{
+		return BinToSize(SizeToBinRoundUp(size));
+	}
+
+private:
+	static constexpr uint32_t MANTISSA_BITS = 3;
+	static constexpr uint32_t MANTISSA_VALUE = 1 << MANTISSA_BITS;
+	static constexpr uint32_t MANTISSA_MASK = MANTISSA_VALUE - 1;
+
+	static constexpr uint32_t NUM_TOP_BINS = 32;
+	static constexpr uint32_t BINS_PER_LEAF = 8;
+	static constexpr uint32_t TOP_BIN_SHIFT = 3;
+	static constexpr uint32_t LEAF_BIN_MASK = BINS_PER_LEAF - 1;
+	static constexpr uint32_t NUM_LEAF_BINS = NUM_TOP_BINS * BINS_PER_LEAF;
+
+	static constexpr uint32_t UNUSED = UINT32_MAX;
+
+	struct Block
+	{
+		uint32_t Offset{ 0 };
+		uint32_t Size{ 0 };
+		uint32_t PrevPhys{ UNUSED }; // neighbours by offset
+		uint32_t NextPhys{ UNUSED };
+		uint32_t PrevFree{ UNUSED }; // neighbours in the bin list
+		uint32_t NextFree{ UNUSED };
+		uint32_t Bin{ UNUSED };
+		bool Used{ false };
+	};
+
+	static uint32_t CountLeadingZeros(uint32_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		return _BitScanReverse(&index, value) ? 31 - index : 32;
+#else
+		return value ? __builtin_clz(value) : 32;
+#endif
+	}
+
+	static uint32_t CountTrailingZeros(uint32_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		return _BitScanForward(&index, value) ? index : 32;
+#else
+		return value ? __builtin_ctz(value) : 32;
+#endif
+	}
+
+	static uint32_t FindLowestSetBitAfter(uint32_t mask, uint32_t startIndex)
+	{
+		if (startIndex >= 32)
+			return NO_SPACE;
+
+		const uint32_t bitsAfter = mask & ~((1u << startIndex) - 1);
+		return bitsAfter ? CountTrailingZeros(bitsAfter) : NO_SPACE;
+	}
+
+	uint32_t NewBlock(uint32_t offset, uint32_t size)
+	{
+		uint32_t index;
+		if (!_FreeBlockSlots.empty())
+		{
+			index = _FreeBlockSlots.back();
+			_FreeBlockSlots.pop_back();
+			_Blocks[index] = Block();
+		}
+		else
+		{
+			index = static_cast<uint32_t>(_Blocks.size());
+			_Blocks.emplace_back();
+		}
+		_Blocks[index].Offset = offset;
+		_Blocks[index].Size = size;
+		return index;
+	}
+
+	void ReleaseBlock(uint32_t index)
+	{
+		_Blocks[index].Used = false;
+		_Blocks[index].Bin = UNUSED;
+		_FreeBlockSlots.push_back(index);
+	}
+
+	void InsertIntoBin(uint32_t index)
+	{
+		// Round down, the block must satisfy any request mapped to this bin
+		Block& block = _Blocks[index];
+		const uint32_t bin = SizeToBinRoundDown(block.Size);
+		const uint32_t top = bin >> TOP_BIN_SHIFT;
+		const uint32_t leaf = bin & LEAF_BIN_MASK;
+
+		if (_BinHeads[bin] == UNUSED)
+		{
+			_UsedBins[top] |= 1u << leaf;
+			_UsedBinsTop |= 1u << top;
+		}
+
+		block.Bin = bin;
+		block.PrevFree = UNUSED;
+		block.NextFree = _BinHeads[bin];
+		if (block.NextFree != UNUSED)
+			_Blocks[block.NextFree].PrevFree = index;
+		_BinHeads[bin] = index;
+
+		_FreeStorage += block.Size;
+		++_NumFreeRegions;
+	}
+
+	void RemoveFromBin(uint32_t index)
+	{
+		Block& block = _Blocks[index];
+		const uint32_t bin = block.Bin;
+
+		if (block.PrevFree != UNUSED)
+			_Blocks[block.PrevFree].NextFree = block.NextFree;
+		else
+			_BinHeads[bin] = block.NextFree;
+
+		if (block.NextFree != UNUSED)
+			_Blocks[block.NextFree].PrevFree = block.PrevFree;
+
+		if (_BinHeads[bin] == UNUSED)
+		{
+			const uint32_t top = bin >> TOP_BIN_SHIFT;
+			_UsedBins[top] &= ~(1u << (bin & LEAF_BIN_MASK));
+			if (_UsedBins[top] == 0)
+				_UsedBinsTop &= ~(1u << top);
+		}
+
+		block.Bin = UNUSED;
+		block.PrevFree = UNUSED;
+		block.NextFree = UNUSED;
+
+		_FreeStorage -= block.Size;
+		--_NumFreeRegions;
+	}
+
+private:
+	uint32_t _Size{ 0 };
+	uint32_t _FreeStorage{ 0 };
+	uint32_t _NumFreeRegions{ 0 };
+
+	uint32_t _UsedBinsTop{ 0 };
+	uint32_t _UsedBins[NUM_TOP_BINS]{};
+	uint32_t _BinHeads[NUM_LEAF_BINS]{};
+
+	std::vector<Block> _Blocks;
+	std::vector<uint32_t> _FreeBlockSlots;
+};
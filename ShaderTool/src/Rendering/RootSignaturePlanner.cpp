@@ -0,0 +1,85 @@
+#include "pch.h"
+#include "RootSignaturePlanner.h"
+#include "Defines.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace
+{
+	// Root CBVs must point to 256 byte aligned data and the shader may read the whole buffer
+	UINT AlignConstantBufferSize(UINT size)
+	{
+		return (size + 255) & ~255u;
+	}
+
+	// Root constants only need to reach the last variable, the padding after it is never read
+	UINT GetNum32BitValues(const CBufferLayout& cbuffer)
+	{
+		UINT end = 0;
+		for (auto& var : cbuffer.Vars)
+			end = std::max(end, var.StartOffset + var.Size);
+		return (end + 3) / 4;
+	}
+}
+
+RootSignatureLayout RootSignaturePlanner::Plan(const std::vector<CBufferLayout>& cbuffers, UINT numDescriptorTables)
+{
+	RootSignatureLayout layout;
+	layout.CBuffers.resize(cbuffers.size());
+
+	// everything spilled is the smallest root signature possible
+	layout.NumDWords = numDescriptorTables;
+	for (size_t i = 0; i < cbuffers.size(); ++i)
+	{
+		auto& placement = layout.CBuffers[i];
+		placement.Binding = CBufferBinding::RootDescriptor;
+		placement.Num32BitValues = GetNum32BitValues(cbuffers[i]);
+		placement.SizeInBytes = AlignConstantBufferSize(std::max(cbuffers[i].Size, placement.Num32BitValues * 4));
+		layout.NumDWords += 2;
+	}
+
+	if (layout.NumDWords > MAX_ROOT_SIGNATURE_DWORDS)
+	{
+		LOG_CRITICAL("Root signature needs {0} DWORDs with every cbuffer spilled, the limit is {1}", layout.NumDWords, MAX_ROOT_SIGNATURE_DWORDS);
+		throw std::runtime_error("Root signature needs " + std::to_string(layout.NumDWords) + " DWORDs");
+	}
+
+	// the smallest cbuffers first, they cost the least budget for each upload avoided
+	std::vector<size_t> order(cbuffers.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&layout](size_t a, size_t b) {
+		return layout.CBuffers[a].Num32BitValues < layout.CBuffers[b].Num32BitValues;
+	});
+
+	for (size_t i : order)
+	{
+		auto& placement = layout.CBuffers[i];
+		if (placement.Num32BitValues > MAX_ROOT_CONSTANTS_PER_CBUFFER)
+			break;
+
+		const UINT numDWords = layout.NumDWords - 2 + placement.Num32BitValues;
+		if (numDWords > MAX_ROOT_SIGNATURE_DWORDS)
+			break;
+
+		placement.Binding = CBufferBinding::RootConstants;
+		layout.NumDWords = numDWords;
+	}
+
+	for (size_t i = 0; i < cbuffers.size(); ++i)
+	{
+		auto& placement = layout.CBuffers[i];
+		if (placement.Binding == CBufferBinding::RootDescriptor)
+		{
+			++layout.NumSpilled;
+			LOG_TRACE("  {0} (b{1}) spilled to a root CBV, {2} bytes", cbuffers[i].Name, cbuffers[i].BindPoint, placement.SizeInBytes);
+		}
+		else
+		{
+			LOG_TRACE("  {0} (b{1}) as {2} root constants", cbuffers[i].Name, cbuffers[i].BindPoint, placement.Num32BitValues);
+		}
+	}
+
+	return layout;
+}
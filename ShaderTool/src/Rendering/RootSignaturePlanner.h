@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Constant buffer variable as reflected from the shader, offset and size in bytes
+struct CBufferVarLayout
+{
+	std::string Name;
+	std::string TypeName;
+	UINT StartOffset;
+	UINT Size;
+};
+
+struct CBufferLayout
+{
+	std::string Name;
+	UINT BindPoint;
+	UINT Size; // in bytes, reflection rounds it up to 16
+	std::vector<CBufferVarLayout> Vars;
+};
+
+enum class CBufferBinding
+{
+	RootConstants,	// inline in the root signature, one DWORD per 32 bit value
+	RootDescriptor	// root CBV pointing to the frame constants, 2 DWORDs
+};
+
+struct CBufferPlacement
+{
+	CBufferBinding Binding;
+	UINT Num32BitValues; // root constants, up to the end of the last variable
+	UINT SizeInBytes;    // root descriptors, multiple of 256
+};
+
+struct RootSignatureLayout
+{
+	std::vector<CBufferPlacement> CBuffers; // same order as the cbuffers planned
+	UINT NumDWords{ 0 };
+	UINT NumSpilled{ 0 };
+};
+
+// Chooses how each constant buffer of a shader is bound within the 64 DWORDs of a root signature.
+// Every cbuffer is written on each draw, so the small ones stay root constants (no upload, no
+// indirection) while the budget allows and the rest spill to root CBVs.
+namespace RootSignaturePlanner
+{
+	// The descriptor tables cost one DWORD each and are never spilled.
+	// Throws when even spilling every cbuffer doesn't fit the budget.
+	RootSignatureLayout Plan(const std::vector<CBufferLayout>& cbuffers, UINT numDescriptorTables);
+}
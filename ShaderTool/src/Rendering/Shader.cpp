@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "Shader.h"
 #include "Editor/Graph/Node.h"
+#include "Defines.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace D3DUtil;
@@ -71,11 +72,35 @@ void Shader::BuildRootParameters()
 	//_RootParameters.resize(numBindings, nullptr);
 	UINT rootParameterIndex = 0;
 
+	// cbuffers in binding order, with the offsets and sizes of the reflection (HLSL packing)
+	std::vector<CBufferLayout> cbufferLayouts;
+	for (auto& bind : bindings)
+	{
+		if (bind.Type != D3D_SIT_CBUFFER)
+			continue;
+
+		CBufferLayout cbufferLayout{ bind.Name, bind.BindPoint, 0 };
+		for (auto& desc : _Reflection->GetBufferDesc())
+			if (desc.Name == bind.Name)
+				cbufferLayout.Size = desc.Size;
+
+		auto it = cbufferVars.find(bind.Name);
+		if (it != cbufferVars.end())
+			for (auto& var : it->second)
+				cbufferLayout.Vars.push_back({ var.Name, var.Type.Name, var.StartOffset, var.Size });
+
+		cbufferLayouts.push_back(cbufferLayout);
+	}
+
+	LOG_TRACE("Root signature layout {0}", _Name);
+	_RootSignatureLayout = RootSignaturePlanner::Plan(cbufferLayouts, GetNumTextures());
+	LOG_INFO("Shader {0}: root signature uses {1}/{2} DWORDs, {3} cbuffer(s) spilled to root CBVs",
+		_Name, _RootSignatureLayout.NumDWords, MAX_ROOT_SIGNATURE_DWORDS, _RootSignatureLayout.NumSpilled);
+	size_t cbufferIndex = 0;
+
 	for (auto& bind : bindings)
 	{
 		LOG_TRACE("BIND {0} {1} {2}", bind.BindPoint, bind.Type, bind.Name);
-		UINT num32BitValuesOffset = 0;
-		UINT num32BitValuesTotal = 0;
 		
 		if (bind.Type == D3D_SIT_SAMPLER) // TODO: ignoring samplers for now
 		{
@@ -110,12 +135,9 @@ void Shader::BuildRootParameters()
 					shaderBind.VarName = var.Name;
 					shaderBind.VarTypeName = var.Type.Name;
 					shaderBind.VarNum32BitValues = num32BitValues;
-					shaderBind.VarNum32BitValuesOffset = num32BitValuesOffset;
+					shaderBind.VarNum32BitValuesOffset = var.StartOffset / 4;
 
 					_BindingVarsMap.push_back(shaderBind);
-
-					num32BitValuesOffset += num32BitValues;
-					num32BitValuesTotal += num32BitValues;
 				}
 			}
 			else
@@ -123,14 +145,29 @@ void Shader::BuildRootParameters()
 				LOG_WARN("Variables NOT FOUND for Constant Buffer {0} ", bind.Name);
 			}
 
-			LOG_TRACE("RootParameters[{0}].InitAsConstants({1}, {2})", rootParameterIndex, num32BitValuesTotal, bind.BindPoint);
-
-			_RootParameters.push_back(
-				std::make_unique<RootParameterConstants>(
-					rootParameterIndex, 
-					bind.Type,
-					num32BitValuesTotal, 
-					bind.BindPoint));
+			auto& placement = _RootSignatureLayout.CBuffers[cbufferIndex++];
+			if (placement.Binding == CBufferBinding::RootConstants)
+			{
+				LOG_TRACE("RootParameters[{0}].InitAsConstants({1}, {2})", rootParameterIndex, placement.Num32BitValues, bind.BindPoint);
+
+				_RootParameters.push_back(
+					std::make_unique<RootParameterConstants>(
+						rootParameterIndex, 
+						bind.Type,
+						placement.Num32BitValues, 
+						bind.BindPoint));
+			}
+			else
+			{
+				LOG_TRACE("RootParameters[{0}].InitAsConstantBufferView({1}) {2} bytes", rootParameterIndex, bind.BindPoint, placement.SizeInBytes);
+
+				_RootParameters.push_back(
+					std::make_unique<RootParameterConstantBufferView>(
+						rootParameterIndex,
+						bind.Type,
+						placement.SizeInBytes,
+						bind.BindPoint));
+			}
 		}
 		break;
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ShaderReflection.h"
+#include "RootSignaturePlanner.h"
 
 #include <map>
 
@@ -16,7 +17,7 @@ struct ShaderBind
 	std::string VarName{"NO_NAME"};
 	std::string VarTypeName{"NO_TYPE_NAME"};
 	UINT VarNum32BitValues{ 0 };
-	UINT VarNum32BitValuesOffset{ 0 };
+	UINT VarNum32BitValuesOffset{ 0 }; // HLSL packing offset from reflection, also used for the spilled cbuffers
 
 	// Used for Textures
 	INT OffsetInDescriptors{ 0 };
@@ -56,20 +57,32 @@ struct ShaderBind
 
 struct RootParameter
 {
-	RootParameter(UINT index, D3D_SHADER_INPUT_TYPE type) : Index(index), Type(type) {}
+	RootParameter(UINT index, D3D_SHADER_INPUT_TYPE type, D3D12_ROOT_PARAMETER_TYPE parameterType)
+		: Index(index), Type(type), ParameterType(parameterType) {}
 	UINT Index;
 	D3D_SHADER_INPUT_TYPE Type;
+	D3D12_ROOT_PARAMETER_TYPE ParameterType;
 };
 
 struct RootParameterConstants : public RootParameter
 {
 	RootParameterConstants(UINT index, D3D_SHADER_INPUT_TYPE type, UINT num32bitvalues, UINT bindpoint)
-		: RootParameter(index, type), Num32BitValues(num32bitvalues), BindPoint(bindpoint) {}
+		: RootParameter(index, type, D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS), Num32BitValues(num32bitvalues), BindPoint(bindpoint) {}
 
 	UINT Num32BitValues;
 	UINT BindPoint;
 };
 
+// cbuffer spilled out of the root constants, written in the frame constants each draw
+struct RootParameterConstantBufferView : public RootParameter
+{
+	RootParameterConstantBufferView(UINT index, D3D_SHADER_INPUT_TYPE type, UINT sizeInBytes, UINT bindpoint)
+		: RootParameter(index, type, D3D12_ROOT_PARAMETER_TYPE_CBV), SizeInBytes(sizeInBytes), BindPoint(bindpoint) {}
+
+	UINT SizeInBytes;
+	UINT BindPoint;
+};
+
 struct RootParameterDescriptorTable : public RootParameter
 {
 	RootParameterDescriptorTable(
@@ -79,7 +92,7 @@ struct RootParameterDescriptorTable : public RootParameter
 		UINT numDescriptors, 
 		UINT bindpoint, 
 		D3D12_SHADER_VISIBILITY shaderVisibility)
-		: RootParameter(index, type),
+		: RootParameter(index, type, D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE),
 		DescRangeType(descRangeType), 
 		NumDescriptors(numDescriptors),
 		BindPoint(bindpoint),
@@ -108,6 +121,7 @@ public:
 
 	const std::vector<ShaderBind>& GetBindingVars() const { return _BindingVarsMap; }
 	const std::vector<std::unique_ptr<RootParameter>>& GetRootParameters() const { return _RootParameters; }
+	UINT GetRootSignatureSize() const { return _RootSignatureLayout.NumDWords; }
 	
 private:
 	void BuildRootParameters();
@@ -119,4 +133,5 @@ private:
 	std::unique_ptr<ShaderReflection>           _Reflection;	
 	std::vector<std::unique_ptr<RootParameter>> _RootParameters;
 	std::vector<ShaderBind>                     _BindingVarsMap;
+	RootSignatureLayout                         _RootSignatureLayout;
 };
\ No newline at end of file
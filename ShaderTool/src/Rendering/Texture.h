@@ -13,8 +13,8 @@ struct Texture
 	size_t Index;
 	std::string Name;
 	std::string Path;
+	std::string LoadedPath; // the DDS the resource was created from, the converted copy of a PNG/TGA/HDR
 	Microsoft::WRL::ComPtr<ID3D12Resource> Resource{ nullptr };
-	Microsoft::WRL::ComPtr<ID3D12Resource> UploadHeap{ nullptr };
 	CD3DX12_CPU_DESCRIPTOR_HANDLE SrvCpuDescHandle;
 	CD3DX12_GPU_DESCRIPTOR_HANDLE SrvGpuDescHandle;
 };
@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "ThumbnailAtlas.h"
+#include "D3DUtil.h"
+#include "Defines.h"
+
+using namespace D3DUtil;
+
+static constexpr uint32_t ATLAS_SIZE = THUMBNAIL_SIZE * THUMBNAIL_ATLAS_COLUMNS;
+
+ThumbnailAtlas::ThumbnailAtlas(ID3D12Device* device) : _Device(device)
+{
+	CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, ATLAS_SIZE, ATLAS_SIZE, 1, 1);
+
+	// the slots are only sampled once something was copied to them
+	ThrowIfFailed(
+		_Device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+			nullptr,
+			IID_PPV_ARGS(_Resource.GetAddressOf()))
+	);
+	_Resource->SetName(L"ThumbnailAtlas");
+
+	// lowest slots first
+	for (int slot = THUMBNAIL_ATLAS_COLUMNS * THUMBNAIL_ATLAS_COLUMNS - 1; slot >= 0; --slot)
+		_FreeSlots.push_back(slot);
+}
+
+ThumbnailAtlas::~ThumbnailAtlas()
+{
+
+}
+
+void ThumbnailAtlas::CreateDescriptors(CD3DX12_CPU_DESCRIPTOR_HANDLE srvCpu, CD3DX12_GPU_DESCRIPTOR_HANDLE srvGpu)
+{
+	_SrvCpuDescHandle = srvCpu;
+	_SrvGpuDescHandle = srvGpu;
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MostDetailedMip = 0;
+	srvDesc.Texture2D.MipLevels = 1;
+
+	_Device->CreateShaderResourceView(_Resource.Get(), &srvDesc, _SrvCpuDescHandle);
+}
+
+int ThumbnailAtlas::AllocateSlot()
+{
+	if (_FreeSlots.empty())
+		return INVALID_INDEX;
+
+	const int slot = _FreeSlots.back();
+	_FreeSlots.pop_back();
+	return slot;
+}
+
+void ThumbnailAtlas::FreeSlot(int slot)
+{
+	assert(slot != INVALID_INDEX && slot < (int)(THUMBNAIL_ATLAS_COLUMNS * THUMBNAIL_ATLAS_COLUMNS) && "Thumbnail slot out of bounds");
+	_FreeSlots.push_back(slot);
+}
+
+void ThumbnailAtlas::Upload(ID3D12GraphicsCommandList* cmdList, UploadRing& uploadRing, int slot, const uint32_t* pixels)
+{
+	static_assert(THUMBNAIL_SIZE * 4 % D3D12_TEXTURE_DATA_PITCH_ALIGNMENT == 0, "The thumbnail rows are copied without padding");
+
+	const UINT rowPitch = THUMBNAIL_SIZE * 4;
+	UploadRing::Allocation upload = uploadRing.Allocate((UINT64)rowPitch * THUMBNAIL_SIZE, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+	CopyMemory(upload.CpuAddress, pixels, (size_t)rowPitch * THUMBNAIL_SIZE);
+
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
+	footprint.Offset = upload.Offset;
+	footprint.Footprint = CD3DX12_SUBRESOURCE_FOOTPRINT(DXGI_FORMAT_R8G8B8A8_UNORM, THUMBNAIL_SIZE, THUMBNAIL_SIZE, 1, rowPitch);
+
+	const CD3DX12_TEXTURE_COPY_LOCATION dst(_Resource.Get(), 0);
+	const CD3DX12_TEXTURE_COPY_LOCATION src(upload.Resource, footprint);
+
+	const UINT x = (slot % THUMBNAIL_ATLAS_COLUMNS) * THUMBNAIL_SIZE;
+	const UINT y = (slot / THUMBNAIL_ATLAS_COLUMNS) * THUMBNAIL_SIZE;
+
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
+		_Resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST));
+	cmdList->CopyTextureRegion(&dst, x, y, 0, &src, nullptr);
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
+		_Resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+}
+
+ThumbnailView ThumbnailAtlas::GetView(int slot) const
+{
+	const float slotSize = 1.f / THUMBNAIL_ATLAS_COLUMNS;
+	const float u = (slot % THUMBNAIL_ATLAS_COLUMNS) * slotSize;
+	const float v = (slot / THUMBNAIL_ATLAS_COLUMNS) * slotSize;
+
+	ThumbnailView view;
+	view.IsReady = true;
+	view.Srv = _SrvGpuDescHandle;
+	view.Uv0 = DirectX::XMFLOAT2(u, v);
+	view.Uv1 = DirectX::XMFLOAT2(u + slotSize, v + slotSize);
+	return view;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "D3DUtil.h"
+#include "UploadRing.h"
+
+#include <vector>
+
+struct ThumbnailView
+{
+	bool IsReady{ false };
+	D3D12_GPU_DESCRIPTOR_HANDLE Srv{};
+	DirectX::XMFLOAT2 Uv0{ 0.f, 0.f };
+	DirectX::XMFLOAT2 Uv1{ 0.f, 0.f };
+};
+
+// Texture the node previews are copied to, THUMBNAIL_ATLAS_COLUMNS x THUMBNAIL_ATLAS_COLUMNS slots
+// of THUMBNAIL_SIZE pixels, so ImGui shows all of them with a single descriptor.
+class ThumbnailAtlas
+{
+public:
+	ThumbnailAtlas(ID3D12Device* device);
+	ThumbnailAtlas(const ThumbnailAtlas&) = delete;
+	ThumbnailAtlas& operator=(const ThumbnailAtlas&) = delete;
+	~ThumbnailAtlas();
+
+	void CreateDescriptors(CD3DX12_CPU_DESCRIPTOR_HANDLE srvCpu, CD3DX12_GPU_DESCRIPTOR_HANDLE srvGpu);
+
+	// INVALID_INDEX when every slot is taken
+	int AllocateSlot();
+	void FreeSlot(int slot);
+
+	// Records the copy of THUMBNAIL_SIZE x THUMBNAIL_SIZE RGBA8 pixels to the slot
+	void Upload(ID3D12GraphicsCommandList* cmdList, UploadRing& uploadRing, int slot, const uint32_t* pixels);
+
+	ThumbnailView GetView(int slot) const;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Resource> _Resource;
+	ID3D12Device* _Device;
+	CD3DX12_CPU_DESCRIPTOR_HANDLE _SrvCpuDescHandle;
+	CD3DX12_GPU_DESCRIPTOR_HANDLE _SrvGpuDescHandle;
+	std::vector<int> _FreeSlots;
+};
@@ -0,0 +1,106 @@
+#include "pch.h"
+#include "UploadRing.h"
+#include "D3DUtil.h"
+
+using Microsoft::WRL::ComPtr;
+
+UploadRing::UploadRing(ID3D12Device* device, UINT64 bytesPerFrame, UINT numFrames)
+	: _Device(device), _BytesPerFrame(bytesPerFrame)
+{
+	const UINT64 capacity = bytesPerFrame * numFrames;
+
+	ThrowIfFailed(
+		_Device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(capacity),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(_Buffer.GetAddressOf())));
+
+	_Buffer->SetName(L"UploadRing");
+
+	// Upload heaps can stay mapped for their whole lifetime
+	ThrowIfFailed(_Buffer->Map(0, nullptr, reinterpret_cast<void**>(&_MappedData)));
+
+	_Allocator.Reset(capacity);
+}
+
+UploadRing::~UploadRing()
+{
+	if (_Buffer != nullptr)
+		_Buffer->Unmap(0, nullptr);
+
+	_MappedData = nullptr;
+}
+
+UploadRing::Allocation UploadRing::Allocate(UINT64 size, UINT64 alignment)
+{
+	if (size > _BytesPerFrame)
+	{
+		LOG_TRACE("UploadRing: {0} bytes exceed the frame budget, using a dedicated upload heap", size);
+		return AllocateDedicated(size);
+	}
+
+	const UINT64 offset = _Allocator.Allocate(size, alignment);
+	if (offset == UploadRingAllocator::INVALID_OFFSET)
+	{
+		LOG_WARN("UploadRing: ring is full ({0}/{1} bytes), using a dedicated upload heap",
+			_Allocator.GetUsedSize(), _Allocator.GetCapacity());
+		return AllocateDedicated(size);
+	}
+
+	Allocation allocation;
+	allocation.Resource = _Buffer.Get();
+	allocation.Offset = offset;
+	allocation.CpuAddress = _MappedData + offset;
+	allocation.GpuAddress = _Buffer->GetGPUVirtualAddress() + offset;
+	return allocation;
+}
+
+UploadRing::Allocation UploadRing::AllocateDedicated(UINT64 size)
+{
+	ComPtr<ID3D12Resource> buffer;
+	ThrowIfFailed(
+		_Device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(size),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(buffer.GetAddressOf())));
+
+	buffer->SetName(L"UploadRingDedicated");
+
+	Allocation allocation;
+	allocation.Resource = buffer.Get();
+	allocation.Offset = 0;
+	ThrowIfFailed(buffer->Map(0, nullptr, reinterpret_cast<void**>(&allocation.CpuAddress)));
+	allocation.GpuAddress = buffer->GetGPUVirtualAddress();
+
+	_PendingRelease.push_back(buffer);
+	return allocation;
+}
+
+void UploadRing::DeferRelease(Microsoft::WRL::ComPtr<ID3D12Resource> resource)
+{
+	_PendingRelease.push_back(resource);
+}
+
+void UploadRing::FinishFrame(UINT64 fenceValue)
+{
+	_Allocator.FinishFrame(fenceValue);
+
+	for (auto& buffer : _PendingRelease)
+		_ReleaseInFlight.push_back({ fenceValue, buffer });
+
+	_PendingRelease.clear();
+}
+
+void UploadRing::Retire(UINT64 completedFenceValue)
+{
+	_Allocator.Retire(completedFenceValue);
+
+	while (!_ReleaseInFlight.empty() && _ReleaseInFlight.front().FenceValue <= completedFenceValue)
+		_ReleaseInFlight.pop_front();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "UploadRingAllocator.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <deque>
+#include <vector>
+
+// Staging memory shared by every upload (vertex/index buffers, textures).
+// One persistently mapped upload heap sized per frame in flight, suballocated linearly and
+// reused once the fence of the frame that recorded the copy has been reached.
+// Requests bigger than a frame budget (or that don't fit) get a dedicated upload heap that is
+// released the same way.
+class UploadRing
+{
+public:
+	struct Allocation
+	{
+		ID3D12Resource* Resource{ nullptr };
+		UINT64 Offset{ 0 };
+		BYTE* CpuAddress{ nullptr };
+		D3D12_GPU_VIRTUAL_ADDRESS GpuAddress{ 0 };
+	};
+
+	UploadRing(ID3D12Device* device, UINT64 bytesPerFrame, UINT numFrames);
+	UploadRing(const UploadRing&) = delete;
+	UploadRing& operator=(const UploadRing&) = delete;
+	~UploadRing();
+
+	Allocation Allocate(UINT64 size, UINT64 alignment = 4);
+
+	// Keeps a resource alive until the frame that is being recorded has been executed.
+	void DeferRelease(Microsoft::WRL::ComPtr<ID3D12Resource> resource);
+
+	// Tags the allocations made since the last call with the fence signaled after
+	// the command list that consumes them.
+	void FinishFrame(UINT64 fenceValue);
+	void Retire(UINT64 completedFenceValue);
+
+	UINT64 GetCapacity() const { return _Allocator.GetCapacity(); }
+	UINT64 GetUsedSize() const { return _Allocator.GetUsedSize(); }
+	size_t GetNumDeferredReleases() const { return _PendingRelease.size() + _ReleaseInFlight.size(); }
+
+private:
+	Allocation AllocateDedicated(UINT64 size);
+
+private:
+	struct DeferredRelease
+	{
+		UINT64 FenceValue;
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+	};
+
+	ID3D12Device* _Device;
+	UINT64 _BytesPerFrame;
+	Microsoft::WRL::ComPtr<ID3D12Resource> _Buffer;
+	BYTE* _MappedData{ nullptr };
+	UploadRingAllocator _Allocator;
+
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> _PendingRelease;
+	std::deque<DeferredRelease> _ReleaseInFlight;
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+
+// Offset bookkeeping of the upload ring. It doesn't touch any GPU resource so it can be
+// exercised without a device. Allocations are linear and grouped per frame: FinishFrame()
+// tags everything allocated since the previous call with the frame fence value and
+// Retire() gives the space back once the GPU has reached that fence.
+class UploadRingAllocator
+{
+public:
+	static constexpr uint64_t INVALID_OFFSET = UINT64_MAX;
+
+	UploadRingAllocator() = default;
+	explicit UploadRingAllocator(uint64_t capacity) { Reset(capacity); }
+
+	void Reset(uint64_t capacity)
+	{
+		_Capacity = capacity;
+		_Head = 0;
+		_Tail = 0;
+		_UsedSize = 0;
+		_PendingSize = 0;
+		_Frames.clear();
+	}
+
+	// Returns the offset of the allocation or INVALID_OFFSET when it doesn't fit.
+	// alignment must be a power of two.
+	uint64_t Allocate(uint64_t size, uint64_t alignment = 1)
+	{
+		if (size == 0 || size > _Capacity || _UsedSize == _Capacity)
+			return INVALID_OFFSET;
+
+		// nothing in flight, start over from the beginning to get the largest contiguous block
+		if (_UsedSize == 0)
+		{
+			_Head = 0;
+			_Tail = 0;
+		}
+
+		const uint64_t alignedHead = AlignUp(_Head, alignment);
+		uint64_t offset = INVALID_OFFSET;
+		uint64_t consumed = 0;
+
+		if (_Head >= _Tail)
+		{
+			// free space is [head, capacity) + [0, tail)
+			if (alignedHead + size <= _Capacity)
+			{
+				offset = alignedHead;
+				consumed = (alignedHead - _Head) + size;
+			}
+			else if (size <= _Tail)
+			{
+				// wrap around, the remaining bytes at the end are wasted until this frame retires
+				offset = 0;
+				consumed = (_Capacity - _Head) + size;
+			}
+		}
+		else if (alignedHead + size <= _Tail)
+		{
+			// free space is [head, tail)
+			offset = alignedHead;
+			consumed = (alignedHead - _Head) + size;
+		}
+
+		if (offset == INVALID_OFFSET)
+			return INVALID_OFFSET;
+
+		_Head = offset + size;
+		if (_Head == _Capacity)
+			_Head = 0;
+
+		_UsedSize += consumed;
+		_PendingSize += consumed;
+
+		return offset;
+	}
+
+	void FinishFrame(uint64_t fenceValue)
+	{
+		if (_PendingSize == 0)
+			return;
+
+		_Frames.push_back({ fenceValue, _PendingSize });
+		_PendingSize = 0;
+	}
+
+	void Retire(uint64_t completedFenceValue)
+	{
+		while (!_Frames.empty() && _Frames.front().FenceValue <= completedFenceValue)
+		{
+			_Tail = (_Tail + _Frames.front().Size) % _Capacity;
+			_UsedSize -= _Frames.front().Size;
+			_Frames.pop_front();
+		}
+	}
+
+	uint64_t GetCapacity() const { return _Capacity; }
+	uint64_t GetUsedSize() const { return _UsedSize; }
+	uint64_t GetPendingSize() const { return _PendingSize; }
+	size_t GetNumFramesInFlight() const { return _Frames.size(); }
+
+	static uint64_t AlignUp(uint64_t value, uint64_t alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+
+private:
+	struct FrameMark
+	{
+		uint64_t FenceValue;
+		uint64_t Size;
+	};
+
+	uint64_t _Capacity{ 0 };
+	uint64_t _Head{ 0 };
+	uint64_t _Tail{ 0 };
+	uint64_t _UsedSize{ 0 };
+	uint64_t _PendingSize{ 0 };
+	std::deque<FrameMark> _Frames;
+};
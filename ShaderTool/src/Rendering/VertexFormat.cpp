@@ -0,0 +1,158 @@
+#include "pch.h"
+#include "VertexFormat.h"
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace VertexFormats
+{
+	struct VertexAttribute
+	{
+		const char* Semantic;
+		DXGI_FORMAT Format;
+		UINT Offset;
+	};
+
+	static const VertexAttribute FullAttributes[] = {
+		{ "POSITION", DXGI_FORMAT_R32G32B32_FLOAT, offsetof(Vertex, Position) },
+		{ "NORMAL", DXGI_FORMAT_R32G32B32_FLOAT, offsetof(Vertex, Normal) },
+		{ "TANGENT", DXGI_FORMAT_R32G32B32_FLOAT, offsetof(Vertex, TangentU) },
+		{ "TEXCOORD", DXGI_FORMAT_R32G32_FLOAT, offsetof(Vertex, TexC) },
+	};
+
+	static const VertexAttribute PackedAttributes[] = {
+		{ "POSITION", DXGI_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, Position) },
+		{ "NORMAL", DXGI_FORMAT_R16G16_SNORM, offsetof(PackedVertex, Normal) },
+		{ "TANGENT", DXGI_FORMAT_R16G16_SNORM, offsetof(PackedVertex, TangentU) },
+		{ "TEXCOORD", DXGI_FORMAT_R16G16_FLOAT, offsetof(PackedVertex, TexC) },
+	};
+
+	static_assert(sizeof(PackedVertex) == 20, "PackedVertex layout has changed");
+
+	UINT GetVertexStride(VertexFormat format)
+	{
+		return format == VertexFormat::Packed ? (UINT)sizeof(PackedVertex) : (UINT)sizeof(Vertex);
+	}
+
+	std::vector<D3D12_INPUT_ELEMENT_DESC> CreateInputLayout(VertexFormat format, bool instanced)
+	{
+		const VertexAttribute* attributes = format == VertexFormat::Packed ? PackedAttributes : FullAttributes;
+		const size_t numAttributes = format == VertexFormat::Packed ? _countof(PackedAttributes) : _countof(FullAttributes);
+
+		std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout;
+		inputLayout.reserve(numAttributes);
+
+		for (size_t i = 0; i < numAttributes; ++i)
+		{
+			inputLayout.push_back({
+				attributes[i].Semantic, 0,
+				attributes[i].Format, 0,
+				attributes[i].Offset,
+				D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
+		}
+
+		if (instanced)
+		{
+			for (UINT row = 0; row < 4; ++row)
+			{
+				inputLayout.push_back({
+					"WORLD", row,
+					DXGI_FORMAT_R32G32B32A32_FLOAT, INSTANCE_SLOT,
+					row * (UINT)sizeof(XMFLOAT4),
+					D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 });
+			}
+		}
+
+		return inputLayout;
+	}
+
+	VertexQuantization ComputeQuantization(const Vertex* vertices, size_t count)
+	{
+		VertexQuantization quantization;
+		if (count == 0)
+			return quantization;
+
+		XMVECTOR minimum = XMLoadFloat3(&vertices[0].Position);
+		XMVECTOR maximum = minimum;
+		for (size_t i = 1; i < count; ++i)
+		{
+			const XMVECTOR p = XMLoadFloat3(&vertices[i].Position);
+			minimum = XMVectorMin(minimum, p);
+			maximum = XMVectorMax(maximum, p);
+		}
+
+		XMStoreFloat3(&quantization.Min, minimum);
+		XMStoreFloat3(&quantization.Extent, XMVectorSubtract(maximum, minimum));
+		return quantization;
+	}
+
+	// Projects the direction on the octahedron |x|+|y|+|z| = 1 and unfolds the lower half over the corners
+	XMVECTOR XM_CALLCONV EncodeOctahedral(FXMVECTOR direction)
+	{
+		const XMVECTOR zero = XMVectorZero();
+		const XMVECTOR one = XMVectorSplatOne();
+
+		const XMVECTOR absDirection = XMVectorAbs(direction);
+		const XMVECTOR l1 = XMVectorAdd(XMVectorAdd(XMVectorSplatX(absDirection), XMVectorSplatY(absDirection)), XMVectorSplatZ(absDirection));
+		if (XMVector3Equal(l1, zero))
+			return zero;
+
+		const XMVECTOR p = XMVectorDivide(direction, l1);
+		const XMVECTOR sign = XMVectorSelect(XMVectorNegate(one), one, XMVectorGreaterOrEqual(p, zero));
+		const XMVECTOR folded = XMVectorMultiply(XMVectorSubtract(one, XMVectorSwizzle<1, 0, 2, 3>(XMVectorAbs(p))), sign);
+
+		const XMVECTOR encoded = XMVectorSelect(p, folded, XMVectorLess(XMVectorSplatZ(p), zero));
+		return XMVectorAndInt(encoded, g_XMMask3); // only xy are meaningful
+	}
+
+	XMVECTOR XM_CALLCONV DecodeOctahedral(FXMVECTOR encoded)
+	{
+		const XMVECTOR zero = XMVectorZero();
+		const XMVECTOR one = XMVectorSplatOne();
+
+		const XMVECTOR absEncoded = XMVectorAbs(encoded);
+		const XMVECTOR z = XMVectorSubtract(XMVectorSubtract(one, XMVectorSplatX(absEncoded)), XMVectorSplatY(absEncoded));
+		const XMVECTOR fold = XMVectorMax(XMVectorNegate(z), zero);
+		const XMVECTOR sign = XMVectorSelect(XMVectorNegate(one), one, XMVectorGreaterOrEqual(encoded, zero));
+
+		const XMVECTOR xy = XMVectorNegativeMultiplySubtract(sign, fold, encoded);
+		const XMVECTOR direction = XMVectorSelect(xy, z, g_XMSelect0011);
+		return XMVector3Normalize(XMVectorAndInt(direction, g_XMMask3));
+	}
+
+	void EncodeVertices(const Vertex* vertices, size_t count, const VertexQuantization& quantization, PackedVertex* packed)
+	{
+		const XMVECTOR minimum = XMLoadFloat3(&quantization.Min);
+		const XMVECTOR extent = XMLoadFloat3(&quantization.Extent);
+
+		// flat axes (a plane, a line) map to 0
+		const XMVECTOR scale = XMVectorSelect(XMVectorReciprocal(extent), XMVectorZero(), XMVectorEqual(extent, XMVectorZero()));
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Vertex& vertex = vertices[i];
+
+			const XMVECTOR position = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&vertex.Position), minimum), scale);
+			XMStoreUShortN4(&packed[i].Position, position);
+			XMStoreShortN2(&packed[i].Normal, EncodeOctahedral(XMLoadFloat3(&vertex.Normal)));
+			XMStoreShortN2(&packed[i].TangentU, EncodeOctahedral(XMLoadFloat3(&vertex.TangentU)));
+			XMStoreHalf2(&packed[i].TexC, XMLoadFloat2(&vertex.TexC));
+		}
+	}
+
+	void DecodeVertices(const PackedVertex* packed, size_t count, const VertexQuantization& quantization, Vertex* vertices)
+	{
+		const XMVECTOR minimum = XMLoadFloat3(&quantization.Min);
+		const XMVECTOR extent = XMLoadFloat3(&quantization.Extent);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			Vertex& vertex = vertices[i];
+
+			XMStoreFloat3(&vertex.Position, XMVectorMultiplyAdd(XMLoadUShortN4(&packed[i].Position), extent, minimum));
+			XMStoreFloat3(&vertex.Normal, DecodeOctahedral(XMLoadShortN2(&packed[i].Normal)));
+			XMStoreFloat3(&vertex.TangentU, DecodeOctahedral(XMLoadShortN2(&packed[i].TangentU)));
+			XMStoreFloat2(&vertex.TexC, XMLoadHalf2(&packed[i].TexC));
+		}
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <d3d12.h>
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <vector>
+
+enum class VertexFormat
+{
+	Full,	// Vertex, 44 bytes
+	Packed	// PackedVertex, 20 bytes
+};
+
+// Positions are 16 bit normalized inside the bounds of their mesh, normal and tangent are
+// octahedral encoded and the UVs are half floats. Shaders decode them with Shaders/packed_vertex.hlsli.
+struct PackedVertex
+{
+	DirectX::PackedVector::XMUSHORTN4 Position; // w unused
+	DirectX::PackedVector::XMSHORTN2 Normal;
+	DirectX::PackedVector::XMSHORTN2 TangentU;
+	DirectX::PackedVector::XMHALF2 TexC;
+};
+
+// Maps the normalized positions back to the mesh bounds: position = Min + packed * Extent
+struct VertexQuantization
+{
+	DirectX::XMFLOAT3 Min{ 0.f, 0.f, 0.f };
+	DirectX::XMFLOAT3 Extent{ 1.f, 1.f, 1.f };
+};
+
+namespace VertexFormats
+{
+	// Vertex buffer slot of the per instance world matrices (WORLD0-3)
+	constexpr UINT INSTANCE_SLOT = 1;
+
+	UINT GetVertexStride(VertexFormat format);
+
+	// Input layout matching the format, one element per vertex attribute. Instanced layouts add
+	// a row vector world matrix per instance read from INSTANCE_SLOT.
+	std::vector<D3D12_INPUT_ELEMENT_DESC> CreateInputLayout(VertexFormat format, bool instanced = false);
+
+	VertexQuantization ComputeQuantization(const Vertex* vertices, size_t count);
+
+	DirectX::XMVECTOR XM_CALLCONV EncodeOctahedral(DirectX::FXMVECTOR direction);
+	DirectX::XMVECTOR XM_CALLCONV DecodeOctahedral(DirectX::FXMVECTOR encoded);
+
+	void EncodeVertices(const Vertex* vertices, size_t count, const VertexQuantization& quantization, PackedVertex* packed);
+	void DecodeVertices(const PackedVertex* packed, size_t count, const VertexQuantization& quantization, Vertex* vertices);
+}
@@ -4,19 +4,20 @@
 #include <unordered_map>
 #include <string>
 
-#include "GameTimer.h"
+#include "TransformBatch.h"
 
 
 #include "Rendering\D3DApp.h"
 #include "Rendering\RenderTexture.h"
 #include "Rendering\Vertex.h"
-#include "Rendering\Mesh.h"
 #include "Rendering\ShaderManager.h"
 #include "Rendering\PipelineStateObject.h"
+#include "Rendering\ConstantStaging.h"
 
 #include "Editor\Graph\Node.h"
 #include "Editor\UiNode\UiNode.h"
 #include "Editor\Graph\Graph.h"
+#include "Editor\Graph\GraphOptimizer.h"
 
 struct Primitive
 {
@@ -25,6 +26,26 @@ struct Primitive
 };
 
 struct DrawNode;
+struct TransformNode;
+struct JournalRecord;
+
+// Command line runner: evaluates a saved project without window, swap chain or ImGui
+struct HeadlessOptions
+{
+	std::string ProjectPath{ PROJECT_FILE };
+	int NumFrames{ 1000 };
+	double FixedTimeStep{ 0.0 }; // in seconds, 0 runs the frames as fast as possible
+	bool RealTime{ false };      // the nodes read the wall clock instead of FixedTimeStep (1/60s when 0) per frame
+	std::string CsvPath;         // per frame timings, not written when empty
+	std::string TracePath;       // profiler zones of the last frames, not written when empty
+	std::string NodeCostsPath;   // average cost of each node, not measured when empty
+	std::string JournalPath;     // graph edits replayed with their frame times instead of running the project
+	uint32_t BenchmarkInstances{ 0 }; // upload of the instanced draws benchmarked instead of running the project when not 0
+	bool BenchmarkPrimitives{ false }; // generation and caching of the primitives benchmarked instead of running the project
+	bool BenchmarkSubdivide{ false };  // box and geosphere subdivision levels benchmarked instead of running the project
+	std::string BenchmarkImportPath;  // model file whose import is benchmarked instead of running the project when not empty
+	std::string BenchmarkSimplifyPath; // model file whose simplification is benchmarked instead of running the project when not empty
+};
 
 class ShaderToolApp : public D3DApp
 {
@@ -36,6 +57,7 @@ public:
 
 	bool Init();
 	void Run();
+	int RunHeadless(const HeadlessOptions& options);
 	void RenderUIDockSpace();
 	void UpdateNodeGraph();
 	void RenderNodeGraph();
@@ -49,15 +71,13 @@ public:
 	void SwapFrameResource();
 	void CreateDescriptorHeaps();
 	void BuildBackBufferPSO();
-	void LoadPrimitiveModels();
 	
-	const GameTimer& GetTimer() const { return _Timer; }
 	const std::vector<std::unique_ptr<UiNode>>& GetUiNodes() const { return _UINodes; }
 	const Graph& GetGraph() const { return _Graph; }
 	UiNode* GetUiNode(NodeId id) { return _UINodeIdMap[id]; }
+	const ConstantUploadStats& GetConstantUploadStats() const { return _ConstantUploadStats; }
 
 private:
-	GameTimer _Timer;
 	bool _IsRunning{ true };
 
 	Microsoft::WRL::ComPtr<ID3D12PipelineState> _BackBufferPSO;
@@ -70,18 +90,59 @@ private: // Node Graph
 	Graph _Graph;
 	int _RootNodeId;
 	bool _RenderTargetReady{ false };
-	std::vector<int> _Primitives; // stores indices to the primitive models 
 	std::unique_ptr<RenderTexture> _RenderTarget;  // TODO: at the moment only 1 render target supported
 	std::vector<std::unique_ptr<UiNode>> _UINodes;
 	std::unordered_map<NodeId, UiNode*> _UINodeIdMap;
 	
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> _TextureSrvDescriptorHeap;
 
+	EvaluationPlan _EvalPlan;
+	GraphStructure _EvalPlanStructure; // graph the plan was built for
+	bool _WasEditingValues{ false };
+
+	TransformBatch _TransformBatch;
+	std::vector<TransformNode*> _BatchedTransforms; // transform nodes evaluated by the plan
+
+	ConstantUploadStats _ConstantUploadStats; // of the last frame evaluated
+
+	// pin values before the nodes are drawn, the ones changed by the widgets are recorded in the journal
+	struct PinValue
+	{
+		int Pin;
+		size_t Offset; // in _PinValueBytes
+		size_t Size;
+	};
+	std::vector<PinValue> _PinValues;
+	std::vector<uint8_t> _PinValueBytes;
+	std::vector<std::pair<int, std::string>> _NodeStates; // ui node id, UiNode::GetState before the nodes are drawn
+	bool _ValuesReplayed{ false }; // pin values set by the journal replay, the plan is rebuilt as when they're edited
+
+	bool InitHeadless(std::istream& project);
+	int RunInstancesBenchmark(const HeadlessOptions& options);
+	int RunPrimitivesBenchmark(const HeadlessOptions& options);
+	int RunSubdivideBenchmark(const HeadlessOptions& options);
+	int RunImportBenchmark(const HeadlessOptions& options);
+	int RunSimplifyBenchmark(const HeadlessOptions& options);
 	void InitNodeGraph();
 	void Reset();
 	void Save();
-	void Load();
+	bool Load(const std::string& path = PROJECT_FILE);
+	void SerializeProject(std::ostream& out);
+	void DeserializeProject(std::istream& in);
+	void ToggleJournalRecording();
+	bool ReplayRecord(const JournalRecord& record);
+	std::unique_ptr<UiNode> MakeUiNode(UiNodeType type);
+	UiNode* CreateUiNode(UiNodeType type);
+	void DeleteUiNode(NodeId id);
+	void SnapshotPinValues();
+	void SnapshotNodeStates();
+	void RecordEditedPinValues();
+	void RecordEditedNodeStates();
+	void GenerateShaderVariant();
+	void BuildEvaluationPlan(bool structureChanged);
 	void EvaluateGraph();
+	void EvaluateNode(int id);
+	void EvaluateTransforms();
 	void RenderToTexture(DrawNode* drawNode);
 	void ClearRenderTexture();
 	void HandleNewNodes();
@@ -89,7 +150,7 @@ private: // Node Graph
 	void HandleDeletedLinks();
 	void HandleDeletedNodes();
 	void BuildRenderTargetRootSignature(const std::string& shaderName);
-	void CreateRenderTargetPSO(int shaderIndex);
+	void CreateRenderTargetPSO(int shaderIndex, bool instanced = false);
 	void LoadSrvTexture(int textureIndex);
 
 
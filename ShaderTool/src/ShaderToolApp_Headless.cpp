@@ -0,0 +1,691 @@
+#include "pch.h"
+#include "ShaderToolApp.h"
+#include "AssetManager.h"
+#include "FrameClock.h"
+#include "Instancing.h"
+#include "Journal.h"
+#include "MeshSimplifier.h"
+#include "NodeCostTracker.h"
+#include "PrimitiveCache.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "Rendering\InstanceBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace D3DUtil;
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct FrameTiming
+	{
+		double UpdateMs;   // UpdateNodeGraph
+		double EvaluateMs; // EvaluateGraph, recording included
+		double EditsMs;    // journal records applied, 0 when not replaying
+		double FrameMs;    // whole frame, waiting for the frame resource included
+	};
+
+	double ToMs(Clock::duration d)
+	{
+		return std::chrono::duration<double, std::milli>(d).count();
+	}
+
+	// nearest rank, the values must be sorted
+	double Percentile(const std::vector<double>& sorted, double p)
+	{
+		size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.5);
+		rank = std::clamp<size_t>(rank, 1, sorted.size());
+		return sorted[rank - 1];
+	}
+
+	void PrintStats(const char* name, std::vector<double> values)
+	{
+		std::sort(values.begin(), values.end());
+
+		double total = 0.0;
+		for (double v : values)
+			total += v;
+
+		std::printf("%-10s mean %8.3f  min %8.3f  p50 %8.3f  p90 %8.3f  p99 %8.3f  max %8.3f ms\n",
+			name, total / values.size(), values.front(), Percentile(values, 50.0),
+			Percentile(values, 90.0), Percentile(values, 99.0), values.back());
+	}
+}
+
+// Same setup as Init without the window, the back buffer PSO and ImGui, then loads the project
+// the way the L key does (with the command list recording, the textures are uploaded with it).
+bool ShaderToolApp::InitHeadless(std::istream& project)
+{
+	if (!D3DApp::InitHeadless())
+		return false;
+
+	// RenderTargetNode keeps a pointer to it, even if nothing is drawn
+	_RenderTarget = std::make_unique<RenderTexture>(
+		_Device.Get(),
+		_BackBufferFormat,
+		RENDER_TARGET_WIDTH,
+		RENDER_TARGET_HEIGHT);
+
+	auto commandAllocator = _CurrFrameResource->CmdListAlloc;
+	_CommandList->Reset(commandAllocator.Get(), nullptr);
+
+	AssetManager::Get().Init(_Device.Get(), _CommandList.Get(), _UploadRing.get());
+
+	CreateDescriptorHeaps();
+	InitNodeGraph();
+
+	DeserializeProject(project);
+
+	ThrowIfFailed(_CommandList->Close());
+	ID3D12CommandList* cmdsLists[] = { _CommandList.Get() };
+	_CommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+
+	FlushCommandQueue();
+
+	_UploadRing->FinishFrame(_CurrentFenceValue);
+	_UploadRing->Retire(_Fence->GetCompletedValue());
+
+	return true;
+}
+
+// Applies a record the way the editor made the edit, false when the graph isn't the one it was recorded on
+bool ShaderToolApp::ReplayRecord(const JournalRecord& record)
+{
+	switch (record.Type)
+	{
+	case JournalRecordType::CreateNode:
+	{
+		UiNode* node = CreateUiNode(record.NodeType);
+		return node && node->Id == record.Id;
+	}
+	case JournalRecordType::DeleteNode:
+		if (_UINodeIdMap.count(record.Id) == 0)
+			return false;
+		DeleteUiNode(record.Id);
+		return true;
+	case JournalRecordType::CreateLink:
+		return _Graph.CreateEdge(record.From, record.To, EdgeType::External) == record.Id;
+	case JournalRecordType::DeleteLink:
+		_Graph.EraseEdge(record.Id);
+		return true;
+	case JournalRecordType::SetValue:
+	{
+		const auto& values = _Graph.GetNodeValues();
+		auto it = values.find(record.Id);
+		if (it == values.end() || !it->second || it->second->GetValueSize() != record.Value.size())
+			return false;
+		it->second->SetValuePtr(const_cast<uint8_t*>(record.Value.data()));
+		_ValuesReplayed = true;
+		return true;
+	}
+	case JournalRecordType::LoadAsset:
+	{
+		auto it = _UINodeIdMap.find(record.Id);
+		if (it == _UINodeIdMap.end())
+			return false;
+		it->second->LoadFile(record.Path);
+		return true;
+	}
+	case JournalRecordType::NodeState:
+	{
+		auto it = _UINodeIdMap.find(record.Id);
+		if (it == _UINodeIdMap.end())
+			return false;
+		it->second->SetState(record.State);
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+// The instances of each layout generated a few times, then the frames of an instanced draw without
+// the draw: the matrices copied to the upload ring every frame against the InstanceBuffer of the
+// InstancesNode, only copied when the instances change (never after the first frame here).
+int ShaderToolApp::RunInstancesBenchmark(const HeadlessOptions& options)
+{
+	constexpr int NUM_GENERATIONS = 10;
+	const uint32_t count = std::min(options.BenchmarkInstances, MAX_INSTANCES);
+	if (options.NumFrames <= 0)
+	{
+		LOG_ERROR("The number of frames must be positive, got {0}", options.NumFrames);
+		return EXIT_FAILURE;
+	}
+
+	std::vector<double> ring, buffer;
+	UINT64 ringBytes = 0;
+	UINT64 bufferBytes = 0;
+
+	try
+	{
+		if (!D3DApp::InitHeadless())
+			return EXIT_FAILURE;
+
+		std::printf("%u instances, %d frames\n", count, options.NumFrames);
+
+		std::vector<DirectX::XMFLOAT4X4> instances;
+		for (InstanceLayout layout : { InstanceLayout::Grid, InstanceLayout::Scatter, InstanceLayout::Array })
+		{
+			InstanceParams params;
+			params.Layout = layout;
+			params.Count = count;
+
+			std::vector<double> generate;
+			for (int i = 0; i < NUM_GENERATIONS; ++i)
+			{
+				const auto start = Clock::now();
+				Instancing::Generate(params, instances);
+				generate.push_back(ToMs(Clock::now() - start));
+			}
+			PrintStats(std::string(magic_enum::enum_name(layout)).c_str(), generate);
+		}
+
+		const UINT64 instancesSize = (UINT64)instances.size() * sizeof(DirectX::XMFLOAT4X4);
+		InstanceBuffer instanceBuffer(_Device.Get(), *_UploadRing);
+		for (auto* times : { &ring, &buffer })
+		{
+			for (int i = 0; i < options.NumFrames; ++i)
+			{
+				SwapFrameResource();
+
+				auto commandAllocator = _CurrFrameResource->CmdListAlloc;
+				commandAllocator->Reset();
+				_CommandList->Reset(commandAllocator.Get(), nullptr);
+
+				const auto frameStart = Clock::now();
+				if (times == &ring)
+				{
+					auto allocation = _UploadRing->Allocate(instancesSize, 16);
+					memcpy(allocation.CpuAddress, instances.data(), instancesSize);
+					ringBytes += instancesSize;
+				}
+				else
+					bufferBytes += instanceBuffer.Update(_CommandList.Get(), instances.data(), (UINT)instances.size(), 1);
+
+				ThrowIfFailed(_CommandList->Close());
+				ID3D12CommandList* const commandLists[] = { _CommandList.Get() };
+				_CommandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+
+				_CurrFrameResource->FenceValue = ++_CurrentFenceValue;
+				_CommandQueue->Signal(_Fence.Get(), _CurrentFenceValue);
+				_UploadRing->FinishFrame(_CurrentFenceValue);
+				times->push_back(ToMs(Clock::now() - frameStart));
+			}
+		}
+
+		FlushCommandQueue();
+	}
+	catch (D3DUtil::DxException& e)
+	{
+		LOG_CRITICAL(L"DX Error: {0}", e.ToString().c_str());
+		return EXIT_FAILURE;
+	}
+
+	PrintStats("ring", ring);
+	PrintStats("buffer", buffer);
+	std::printf("uploaded  ring %.1f MB, buffer %.1f MB\n", ringBytes / (1024.0 * 1024.0), bufferBytes / (1024.0 * 1024.0));
+	return EXIT_SUCCESS;
+}
+
+// Each shape at a high tessellation: its generation alone, then PrimitiveCache::Acquire when the
+// parameters change every frame (generation, optimization, model creation and upload, eviction)
+// and when they don't (a cache hit).
+int ShaderToolApp::RunPrimitivesBenchmark(const HeadlessOptions& options)
+{
+	constexpr int NUM_GENERATIONS = 10;
+	constexpr int NUM_MISSES = 50;
+	constexpr int NUM_HITS = 100000;
+
+	std::vector<PrimitiveParams> primitives(5);
+	primitives[0].Shape = PrimitiveShape::Box;
+	primitives[0].Subdivisions = 5;
+	primitives[1].Shape = PrimitiveShape::Sphere;
+	primitives[1].Slices = 256;
+	primitives[1].Stacks = 128;
+	primitives[2].Shape = PrimitiveShape::Geosphere;
+	primitives[2].Subdivisions = 6;
+	primitives[3].Shape = PrimitiveShape::Cylinder;
+	primitives[3].Slices = 256;
+	primitives[3].Stacks = 64;
+	primitives[4].Shape = PrimitiveShape::Grid;
+	primitives[4].Slices = 256;
+	primitives[4].Stacks = 256;
+
+	try
+	{
+		if (!D3DApp::InitHeadless())
+			return EXIT_FAILURE;
+
+		AssetManager::Get().Init(_Device.Get(), _CommandList.Get(), _UploadRing.get());
+
+		for (PrimitiveParams& params : primitives)
+		{
+			std::vector<double> generate;
+			size_t numVertices = 0;
+			size_t numTriangles = 0;
+			for (int i = 0; i < NUM_GENERATIONS; ++i)
+			{
+				const auto start = Clock::now();
+				const GeometryGenerator::MeshData mesh = PrimitiveCache::Generate(params);
+				generate.push_back(ToMs(Clock::now() - start));
+				numVertices = mesh.Vertices.size();
+				numTriangles = mesh.Indices32.size() / 3;
+			}
+
+			// a size animated by a node graph, every frame misses the cache
+			std::vector<double> miss;
+			int modelIndex = INVALID_INDEX;
+			for (int i = 0; i < NUM_MISSES; ++i)
+			{
+				SwapFrameResource();
+
+				auto commandAllocator = _CurrFrameResource->CmdListAlloc;
+				commandAllocator->Reset();
+				_CommandList->Reset(commandAllocator.Get(), nullptr);
+
+				params.Width = params.Radius = 1.f + 0.01f * (i + 1);
+				const auto start = Clock::now();
+				modelIndex = PrimitiveCache::Get().Acquire(params);
+				miss.push_back(ToMs(Clock::now() - start));
+				if (modelIndex == INVALID_INDEX)
+					return EXIT_FAILURE;
+				PrimitiveCache::Get().Release(modelIndex);
+
+				ThrowIfFailed(_CommandList->Close());
+				ID3D12CommandList* const commandLists[] = { _CommandList.Get() };
+				_CommandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+
+				_CurrFrameResource->FenceValue = ++_CurrentFenceValue;
+				_CommandQueue->Signal(_Fence.Get(), _CurrentFenceValue);
+				_UploadRing->FinishFrame(_CurrentFenceValue);
+			}
+
+			// the parameters of the last frame are still in the cache
+			const auto start = Clock::now();
+			for (int i = 0; i < NUM_HITS; ++i)
+				PrimitiveCache::Get().Release(PrimitiveCache::Get().Acquire(params));
+			const double hitNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / NUM_HITS;
+
+			std::printf("%s: %zu vertices, %zu triangles\n", std::string(magic_enum::enum_name(params.Shape)).c_str(), numVertices, numTriangles);
+			PrintStats("generate", generate);
+			PrintStats("miss", miss);
+			std::printf("hit       %.1f ns, generation %.2f M vertices/s\n",
+				hitNs, numVertices / (*std::min_element(generate.begin(), generate.end()) * 1000.0));
+		}
+
+		FlushCommandQueue();
+	}
+	catch (D3DUtil::DxException& e)
+	{
+		LOG_CRITICAL(L"DX Error: {0}", e.ToString().c_str());
+		return EXIT_FAILURE;
+	}
+
+	std::printf("%zu primitives cached\n", PrimitiveCache::Get().GetNumEntries());
+	return EXIT_SUCCESS;
+}
+
+// The box and the geosphere at each level of subdivision, the whole generation timed (the
+// geosphere is projected on the sphere after the subdivision). Only the CPU is used, no device.
+int ShaderToolApp::RunSubdivideBenchmark(const HeadlessOptions& options)
+{
+	constexpr int NUM_RUNS = 5;
+
+	std::printf("%-10s %5s %10s %10s %8s %10s %10s\n", "shape", "level", "vertices", "triangles", "MB", "best ms", "mean ms");
+	for (PrimitiveShape shape : { PrimitiveShape::Box, PrimitiveShape::Geosphere })
+	{
+		const uint32_t maxLevel = shape == PrimitiveShape::Box ? MAX_PRIMITIVE_SUBDIVISIONS : MAX_GEOSPHERE_SUBDIVISIONS;
+		for (uint32_t level = 0; level <= maxLevel; ++level)
+		{
+			PrimitiveParams params;
+			params.Shape = shape;
+			params.Subdivisions = level;
+
+			std::vector<double> times;
+			size_t numVertices = 0;
+			size_t numTriangles = 0;
+			for (int i = 0; i < NUM_RUNS; ++i)
+			{
+				const auto start = Clock::now();
+				const GeometryGenerator::MeshData mesh = PrimitiveCache::Generate(params);
+				times.push_back(ToMs(Clock::now() - start));
+				numVertices = mesh.Vertices.size();
+				numTriangles = mesh.Indices32.size() / 3;
+			}
+
+			double total = 0.0;
+			for (double t : times)
+				total += t;
+			const double megabytes = (numVertices * sizeof(Vertex) + numTriangles * 3 * sizeof(uint32_t)) / (1024.0 * 1024.0);
+			std::printf("%-10s %5u %10zu %10zu %8.2f %10.3f %10.3f\n", std::string(magic_enum::enum_name(shape)).c_str(),
+				level, numVertices, numTriangles, megabytes, *std::min_element(times.begin(), times.end()), total / times.size());
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+// A model file imported a few times the way the model node does it, its models unloaded after each
+// import: the time of each stage of LoadModelsFromFile, the upload of the geometry recorded and executed.
+int ShaderToolApp::RunImportBenchmark(const HeadlessOptions& options)
+{
+	constexpr int NUM_IMPORTS = 5;
+
+	std::vector<double> read, convert, process, upload, total;
+	ImportStats stats;
+
+	try
+	{
+		if (!D3DApp::InitHeadless())
+			return EXIT_FAILURE;
+
+		AssetManager::Get().Init(_Device.Get(), _CommandList.Get(), _UploadRing.get());
+
+		for (int i = 0; i < NUM_IMPORTS; ++i)
+		{
+			SwapFrameResource();
+
+			auto commandAllocator = _CurrFrameResource->CmdListAlloc;
+			commandAllocator->Reset();
+			_CommandList->Reset(commandAllocator.Get(), nullptr);
+
+			const std::vector<int> modelIndices = AssetManager::Get().LoadModelsFromFile(options.BenchmarkImportPath, &stats);
+			if (modelIndices.empty())
+				return EXIT_FAILURE;
+
+			ThrowIfFailed(_CommandList->Close());
+			ID3D12CommandList* const commandLists[] = { _CommandList.Get() };
+			_CommandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+
+			_CurrFrameResource->FenceValue = ++_CurrentFenceValue;
+			_CommandQueue->Signal(_Fence.Get(), _CurrentFenceValue);
+			_UploadRing->FinishFrame(_CurrentFenceValue);
+
+			// the next import takes the same slots and geometry ranges
+			for (int modelIndex : modelIndices)
+				AssetManager::Get().UnloadModel(modelIndex);
+
+			read.push_back(stats.ReadMs);
+			convert.push_back(stats.ConvertMs);
+			process.push_back(stats.ProcessMs);
+			upload.push_back(stats.UploadMs);
+			total.push_back(stats.TotalMs);
+		}
+
+		FlushCommandQueue();
+	}
+	catch (D3DUtil::DxException& e)
+	{
+		LOG_CRITICAL(L"DX Error: {0}", e.ToString().c_str());
+		return EXIT_FAILURE;
+	}
+
+	std::printf("%s: %zu meshes, %zu vertices, %zu triangles, %d imports, %zu threads\n",
+		options.BenchmarkImportPath.c_str(), stats.NumMeshes, stats.NumVertices, stats.NumTriangles, NUM_IMPORTS, ThreadPool::Get().GetNumThreads());
+	PrintStats("read", read);
+	PrintStats("convert", convert);
+	PrintStats("process", process);
+	PrintStats("upload", upload);
+	PrintStats("total", total);
+	std::printf("best      %.2f M triangles/s\n", stats.NumTriangles / (*std::min_element(total.begin(), total.end()) * 1000.0));
+	return EXIT_SUCCESS;
+}
+
+// The meshes are simplified from the full resolution to each ratio of their triangles, the error
+// is the largest one of the meshes relative to their size. Only the CPU is used, no device.
+int ShaderToolApp::RunSimplifyBenchmark(const HeadlessOptions& options)
+{
+	constexpr int NUM_RUNS = 3;
+	constexpr size_t NUM_LEVELS = 4; // 50, 25, 12.5 and 6.25% of the triangles
+
+	const std::vector<ImportedMesh> meshes = AssetManager::ReadMeshes(options.BenchmarkSimplifyPath);
+	if (meshes.empty())
+		return EXIT_FAILURE;
+
+	size_t numVertices = 0;
+	size_t numTriangles = 0;
+	for (const ImportedMesh& mesh : meshes)
+	{
+		numVertices += mesh.Vertices.size();
+		numTriangles += mesh.Indices.size() / 3;
+	}
+	std::printf("%s: %zu meshes, %zu vertices, %zu triangles, %d runs\n",
+		options.BenchmarkSimplifyPath.c_str(), meshes.size(), numVertices, numTriangles, NUM_RUNS);
+
+	for (size_t level = 1; level <= NUM_LEVELS; ++level)
+	{
+		std::vector<double> times;
+		size_t simplifiedTriangles = 0;
+		float maxError = 0.f;
+
+		for (int run = 0; run < NUM_RUNS; ++run)
+		{
+			simplifiedTriangles = 0;
+			const auto start = Clock::now();
+			for (const ImportedMesh& mesh : meshes)
+			{
+				const size_t targetIndexCount = ((mesh.Indices.size() / 3) >> level) * 3;
+				float error = 0.f;
+				simplifiedTriangles += MeshSimplifier::Simplify(mesh.Vertices, mesh.Indices, targetIndexCount, &error).size() / 3;
+				maxError = std::max(maxError, error);
+			}
+			times.push_back(ToMs(Clock::now() - start));
+		}
+
+		char name[16];
+		std::snprintf(name, sizeof(name), "%.2f%%", 100.0 / (1 << level));
+		PrintStats(name, times);
+		std::printf("           %zu triangles, error %.5f, %.2f M input triangles/s\n",
+			simplifiedTriangles, maxError, numTriangles / (*std::min_element(times.begin(), times.end()) * 1000.0));
+	}
+
+	// the chain built at import, each level simplifies the previous one
+	std::vector<double> times;
+	size_t numLods = 0;
+	float maxError = 0.f;
+	for (int run = 0; run < NUM_RUNS; ++run)
+	{
+		numLods = 0;
+		const auto start = Clock::now();
+		for (const ImportedMesh& mesh : meshes)
+		{
+			const std::vector<MeshSimplifier::Lod> lods = MeshSimplifier::BuildLodChain(mesh.Vertices, mesh.Indices, MAX_MODEL_LODS - 1);
+			numLods += lods.size();
+			if (!lods.empty())
+				maxError = std::max(maxError, lods.back().Error);
+		}
+		times.push_back(ToMs(Clock::now() - start));
+	}
+	PrintStats("lod chain", times);
+	std::printf("           %zu LODs, error of the last %.5f\n", numLods, maxError);
+	return EXIT_SUCCESS;
+}
+
+int ShaderToolApp::RunHeadless(const HeadlessOptions& options)
+{
+	Log::Init();
+	Profiler::SetThreadName("Main");
+
+	if (options.BenchmarkInstances > 0)
+		return RunInstancesBenchmark(options);
+	if (options.BenchmarkPrimitives)
+		return RunPrimitivesBenchmark(options);
+	if (options.BenchmarkSubdivide)
+		return RunSubdivideBenchmark(options);
+	if (!options.BenchmarkImportPath.empty())
+		return RunImportBenchmark(options);
+	if (!options.BenchmarkSimplifyPath.empty())
+		return RunSimplifyBenchmark(options);
+
+	// a journal replays its frames on the project saved in it
+	const bool isReplay = !options.JournalPath.empty();
+	const std::string& name = isReplay ? options.JournalPath : options.ProjectPath;
+	JournalData journal;
+	std::unique_ptr<std::istream> project;
+	if (isReplay)
+	{
+		if (!Journal::Read(options.JournalPath, journal))
+			return EXIT_FAILURE;
+		project = std::make_unique<std::istringstream>(journal.Project);
+	}
+	else
+		project = std::make_unique<std::ifstream>(options.ProjectPath, std::ios_base::in);
+
+	if (!*project)
+	{
+		LOG_ERROR("Failed to load file {0}", options.ProjectPath);
+		return EXIT_FAILURE;
+	}
+
+	const int numFrames = isReplay ? static_cast<int>(journal.Frames.size()) : options.NumFrames;
+	if (numFrames <= 0)
+	{
+		LOG_ERROR("The number of frames must be positive, got {0}", numFrames);
+		return EXIT_FAILURE;
+	}
+
+	std::vector<FrameTiming> timings;
+	timings.reserve(numFrames);
+	Clock::duration totalTime{};
+
+	try
+	{
+		if (!InitHeadless(*project))
+			return EXIT_FAILURE;
+
+		LOG_INFO("Running {0} for {1} frames, {2}", name, numFrames,
+			options.FixedTimeStep > 0.0 ? std::to_string(options.FixedTimeStep) + "s per frame" : "as fast as possible");
+
+		const auto fixedStep = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.FixedTimeStep));
+		const auto start = Clock::now();
+		auto nextFrame = start;
+
+		NodeCostTracker::Get().SetEnabled(!options.NodeCostsPath.empty());
+
+		// the same times in every run unless the wall clock is asked for
+		FrameClock::Get().SetMode(options.RealTime ? FrameClockMode::RealTime : FrameClockMode::Deterministic, options.FixedTimeStep);
+		FrameClock::Get().Reset();
+		for (int i = 0; i < numFrames; ++i)
+		{
+			Profiler::BeginFrame();
+			const auto frameStart = Clock::now();
+
+			// same order as OnUpdate/OnRender, without the back buffer and the UI
+			if (isReplay)
+				FrameClock::Get().SetTime(journal.Frames[i].Time, journal.Frames[i].DeltaTime);
+			else
+				FrameClock::Get().Tick();
+			SwapFrameResource();
+
+			const auto updateStart = Clock::now();
+			UpdateNodeGraph();
+			const auto updateEnd = Clock::now();
+
+			auto commandAllocator = _CurrFrameResource->CmdListAlloc;
+			commandAllocator->Reset();
+			_CommandList->Reset(commandAllocator.Get(), nullptr);
+
+			const auto evaluateStart = Clock::now();
+			EvaluateGraph();
+			const auto evaluateEnd = Clock::now();
+
+			// the edits were made in the node graph window, drawn after the evaluation
+			if (isReplay)
+			{
+				PROFILE_SCOPE("ReplayRecords");
+				for (const auto& record : journal.Frames[i].Records)
+				{
+					if (!ReplayRecord(record))
+					{
+						LOG_ERROR("The {0} record of frame {1} doesn't match the graph of the journal, the replay stops",
+							magic_enum::enum_name(record.Type), i);
+						return EXIT_FAILURE;
+					}
+				}
+			}
+			const auto editsEnd = Clock::now();
+
+			ThrowIfFailed(_CommandList->Close());
+			ID3D12CommandList* const commandLists[] = { _CommandList.Get() };
+			_CommandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+
+			_CurrFrameResource->FenceValue = ++_CurrentFenceValue;
+			_CommandQueue->Signal(_Fence.Get(), _CurrentFenceValue);
+			_UploadRing->FinishFrame(_CurrentFenceValue);
+
+			const auto frameEnd = Clock::now();
+			timings.push_back({ ToMs(updateEnd - updateStart), ToMs(evaluateEnd - evaluateStart), ToMs(editsEnd - evaluateEnd), ToMs(frameEnd - frameStart) });
+
+			if (fixedStep.count() > 0)
+			{
+				nextFrame += fixedStep;
+				std::this_thread::sleep_until(nextFrame);
+			}
+		}
+
+		FlushCommandQueue();
+		totalTime = Clock::now() - start;
+	}
+	catch (D3DUtil::DxException& e)
+	{
+		LOG_CRITICAL(L"DX Error: {0}", e.ToString().c_str());
+		return EXIT_FAILURE;
+	}
+
+	std::vector<double> update, evaluate, edits, frame;
+	for (const auto& t : timings)
+	{
+		update.push_back(t.UpdateMs);
+		evaluate.push_back(t.EvaluateMs);
+		edits.push_back(t.EditsMs);
+		frame.push_back(t.FrameMs);
+	}
+
+	const double totalMs = ToMs(totalTime);
+	std::printf("%s: %d frames, %zu ui nodes, %zu evaluated\n",
+		name.c_str(), numFrames, _UINodes.size(), _EvalPlan.Steps.size() - _EvalPlan.NumMerged);
+	if (isReplay)
+		std::printf("%zu edits replayed\n", journal.NumRecords);
+	std::printf("total %.3f ms, %.1f frames/s\n", totalMs, numFrames * 1000.0 / totalMs);
+	PrintStats("update", update);
+	PrintStats("evaluate", evaluate);
+	if (isReplay)
+		PrintStats("edits", edits);
+	PrintStats("frame", frame);
+
+	if constexpr (PROFILER_ENABLED)
+		std::printf("profiler  %.1f ns per zone\n", Profiler::MeasureOverhead(1000000));
+
+	if (!options.TracePath.empty() && !Profiler::WriteChromeTrace(options.TracePath))
+		return EXIT_FAILURE;
+
+	if (!options.NodeCostsPath.empty())
+	{
+		NodeCostTracker::Get().BeginFrame(); // the last frame
+		if (!NodeCostTracker::Get().WriteCsv(options.NodeCostsPath))
+			return EXIT_FAILURE;
+	}
+
+	if (!options.CsvPath.empty())
+	{
+		std::ofstream csv(options.CsvPath, std::ios_base::out | std::ios_base::trunc);
+		if (!csv.is_open())
+		{
+			LOG_ERROR("Failed to write file {0}", options.CsvPath);
+			return EXIT_FAILURE;
+		}
+
+		csv << "frame,update_ms,evaluate_ms,edits_ms,frame_ms\n";
+		for (size_t i = 0; i < timings.size(); ++i)
+			csv << i << "," << timings[i].UpdateMs << "," << timings[i].EvaluateMs << "," << timings[i].EditsMs << "," << timings[i].FrameMs << "\n";
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -1,7 +1,7 @@
 #include "pch.h"
 #include "ShaderToolApp.h"
-#include "GeometryGenerator.h"
 #include "AssetManager.h"
+#include "FrameClock.h"
 
 
 using namespace DirectX;
@@ -24,9 +24,10 @@ bool ShaderToolApp::Init()
 	auto commandAllocator = _CurrFrameResource->CmdListAlloc;
 	_CommandList->Reset(commandAllocator.Get(), nullptr);
 
+	AssetManager::Get().Init(_Device.Get(), _CommandList.Get(), _UploadRing.get());
+
 	CreateDescriptorHeaps();
 	BuildBackBufferPSO();
-	LoadPrimitiveModels();
 
 	ThrowIfFailed(_CommandList->Close());
 	ID3D12CommandList* cmdsLists[] = { _CommandList.Get() };
@@ -34,12 +35,14 @@ bool ShaderToolApp::Init()
 
 	FlushCommandQueue();
 
-	_Timer.Reset();
+	// the primitives upload is done, give the staging memory back to the ring
+	_UploadRing->FinishFrame(_CurrentFenceValue);
+	_UploadRing->Retire(_Fence->GetCompletedValue());
+
+	FrameClock::Get().Reset();
 	ImNodesIO& io = ImNodes::GetIO();
 	io.LinkDetachWithModifierClick.Modifier = &ImGui::GetIO().KeyCtrl;
 
-	AssetManager::Get().Init(_Device.Get(), _CommandList.Get());
-
 	InitNodeGraph();
 
 	return true;
@@ -81,6 +84,16 @@ void ShaderToolApp::CreateDescriptorHeaps()
 			2,
 			_CbvSrvUavDescriptorSize));
 
+	AssetManager::Get().SetThumbnailDescriptors(
+		CD3DX12_CPU_DESCRIPTOR_HANDLE(
+			_ImGuiSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
+			3,
+			_CbvSrvUavDescriptorSize),
+		CD3DX12_GPU_DESCRIPTOR_HANDLE(
+			_ImGuiSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart(),
+			3,
+			_CbvSrvUavDescriptorSize));
+
 	// Textures used in shaders for texture mapping
 	D3D12_DESCRIPTOR_HEAP_DESC texSrvHeapDesc = {};
 	texSrvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
@@ -153,87 +166,4 @@ void ShaderToolApp::BuildBackBufferPSO()
 	
 	ThrowIfFailed(_Device->CreateGraphicsPipelineState(&pso, IID_PPV_ARGS(&_BackBufferPSO)));
 
-}
-
-void ShaderToolApp::LoadPrimitiveModels()
-{
-	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData cube = geoGen.CreateBox(1.f, 1.f, 1.f, 0u);
-	GeometryGenerator::MeshData sphere = geoGen.CreateSphere(1.f, 20u, 20u);
-	GeometryGenerator::MeshData grid = geoGen.CreateGrid(10.f, 10.f, 10u, 10u);
-
-	auto mesh = std::make_shared<Mesh>();
-	mesh->Name = "primitives";
-
-	// the order that vertices and indices are inserted MUST be the same as the offsets in the submeshes
-
-	std::vector<Vertex> vertices;
-	vertices.insert(vertices.end(), cube.Vertices.begin(), cube.Vertices.end());
-	vertices.insert(vertices.end(), sphere.Vertices.begin(), sphere.Vertices.end());
-	vertices.insert(vertices.end(), grid.Vertices.begin(), grid.Vertices.end());
-
-	std::vector<uint32_t> indices;
-	indices.insert(indices.end(), cube.Indices32.begin(), cube.Indices32.end());
-	indices.insert(indices.end(), sphere.Indices32.begin(), sphere.Indices32.end());
-	indices.insert(indices.end(), grid.Indices32.begin(), grid.Indices32.end());
-
-	const UINT vbByteSize = static_cast<UINT>(vertices.size()) * sizeof(Vertex);
-	const UINT ibByteSize = static_cast<UINT>(indices.size()) * sizeof(uint32_t);
-
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &mesh->VertexBufferCPU));
-	CopyMemory(mesh->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
-
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &mesh->IndexBufferCPU));
-	CopyMemory(mesh->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
-
-	mesh->VertexBufferGPU = D3DUtil::CreateDefaultBuffer(
-		_Device.Get(),
-		_CommandList.Get(),
-		vertices.data(),
-		vbByteSize,
-		mesh->VertexBufferUploader);
-
-	mesh->IndexBufferGPU = D3DUtil::CreateDefaultBuffer(
-		_Device.Get(),
-		_CommandList.Get(),
-		indices.data(),
-		ibByteSize,
-		mesh->IndexBufferUploader);
-
-	mesh->VertexByteStride = sizeof(Vertex);
-	mesh->VertexBufferByteSize = vbByteSize;
-	mesh->IndexFormat = DXGI_FORMAT_R32_UINT;
-	mesh->IndexBufferByteSize = ibByteSize;
-
-	AssetManager::Get().AddMesh(mesh);
-
-	// The meshes MUST be stored and in the exact same way they are indexed in the submeshes
-
-	Model model;
-	model.VertexBufferView = mesh->VertexBufferView();
-	model.IndexBufferView = mesh->IndexBufferView();
-
-	// Cube
-	model.Name = "cube";
-	model.IndexCount = (UINT)cube.Indices32.size();
-	model.StartIndexLocation = 0;
-	model.BaseVertexLocation = 0;
-	int modelIndex = AssetManager::Get().AddModel(model);
-	_Primitives.push_back(modelIndex);
-
-	// Sphere
-	model.Name = "sphere";
-	model.IndexCount = (UINT)sphere.Indices32.size();
-	model.StartIndexLocation = (UINT)cube.Indices32.size();
-	model.BaseVertexLocation = (UINT)cube.Vertices.size();
-	modelIndex = AssetManager::Get().AddModel(model);
-	_Primitives.push_back(modelIndex);
-
-	// Grid
-	model.Name = "grid";
-	model.IndexCount = (UINT)grid.Indices32.size();
-	model.StartIndexLocation += (UINT)sphere.Indices32.size();
-	model.BaseVertexLocation += (UINT)sphere.Vertices.size();
-	modelIndex = AssetManager::Get().AddModel(model);
-	_Primitives.push_back(modelIndex);
 }
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include "pch.h"
 #include "ShaderToolApp.h"
+#include "AssetManager.h"
+#include "FrameClock.h"
+#include "Journal.h"
+#include "Profiler.h"
 
 using namespace DirectX;
 using namespace D3DUtil;
@@ -40,11 +44,12 @@ void ShaderToolApp::OnKeyUp(WPARAM key)
 void ShaderToolApp::Run()
 {
 	Log::Init();
+	Profiler::SetThreadName("Main");
 
 	if (!Init())
 		return;
 	
-	_Timer.Reset();
+	FrameClock::Get().Reset();
 	try
 	{
 		MSG msg = { 0 };
@@ -78,13 +83,19 @@ void ShaderToolApp::OnResize(uint32_t width, uint32_t height)
 
 void ShaderToolApp::OnUpdate()
 {
-	_Timer.Tick();
+	Profiler::BeginFrame();
+	PROFILE_FUNCTION();
+
+	FrameClock::Get().Tick();
+	Journal::Get().RecordFrame(FrameClock::Get().GetTime(), FrameClock::Get().GetDeltaTime());
 	SwapFrameResource();
 	UpdateNodeGraph();
 }
 
 void ShaderToolApp::OnRender()
 {
+	PROFILE_FUNCTION();
+
 	// Reset command list
 	auto backBuffer = _BackBuffers[_CurrentBackBufferIndex];
 	auto commandAllocator = _CurrFrameResource->CmdListAlloc;
@@ -95,6 +106,9 @@ void ShaderToolApp::OnRender()
 
 	EvaluateGraph();
 
+	// the previews requested by the nodes in the last frame, copied before the UI samples them
+	AssetManager::Get().UpdateThumbnails();
+
 	// Render to back buffer
 	{
 		CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
@@ -129,10 +143,16 @@ void ShaderToolApp::OnRender()
 	_CommandList->SetGraphicsRootSignature(_BackBufferRootSignature.Get());
 	_CommandList->SetPipelineState(_BackBufferPSO.Get());
 
-	NewUIFrame();
+	{
+		PROFILE_SCOPE("ImGui::NewFrame");
+		NewUIFrame();
+	}
 	RenderUIDockSpace();
 	RenderNodeGraph();
-	RenderUI();
+	{
+		PROFILE_SCOPE("ImGui::Render");
+		RenderUI();
+	}
 
 	// PRESENT
 	{
@@ -144,13 +164,19 @@ void ShaderToolApp::OnRender()
 		_CommandList->ResourceBarrier(1, &barrier);
 	}
 
-	ThrowIfFailed(_CommandList->Close());
-	ID3D12CommandList* const commandLists[] = { _CommandList.Get() };
-	_CommandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+	{
+		PROFILE_SCOPE("ExecuteCommandLists");
+		ThrowIfFailed(_CommandList->Close());
+		ID3D12CommandList* const commandLists[] = { _CommandList.Get() };
+		_CommandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+	}
 
-	UINT syncInterval = _VSync ? 1 : 0;
-	UINT presentFlags = _TearingSupport && !_VSync ? DXGI_PRESENT_ALLOW_TEARING : 0;
-	ThrowIfFailed(_SwapChain->Present(syncInterval, presentFlags));
+	{
+		PROFILE_SCOPE("Present");
+		UINT syncInterval = _VSync ? 1 : 0;
+		UINT presentFlags = _TearingSupport && !_VSync ? DXGI_PRESENT_ALLOW_TEARING : 0;
+		ThrowIfFailed(_SwapChain->Present(syncInterval, presentFlags));
+	}
 
 	_CurrentBackBufferIndex = (_CurrentBackBufferIndex + 1) % NUM_BACK_BUFFERS;
 
@@ -162,11 +188,16 @@ void ShaderToolApp::OnRender()
 	// set until the GPU finishes processing all the commands prior to this Signal().
 	_CommandQueue->Signal(_Fence.Get(), _CurrentFenceValue);
 
+	// Uploads recorded in this frame are released once the GPU reaches the same fence point.
+	_UploadRing->FinishFrame(_CurrentFenceValue);
+
 }
 
 // cycle through frames to continue writing commands avoiding the GPU getting idle
 void ShaderToolApp::SwapFrameResource()
 {
+	PROFILE_FUNCTION();
+
 	_CurrFrameResourceIndex = (_CurrFrameResourceIndex + 1) % NUM_FRAMES;
 	_CurrFrameResource = _FrameResources[_CurrFrameResourceIndex].get();
 
@@ -174,11 +205,14 @@ void ShaderToolApp::SwapFrameResource()
 	// If not, wait until the GPU has completed commands up to this fence point.
 	if (_CurrFrameResource->FenceValue != 0 && _Fence->GetCompletedValue() < _CurrFrameResource->FenceValue)
 	{
+		PROFILE_SCOPE("WaitForFrameFence");
 		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
 		ThrowIfFailed(_Fence->SetEventOnCompletion(_CurrFrameResource->FenceValue, eventHandle));
 		WaitForSingleObject(eventHandle, INFINITE);
 		CloseHandle(eventHandle);
 	}
+
+	_UploadRing->Retire(_Fence->GetCompletedValue());
 }
 
 
@@ -227,6 +261,18 @@ void ShaderToolApp::RenderUIDockSpace()
 			if (ImGui::MenuItem("Close", NULL, false, docking_open != NULL)) LOG_WARN("Close NOT IMPLEMENTED");
 			ImGui::EndMenu();
 		}
+		if (ImGui::BeginMenu("Clock"))
+		{
+			FrameClock& clock = FrameClock::Get();
+			for (auto mode : magic_enum::enum_values<FrameClockMode>())
+			{
+				if (ImGui::MenuItem(std::string(magic_enum::enum_name(mode)).c_str(), NULL, clock.GetMode() == mode))
+					clock.SetMode(mode, FRAME_CLOCK_FIXED_STEP);
+			}
+			ImGui::Separator();
+			if (ImGui::MenuItem("Reset")) clock.Reset();
+			ImGui::EndMenu();
+		}
 		ImGui::EndMenuBar();
 	}
 
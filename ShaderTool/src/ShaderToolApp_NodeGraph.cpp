@@ -1,6 +1,12 @@
 #include "pch.h"
 #include "ShaderToolApp.h"
 #include "AssetManager.h"
+#include "FrameClock.h"
+#include "Journal.h"
+#include "Meshlets.h"
+#include "NodeCostTracker.h"
+#include "Profiler.h"
+#include "Rendering/Frustum.h"
 
 #include "Editor\UiNode\AddNode.h"
 #include "Editor\UiNode\MultiplyNode.h"
@@ -20,18 +26,24 @@
 #include "Editor\UiNode\ModelNode.h"
 #include "Editor\UiNode\TextureNode.h"
 #include "Editor\UiNode\TransformNode.h"
+#include "Editor\UiNode\InstancesNode.h"
 
 #include "Rendering/DDSTextureLoader.h"
+#include "Editor/Graph/HlslGenerator.h"
 
 #include <iomanip>
 #include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <cmath>
+#include <cstring>
+#include <limits>
+#include <string_view>
 
 #define VK_S 0x53
 #define VK_L 0x4C
 #define VK_N 0x4E
+#define VK_G 0x47
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -47,6 +59,7 @@ ImGuiWindowFlags overlay_window_flags = ImGuiWindowFlags_NoDecoration | ImGuiWin
 static bool showDfsDebug = false;
 static bool showShadersDebug = false;
 static bool showNodeValueDebug = false;
+static bool showProfiler = false;
 std::stack<int> postOrderClone; // TODO: debug only
 
 void ShowHoverDebugInfo(std::function<void(void)> info)
@@ -70,6 +83,132 @@ void ShowHoverDebugInfo(std::function<void(void)> info)
 	ImGui::End();
 }
 
+// Zones of each thread in the last frame, one row per nesting level
+void ProfilerWindow()
+{
+	static bool paused = false;
+	static std::vector<ProfileThread> threads;
+	static int64_t frameStart = 0;
+	static int64_t frameEnd = 0;
+
+	ImGui::SetNextWindowSize(ImVec2(900.0f, 300.0f), ImGuiCond_FirstUseEver);
+	if (!ImGui::Begin("Profiler", &showProfiler))
+	{
+		ImGui::End();
+		return;
+	}
+
+	if constexpr (!PROFILER_ENABLED)
+	{
+		ImGui::Text("Disabled at compile time (PROFILER_ENABLED)");
+		ImGui::End();
+		return;
+	}
+
+	// the current frame isn't done, the previous one is shown
+	const std::vector<int64_t> frames = Profiler::GetFrames();
+	if (!paused && frames.size() > 1)
+	{
+		frameStart = frames[frames.size() - 2];
+		frameEnd = frames.back();
+		Profiler::Capture(frameStart, frameEnd, threads);
+	}
+
+	ImGui::Checkbox("Pause", &paused);
+	ImGui::SameLine();
+	if (ImGui::Button("Export trace"))
+		Profiler::WriteChromeTrace(PROFILER_TRACE_FILE);
+	ImGui::SameLine();
+	ImGui::Text("Frame: %.3f ms", Profiler::TicksToMs(frameEnd - frameStart));
+	ImGui::Separator();
+
+	if (frameEnd <= frameStart)
+	{
+		ImGui::End();
+		return;
+	}
+
+	const float labelWidth = 100.0f;
+	const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+	const float width = std::max(ImGui::GetContentRegionAvail().x - labelWidth, 100.0f);
+	const double pixelsPerTick = width / (double)(frameEnd - frameStart);
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+
+	for (const auto& thread : threads)
+	{
+		if (thread.Zones.empty())
+			continue;
+
+		const ImVec2 origin = ImGui::GetCursorScreenPos();
+		drawList->AddText(origin, ImGui::GetColorU32(ImGuiCol_Text), thread.Name.c_str());
+
+		uint32_t maxDepth = 0;
+		for (const auto& zone : thread.Zones)
+		{
+			maxDepth = std::max(maxDepth, zone.Depth);
+
+			const float x0 = origin.x + labelWidth + (float)((std::max(zone.Start, frameStart) - frameStart) * pixelsPerTick);
+			const float x1 = origin.x + labelWidth + (float)((std::min(zone.End, frameEnd) - frameStart) * pixelsPerTick);
+			const ImVec2 min(x0, origin.y + zone.Depth * rowHeight);
+			const ImVec2 max(std::max(x1, x0 + 1.0f), min.y + rowHeight - 1.0f);
+
+			const float hue = (std::hash<std::string_view>()(zone.Name) % 64) / 64.0f;
+			drawList->AddRectFilled(min, max, ImColor::HSV(hue, 0.5f, 0.75f));
+			const ImVec4 clip(min.x, min.y, max.x, max.y);
+			drawList->AddText(nullptr, 0.0f, ImVec2(min.x + 2.0f, min.y), IM_COL32_BLACK, zone.Name, nullptr, 0.0f, &clip);
+
+			if (ImGui::IsMouseHoveringRect(min, max))
+			{
+				ImGui::BeginTooltip();
+				ImGui::Text("%s", zone.Name);
+				ImGui::Text("%.3f ms", Profiler::TicksToMs(zone.End - zone.Start));
+				ImGui::EndTooltip();
+			}
+		}
+
+		ImGui::Dummy(ImVec2(labelWidth + width, (maxDepth + 1) * rowHeight));
+		ImGui::Separator();
+	}
+
+	ImGui::End();
+}
+
+// Green for the cheapest nodes to red for the most expensive one
+ImU32 GetHeatColor(float heat, float brightness)
+{
+	return ImColor::HSV((1.0f - heat) * 0.33f, 0.8f, brightness);
+}
+
+void NodeCostsWindow(ShaderToolApp* app)
+{
+	ImGui::Begin("Node Costs");
+
+	if (ImGui::Button("Export CSV"))
+		NodeCostTracker::Get().WriteCsv(NODE_COST_CSV_FILE);
+	ImGui::SameLine();
+	ImGui::Text("average of %u frames", NODE_COST_AVERAGE_FRAMES);
+	ImGui::Separator();
+
+	ImGui::Text("%-6s %-14s %9s %9s %9s %9s", "Id", "Type", "Update", "Eval", "Render", "Total");
+	for (const auto& [id, cost] : NodeCostTracker::Get().GetHottest(NODE_COST_TOP_N))
+	{
+		ImGui::PushStyleColor(ImGuiCol_Text, GetHeatColor(NodeCostTracker::Get().GetHeat(id), 1.0f));
+		ImGui::Text("%-6i %-14s %9.4f %9.4f %9.4f %9.4f", id, std::string(magic_enum::enum_name(cost->Type)).c_str(),
+			cost->AverageMs[(size_t)NodeCostKind::Update], cost->AverageMs[(size_t)NodeCostKind::Eval],
+			cost->AverageMs[(size_t)NodeCostKind::Render], cost->GetTotalMs());
+		ImGui::PopStyleColor();
+
+		if (ImGui::IsItemClicked())
+		{
+			ImNodes::ClearNodeSelection();
+			ImNodes::SelectNode(id);
+		}
+	}
+	ImGui::Text("ms per frame, click to select the node");
+
+	ImGui::End();
+}
+
 void DebugInfo(ShaderToolApp* app)
 {
 	{
@@ -79,10 +218,18 @@ void DebugInfo(ShaderToolApp* app)
 		ImGuiIO& io = ImGui::GetIO();
 		ImGui::Text("MS/Frame: %.3f", 1000.0f / io.Framerate);
 		ImGui::Text("FPS:      %.1f", io.Framerate);
+		ImGui::Text("Time:     %.3f s (%s)", FrameClock::Get().GetTime(), std::string(magic_enum::enum_name(FrameClock::Get().GetMode())).c_str());
+		if (Journal::Get().IsRecording())
+			ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Recording: %llu frames, %llu edits (F6 stops)", Journal::Get().GetNumFrames(), Journal::Get().GetNumRecords());
 		ImGui::Separator();
 		ImGui::Text("UiNodes:  %i", app->GetUiNodes().size());
 		ImGui::Text("Nodes:    %i", app->GetGraph().GetNodesCount());
 		ImGui::Text("Edges:    %i", app->GetGraph().GetEdgesCount());
+		ImGui::Separator();
+		auto& constants = app->GetConstantUploadStats();
+		ImGui::Text("Constants uploaded: %llu bytes", constants.UploadedBytes);
+		ImGui::Text("Constants skipped:  %llu bytes", constants.SkippedBytes);
+		ImGui::Text("Root constants:     %llu bytes, %u root parameters", constants.RootConstantBytes, constants.NumRootParameters);
 		ImGui::End();
 	}
 
@@ -154,6 +301,7 @@ void DebugInfo(ShaderToolApp* app)
 						ImGui::Text("Id:      %i", drawNode->Id);
 						ImGui::Text("Shader:  %i %i", drawNode->ShaderPin, drawNode->ShaderNodeValue->Value);
 						ImGui::Text("Model:   %i %i", drawNode->ModelPin, drawNode->ModelNodeValue->Value);
+						ImGui::Text("Instances: %i %i", drawNode->InstancesPin, drawNode->InstancesNodeValue->Value);
 
 						for (auto& bindPin : drawNode->ShaderBindingPins)
 						{
@@ -197,7 +345,9 @@ void DebugInfo(ShaderToolApp* app)
 					ShowHoverDebugInfo([&]() {
 						ImGui::Text("PrimitiveNode");
 						ImGui::Text("Id:    %i", primNode->Id);
+						ImGui::Text("Shape: %s", magic_enum::enum_name(primNode->GetParams().Shape).data());
 						ImGui::Text("Model: %i %i", primNode->OutputPin, primNode->OutputNodeValue->Value);
+						ImGui::Text("Cache: %zu", PrimitiveCache::Get().GetNumEntries());
 					});
 				}
 				break;
@@ -345,6 +495,22 @@ void DebugInfo(ShaderToolApp* app)
 				}
 				break;
 
+				case UiNodeType::Instances:
+				{
+					auto uinode = static_cast<InstancesNode*>(node);
+					ShowHoverDebugInfo([&]() {
+						ImGui::Text("InstancesNode");
+						ImGui::Text("Id:         %i", uinode->Id);
+						ImGui::Text("Layout:     %s", magic_enum::enum_name(uinode->GetParams().Layout).data());
+						ImGui::Text("Instances:  %i", (int)uinode->GetInstances().size());
+						ImGui::Text("Offset:     %i %.3f %.3f %.3f", uinode->OffsetPin, uinode->OffsetNodeValue->Value.x, uinode->OffsetNodeValue->Value.y, uinode->OffsetNodeValue->Value.z);
+						ImGui::Text("Rotation:   %i %.3f %.3f %.3f", uinode->RotationPin, uinode->RotationNodeValue->Value.x, uinode->RotationNodeValue->Value.y, uinode->RotationNodeValue->Value.z);
+						ImGui::Text("Scale:      %i %.3f", uinode->ScalePin, uinode->ScaleNodeValue->Value);
+						ImGui::Text("Output:     %i %i", uinode->OutputPin, uinode->OutputNodeValue->Value);
+						});
+				}
+				break;
+
 				default:
 					break;
 				}
@@ -413,6 +579,18 @@ void DebugInfo(ShaderToolApp* app)
 	if (ImGui::IsKeyReleased(VK_F3))
 		showNodeValueDebug = !showNodeValueDebug;
 
+	if (ImGui::IsKeyReleased(VK_F4))
+		showProfiler = !showProfiler;
+
+	if (ImGui::IsKeyReleased(VK_F5))
+		NodeCostTracker::Get().SetEnabled(!NodeCostTracker::Get().IsEnabled());
+
+	if (NodeCostTracker::Get().IsEnabled())
+		NodeCostsWindow(app);
+
+	if (showProfiler)
+		ProfilerWindow();
+
 	if (showNodeValueDebug)
 	{
 		auto& nodes = app->GetGraph().GetNodes();
@@ -462,153 +640,198 @@ void DebugInfo(ShaderToolApp* app)
 
 void ShaderToolApp::EvaluateGraph()
 {
+	PROFILE_FUNCTION();
+
 	// MUST set the PSO every frame due to the FrameResource swapping
 	_CurrFrameResource->RenderTargetPSO = _RenderTargetPSO;
+	_ConstantUploadStats = ConstantUploadStats();
 
 	if (_RootNodeId == INVALID_ID)
 		return;
 
-	std::stack<int> postorder;
-	dfs_traverse(_Graph, _RootNodeId, [&postorder](const int nodeId) -> void { postorder.push(nodeId); });
+	EvaluateTransforms();
 
-	postOrderClone = postorder;
-	//LOG_TRACE("##############################");
+	postOrderClone = std::stack<int>();
+	for (auto it = _EvalPlan.Steps.rbegin(); it != _EvalPlan.Steps.rend(); ++it)
+		postOrderClone.push(it->NodeId);
 
-	//std::stack<float> valueStack;
-	while (!postorder.empty())
+	// the plan has the reachable nodes that aren't constant, dependencies first
+	for (const auto& step : _EvalPlan.Steps)
 	{
-		const int id = postorder.top();
-		postorder.pop();
-		Node& node = _Graph.GetNode(id);
-
-		switch (node.Type)
+		if (step.MergedWith != INVALID_ID)
 		{
-		case NodeType::Float:
-		case NodeType::Float2:
-		case NodeType::Float3:
-		case NodeType::Float4:
-		case NodeType::Float4x4:
-		case NodeType::Int:
-		{
-			// nothing happen at the moment
+			for (const auto& [pin, mergedPin] : step.MergedOutputs)
+				_Graph.GetNodeValue(pin)->SetValuePtr(_Graph.GetNodeValue(mergedPin)->GetValuePtr());
+			continue;
 		}
-		break;
 
-		case NodeType::Add:
-		{
-			static_cast<AddNode*>(_UINodeIdMap[id])->OnEval();
-		}
-		break;
+		// already evaluated by EvaluateTransforms
+		if (_Graph.GetNode(step.NodeId).Type == NodeType::Transform)
+			continue;
 
-		case NodeType::Multiply:
-		{
-			static_cast<MultiplyNode*>(_UINodeIdMap[id])->OnEval();
-		}
-		break;
+		EvaluateNode(step.NodeId);
+	}
+}
 
-		case NodeType::Sine:
-		{
-			static_cast<SineNode*>(_UINodeIdMap[id])->OnEval();
-		}
-		break;
+void ShaderToolApp::EvaluateNode(int id)
+{
+	Node& node = _Graph.GetNode(id);
+	NodeCostScope cost(_UINodeIdMap[id], NodeCostKind::Eval);
 
-		case NodeType::Time:
-		{
-			static_cast<TimeNode*>(_UINodeIdMap[id])->OnEval();
-		}
-		break;
-		
-		case NodeType::RenderTarget:
-		{
-			//calling it here although RenderTarget is not part of the graph search anymore...
-			static_cast<RenderTargetNode*>(_UINodeIdMap[id])->OnEval();
-		}
-		break;
-		
-		case NodeType::Draw:
+	switch (node.Type)
+	{
+	case NodeType::Add:
+	{
+		static_cast<AddNode*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
+
+	case NodeType::Multiply:
+	{
+		static_cast<MultiplyNode*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
+
+	case NodeType::Sine:
+	{
+		static_cast<SineNode*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
+
+	case NodeType::Time:
+	{
+		static_cast<TimeNode*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
+	
+	case NodeType::RenderTarget:
+	{
+		//calling it here although RenderTarget is not part of the graph search anymore...
+		static_cast<RenderTargetNode*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
+	
+	case NodeType::Draw:
+	{
+		auto drawNode = static_cast<DrawNode*>(_UINodeIdMap[id]);
+		drawNode->OnEval();
+
+		// null render sink, the command line runner only measures the graph
+		if (!_IsHeadless)
 		{
-			auto drawNode = static_cast<DrawNode*>(_UINodeIdMap[id]);
-			drawNode->OnEval();
+			cost.Stop(); // counted as Render
 			RenderToTexture(drawNode);
 		}
-		break;
+	}
+	break;
 
-		case NodeType::Primitive:
-		{
-			static_cast<PrimitiveNode*>(_UINodeIdMap[id])->OnEval();
-		}
-		break;
+	case NodeType::Primitive:
+	{
+		static_cast<PrimitiveNode*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
 
-		case NodeType::Shader:
-		{
-			static_cast<ShaderNode*>(_UINodeIdMap[id])->OnEval();
-		}
-		break;
+	case NodeType::Shader:
+	{
+		static_cast<ShaderNode*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
 
-		case NodeType::Color:
-		{
-			static_cast<ColorNode*>(_UINodeIdMap[id])->OnEval();
-		}
-		break;
-		
-		case NodeType::Camera:
-		{
-			static_cast<CameraNode*>(_UINodeIdMap[id])->OnEval();
-		}
-		break;
+	case NodeType::Color:
+	{
+		static_cast<ColorNode*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
+	
+	case NodeType::Camera:
+	{
+		static_cast<CameraNode*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
 
-		case NodeType::Scalar:
-		{
-			static_cast<ScalarNode*>(_UINodeIdMap[id])->OnEval();
-		}
-		break;
+	case NodeType::Scalar:
+	{
+		static_cast<ScalarNode*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
 
-		case NodeType::Vector4:
-		{
-			static_cast<Vector4Node*>(_UINodeIdMap[id])->OnEval();
-		}
-		break;
+	case NodeType::Vector4:
+	{
+		static_cast<Vector4Node*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
 
-		case NodeType::Vector3:
-		{
-			static_cast<Vector3Node*>(_UINodeIdMap[id])->OnEval();
-		}
-		break;
+	case NodeType::Vector3:
+	{
+		static_cast<Vector3Node*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
 
-		case NodeType::Vector2:
-		{
-			static_cast<Vector2Node*>(_UINodeIdMap[id])->OnEval();
-		}
-		break;
+	case NodeType::Vector2:
+	{
+		static_cast<Vector2Node*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
 
-		case NodeType::Matrix4x4:
-		{
-			static_cast<Matrix4x4Node*>(_UINodeIdMap[id])->OnEval();
-		}
-		break;
+	case NodeType::Matrix4x4:
+	{
+		static_cast<Matrix4x4Node*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
 
-		case NodeType::Model:
-		{
-			static_cast<ModelNode*>(_UINodeIdMap[id])->OnEval();
-		}
-		break;
+	case NodeType::Model:
+	{
+		static_cast<ModelNode*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
 
-		case NodeType::Texture:
-		{
-			static_cast<TextureNode*>(_UINodeIdMap[id])->OnEval();
-		}
-		break;
+	case NodeType::Texture:
+	{
+		static_cast<TextureNode*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
 
-		case NodeType::Transform:
-		{
-			static_cast<TransformNode*>(_UINodeIdMap[id])->OnEval();
-		}
+	case NodeType::Transform:
+	{
+		// only the folded ones, the others are evaluated by EvaluateTransforms
+		static_cast<TransformNode*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
+
+	case NodeType::Instances:
+	{
+		static_cast<InstancesNode*>(_UINodeIdMap[id])->OnEval();
+	}
+	break;
+
+	default:
+		LOG_WARN("NodeType {0} not handled", node.Type);
 		break;
+	}
+}
 
-		default:
-			LOG_WARN("NodeType {0} not handled", node.Type);
-			break;
-		}
+void ShaderToolApp::EvaluateTransforms()
+{
+	PROFILE_FUNCTION();
+
+	// The inputs of the transform nodes are copied from their links in OnUpdate, before the
+	// evaluation, so all of them can be evaluated up front instead of one by one in the plan order.
+	_TransformBatch.Clear();
+	for (auto node : _BatchedTransforms)
+		_TransformBatch.Add(node->PositionNodeValue->Value, node->RotationNodeValue->Value, node->ScaleNodeValue->Value);
+
+	const uint64_t startCycles = NodeCostTracker::Get().IsEnabled() ? __rdtsc() : 0;
+	_TransformBatch.Evaluate();
+
+	for (size_t i = 0; i < _BatchedTransforms.size(); ++i)
+		_BatchedTransforms[i]->OutputNodeValue->Value = _TransformBatch.GetWorld(i);
+
+	// the batch is shared evenly by its nodes
+	if (startCycles != 0 && !_BatchedTransforms.empty())
+	{
+		const uint64_t cycles = (__rdtsc() - startCycles) / _BatchedTransforms.size();
+		for (auto node : _BatchedTransforms)
+			NodeCostTracker::Get().Add(node, NodeCostKind::Eval, cycles);
 	}
 }
 
@@ -627,7 +850,13 @@ void ShaderToolApp::BuildRenderTargetRootSignature(const std::string& shaderName
 		case D3D_SIT_CBUFFER:
 		{
 			RootParameterConstants* rootParConstants = (RootParameterConstants*)rp.get();
-			if (rootParConstants)
+			if (rp->ParameterType == D3D12_ROOT_PARAMETER_TYPE_CBV)
+			{
+				// spilled, the data is in the frame constants
+				RootParameterConstantBufferView* rootParCbv = (RootParameterConstantBufferView*)rp.get();
+				slotRootParameter[rp->Index].InitAsConstantBufferView(rootParCbv->BindPoint);
+			}
+			else if (rootParConstants)
 			{
 				slotRootParameter[rp->Index].InitAsConstants(rootParConstants->Num32BitValues, rootParConstants->BindPoint);
 			}
@@ -693,16 +922,11 @@ void ShaderToolApp::BuildRenderTargetRootSignature(const std::string& shaderName
 			IID_PPV_ARGS(_RenderTargetRootSignature.GetAddressOf())));
 }
 
-void ShaderToolApp::CreateRenderTargetPSO(int shaderIndex)
+void ShaderToolApp::CreateRenderTargetPSO(int shaderIndex, bool instanced)
 {
-	LOG_INFO("ShaderToolApp::CreateRenderTargetPSO [{0}]", shaderIndex);
+	LOG_INFO("ShaderToolApp::CreateRenderTargetPSO [{0}]{1}", shaderIndex, instanced ? " instanced" : "");
 
-	_InputLayout = {
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 36, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-	};
+	_InputLayout = VertexFormats::CreateInputLayout(AssetManager::Get().GetVertexFormat(), instanced);
 	D3D12_INPUT_LAYOUT_DESC inputLayout = { _InputLayout.data(), (UINT)_InputLayout.size() };
 
 	auto shaderName = shaderIndex == NOT_LINKED ? DEFAULT_SHADER : ShaderManager::Get()->GetShaderName((size_t)shaderIndex);
@@ -720,6 +944,7 @@ void ShaderToolApp::CreateRenderTargetPSO(int shaderIndex)
 }
 
 static int PreviousShaderIndexRT = INVALID_INDEX;
+static bool PreviousInstancedRT = false;
 
 
 void ShaderToolApp::LoadSrvTexture(int textureIndex)
@@ -741,6 +966,7 @@ void ShaderToolApp::LoadSrvTexture(int textureIndex)
 
 	//auto tex = std::make_shared<Texture>();
 	tex->Path = AssetManager::Get().GetTexturePath(textureIndex);
+	tex->LoadedPath = AssetManager::Get().GetTexture(textureIndex)->LoadedPath; // imported when the node loaded it
 	tex->Name = ExtractFilename(tex->Path);
 	tex->SrvCpuDescHandle = texCpuDescHandle; // TODO: the descHandle has to be handled properly, now it's fixed
 	tex->SrvGpuDescHandle = texGpuDescHandle; // TODO: the descHandle has to be handled properly, now it's fixed
@@ -749,9 +975,9 @@ void ShaderToolApp::LoadSrvTexture(int textureIndex)
 		CreateDDSTextureFromFile12(
 			_Device.Get(),
 			_CommandList.Get(),
-			AnsiToWString(tex->Path).c_str(),
+			AnsiToWString(tex->LoadedPath).c_str(),
 			tex->Resource,
-			tex->UploadHeap));
+			*_UploadRing));
 
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
@@ -764,23 +990,110 @@ void ShaderToolApp::LoadSrvTexture(int textureIndex)
 	_Device->CreateShaderResourceView(tex->Resource.Get(), &srvDesc, tex->SrvCpuDescHandle);
 }
 
+struct DrawCamera
+{
+	XMMATRIX World;
+	XMMATRIX WorldView;
+	XMMATRIX Projection;
+	XMMATRIX WorldViewProj;
+	XMVECTOR Eye; // model space
+};
+
+// World/View/Proj bound to the draw node, the matrices are stored transposed for HLSL
+static bool GetDrawCamera(DrawNode* drawNode, DrawCamera& camera)
+{
+	auto& pins = drawNode->ShaderBindingPinNameMap;
+	auto world = pins.find(WORLD_MATRIX_VAR);
+	auto view = pins.find(VIEW_MATRIX_VAR);
+	auto projection = pins.find(PROJECTION_MATRIX_VAR);
+	if (world == pins.end() || view == pins.end() || projection == pins.end())
+		return false;
+
+	for (size_t pinIndex : { world->second, view->second, projection->second })
+	{
+		const auto& pin = drawNode->ShaderBindingPins[pinIndex];
+		if (pin.Bind.VarTypeName != "float4x4" || !pin.Data)
+			return false;
+	}
+
+	auto loadMatrix = [drawNode](size_t pinIndex)
+	{
+		return XMMatrixTranspose(XMLoadFloat4x4((XMFLOAT4X4*)drawNode->ShaderBindingPins[pinIndex].Data));
+	};
+
+	camera.World = loadMatrix(world->second);
+	camera.WorldView = XMMatrixMultiply(camera.World, loadMatrix(view->second));
+	camera.Projection = loadMatrix(projection->second);
+	camera.WorldViewProj = XMMatrixMultiply(camera.WorldView, camera.Projection);
+
+	XMVECTOR determinant;
+	const XMMATRIX invWorldView = XMMatrixInverse(&determinant, camera.WorldView);
+	if (XMVectorGetX(determinant) == 0.f)
+		return false;
+
+	camera.Eye = invWorldView.r[3];
+	return true;
+}
+
+// Projected radius of the bounding sphere as a fraction of the viewport height, the LOD
+// changes each time it halves
+static UINT SelectLod(const Model& model, const DrawCamera& camera)
+{
+	const float depth = XMVectorGetZ(XMVector3Transform(XMLoadFloat3(&model.Sphere.Center), camera.WorldView));
+	if (depth <= 0.f)
+		return 0; // the camera is inside the bounds
+
+	const float worldScale = std::max(
+		XMVectorGetX(XMVector3Length(camera.World.r[0])),
+		std::max(XMVectorGetX(XMVector3Length(camera.World.r[1])), XMVectorGetX(XMVector3Length(camera.World.r[2]))));
+
+	const float screenSize = model.Sphere.Radius * worldScale * XMVectorGetY(camera.Projection.r[1]) / depth;
+
+	UINT lod = 0;
+	float threshold = LOD_SCREEN_SIZE;
+	while (lod + 1 < model.NumLods && screenSize < threshold)
+	{
+		++lod;
+		threshold *= 0.5f;
+	}
+	return lod;
+}
+
 void ShaderToolApp::RenderToTexture(DrawNode* drawNode)
 {
+	PROFILE_FUNCTION();
+	NodeCostScope cost(drawNode, NodeCostKind::Render);
+
 	ClearRenderTexture();
 
 	if (drawNode->OutputNodeValue->Value == INVALID_INDEX) return; // NOT READY
 
 	int currentModel = drawNode->ModelNodeValue->Value;
 	if (currentModel == INVALID_INDEX) return; // no model linked
+	if (AssetManager::Get().GetModel(currentModel).IndexCount == 0) return; // model unloaded
 
 	int currentShaderIndex = drawNode->ShaderNodeValue->Value;
 	if (currentShaderIndex == INVALID_INDEX) return; // no shader linked
 
-	// recreate PSO when shader has changed
-	if(PreviousShaderIndexRT != currentShaderIndex)
+	// the instances are read from a second vertex stream
+	InstancesNode* instancesNode = nullptr;
+	if (drawNode->IsInstanced())
 	{
-		CreateRenderTargetPSO(currentShaderIndex);
+		auto it = _UINodeIdMap.find(drawNode->InstancesNodeValue->Value);
+		if (it == _UINodeIdMap.end() || it->second->Type != UiNodeType::Instances)
+			return;
+
+		instancesNode = static_cast<InstancesNode*>(it->second);
+		if (instancesNode->GetInstances().empty())
+			return;
+	}
+
+	// recreate PSO when shader or input layout has changed
+	if(PreviousShaderIndexRT != currentShaderIndex || PreviousInstancedRT != drawNode->IsInstanced())
+	{
+		CreateRenderTargetPSO(currentShaderIndex, drawNode->IsInstanced());
 		PreviousShaderIndexRT = currentShaderIndex;
+		PreviousInstancedRT = drawNode->IsInstanced();
 	}
 	
 	_CommandList->ResourceBarrier(
@@ -797,15 +1110,24 @@ void ShaderToolApp::RenderToTexture(DrawNode* drawNode)
 	_CommandList->ClearRenderTargetView(_RenderTarget->RTV(), _RenderTarget->GetClearColor(), 0, nullptr);
 	_CommandList->OMSetRenderTargets(1, &_RenderTarget->RTV(), true, nullptr);
 
+	auto shader = ShaderManager::Get()->GetShader((size_t)currentShaderIndex);
+	drawNode->SyncShaderBindings(currentShaderIndex);
+
+	// the values are staged and each cbuffer is bound once they're all known
+	if (!drawNode->Constants)
+		drawNode->Constants = std::make_unique<ConstantStaging>(_Device.Get(), *_UploadRing);
+	if (drawNode->Constants->GetShaderIndex() != currentShaderIndex)
+		drawNode->Constants->SetShader(currentShaderIndex, *shader);
+
+	auto& rootParameters = shader->GetRootParameters();
 	for (auto& var : drawNode->ShaderBindingPins)
 	{
+		if (var.Bind.RootParameterIndex >= rootParameters.size())
+			continue; // not in the shader anymore
+
 		if (var.Bind.BindType == D3D_SIT_CBUFFER)
 		{
-			_CommandList->SetGraphicsRoot32BitConstants(
-				var.Bind.RootParameterIndex, 
-				var.Bind.VarNum32BitValues, 
-				var.Data, 
-				var.Bind.VarNum32BitValuesOffset);
+			drawNode->Constants->Stage(var.Bind, var.Data);
 		}
 		else if(var.Bind.BindType == D3D_SIT_TEXTURE)
 		{
@@ -835,17 +1157,86 @@ void ShaderToolApp::RenderToTexture(DrawNode* drawNode)
 
 	{
 		auto& selectedModel = AssetManager::Get().GetModel(currentModel);
+
+		// packed positions are relative to the bounds of the model
+		for (auto& var : shader->GetBindingVars())
+		{
+			if (var.BindName != VERTEX_QUANTIZATION_CBUFFER)
+				continue;
+
+			const auto& quantization = selectedModel.Quantization;
+			const XMFLOAT4 value = var.VarName == "QuantizationMin"
+				? XMFLOAT4(quantization.Min.x, quantization.Min.y, quantization.Min.z, 0.f)
+				: XMFLOAT4(quantization.Extent.x, quantization.Extent.y, quantization.Extent.z, 0.f);
+
+			drawNode->Constants->Stage(var, &value);
+		}
+
+		drawNode->Constants->Bind(_CommandList.Get(), _ConstantUploadStats);
 		
 		_CommandList->IASetVertexBuffers(0, 1, &selectedModel.VertexBufferView);
 		_CommandList->IASetIndexBuffer(&selectedModel.IndexBufferView);
 		_CommandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-		_CommandList->DrawIndexedInstanced(
-			selectedModel.IndexCount,
-			1,
-			selectedModel.StartIndexLocation,
-			selectedModel.BaseVertexLocation,
-			0);
+		DrawCamera camera;
+		if (instancesNode)
+		{
+			// every instance in a single draw, the model bounds and LODs only apply to World.
+			// The matrices are only uploaded again when the node has generated new ones.
+			const auto& instances = instancesNode->GetInstances();
+			if (!instancesNode->Buffer)
+				instancesNode->Buffer = std::make_unique<InstanceBuffer>(_Device.Get(), *_UploadRing);
+			instancesNode->Buffer->Update(_CommandList.Get(), instances.data(), (UINT)instances.size(), instancesNode->GetVersion());
+
+			const D3D12_VERTEX_BUFFER_VIEW instancesView = instancesNode->Buffer->View();
+			_CommandList->IASetVertexBuffers(VertexFormats::INSTANCE_SLOT, 1, &instancesView);
+
+			_CommandList->DrawIndexedInstanced(
+				selectedModel.IndexCount,
+				instancesNode->Buffer->GetCount(),
+				selectedModel.StartIndexLocation,
+				selectedModel.BaseVertexLocation,
+				0);
+		}
+		else if (GetDrawCamera(drawNode, camera))
+		{
+			// the whole model is skipped when its bounds are outside the frustum
+			const bool visible = Frustum(camera.WorldViewProj).IntersectsSphere(
+				XMLoadFloat3(&selectedModel.Sphere.Center), selectedModel.Sphere.Radius);
+
+			const UINT lod = visible ? SelectLod(selectedModel, camera) : 0;
+			if (visible && lod == 0 && selectedModel.Meshlets)
+			{
+				// only the meshlets inside the frustum and facing the camera
+				for (auto& range : Meshlets::Cull(*selectedModel.Meshlets, camera.WorldViewProj, camera.Eye))
+				{
+					_CommandList->DrawIndexedInstanced(
+						range.IndexCount,
+						1,
+						selectedModel.StartIndexLocation + range.IndexOffset,
+						selectedModel.BaseVertexLocation,
+						0);
+				}
+			}
+			else if (visible)
+			{
+				_CommandList->DrawIndexedInstanced(
+					selectedModel.Lods[lod].IndexCount,
+					1,
+					selectedModel.StartIndexLocation + selectedModel.Lods[lod].IndexOffset,
+					selectedModel.BaseVertexLocation,
+					0);
+			}
+		}
+		else
+		{
+			_CommandList->DrawIndexedInstanced(
+				selectedModel.IndexCount,
+				1,
+				selectedModel.StartIndexLocation,
+				selectedModel.BaseVertexLocation,
+				0);
+		}
 	}
 
 	_CommandList->ResourceBarrier(
@@ -880,6 +1271,30 @@ void ShaderToolApp::ClearRenderTexture()
 			D3D12_RESOURCE_STATE_GENERIC_READ));
 }
 
+// Items of the Add Node popup
+static const std::pair<const char*, UiNodeType> ADD_NODE_MENU[] =
+{
+	{ "Render Target", UiNodeType::RenderTarget },
+	{ "Draw", UiNodeType::Draw },
+	{ "Shader", UiNodeType::Shader },
+	{ "Camera", UiNodeType::Camera },
+	{ "Transform", UiNodeType::Transform },
+	{ "Instances", UiNodeType::Instances },
+	{ "Primitive", UiNodeType::Primitive },
+	{ "Model", UiNodeType::Model },
+	{ "Texture", UiNodeType::Texture },
+	{ "Color", UiNodeType::Color },
+	{ "Time", UiNodeType::Time },
+	{ "Add", UiNodeType::Add },
+	{ "Multiply", UiNodeType::Multiply },
+	{ "Sine", UiNodeType::Sine },
+	{ "Scalar", UiNodeType::Scalar },
+	{ "Vector4", UiNodeType::Vector4 },
+	{ "Vector3", UiNodeType::Vector3 },
+	{ "Vector2", UiNodeType::Vector2 },
+	{ "Matrix4x4", UiNodeType::Matrix4x4 },
+};
+
 void ShaderToolApp::HandleNewNodes()
 {
 	// Handle new nodes
@@ -900,150 +1315,15 @@ void ShaderToolApp::HandleNewNodes()
 		{
 			const ImVec2 click_pos = ImGui::GetMousePosOnOpeningCurrentPopup();
 
-			if (ImGui::MenuItem("Render Target"))
-			{
-				auto node = std::make_unique<RenderTargetNode>(&_Graph, _RenderTarget.get());
-				node->OnCreate();
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
-			}
-			else if (ImGui::MenuItem("Draw") && _RootNodeId == INVALID_ID)
-			{
-				auto node = std::make_unique<DrawNode>(&_Graph);
-				node->OnCreate();
-				_RootNodeId = node->Id;
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
-			}
-			else if (ImGui::MenuItem("Shader"))
-			{
-				auto node = std::make_unique<ShaderNode>(&_Graph);
-				node->OnCreate();
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
-			}
-			else if (ImGui::MenuItem("Camera"))
-			{
-				auto node = std::make_unique<CameraNode>(&_Graph);
-				node->OnCreate();
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
-			}
-			else if (ImGui::MenuItem("Transform"))
+			for (const auto& [label, type] : ADD_NODE_MENU)
 			{
-				auto node = std::make_unique<TransformNode>(&_Graph);
-				node->OnCreate();
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
-			}
-			else if (ImGui::MenuItem("Primitive"))
-			{
-				auto node = std::make_unique<PrimitiveNode>(&_Graph, _Primitives);
-				node->OnCreate();
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
-			}
-			else if (ImGui::MenuItem("Model"))
-			{
-				auto node = std::make_unique<ModelNode>(&_Graph);
-				node->OnCreate();
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
-			}
-			else if (ImGui::MenuItem("Texture"))
-			{
-				auto node = std::make_unique<TextureNode>(&_Graph);
-				node->OnCreate();
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
-			}
-			else if (ImGui::MenuItem("Color"))
-			{
-				auto node = std::make_unique<ColorNode>(&_Graph);
-				node->OnCreate();
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
-			}
-			else if (ImGui::MenuItem("Time"))
-			{
-				auto node = std::make_unique<TimeNode>(&_Graph);
-				node->OnCreate();
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
-			}
-			else if (ImGui::MenuItem("Add"))
-			{
-				auto node = std::make_unique<AddNode>(&_Graph);
-				node->OnCreate();
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
-			}
-			else if (ImGui::MenuItem("Multiply"))
-			{
-				auto node = std::make_unique<MultiplyNode>(&_Graph);
-				node->OnCreate();
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
-			}
-			else if (ImGui::MenuItem("Sine"))
-			{
-				auto node = std::make_unique<SineNode>(&_Graph);
-				node->OnCreate();
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
-			}
-			else if (ImGui::MenuItem("Scalar"))
-			{
-				auto node = std::make_unique<ScalarNode>(&_Graph);
-				node->OnCreate();
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
-			}
-			else if (ImGui::MenuItem("Vector4"))
-			{
-				auto node = std::make_unique<Vector4Node>(&_Graph);
-				node->OnCreate();
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
-			}
-			else if (ImGui::MenuItem("Vector3"))
-			{
-				auto node = std::make_unique<Vector3Node>(&_Graph);
-				node->OnCreate();
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
-			}
-			else if (ImGui::MenuItem("Vector2"))
-			{
-				auto node = std::make_unique<Vector2Node>(&_Graph);
-				node->OnCreate();
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
-			}
-			else if (ImGui::MenuItem("Matrix4x4"))
-			{
-				auto node = std::make_unique<Matrix4x4Node>(&_Graph);
-				node->OnCreate();
-				ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
-				_UINodeIdMap[node->Id] = node.get();
-				_UINodes.push_back(std::move(node));
+				// only one draw node, the root of the graph
+				if (ImGui::MenuItem(label) && (type != UiNodeType::Draw || _RootNodeId == INVALID_ID))
+				{
+					UiNode* node = CreateUiNode(type);
+					ImNodes::SetNodeScreenSpacePos(node->Id, click_pos);
+					break;
+				}
 			}
 			
 			ImGui::EndPopup();
@@ -1088,7 +1368,8 @@ void ShaderToolApp::HandleNewLinks()
 		{
 			std::swap(start_attr, end_attr);
 		}
-		_Graph.CreateEdge(start_attr, end_attr, EdgeType::External);
+		const int edge_id = _Graph.CreateEdge(start_attr, end_attr, EdgeType::External);
+		Journal::Get().RecordCreateLink(start_attr, end_attr, edge_id);
 	}
 }
 
@@ -1099,6 +1380,7 @@ void ShaderToolApp::HandleDeletedLinks()
 	{
 		LOG_WARN("link destroyed {0}", link_id);
 		_Graph.EraseEdge(link_id);
+		Journal::Get().RecordDeleteLink(link_id);
 	}
 	
 	const int num_selected = ImNodes::NumSelectedLinks();
@@ -1110,6 +1392,7 @@ void ShaderToolApp::HandleDeletedLinks()
 		for (const int edge_id : selected_links)
 		{
 			_Graph.EraseEdge(edge_id);
+			Journal::Get().RecordDeleteLink(edge_id);
 		}
 	}
 }
@@ -1124,33 +1407,136 @@ void ShaderToolApp::HandleDeletedNodes()
 		ImNodes::GetSelectedNodes(selected_nodes.data());
 		for (const int node_id : selected_nodes)
 		{
-			for (auto it = _UINodes.begin(); it != _UINodes.end(); ++it)
-			{
-				auto node = (*it).get();
-				if (node->Id == node_id)
-				{
-					if (_RootNodeId == node_id) _RootNodeId = INVALID_ID;
+			DeleteUiNode(node_id);
+		}
+	}
+}
 
-					node->OnDelete();
-					_UINodeIdMap.erase(node_id);
-					_UINodes.erase(it);
-					break;
-				}
-			}
+// TODO: could be implemented using the pattern described in the links below... for now I'll use a switch
+// https://isocpp.org/wiki/faq/serialization#serialize-inherit-no-ptrs
+// https://stackoverflow.com/questions/3268801/how-do-you-de-serialize-a-derived-class-from-serialized-data
+std::unique_ptr<UiNode> ShaderToolApp::MakeUiNode(UiNodeType type)
+{
+	switch (type)
+	{
+	case UiNodeType::Add: return std::make_unique<AddNode>(&_Graph);
+	case UiNodeType::Multiply: return std::make_unique<MultiplyNode>(&_Graph);
+	case UiNodeType::Draw: return std::make_unique<DrawNode>(&_Graph);
+	case UiNodeType::Sine: return std::make_unique<SineNode>(&_Graph);
+	case UiNodeType::Primitive: return std::make_unique<PrimitiveNode>(&_Graph);
+	case UiNodeType::Model: return std::make_unique<ModelNode>(&_Graph);
+	case UiNodeType::Texture: return std::make_unique<TextureNode>(&_Graph);
+	case UiNodeType::RenderTarget: return std::make_unique<RenderTargetNode>(&_Graph, _RenderTarget.get());
+	case UiNodeType::Time: return std::make_unique<TimeNode>(&_Graph);
+	case UiNodeType::Shader: return std::make_unique<ShaderNode>(&_Graph);
+	case UiNodeType::Color: return std::make_unique<ColorNode>(&_Graph);
+	case UiNodeType::Camera: return std::make_unique<CameraNode>(&_Graph);
+	case UiNodeType::Scalar: return std::make_unique<ScalarNode>(&_Graph);
+	case UiNodeType::Vector4: return std::make_unique<Vector4Node>(&_Graph);
+	case UiNodeType::Vector3: return std::make_unique<Vector3Node>(&_Graph);
+	case UiNodeType::Vector2: return std::make_unique<Vector2Node>(&_Graph);
+	case UiNodeType::Matrix4x4: return std::make_unique<Matrix4x4Node>(&_Graph);
+	case UiNodeType::Transform: return std::make_unique<TransformNode>(&_Graph);
+	case UiNodeType::Instances: return std::make_unique<InstancesNode>(&_Graph);
+	default: return nullptr;
+	}
+}
+
+// new node from the Add Node popup or a journal replay
+UiNode* ShaderToolApp::CreateUiNode(UiNodeType type)
+{
+	auto node = MakeUiNode(type);
+	if (!node)
+		return nullptr;
+
+	node->OnCreate();
+	if (type == UiNodeType::Draw)
+		_RootNodeId = node->Id;
+
+	Journal::Get().RecordCreateNode(type, node->Id);
+
+	UiNode* uiNode = node.get();
+	_UINodeIdMap[node->Id] = uiNode;
+	_UINodes.push_back(std::move(node));
+	return uiNode;
+}
+
+void ShaderToolApp::DeleteUiNode(NodeId id)
+{
+	for (auto it = _UINodes.begin(); it != _UINodes.end(); ++it)
+	{
+		auto node = (*it).get();
+		if (node->Id == id)
+		{
+			if (_RootNodeId == id) _RootNodeId = INVALID_ID;
+
+			Journal::Get().RecordDeleteNode(id);
+
+			node->OnDelete();
+			NodeCostTracker::Get().Remove(id);
+			_UINodeIdMap.erase(id);
+			_UINodes.erase(it);
+			break;
 		}
 	}
 }
 
 void ShaderToolApp::UpdateNodeGraph()
 {
+	PROFILE_FUNCTION();
+
+	NodeCostTracker::Get().BeginFrame();
 	EVENT_MANAGER.NotifyQueuedEvents();
 
+	// The folded values and the merged nodes depend on the values typed in the nodes, so the plan is
+	// also rebuilt while a widget is being edited and in the frame it's released.
+	const GraphStructure structure = GraphOptimizer::GetStructure(_Graph, _RootNodeId);
+	const bool isEditingValues = _IsHeadless ? _ValuesReplayed : ImGui::IsAnyItemActive();
+	_ValuesReplayed = false;
+	if (structure != _EvalPlanStructure || isEditingValues || _WasEditingValues)
+		BuildEvaluationPlan(structure != _EvalPlanStructure);
+	_EvalPlanStructure = structure;
+	_WasEditingValues = isEditingValues;
+
+	// the nodes that don't reach the root and the folded ones are not updated
 	for (auto& node : _UINodes)
-		node->OnUpdate();
+	{
+		if (_EvalPlan.Updated.count(node->Id) > 0)
+		{
+			NodeCostScope cost(node.get(), NodeCostKind::Update);
+			node->OnUpdate();
+		}
+	}
+}
+
+void ShaderToolApp::BuildEvaluationPlan(bool structureChanged)
+{
+	_EvalPlan = GraphOptimizer::Optimize(_Graph, _RootNodeId, [this](int id)
+	{
+		_UINodeIdMap[id]->OnUpdate();
+		EvaluateNode(id);
+	});
+
+	_BatchedTransforms.clear();
+	for (const auto& step : _EvalPlan.Steps)
+	{
+		if (step.MergedWith == INVALID_ID && _Graph.GetNode(step.NodeId).Type == NodeType::Transform)
+			_BatchedTransforms.push_back(static_cast<TransformNode*>(_UINodeIdMap[step.NodeId]));
+	}
+
+	if (structureChanged && _RootNodeId != INVALID_ID)
+	{
+		LOG_TRACE("Evaluation plan: {0} nodes, {1} updated ({2} before), {3} evaluated ({4} before), {5} folded, {6} merged",
+			_UINodes.size(), _EvalPlan.Updated.size(), _UINodes.size(),
+			_EvalPlan.Steps.size() - _EvalPlan.NumMerged, _EvalPlan.NumTraversed,
+			_EvalPlan.Folded.size(), _EvalPlan.NumMerged);
+	}
 }
 
 void ShaderToolApp::RenderNodeGraph()
 {
+	PROFILE_FUNCTION();
+
 	// The node editor window
 	ImGui::Begin("Shader Editor");
 	ImGui::Columns(1);
@@ -1158,10 +1544,42 @@ void ShaderToolApp::RenderNodeGraph()
 
 	HandleNewNodes();
 
-	// RENDER UI NODES
+	// the values edited by the widgets are found by comparing them before and after the nodes are drawn
+	const bool isRecording = Journal::Get().IsRecording();
+	if (isRecording)
+	{
+		SnapshotPinValues();
+		SnapshotNodeStates();
+	}
+
+	// RENDER UI NODES, the title bars show the cost of the nodes while it's measured
+	const bool showCosts = NodeCostTracker::Get().IsEnabled();
 	for (const auto& node : _UINodes)
+	{
+		if (showCosts)
+		{
+			const float heat = NodeCostTracker::Get().GetHeat(node->Id);
+			ImNodes::PushColorStyle(ImNodesCol_TitleBar, GetHeatColor(heat, 0.6f));
+			ImNodes::PushColorStyle(ImNodesCol_TitleBarHovered, GetHeatColor(heat, 0.8f));
+			ImNodes::PushColorStyle(ImNodesCol_TitleBarSelected, GetHeatColor(heat, 0.8f));
+		}
+
 		node->OnRender();
 
+		if (showCosts)
+		{
+			ImNodes::PopColorStyle();
+			ImNodes::PopColorStyle();
+			ImNodes::PopColorStyle();
+		}
+	}
+
+	if (isRecording)
+	{
+		RecordEditedPinValues();
+		RecordEditedNodeStates();
+	}
+
 	for (const auto& edge : _Graph.GetEdges())
 	{
 		// If edge doesn't start at value, then it's an internal edge, i.e.
@@ -1192,232 +1610,298 @@ void ShaderToolApp::RenderNodeGraph()
 	if (ImGui::IsKeyReleased(VK_N))
 		Reset();
 
+	if (ImGui::IsKeyReleased(VK_G))
+		GenerateShaderVariant();
+
+	// last, the edits of this frame were made before the project is written to the journal
+	if (ImGui::IsKeyReleased(VK_F6))
+		ToggleJournalRecording();
+
 	ImGui::End();
 }
 
-void ShaderToolApp::Save()
+void ShaderToolApp::ToggleJournalRecording()
 {
-	// Save the internal imnodes state
-	ImNodes::SaveCurrentEditorStateToIniFile("node_graph.ini");
-	std::ofstream fout("node_graph.txt", std::ios_base::out | std::ios_base::trunc);
+	if (Journal::Get().IsRecording())
+	{
+		Journal::Get().StopRecording();
+		return;
+	}
 
-	fout << "#shaders\n";
-	ShaderManager::Get()->Serialize(fout);
-	
-	fout << "#assets\n";
-	AssetManager::Get().Serialize(fout);
+	// the values as they are, not rounded to the 6 digits of the saved projects
+	std::ostringstream project;
+	project << std::setprecision(std::numeric_limits<float>::max_digits10);
+	SerializeProject(project);
+	Journal::Get().StartRecording(JOURNAL_FILE, project.str());
+}
 
-	fout << "#graph\n";
-	fout << _Graph;
+void ShaderToolApp::SnapshotPinValues()
+{
+	_PinValues.clear();
+	_PinValueBytes.clear();
+	for (const auto& [pin, value] : _Graph.GetNodeValues())
+	{
+		if (!value)
+			continue;
 
-	fout << "#ui_nodes\n";
-	fout << _RootNodeId << "\n";
-	fout << _UINodes.size() << "\n";
-	for (auto& uin : _UINodes)
-		fout << *uin.get() << "\n";
+		const auto bytes = static_cast<const uint8_t*>(value->GetValuePtr());
+		_PinValues.push_back({ pin, _PinValueBytes.size(), value->GetValueSize() });
+		_PinValueBytes.insert(_PinValueBytes.end(), bytes, bytes + value->GetValueSize());
+	}
+}
+
+void ShaderToolApp::RecordEditedPinValues()
+{
+	const auto& values = _Graph.GetNodeValues();
+	for (const auto& pinValue : _PinValues)
+	{
+		auto it = values.find(pinValue.Pin);
+		if (it == values.end() || !it->second || it->second->GetValueSize() != pinValue.Size)
+			continue;
+
+		const void* value = it->second->GetValuePtr();
+		if (std::memcmp(value, _PinValueBytes.data() + pinValue.Offset, pinValue.Size) != 0)
+			Journal::Get().RecordSetValue(pinValue.Pin, value, pinValue.Size);
+	}
+}
+
+void ShaderToolApp::SnapshotNodeStates()
+{
+	_NodeStates.clear();
+	for (const auto& node : _UINodes)
+		_NodeStates.push_back({ node->Id, node->GetState() });
+}
+
+// after the pin values, a file opened in the same frame was recorded before and is loaded first when replayed
+void ShaderToolApp::RecordEditedNodeStates()
+{
+	for (const auto& [id, state] : _NodeStates)
+	{
+		auto it = _UINodeIdMap.find(id);
+		if (it == _UINodeIdMap.end())
+			continue;
+
+		const std::string current = it->second->GetState();
+		if (current != state)
+			Journal::Get().RecordNodeState(id, current);
+	}
+}
+
+void ShaderToolApp::GenerateShaderVariant()
+{
+	if (_RootNodeId == INVALID_ID)
+		return;
+
+	// writes and compiles a new shader file, it isn't replayed
+	if (Journal::Get().IsRecording())
+	{
+		LOG_WARN("Shader variant generated, the recording of the journal stops");
+		Journal::Get().StopRecording();
+	}
+
+	auto drawNode = static_cast<DrawNode*>(_UINodeIdMap[_RootNodeId]);
+	if (_Graph.GetNumEdgesFromNode(drawNode->ShaderPin) == 0ull)
+	{
+		LOG_WARN("No shader linked to the draw node");
+		return;
+	}
+
+	const int shaderOutputPin = *_Graph.GetNeighbors(drawNode->ShaderPin).begin();
+	const int shaderIndex = *(int*)_Graph.GetNodeValue(shaderOutputPin)->GetValuePtr();
+	if (shaderIndex == INVALID_INDEX)
+		return;
+
+	auto shaderMgr = ShaderManager::Get();
+	const std::string path = shaderMgr->GetShaderPath(shaderIndex);
+	std::ifstream fin(path);
+	if (!fin)
+	{
+		LOG_ERROR("Failed to read the shader {0}", path);
+		return;
+	}
+	std::stringstream source;
+	source << fin.rdbuf();
+
+	if (source.str().find(GENERATED_CBUFFER) != std::string::npos)
+	{
+		LOG_WARN("The shader {0} is already generated", shaderMgr->GetShaderName(shaderIndex));
+		return;
+	}
+
+	// the links of the bindings that stay are restored on the pins of the variant
+	std::vector<HlslBinding> bindings;
+	std::unordered_map<std::string, int> linkedSources;
+	for (auto& bindPin : drawNode->ShaderBindingPins)
+	{
+		if (bindPin.Bind.BindType == D3D_SIT_CBUFFER)
+			bindings.push_back({ bindPin.Bind.VarName, bindPin.Bind.VarTypeName, bindPin.PinId });
+
+		if (_Graph.GetNumEdgesFromNode(bindPin.PinId) == 1ull)
+			linkedSources[bindPin.Bind.VarName] = *_Graph.GetNeighbors(bindPin.PinId).begin();
+	}
+
+	// cbGenerated can't take a register of the shader, nor of its includes
+	std::vector<uint32_t> usedRegisters;
+	for (const auto& bind : shaderMgr->GetShader(shaderIndex)->GetBindingVars())
+	{
+		if (bind.BindType == D3D_SIT_CBUFFER)
+			usedRegisters.push_back(bind.BindPoint);
+	}
+
+	GeneratedShader generated = HlslGenerator::Generate(_Graph, bindings, source.str(), usedRegisters);
+	if (!generated.Error.empty())
+	{
+		LOG_ERROR("Failed to generate a variant of the shader {0}: {1}", shaderMgr->GetShaderName(shaderIndex), generated.Error);
+		return;
+	}
+	if (generated.GeneratedVars.empty())
+	{
+		LOG_WARN("No math nodes linked to the shader {0}", shaderMgr->GetShaderName(shaderIndex));
+		return;
+	}
+
+	// next to the original shader so its includes are found
+	const size_t extension = path.find_last_of('.');
+	const std::string variantPath = path.substr(0, extension) + "_generated" + (extension != std::string::npos ? path.substr(extension) : "");
+	{
+		std::ofstream fout(variantPath, std::ios_base::out | std::ios_base::trunc);
+		fout << generated.Source;
+	}
+
+	const int variantIndex = shaderMgr->LoadShaderFromFile(variantPath);
+	if (variantIndex == INVALID_INDEX)
+	{
+		LOG_ERROR("Failed to compile the shader variant {0}", variantPath);
+		return;
+	}
+
+	for (const auto& input : generated.Inputs)
+		linkedSources[input.Name] = input.SourcePin;
+
+	// The shader node outputs the variant, without the ShaderUpdatedEvent unlinking the draw node.
+	// The math nodes are no longer linked to the draw node and leave the evaluation plan.
+	*(int*)_Graph.GetNodeValue(shaderOutputPin)->GetValuePtr() = variantIndex;
+	drawNode->ClearShaderBindings();
+	drawNode->CreateShaderBindingPins(variantIndex);
+	for (auto& bindPin : drawNode->ShaderBindingPins)
+	{
+		auto linkedSource = linkedSources.find(bindPin.Bind.VarName);
+		if (linkedSource != linkedSources.end())
+			_Graph.CreateEdge(bindPin.PinId, linkedSource->second, EdgeType::External);
+	}
+
+	LOG_INFO("Shader variant {0}: {1} variables and {2} math nodes moved to the shader, {3} constants inlined, {4} root constants for the inputs",
+		shaderMgr->GetShaderName(variantIndex), generated.GeneratedVars.size(), generated.NumMathNodes,
+		generated.NumInlinedConstants, generated.Inputs.size());
+}
+
+void ShaderToolApp::Save()
+{
+	// Save the internal imnodes state
+	ImNodes::SaveCurrentEditorStateToIniFile(EDITOR_STATE_FILE);
+	std::ofstream fout(PROJECT_FILE, std::ios_base::out | std::ios_base::trunc);
+
+	SerializeProject(fout);
 
 	fout.close();
 }
 
-void ShaderToolApp::Load()
+bool ShaderToolApp::Load(const std::string& path)
 {
-	EVENT_MANAGER.Enable(false); // TODO: awful hack to avoid duplication :/	
-	
-	ImNodes::LoadCurrentEditorStateFromIniFile("node_graph.ini"); // Load the internal imnodes state
-	std::ifstream fin("node_graph.txt", std::ios_base::in); // load project data
+	std::ifstream fin(path, std::ios_base::in); // load project data
 
 	if (!fin.is_open())
 	{
-		LOG_WARN("Failed to load file node_graph.txt");
-		return;
+		LOG_WARN("Failed to load file {0}", path);
+		return false;
 	}
 
+	if (!_IsHeadless)
+		ImNodes::LoadCurrentEditorStateFromIniFile(EDITOR_STATE_FILE); // Load the internal imnodes state
+
+	DeserializeProject(fin);
+
+	fin.close();
+
+	return true;
+}
+
+void ShaderToolApp::SerializeProject(std::ostream& out)
+{
+	out << "#shaders\n";
+	ShaderManager::Get()->Serialize(out);
+	
+	out << "#assets\n";
+	AssetManager::Get().Serialize(out);
+
+	out << "#graph\n";
+	out << _Graph;
+
+	out << "#ui_nodes\n";
+	out << _RootNodeId << "\n";
+	out << _UINodes.size() << "\n";
+	for (auto& uin : _UINodes)
+		out << *uin.get() << "\n";
+}
+
+void ShaderToolApp::DeserializeProject(std::istream& in)
+{
+	EVENT_MANAGER.Enable(false); // TODO: awful hack to avoid duplication :/	
+
 	Reset();
 
 	std::string label;
-	fin >> label;
-	ShaderManager::Get()->Deserialize(fin);
+	in >> label;
+	ShaderManager::Get()->Deserialize(in);
 
-	fin >> label;
-	AssetManager::Get().Deserialize(fin);
+	in >> label;
+	AssetManager::Get().Deserialize(in);
 
-	fin >> _Graph;
+	in >> _Graph;
 
 	std::string comment;
 	int numUiNodes;
-	fin >> comment >> _RootNodeId >> numUiNodes;
+	in >> comment >> _RootNodeId >> numUiNodes;
 
 	std::string typeName;
 	int type;
 	for (int i = 0; i < numUiNodes; ++i)
 	{
-		fin >> typeName >> type;
+		in >> typeName >> type;
 		auto nodeType = static_cast<UiNodeType>(type);
 		
-		// TODO: could be implemented using the pattern described in the links below... for now I'll use a switch
-		// https://isocpp.org/wiki/faq/serialization#serialize-inherit-no-ptrs
-		// https://stackoverflow.com/questions/3268801/how-do-you-de-serialize-a-derived-class-from-serialized-data
-		switch (nodeType)
-		{
-		case UiNodeType::Add: 
+		auto node = MakeUiNode(nodeType);
+		if (!node)
 		{
-			auto node = std::make_unique<AddNode>(&_Graph);
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		case UiNodeType::Multiply:
-		{
-			auto node = std::make_unique<MultiplyNode>(&_Graph);
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		case UiNodeType::Draw:
-		{
-			auto node = std::make_unique<DrawNode>(&_Graph);
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		case UiNodeType::Sine:
-		{
-			auto node = std::make_unique<SineNode>(&_Graph);
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		case UiNodeType::Primitive:
-		{
-			auto node = std::make_unique<PrimitiveNode>(&_Graph, _Primitives);
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		case UiNodeType::Model:
-		{
-			auto node = std::make_unique<ModelNode>(&_Graph);
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		case UiNodeType::Texture:
-		{
-			auto node = std::make_unique<TextureNode>(&_Graph);
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		case UiNodeType::RenderTarget:
-		{
-			auto node = std::make_unique<RenderTargetNode>(&_Graph, _RenderTarget.get());
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		case UiNodeType::Time:
-		{
-			auto node = std::make_unique<TimeNode>(&_Graph);
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		case UiNodeType::Shader:
-		{
-			auto node = std::make_unique<ShaderNode>(&_Graph);
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		case UiNodeType::Color:
-		{
-			auto node = std::make_unique<ColorNode>(&_Graph);
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		case UiNodeType::Camera:
-		{
-			auto node = std::make_unique<CameraNode>(&_Graph);
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		case UiNodeType::Scalar:
-		{
-			auto node = std::make_unique<ScalarNode>(&_Graph);
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		case UiNodeType::Vector4:
-		{
-			auto node = std::make_unique<Vector4Node>(&_Graph);
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		case UiNodeType::Vector3:
-		{
-			auto node = std::make_unique<Vector3Node>(&_Graph);
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		case UiNodeType::Vector2:
-		{
-			auto node = std::make_unique<Vector2Node>(&_Graph);
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		case UiNodeType::Matrix4x4:
-		{
-			auto node = std::make_unique<Matrix4x4Node>(&_Graph);
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		case UiNodeType::Transform:
-		{
-			auto node = std::make_unique<TransformNode>(&_Graph);
-			fin >> *node.get();
-			_UINodeIdMap[node->Id] = node.get();
-			_UINodes.push_back(std::move(node));
-		}
-		break;
-		default:
 			LOG_WARN("Failed to load Unknown UI node type {0}", nodeType);
-			break;
+			continue;
 		}
-	}
 
-	fin.close();
+		in >> *node.get();
+		_UINodeIdMap[node->Id] = node.get();
+		_UINodes.push_back(std::move(node));
+	}
 
 	EVENT_MANAGER.Enable(true);
 }
 
 void ShaderToolApp::Reset()
 {
+	// the journal replays the edits on the project it was started with
+	if (Journal::Get().IsRecording())
+	{
+		LOG_WARN("The project is reset, the recording of the journal stops");
+		Journal::Get().StopRecording();
+	}
+
 	_Graph.Reset();
 	_UINodeIdMap.clear();
 	_UINodes.clear();
 	_RootNodeId = INVALID_ID;
+
+	// the ids of the next graph may be the same
+	_EvalPlan = EvaluationPlan();
+	_EvalPlanStructure = GraphStructure();
+	_BatchedTransforms.clear();
+	NodeCostTracker::Get().Clear();
 }
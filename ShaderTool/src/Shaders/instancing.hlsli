@@ -0,0 +1,7 @@
+// Per instance input of the draws made with an InstancesNode linked to the draw node.
+// The matrix is a row vector world matrix: posW = mul(mul(float4(pos, 1.0), InstanceWorld), World)
+
+struct VS_INSTANCE_DATA
+{
+    float4x4 InstanceWorld : WORLD;
+};
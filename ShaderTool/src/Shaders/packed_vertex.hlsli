@@ -0,0 +1,29 @@
+// Decoding of the packed vertex format (PACKED_VERTICES in Defines.h).
+// The app fills cbVertexQuantization with the bounds of the model being drawn.
+
+cbuffer cbVertexQuantization : register(b8)
+{
+    float4 QuantizationMin;
+    float4 QuantizationExtent;
+}
+
+struct VS_PACKED_DATA
+{
+    float4 Pos  : POSITION; // normalized inside the model bounds
+    float2 Norm : NORMAL;   // octahedral
+    float2 Tang : TANGENT;  // octahedral
+    float2 TexC : TEXCOORD;
+};
+
+float3 DecodePosition(float4 pos)
+{
+    return QuantizationMin.xyz + pos.xyz * QuantizationExtent.xyz;
+}
+
+float3 DecodeOctahedral(float2 e)
+{
+    float3 n = float3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += n.xy >= 0.0 ? -t : t;
+    return normalize(n);
+}
@@ -13,9 +13,7 @@ cbuffer cbPerFrame : register(b1)
 cbuffer cbLight : register(b2)
 {
     float3 ModelColor;
-    float  Pad1;
     float3 LightColor;
-    float  Pad2;
     float3 LightDirection;
     float  SpecularPower;
 }
@@ -0,0 +1,765 @@
+#include "pch.h"
+#include "TextureDecoder.h"
+#include "ThreadPool.h"
+#include "DDSHeaders.h"
+#include "Defines.h"
+
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace TextureDecoder
+{
+	static constexpr size_t BLOCKS_PER_TASK = 4096;
+	static constexpr size_t PIXELS_PER_TASK = 64 * 1024;
+
+	struct BC7Mode
+	{
+		uint8_t NumSubsets;
+		uint8_t PartitionBits;
+		uint8_t RotationBits;
+		uint8_t IndexSelectionBits;
+		uint8_t ColorBits;
+		uint8_t AlphaBits;
+		uint8_t EndpointPBits; // one per endpoint
+		uint8_t SharedPBits;   // one per subset
+		uint8_t IndexBits;
+		uint8_t IndexBits2;    // second set of indices, modes 4 and 5
+	};
+
+	static constexpr BC7Mode BC7_MODES[8] =
+	{
+		{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+		{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+		{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+		{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+		{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+		{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+		{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+	};
+
+	static constexpr uint8_t BC7_WEIGHTS2[4] = { 0, 21, 43, 64 };
+	static constexpr uint8_t BC7_WEIGHTS3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	static constexpr uint8_t BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// subset of each pixel, 1 bit per pixel for 2 subsets, 2 bits for 3 subsets, first pixel in the low bits
+	static constexpr uint16_t BC7_PARTITIONS2[64] =
+	{
+		0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+		0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+		0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+		0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+		0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a,
+		0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+		0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c,
+		0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22,
+	};
+
+	static constexpr uint32_t BC7_PARTITIONS3[64] =
+	{
+		0xaa685050, 0x6a5a5040, 0x5a5a4200, 0x5450a0a8, 0xa5a50000, 0xa0a05050, 0x5555a0a0, 0x5a5a5050,
+		0xaa550000, 0xaa555500, 0xaaaa5500, 0x90909090, 0x94949494, 0xa4a4a4a4, 0xa9a59450, 0x2a0a4250,
+		0xa5945040, 0x0a425054, 0xa5a5a500, 0x55a0a0a0, 0xa8a85454, 0x6a6a4040, 0xa4a45000, 0x1a1a0500,
+		0x0050a4a4, 0xaaa59090, 0x14696914, 0x69691400, 0xa08585a0, 0xaa821414, 0x50a4a450, 0x6a5a0200,
+		0xa9a58000, 0x5090a0a8, 0xa8a09050, 0x24242424, 0x00aa5500, 0x24924924, 0x24499224, 0x50a50a50,
+		0x500aa550, 0xaaaa4444, 0x66660000, 0xa5a0a5a0, 0x50a050a0, 0x69286928, 0x44aaaa44, 0x66666600,
+		0xaa444444, 0x54a854a8, 0x95809580, 0x96969600, 0xa85454a8, 0x80959580, 0xaa141414, 0x96960000,
+		0xaaaa1414, 0xa05050a0, 0xa0a5a5a0, 0x96000000, 0x40804080, 0xa9a8a9a8, 0xaaaaaa44, 0x2a4a5254,
+	};
+
+	// pixel whose index has one bit less, besides the first pixel (the anchor of the first subset)
+	static constexpr uint8_t BC7_ANCHORS2[64] =
+	{
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+		15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+		 6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+	};
+
+	static constexpr uint8_t BC7_ANCHORS3_SECOND[64] =
+	{
+		 3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+		 3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+		 8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+		 3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3,
+	};
+
+	static constexpr uint8_t BC7_ANCHORS3_THIRD[64] =
+	{
+		15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+		15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+		15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+		15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8,
+	};
+
+	// Bits of a 128 bit block, read from the lowest
+	struct BitReader
+	{
+		uint64_t Low;
+		uint64_t High;
+		uint32_t Position;
+
+		explicit BitReader(const uint8_t* block) : Position(0)
+		{
+			std::memcpy(&Low, block, sizeof(Low));
+			std::memcpy(&High, block + 8, sizeof(High));
+		}
+
+		uint32_t Read(uint32_t count)
+		{
+			if (count == 0)
+				return 0;
+
+			uint64_t bits = Position < 64 ? Low >> Position : High >> (Position - 64);
+			if (Position < 64 && Position + count > 64)
+				bits |= High << (64 - Position);
+
+			Position += count;
+			return (uint32_t)(bits & ((1ull << count) - 1));
+		}
+	};
+
+	static uint32_t GetBlockBytes(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+		case DXGI_FORMAT_BC4_UNORM:
+			return 8;
+		case DXGI_FORMAT_BC2_UNORM:
+		case DXGI_FORMAT_BC2_UNORM_SRGB:
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+		case DXGI_FORMAT_BC5_UNORM:
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			return 16;
+		default:
+			return 0; // not block compressed
+		}
+	}
+
+	static uint32_t GetPixelBytes(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			return 8;
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			return 16;
+		default:
+			return 4;
+		}
+	}
+
+	static void GetSurfaceLayout(DXGI_FORMAT format, uint32_t width, uint32_t height, size_t& rowPitch, size_t& numRows)
+	{
+		const uint32_t blockBytes = GetBlockBytes(format);
+		if (blockBytes)
+		{
+			rowPitch = (size_t)std::max(1u, (width + 3) / 4) * blockBytes;
+			numRows = std::max(1u, (height + 3) / 4);
+		}
+		else
+		{
+			rowPitch = (size_t)width * GetPixelBytes(format);
+			numRows = height;
+		}
+	}
+
+	static DXGI_FORMAT GetFormat(const DDS::PixelFormat& pf)
+	{
+		if (pf.Flags & DDS::DDPF_FOURCC)
+		{
+			switch (pf.FourCC)
+			{
+			case DDS::MakeFourCC('D', 'X', 'T', '1'): return DXGI_FORMAT_BC1_UNORM;
+			case DDS::MakeFourCC('D', 'X', 'T', '2'):
+			case DDS::MakeFourCC('D', 'X', 'T', '3'): return DXGI_FORMAT_BC2_UNORM;
+			case DDS::MakeFourCC('D', 'X', 'T', '4'):
+			case DDS::MakeFourCC('D', 'X', 'T', '5'): return DXGI_FORMAT_BC3_UNORM;
+			case DDS::MakeFourCC('A', 'T', 'I', '1'):
+			case DDS::MakeFourCC('B', 'C', '4', 'U'): return DXGI_FORMAT_BC4_UNORM;
+			case DDS::MakeFourCC('A', 'T', 'I', '2'):
+			case DDS::MakeFourCC('B', 'C', '5', 'U'): return DXGI_FORMAT_BC5_UNORM;
+			case 113: return DXGI_FORMAT_R16G16B16A16_FLOAT; // D3DFMT_A16B16G16R16F
+			case 116: return DXGI_FORMAT_R32G32B32A32_FLOAT; // D3DFMT_A32B32G32R32F
+			default: return DXGI_FORMAT_UNKNOWN;
+			}
+		}
+
+		if ((pf.Flags & DDS::DDPF_RGB) && pf.RGBBitCount == 32)
+		{
+			if (pf.RBitMask == 0x000000ff && pf.GBitMask == 0x0000ff00 && pf.BBitMask == 0x00ff0000 && pf.ABitMask == 0xff000000)
+				return DXGI_FORMAT_R8G8B8A8_UNORM;
+			if (pf.RBitMask == 0x00ff0000 && pf.GBitMask == 0x0000ff00 && pf.BBitMask == 0x000000ff)
+				return pf.ABitMask == 0xff000000 ? DXGI_FORMAT_B8G8R8A8_UNORM : DXGI_FORMAT_B8G8R8X8_UNORM;
+		}
+
+		return DXGI_FORMAT_UNKNOWN;
+	}
+
+	// Rounds the channels to the nearest integer, halves up like the integer formulas of the formats
+	static uint32_t PackColor(FXMVECTOR rgba)
+	{
+		XMUBYTE4 packed;
+		XMStoreUByte4(&packed, XMVectorFloor(XMVectorAdd(rgba, XMVectorReplicate(0.5f))));
+		return packed.v;
+	}
+
+	static XMVECTOR LoadColor565(uint16_t color)
+	{
+		const uint32_t r = (color >> 11) & 31;
+		const uint32_t g = (color >> 5) & 63;
+		const uint32_t b = color & 31;
+		return XMVectorSet((float)((r << 3) | (r >> 2)), (float)((g << 2) | (g >> 4)), (float)((b << 3) | (b >> 2)), 255.f);
+	}
+
+	// BC2 and BC3 always use 4 colors, BC1 uses 3 and transparent black when color0 <= color1
+	static void DecodeColorBlock(const uint8_t* block, bool hasTransparent, uint32_t* pixels)
+	{
+		const uint16_t color0 = (uint16_t)(block[0] | (block[1] << 8));
+		const uint16_t color1 = (uint16_t)(block[2] | (block[3] << 8));
+		const XMVECTOR c0 = LoadColor565(color0);
+		const XMVECTOR c1 = LoadColor565(color1);
+
+		uint32_t palette[4];
+		palette[0] = PackColor(c0);
+		palette[1] = PackColor(c1);
+		if (color0 > color1 || !hasTransparent)
+		{
+			palette[2] = PackColor(XMVectorLerp(c0, c1, 1.f / 3.f));
+			palette[3] = PackColor(XMVectorLerp(c0, c1, 2.f / 3.f));
+		}
+		else
+		{
+			palette[2] = PackColor(XMVectorLerp(c0, c1, 0.5f));
+			palette[3] = 0;
+		}
+
+		uint32_t indices;
+		std::memcpy(&indices, block + 4, sizeof(indices));
+		for (uint32_t i = 0; i < 16; ++i)
+			pixels[i] = palette[(indices >> (2 * i)) & 3];
+	}
+
+	// 8 byte block of one channel: BC4, the alpha of BC3 and each channel of BC5
+	static void DecodeChannelBlock(const uint8_t* block, uint8_t* values)
+	{
+		const XMVECTOR v0 = XMVectorReplicate(block[0]);
+		const XMVECTOR delta = XMVectorReplicate((float)block[1] - (float)block[0]);
+
+		// weights of block[1] for the 8 indices
+		XMVECTOR low, high;
+		if (block[0] > block[1])
+		{
+			low = XMVectorScale(XMVectorSet(0.f, 7.f, 1.f, 2.f), 1.f / 7.f);
+			high = XMVectorScale(XMVectorSet(3.f, 4.f, 5.f, 6.f), 1.f / 7.f);
+		}
+		else
+		{
+			low = XMVectorScale(XMVectorSet(0.f, 5.f, 1.f, 2.f), 1.f / 5.f);
+			high = XMVectorScale(XMVectorSet(3.f, 4.f, 0.f, 0.f), 1.f / 5.f);
+		}
+
+		uint8_t palette[8];
+		const uint32_t lowPacked = PackColor(XMVectorMultiplyAdd(delta, low, v0));
+		const uint32_t highPacked = PackColor(XMVectorMultiplyAdd(delta, high, v0));
+		std::memcpy(palette, &lowPacked, 4);
+		std::memcpy(palette + 4, &highPacked, 4);
+		if (block[0] <= block[1])
+		{
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		uint64_t indices = 0;
+		std::memcpy(&indices, block + 2, 6);
+		for (uint32_t i = 0; i < 16; ++i)
+			values[i] = palette[(indices >> (3 * i)) & 7];
+	}
+
+	static uint32_t ExpandBits(uint32_t value, uint32_t numBits)
+	{
+		value <<= 8 - numBits;
+		return value | (value >> numBits);
+	}
+
+	static void BuildBC7Palette(const uint32_t* endpoint0, const uint32_t* endpoint1, uint32_t indexBits, uint32_t* palette)
+	{
+		const uint8_t* weights = indexBits == 2 ? BC7_WEIGHTS2 : indexBits == 3 ? BC7_WEIGHTS3 : BC7_WEIGHTS4;
+		const XMVECTOR e0 = XMVectorSet((float)endpoint0[0], (float)endpoint0[1], (float)endpoint0[2], (float)endpoint0[3]);
+		const XMVECTOR e1 = XMVectorSet((float)endpoint1[0], (float)endpoint1[1], (float)endpoint1[2], (float)endpoint1[3]);
+		const XMVECTOR delta = XMVectorSubtract(e1, e0);
+
+		// ((64 - w) * e0 + w * e1 + 32) >> 6, exact in floats
+		for (uint32_t i = 0; i < (1u << indexBits); ++i)
+			palette[i] = PackColor(XMVectorMultiplyAdd(delta, XMVectorReplicate(weights[i] / 64.f), e0));
+	}
+
+	static void DecodeBC7(const uint8_t* block, uint32_t* pixels)
+	{
+		uint32_t mode = 0;
+		while (mode < 8 && !(block[0] & (1 << mode)))
+			++mode;
+
+		if (mode == 8) // reserved, decodes to transparent black
+		{
+			std::fill(pixels, pixels + 16, 0u);
+			return;
+		}
+
+		const BC7Mode& m = BC7_MODES[mode];
+		BitReader bits(block);
+		bits.Read(mode + 1);
+
+		const uint32_t partition = bits.Read(m.PartitionBits);
+		const uint32_t rotation = bits.Read(m.RotationBits);
+		const uint32_t indexSelection = bits.Read(m.IndexSelectionBits);
+		const uint32_t numEndpoints = m.NumSubsets * 2u;
+
+		uint32_t endpoints[6][4];
+		for (uint32_t c = 0; c < 3; ++c)
+			for (uint32_t e = 0; e < numEndpoints; ++e)
+				endpoints[e][c] = bits.Read(m.ColorBits);
+
+		for (uint32_t e = 0; e < numEndpoints; ++e)
+			endpoints[e][3] = m.AlphaBits ? bits.Read(m.AlphaBits) : 255;
+
+		uint32_t colorBits = m.ColorBits;
+		uint32_t alphaBits = m.AlphaBits;
+		if (m.EndpointPBits || m.SharedPBits)
+		{
+			uint32_t pBits[6];
+			if (m.EndpointPBits)
+			{
+				for (uint32_t e = 0; e < numEndpoints; ++e)
+					pBits[e] = bits.Read(1);
+			}
+			else
+			{
+				for (uint32_t s = 0; s < m.NumSubsets; ++s)
+					pBits[2 * s] = pBits[2 * s + 1] = bits.Read(1);
+			}
+
+			for (uint32_t e = 0; e < numEndpoints; ++e)
+			{
+				const uint32_t numChannels = alphaBits ? 4 : 3;
+				for (uint32_t c = 0; c < numChannels; ++c)
+					endpoints[e][c] = (endpoints[e][c] << 1) | pBits[e];
+			}
+
+			++colorBits;
+			if (alphaBits)
+				++alphaBits;
+		}
+
+		for (uint32_t e = 0; e < numEndpoints; ++e)
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+				endpoints[e][c] = ExpandBits(endpoints[e][c], colorBits);
+			if (alphaBits)
+				endpoints[e][3] = ExpandBits(endpoints[e][3], alphaBits);
+		}
+
+		uint32_t subsets[16];
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			if (m.NumSubsets == 1)
+				subsets[i] = 0;
+			else if (m.NumSubsets == 2)
+				subsets[i] = (BC7_PARTITIONS2[partition] >> i) & 1;
+			else
+				subsets[i] = (BC7_PARTITIONS3[partition] >> (2 * i)) & 3;
+		}
+
+		uint32_t indices[16];
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			bool isAnchor = i == 0;
+			if (m.NumSubsets == 2)
+				isAnchor |= i == BC7_ANCHORS2[partition];
+			else if (m.NumSubsets == 3)
+				isAnchor |= i == BC7_ANCHORS3_SECOND[partition] || i == BC7_ANCHORS3_THIRD[partition];
+			indices[i] = bits.Read(m.IndexBits - (isAnchor ? 1 : 0));
+		}
+
+		uint32_t palettes[3][16];
+		for (uint32_t s = 0; s < m.NumSubsets; ++s)
+			BuildBC7Palette(endpoints[2 * s], endpoints[2 * s + 1], m.IndexBits, palettes[s]);
+
+		if (m.IndexBits2 == 0)
+		{
+			for (uint32_t i = 0; i < 16; ++i)
+				pixels[i] = palettes[subsets[i]][indices[i]];
+		}
+		else
+		{
+			// modes 4 and 5, the second indices are for the alpha unless the index selection swaps them
+			uint32_t indices2[16];
+			for (uint32_t i = 0; i < 16; ++i)
+				indices2[i] = bits.Read(m.IndexBits2 - (i == 0 ? 1 : 0));
+
+			uint32_t palette2[16];
+			BuildBC7Palette(endpoints[0], endpoints[1], m.IndexBits2, palette2);
+
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				const uint32_t first = palettes[0][indices[i]];
+				const uint32_t second = palette2[indices2[i]];
+				pixels[i] = indexSelection
+					? (second & 0x00ffffff) | (first & 0xff000000)
+					: (first & 0x00ffffff) | (second & 0xff000000);
+			}
+		}
+
+		// the rotation swaps the alpha with red, green or blue
+		if (rotation)
+		{
+			const uint32_t shift = 8 * (rotation - 1);
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				const uint32_t alpha = pixels[i] >> 24;
+				const uint32_t other = (pixels[i] >> shift) & 0xff;
+				pixels[i] = (pixels[i] & ~(0xffu << shift) & 0x00ffffff) | (alpha << shift) | (other << 24);
+			}
+		}
+	}
+
+	static void DecodeBlock(DXGI_FORMAT format, const uint8_t* block, uint32_t* pixels)
+	{
+		uint8_t values[16];
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+			DecodeColorBlock(block, true, pixels);
+			break;
+		case DXGI_FORMAT_BC2_UNORM:
+		case DXGI_FORMAT_BC2_UNORM_SRGB:
+		{
+			DecodeColorBlock(block + 8, false, pixels);
+			uint64_t alphas;
+			std::memcpy(&alphas, block, sizeof(alphas));
+			for (uint32_t i = 0; i < 16; ++i)
+				pixels[i] = (pixels[i] & 0x00ffffff) | ((uint32_t)((alphas >> (4 * i)) & 15) * 17 << 24);
+			break;
+		}
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+			DecodeColorBlock(block + 8, false, pixels);
+			DecodeChannelBlock(block, values);
+			for (uint32_t i = 0; i < 16; ++i)
+				pixels[i] = (pixels[i] & 0x00ffffff) | ((uint32_t)values[i] << 24);
+			break;
+		case DXGI_FORMAT_BC4_UNORM:
+			DecodeChannelBlock(block, values);
+			for (uint32_t i = 0; i < 16; ++i)
+				pixels[i] = values[i] | 0xff000000;
+			break;
+		case DXGI_FORMAT_BC5_UNORM:
+		{
+			uint8_t green[16];
+			DecodeChannelBlock(block, values);
+			DecodeChannelBlock(block + 8, green);
+			for (uint32_t i = 0; i < 16; ++i)
+				pixels[i] = values[i] | ((uint32_t)green[i] << 8) | 0xff000000;
+			break;
+		}
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			DecodeBC7(block, pixels);
+			break;
+		default:
+			assert(false && "Not a block compressed format");
+			break;
+		}
+	}
+
+	bool IsSupported(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8X8_UNORM:
+		case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			return true;
+		default:
+			return GetBlockBytes(format) != 0;
+		}
+	}
+
+	bool ReadDDS(const std::string& path, DDSFile& file)
+	{
+		std::ifstream in(path, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+		if (!in.is_open())
+		{
+			LOG_ERROR("Failed to open file {0}", path);
+			return false;
+		}
+
+		const size_t size = (size_t)in.tellg();
+		file.Data.resize(size);
+		in.seekg(0);
+		in.read((char*)file.Data.data(), size);
+
+		uint32_t magic = 0;
+		DDS::Header header{};
+		if (size >= sizeof(magic) + sizeof(header))
+		{
+			std::memcpy(&magic, file.Data.data(), sizeof(magic));
+			std::memcpy(&header, file.Data.data() + sizeof(magic), sizeof(header));
+		}
+
+		if (!in || magic != DDS::MAGIC || header.Size != sizeof(DDS::Header) || header.PixelFormat.Size != sizeof(DDS::PixelFormat))
+		{
+			LOG_ERROR("{0} is not a DDS file", path);
+			return false;
+		}
+
+		size_t offset = sizeof(magic) + sizeof(header);
+		if ((header.PixelFormat.Flags & DDS::DDPF_FOURCC) && header.PixelFormat.FourCC == DDS::MakeFourCC('D', 'X', '1', '0'))
+		{
+			DDS::HeaderDXT10 header10{};
+			if (size < offset + sizeof(header10))
+			{
+				LOG_ERROR("{0} is not a DDS file", path);
+				return false;
+			}
+			std::memcpy(&header10, file.Data.data() + offset, sizeof(header10));
+			offset += sizeof(header10);
+
+			if (header10.ResourceDimension != D3D12_RESOURCE_DIMENSION_TEXTURE2D)
+			{
+				LOG_WARN("{0} is not a 2D texture, it can't be decoded on the CPU", path);
+				return false;
+			}
+			file.Format = (DXGI_FORMAT)header10.Format;
+			file.NumSlices = std::max(1u, header10.ArraySize) * (header10.MiscFlag & DDS::RESOURCE_MISC_TEXTURECUBE ? 6 : 1);
+		}
+		else
+		{
+			if (header.Caps2 & DDS::DDSCAPS2_VOLUME)
+			{
+				LOG_WARN("{0} is not a 2D texture, it can't be decoded on the CPU", path);
+				return false;
+			}
+			file.Format = GetFormat(header.PixelFormat);
+			file.NumSlices = header.Caps2 & DDS::DDSCAPS2_CUBEMAP ? 6 : 1;
+		}
+
+		if (!IsSupported(file.Format))
+		{
+			LOG_WARN("{0} uses format {1}, it can't be decoded on the CPU", path, (int)file.Format);
+			return false;
+		}
+
+		file.Width = header.Width;
+		file.Height = header.Height;
+		file.MipOffsets.clear();
+
+		const uint32_t mipCount = std::max(1u, header.MipMapCount);
+		for (uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			size_t rowPitch, numRows;
+			GetSurfaceLayout(file.Format, std::max(1u, file.Width >> mip), std::max(1u, file.Height >> mip), rowPitch, numRows);
+			if (offset + rowPitch * numRows > size)
+				break;
+
+			file.MipOffsets.push_back(offset);
+			offset += rowPitch * numRows;
+		}
+
+		if (file.MipOffsets.empty())
+		{
+			LOG_ERROR("{0} is truncated", path);
+			return false;
+		}
+		return true;
+	}
+
+	uint32_t SelectMip(const DDSFile& file, uint32_t maxSize)
+	{
+		const uint32_t numMips = (uint32_t)file.MipOffsets.size();
+		for (uint32_t mip = 0; mip < numMips; ++mip)
+		{
+			if (std::max(file.Width >> mip, file.Height >> mip) <= maxSize)
+				return mip;
+		}
+		return numMips - 1;
+	}
+
+	bool DecodeMip(const DDSFile& file, uint32_t mip, DecodedImage& image)
+	{
+		if (mip >= file.MipOffsets.size())
+			return false;
+
+		image.Width = std::max(1u, file.Width >> mip);
+		image.Height = std::max(1u, file.Height >> mip);
+		image.Pixels.resize((size_t)image.Width * image.Height);
+
+		size_t rowPitch, numRows;
+		GetSurfaceLayout(file.Format, image.Width, image.Height, rowPitch, numRows);
+		Decode(file.Format, file.Data.data() + file.MipOffsets[mip], rowPitch, image.Width, image.Height, image.Pixels.data());
+		return true;
+	}
+
+	void Decode(DXGI_FORMAT format, const uint8_t* data, size_t rowPitch, uint32_t width, uint32_t height, uint32_t* pixels)
+	{
+		assert(IsSupported(format) && "Format can't be decoded");
+
+		const uint32_t blockBytes = GetBlockBytes(format);
+		if (format == DXGI_FORMAT_R16G16B16A16_FLOAT || format == DXGI_FORMAT_R32G32B32A32_FLOAT)
+		{
+			ThreadPool::Get().ParallelFor(height, std::max<size_t>(1, PIXELS_PER_TASK / width), [&](size_t begin, size_t end)
+			{
+				for (size_t y = begin; y < end; ++y)
+				{
+					const uint8_t* row = data + y * rowPitch;
+					uint32_t* out = pixels + y * width;
+					for (uint32_t x = 0; x < width; ++x)
+					{
+						const XMVECTOR color = format == DXGI_FORMAT_R16G16B16A16_FLOAT
+							? XMLoadHalf4((const XMHALF4*)row + x)
+							: XMLoadFloat4((const XMFLOAT4*)row + x);
+						out[x] = PackColor(XMVectorScale(XMVectorSaturate(color), 255.f));
+					}
+				}
+			});
+			return;
+		}
+
+		if (blockBytes == 0)
+		{
+			const bool isBGRA = format != DXGI_FORMAT_R8G8B8A8_UNORM && format != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+			const bool isOpaque = format == DXGI_FORMAT_B8G8R8X8_UNORM || format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+
+			ThreadPool::Get().ParallelFor(height, std::max<size_t>(1, PIXELS_PER_TASK / width), [&](size_t begin, size_t end)
+			{
+				for (size_t y = begin; y < end; ++y)
+				{
+					const uint8_t* row = data + y * rowPitch;
+					uint32_t* out = pixels + y * width;
+					for (uint32_t x = 0; x < width; ++x)
+					{
+						uint32_t pixel;
+						std::memcpy(&pixel, row + 4 * x, sizeof(pixel));
+						if (isBGRA)
+							pixel = (pixel & 0xff00ff00) | ((pixel >> 16) & 0xff) | ((pixel & 0xff) << 16);
+						if (isOpaque)
+							pixel |= 0xff000000;
+						out[x] = pixel;
+					}
+				}
+			});
+			return;
+		}
+
+		const uint32_t blocksWide = (width + 3) / 4;
+		const uint32_t blocksHigh = (height + 3) / 4;
+		ThreadPool::Get().ParallelFor(blocksHigh, std::max<size_t>(1, BLOCKS_PER_TASK / blocksWide), [&](size_t begin, size_t end)
+		{
+			uint32_t block[16];
+			for (size_t by = begin; by < end; ++by)
+			{
+				const uint8_t* row = data + by * rowPitch;
+				const uint32_t numRows = std::min(4u, height - (uint32_t)by * 4);
+				for (uint32_t bx = 0; bx < blocksWide; ++bx)
+				{
+					DecodeBlock(format, row + bx * blockBytes, block);
+
+					// the blocks on the right and bottom edges can be partly outside the image
+					const uint32_t numColumns = std::min(4u, width - bx * 4);
+					uint32_t* out = pixels + by * 4 * width + bx * 4;
+					for (uint32_t y = 0; y < numRows; ++y)
+						std::memcpy(out + y * width, block + y * 4, numColumns * sizeof(uint32_t));
+				}
+			}
+		});
+	}
+
+	void Fit(const DecodedImage& image, uint32_t size, uint32_t* pixels)
+	{
+		std::fill(pixels, pixels + (size_t)size * size, 0u);
+		if (image.Width == 0 || image.Height == 0)
+			return;
+
+		const float scale = std::min((float)size / image.Width, (float)size / image.Height);
+		const uint32_t width = std::clamp((uint32_t)std::lround(image.Width * scale), 1u, size);
+		const uint32_t height = std::clamp((uint32_t)std::lround(image.Height * scale), 1u, size);
+		const uint32_t left = (size - width) / 2;
+		const uint32_t top = (size - height) / 2;
+
+		ThreadPool::Get().ParallelFor(height, 8, [&](size_t begin, size_t end)
+		{
+			for (size_t y = begin; y < end; ++y)
+			{
+				const size_t y0 = y * image.Height / height;
+				const size_t y1 = std::max(y0 + 1, (y + 1) * image.Height / height);
+				for (size_t x = 0; x < width; ++x)
+				{
+					const size_t x0 = x * image.Width / width;
+					const size_t x1 = std::max(x0 + 1, (x + 1) * image.Width / width);
+
+					uint64_t sum[4] = {};
+					for (size_t sy = y0; sy < y1; ++sy)
+					{
+						for (size_t sx = x0; sx < x1; ++sx)
+						{
+							const uint32_t pixel = image.Pixels[sy * image.Width + sx];
+							for (uint32_t c = 0; c < 4; ++c)
+								sum[c] += (pixel >> (8 * c)) & 0xff;
+						}
+					}
+
+					const uint64_t count = (y1 - y0) * (x1 - x0);
+					uint32_t result = 0;
+					for (uint32_t c = 0; c < 4; ++c)
+						result |= (uint32_t)((sum[c] + count / 2) / count) << (8 * c);
+					pixels[(top + y) * size + left + x] = result;
+				}
+			}
+		});
+	}
+
+	ImageDiff Compare(const DecodedImage& a, const DecodedImage& b)
+	{
+		assert(a.Width == b.Width && a.Height == b.Height && "Images of different sizes");
+
+		ImageDiff diff;
+		uint64_t sumSquares = 0;
+		for (size_t i = 0; i < a.Pixels.size(); ++i)
+		{
+			if (a.Pixels[i] == b.Pixels[i])
+				continue;
+
+			++diff.NumDifferentPixels;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				const int error = std::abs((int)((a.Pixels[i] >> (8 * c)) & 0xff) - (int)((b.Pixels[i] >> (8 * c)) & 0xff));
+				diff.MaxError = std::max(diff.MaxError, (uint32_t)error);
+				sumSquares += (uint64_t)(error * error);
+			}
+		}
+
+		const size_t numValues = a.Pixels.size() * 4;
+		diff.MeanSquaredError = numValues ? (double)sumSquares / numValues : 0.0;
+		diff.Psnr = diff.MeanSquaredError > 0.0
+			? 10.0 * std::log10(255.0 * 255.0 / diff.MeanSquaredError)
+			: std::numeric_limits<double>::infinity();
+		return diff;
+	}
+}
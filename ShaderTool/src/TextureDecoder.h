@@ -0,0 +1,60 @@
+#pragma once
+
+#include <dxgiformat.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// RGBA8 pixels, top row first
+struct DecodedImage
+{
+	uint32_t Width{ 0 };
+	uint32_t Height{ 0 };
+	std::vector<uint32_t> Pixels;
+};
+
+// DDS file read in memory, only the first array slice (or cube face) of a 2D texture is used
+struct DDSFile
+{
+	DXGI_FORMAT Format{ DXGI_FORMAT_UNKNOWN };
+	uint32_t Width{ 0 };
+	uint32_t Height{ 0 };
+	uint32_t NumSlices{ 1 };        // array slices, 6 per cube
+	std::vector<uint8_t> Data;      // the whole file
+	std::vector<size_t> MipOffsets; // in Data, one per mip of the first array slice
+};
+
+// Differences between two images of the same size, over the 4 channels
+struct ImageDiff
+{
+	uint32_t MaxError{ 0 };
+	uint32_t NumDifferentPixels{ 0 };
+	double MeanSquaredError{ 0.0 };
+	double Psnr{ 0.0 }; // dB, infinity when the images are the same
+};
+
+// CPU decoder of the DDS formats the texture nodes load, for the node previews and to compare
+// texture contents without reading them back from the GPU. Everything is decoded to RGBA8 the way
+// the GPU samples it (BC4 to red, BC5 to red and green, alpha 255 when the format has none).
+// The rows of blocks are split between the workers and the palettes are interpolated in XMVECTORs.
+namespace TextureDecoder
+{
+	// BC1 to BC5 and BC7 (UNORM and SRGB), the 32 bit RGBA/BGRA formats and RGBA16F/RGBA32F (saturated)
+	bool IsSupported(DXGI_FORMAT format);
+
+	bool ReadDDS(const std::string& path, DDSFile& file);
+
+	// The finest mip with both sides at most maxSize, the coarsest one when none is that small
+	uint32_t SelectMip(const DDSFile& file, uint32_t maxSize);
+
+	bool DecodeMip(const DDSFile& file, uint32_t mip, DecodedImage& image);
+
+	// width x height pixels from rows of blocks (or of pixels) rowPitch bytes apart
+	void Decode(DXGI_FORMAT format, const uint8_t* data, size_t rowPitch, uint32_t width, uint32_t height, uint32_t* pixels);
+
+	// Scales the image to fit size x size keeping its aspect ratio, centered on a transparent
+	// background. Averages the covered pixels when shrinking, nearest pixel when growing.
+	void Fit(const DecodedImage& image, uint32_t size, uint32_t* pixels);
+
+	ImageDiff Compare(const DecodedImage& a, const DecodedImage& b);
+}
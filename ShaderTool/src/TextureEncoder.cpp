@@ -0,0 +1,530 @@
+#include "pch.h"
+#include "TextureEncoder.h"
+#include "ThreadPool.h"
+#include "DDSHeaders.h"
+#include "Defines.h"
+
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace TextureEncoder
+{
+	static constexpr size_t BLOCKS_PER_TASK = 1024;
+	static constexpr uint32_t POWER_ITERATIONS = 8;
+
+	// weight of the second endpoint for each index
+	static constexpr float BC1_WEIGHTS[4] = { 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+	static constexpr uint8_t BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	struct BitWriter
+	{
+		uint8_t* Block; // zeroed
+		uint32_t Position{ 0 };
+
+		void Write(uint32_t value, uint32_t count)
+		{
+			for (uint32_t i = 0; i < count; ++i, ++Position)
+			{
+				if ((value >> i) & 1)
+					Block[Position >> 3] |= (uint8_t)(1 << (Position & 7));
+			}
+		}
+	};
+
+	static uint32_t GetBlockBytes(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+			return 8;
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+		case DXGI_FORMAT_BC5_UNORM:
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+
+	// The edge pixels are repeated for the blocks partly outside the image
+	static void LoadBlock(const uint32_t* pixels, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, uint32_t* texels)
+	{
+		for (uint32_t y = 0; y < 4; ++y)
+		{
+			const uint32_t sy = std::min(by * 4 + y, height - 1);
+			for (uint32_t x = 0; x < 4; ++x)
+				texels[y * 4 + x] = pixels[(size_t)sy * width + std::min(bx * 4 + x, width - 1)];
+		}
+	}
+
+	static void LoadColors(const uint32_t* texels, XMVECTOR* colors)
+	{
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			XMUBYTE4 texel;
+			texel.v = texels[i];
+			colors[i] = XMLoadUByte4(&texel);
+		}
+	}
+
+	// Mean of the colors and direction of their largest variance (power iteration on the covariance),
+	// the channels not in the mask are ignored. The axis is zero when all the colors are the same.
+	static void PrincipalAxis(const XMVECTOR* colors, FXMVECTOR mask, XMVECTOR& mean, XMVECTOR& axis)
+	{
+		XMVECTOR sum = XMVectorZero();
+		for (uint32_t i = 0; i < 16; ++i)
+			sum = XMVectorAdd(sum, colors[i]);
+		mean = XMVectorScale(sum, 1.f / 16.f);
+
+		XMVECTOR covariance[4] = { XMVectorZero(), XMVectorZero(), XMVectorZero(), XMVectorZero() };
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const XMVECTOR d = XMVectorMultiply(XMVectorSubtract(colors[i], mean), mask);
+			covariance[0] = XMVectorMultiplyAdd(d, XMVectorSplatX(d), covariance[0]);
+			covariance[1] = XMVectorMultiplyAdd(d, XMVectorSplatY(d), covariance[1]);
+			covariance[2] = XMVectorMultiplyAdd(d, XMVectorSplatZ(d), covariance[2]);
+			covariance[3] = XMVectorMultiplyAdd(d, XMVectorSplatW(d), covariance[3]);
+		}
+
+		// starts from the channel with the most variance, its row is never orthogonal to the axis
+		const float variances[4] = { XMVectorGetX(covariance[0]), XMVectorGetY(covariance[1]), XMVectorGetZ(covariance[2]), XMVectorGetW(covariance[3]) };
+		axis = covariance[std::max_element(variances, variances + 4) - variances];
+
+		for (uint32_t i = 0; i < POWER_ITERATIONS; ++i)
+		{
+			const float length = XMVectorGetX(XMVector4Length(axis));
+			if (length < 1e-6f)
+			{
+				axis = XMVectorZero();
+				return;
+			}
+			axis = XMVectorScale(axis, 1.f / length);
+
+			axis = XMVectorMultiplyAdd(covariance[0], XMVectorSplatX(axis),
+				XMVectorMultiplyAdd(covariance[1], XMVectorSplatY(axis),
+				XMVectorMultiplyAdd(covariance[2], XMVectorSplatZ(axis),
+				XMVectorMultiply(covariance[3], XMVectorSplatW(axis)))));
+		}
+		axis = XMVector4Normalize(axis);
+	}
+
+	// The extremes of the colors projected on the axis
+	static void AxisEndpoints(const XMVECTOR* colors, FXMVECTOR mean, FXMVECTOR axis, XMVECTOR& endpoint0, XMVECTOR& endpoint1)
+	{
+		float minT = FLT_MAX;
+		float maxT = -FLT_MAX;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const float t = XMVectorGetX(XMVector4Dot(XMVectorSubtract(colors[i], mean), axis));
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+
+		const XMVECTOR maxColor = XMVectorReplicate(255.f);
+		endpoint0 = XMVectorClamp(XMVectorMultiplyAdd(axis, XMVectorReplicate(minT), mean), XMVectorZero(), maxColor);
+		endpoint1 = XMVectorClamp(XMVectorMultiplyAdd(axis, XMVectorReplicate(maxT), mean), XMVectorZero(), maxColor);
+	}
+
+	// Endpoints minimizing the squared error of colors[i] = lerp(endpoint0, endpoint1, weights[indices[i]]),
+	// false when the indices don't constrain both endpoints
+	static bool SolveEndpoints(const XMVECTOR* colors, const uint32_t* indices, const float* weights, XMVECTOR& endpoint0, XMVECTOR& endpoint1)
+	{
+		float a = 0.f, b = 0.f, c = 0.f;
+		XMVECTOR x0 = XMVectorZero();
+		XMVECTOR x1 = XMVectorZero();
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const float w = weights[indices[i]];
+			a += (1.f - w) * (1.f - w);
+			b += (1.f - w) * w;
+			c += w * w;
+			x0 = XMVectorMultiplyAdd(colors[i], XMVectorReplicate(1.f - w), x0);
+			x1 = XMVectorMultiplyAdd(colors[i], XMVectorReplicate(w), x1);
+		}
+
+		const float det = a * c - b * b;
+		if (std::fabs(det) < 1e-6f)
+			return false;
+
+		const XMVECTOR maxColor = XMVectorReplicate(255.f);
+		endpoint0 = XMVectorScale(XMVectorSubtract(XMVectorScale(x0, c), XMVectorScale(x1, b)), 1.f / det);
+		endpoint1 = XMVectorScale(XMVectorSubtract(XMVectorScale(x1, a), XMVectorScale(x0, b)), 1.f / det);
+		endpoint0 = XMVectorClamp(endpoint0, XMVectorZero(), maxColor);
+		endpoint1 = XMVectorClamp(endpoint1, XMVectorZero(), maxColor);
+		return true;
+	}
+
+	// Nearest palette entry of each color, returns the total squared error
+	static float ChooseIndices(const XMVECTOR* colors, const XMVECTOR* palette, uint32_t paletteSize, uint32_t* indices)
+	{
+		float totalError = 0.f;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			float bestError = FLT_MAX;
+			for (uint32_t k = 0; k < paletteSize; ++k)
+			{
+				const XMVECTOR d = XMVectorSubtract(colors[i], palette[k]);
+				const float error = XMVectorGetX(XMVector4Dot(d, d));
+				if (error < bestError)
+				{
+					bestError = error;
+					indices[i] = k;
+				}
+			}
+			totalError += bestError;
+		}
+		return totalError;
+	}
+
+	static XMVECTOR RoundColor(FXMVECTOR color)
+	{
+		return XMVectorFloor(XMVectorAdd(color, XMVectorReplicate(0.5f)));
+	}
+
+	// BC1 and the color of BC3
+
+	static uint16_t QuantizeColor565(FXMVECTOR color)
+	{
+		const XMVECTOR scaled = RoundColor(XMVectorMultiply(color, XMVectorSet(31.f / 255.f, 63.f / 255.f, 31.f / 255.f, 0.f)));
+		return (uint16_t)(((uint32_t)XMVectorGetX(scaled) << 11) | ((uint32_t)XMVectorGetY(scaled) << 5) | (uint32_t)XMVectorGetZ(scaled));
+	}
+
+	static XMVECTOR LoadColor565(uint16_t color)
+	{
+		const uint32_t r = (color >> 11) & 31;
+		const uint32_t g = (color >> 5) & 63;
+		const uint32_t b = color & 31;
+		return XMVectorSet((float)((r << 3) | (r >> 2)), (float)((g << 2) | (g >> 4)), (float)((b << 3) | (b >> 2)), 255.f);
+	}
+
+	// Palette of the 4 color mode, rounded like the decoder does
+	static float ChooseColorIndices(const XMVECTOR* colors, uint16_t color0, uint16_t color1, uint32_t* indices)
+	{
+		const XMVECTOR c0 = LoadColor565(color0);
+		const XMVECTOR c1 = LoadColor565(color1);
+		const XMVECTOR palette[4] =
+		{
+			c0,
+			c1,
+			RoundColor(XMVectorLerp(c0, c1, 1.f / 3.f)),
+			RoundColor(XMVectorLerp(c0, c1, 2.f / 3.f)),
+		};
+		return ChooseIndices(colors, palette, 4, indices);
+	}
+
+	static void EncodeColorBlock(const uint32_t* texels, uint8_t* block)
+	{
+		// alpha is encoded separately (BC3) or ignored (BC1), it's set to 255 to not weigh in the errors
+		XMVECTOR colors[16];
+		LoadColors(texels, colors);
+		for (uint32_t i = 0; i < 16; ++i)
+			colors[i] = XMVectorSetW(colors[i], 255.f);
+
+		XMVECTOR mean, axis, endpoint0, endpoint1;
+		PrincipalAxis(colors, XMVectorSet(1.f, 1.f, 1.f, 0.f), mean, axis);
+		AxisEndpoints(colors, mean, axis, endpoint0, endpoint1);
+
+		uint16_t color0 = QuantizeColor565(endpoint0);
+		uint16_t color1 = QuantizeColor565(endpoint1);
+		uint32_t indices[16];
+		float error = ChooseColorIndices(colors, color0, color1, indices);
+
+		if (error > 0.f && SolveEndpoints(colors, indices, BC1_WEIGHTS, endpoint0, endpoint1))
+		{
+			const uint16_t refined0 = QuantizeColor565(endpoint0);
+			const uint16_t refined1 = QuantizeColor565(endpoint1);
+			uint32_t refinedIndices[16];
+			if (ChooseColorIndices(colors, refined0, refined1, refinedIndices) < error)
+			{
+				color0 = refined0;
+				color1 = refined1;
+				std::memcpy(indices, refinedIndices, sizeof(indices));
+			}
+		}
+
+		// the 4 color mode needs color0 > color1, swapping the endpoints swaps the indices 0/1 and 2/3
+		if (color0 < color1)
+		{
+			std::swap(color0, color1);
+			for (uint32_t i = 0; i < 16; ++i)
+				indices[i] ^= 1;
+		}
+		else if (color0 == color1)
+			std::fill(indices, indices + 16, 0u); // decoded with 3 colors, index 0 is the only one that's the same
+
+		uint32_t packedIndices = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+			packedIndices |= indices[i] << (2 * i);
+
+		block[0] = (uint8_t)(color0 & 0xff);
+		block[1] = (uint8_t)(color0 >> 8);
+		block[2] = (uint8_t)(color1 & 0xff);
+		block[3] = (uint8_t)(color1 >> 8);
+		std::memcpy(block + 4, &packedIndices, sizeof(packedIndices));
+	}
+
+	// BC4 block of one channel: the alpha of BC3 and each channel of BC5. Always the 8 values mode,
+	// the extremes of the block are the endpoints.
+	static void EncodeChannelBlock(const uint8_t* values, uint8_t* block)
+	{
+		const uint8_t maxValue = *std::max_element(values, values + 16);
+		const uint8_t minValue = *std::min_element(values, values + 16);
+		std::memset(block, 0, 8);
+		block[0] = maxValue;
+		block[1] = minValue;
+		if (maxValue == minValue)
+			return;
+
+		// same palette as the decoder: index 0 is the max, 1 the min, then 6 steps from the max
+		const XMVECTOR v0 = XMVectorReplicate(maxValue);
+		const XMVECTOR delta = XMVectorReplicate((float)minValue - (float)maxValue);
+		XMUBYTE4 low, high;
+		XMStoreUByte4(&low, RoundColor(XMVectorMultiplyAdd(delta, XMVectorScale(XMVectorSet(0.f, 7.f, 1.f, 2.f), 1.f / 7.f), v0)));
+		XMStoreUByte4(&high, RoundColor(XMVectorMultiplyAdd(delta, XMVectorScale(XMVectorSet(3.f, 4.f, 5.f, 6.f), 1.f / 7.f), v0)));
+		const uint8_t palette[8] = { low.x, low.y, low.z, low.w, high.x, high.y, high.z, high.w };
+
+		uint64_t packedIndices = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			uint32_t best = 0;
+			for (uint32_t k = 1; k < 8; ++k)
+			{
+				if (std::abs(values[i] - palette[k]) < std::abs(values[i] - palette[best]))
+					best = k;
+			}
+			packedIndices |= (uint64_t)best << (3 * i);
+		}
+		std::memcpy(block + 2, &packedIndices, 6);
+	}
+
+	// BC7 mode 6: 7 bit RGBA endpoints with a p bit each, 4 bit indices
+
+	// 7 bits per channel and the p bit (shared by the channels) closest to the 8 bit color
+	static void QuantizeBC7Endpoint(FXMVECTOR color, uint32_t* quantized, uint32_t& pBit)
+	{
+		XMFLOAT4A values;
+		XMStoreFloat4A(&values, color);
+		const float channels[4] = { values.x, values.y, values.z, values.w };
+
+		float bestError = FLT_MAX;
+		for (uint32_t p = 0; p < 2; ++p)
+		{
+			uint32_t candidate[4];
+			float error = 0.f;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				candidate[c] = (uint32_t)std::clamp((int)std::floor((channels[c] - p) * 0.5f + 0.5f), 0, 127);
+				const float d = (float)(candidate[c] * 2 + p) - channels[c];
+				error += d * d;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				pBit = p;
+				std::memcpy(quantized, candidate, sizeof(candidate));
+			}
+		}
+	}
+
+	static float ChooseBC7Indices(const XMVECTOR* colors, const uint32_t* quantized0, uint32_t pBit0, const uint32_t* quantized1, uint32_t pBit1, uint32_t* indices)
+	{
+		const XMVECTOR e0 = XMVectorSet((float)(quantized0[0] * 2 + pBit0), (float)(quantized0[1] * 2 + pBit0), (float)(quantized0[2] * 2 + pBit0), (float)(quantized0[3] * 2 + pBit0));
+		const XMVECTOR e1 = XMVectorSet((float)(quantized1[0] * 2 + pBit1), (float)(quantized1[1] * 2 + pBit1), (float)(quantized1[2] * 2 + pBit1), (float)(quantized1[3] * 2 + pBit1));
+		const XMVECTOR delta = XMVectorSubtract(e1, e0);
+
+		XMVECTOR palette[16];
+		for (uint32_t i = 0; i < 16; ++i)
+			palette[i] = RoundColor(XMVectorMultiplyAdd(delta, XMVectorReplicate(BC7_WEIGHTS4[i] / 64.f), e0));
+
+		// the weights are within half a step of i / 15: the projection on the endpoint line gives the index,
+		// its neighbors are checked for the rounding of the palette
+		const float lengthSq = XMVectorGetX(XMVector4Dot(delta, delta));
+		const float scale = lengthSq > 0.f ? 15.f / lengthSq : 0.f;
+		float totalError = 0.f;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const float t = XMVectorGetX(XMVector4Dot(XMVectorSubtract(colors[i], e0), delta)) * scale;
+			const int guess = std::clamp((int)std::floor(t + 0.5f), 0, 15);
+
+			float bestError = FLT_MAX;
+			for (int k = std::max(0, guess - 1); k <= std::min(15, guess + 1); ++k)
+			{
+				const XMVECTOR d = XMVectorSubtract(colors[i], palette[k]);
+				const float error = XMVectorGetX(XMVector4Dot(d, d));
+				if (error < bestError)
+				{
+					bestError = error;
+					indices[i] = (uint32_t)k;
+				}
+			}
+			totalError += bestError;
+		}
+		return totalError;
+	}
+
+	static void EncodeBC7(const uint32_t* texels, uint8_t* block)
+	{
+		static const auto weights = [] {
+			std::array<float, 16> w;
+			for (uint32_t i = 0; i < 16; ++i)
+				w[i] = BC7_WEIGHTS4[i] / 64.f;
+			return w;
+		}();
+
+		XMVECTOR colors[16];
+		LoadColors(texels, colors);
+
+		XMVECTOR mean, axis, endpoint0, endpoint1;
+		PrincipalAxis(colors, XMVectorSplatOne(), mean, axis);
+		AxisEndpoints(colors, mean, axis, endpoint0, endpoint1);
+
+		uint32_t quantized[2][4], pBits[2];
+		QuantizeBC7Endpoint(endpoint0, quantized[0], pBits[0]);
+		QuantizeBC7Endpoint(endpoint1, quantized[1], pBits[1]);
+		uint32_t indices[16];
+		float error = ChooseBC7Indices(colors, quantized[0], pBits[0], quantized[1], pBits[1], indices);
+
+		if (error > 0.f && SolveEndpoints(colors, indices, weights.data(), endpoint0, endpoint1))
+		{
+			uint32_t refined[2][4], refinedPBits[2], refinedIndices[16];
+			QuantizeBC7Endpoint(endpoint0, refined[0], refinedPBits[0]);
+			QuantizeBC7Endpoint(endpoint1, refined[1], refinedPBits[1]);
+			if (ChooseBC7Indices(colors, refined[0], refinedPBits[0], refined[1], refinedPBits[1], refinedIndices) < error)
+			{
+				std::memcpy(quantized, refined, sizeof(quantized));
+				std::memcpy(pBits, refinedPBits, sizeof(pBits));
+				std::memcpy(indices, refinedIndices, sizeof(indices));
+			}
+		}
+
+		// the index of the first pixel is stored without its high bit, swapping the endpoints inverts the indices
+		if (indices[0] >= 8)
+		{
+			std::swap(quantized[0], quantized[1]);
+			std::swap(pBits[0], pBits[1]);
+			for (uint32_t i = 0; i < 16; ++i)
+				indices[i] = 15 - indices[i];
+		}
+
+		std::memset(block, 0, 16);
+		BitWriter bits{ block };
+		bits.Write(1 << 6, 7); // mode 6
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			bits.Write(quantized[0][c], 7);
+			bits.Write(quantized[1][c], 7);
+		}
+		bits.Write(pBits[0], 1);
+		bits.Write(pBits[1], 1);
+		for (uint32_t i = 0; i < 16; ++i)
+			bits.Write(indices[i], i == 0 ? 3 : 4);
+	}
+
+	bool IsSupported(DXGI_FORMAT format)
+	{
+		return GetBlockBytes(format) != 0;
+	}
+
+	size_t GetEncodedSize(DXGI_FORMAT format, uint32_t width, uint32_t height)
+	{
+		return (size_t)std::max(1u, (width + 3) / 4) * std::max(1u, (height + 3) / 4) * GetBlockBytes(format);
+	}
+
+	void Encode(DXGI_FORMAT format, const uint32_t* pixels, uint32_t width, uint32_t height, uint8_t* data)
+	{
+		assert(IsSupported(format) && "Format can't be encoded");
+
+		const uint32_t blockBytes = GetBlockBytes(format);
+		const uint32_t blocksWide = (width + 3) / 4;
+		const uint32_t blocksHigh = (height + 3) / 4;
+		ThreadPool::Get().ParallelFor(blocksHigh, std::max<size_t>(1, BLOCKS_PER_TASK / blocksWide), [&](size_t begin, size_t end)
+		{
+			uint32_t texels[16];
+			uint8_t values[16];
+			for (size_t by = begin; by < end; ++by)
+			{
+				for (uint32_t bx = 0; bx < blocksWide; ++bx)
+				{
+					uint8_t* block = data + (by * blocksWide + bx) * blockBytes;
+					LoadBlock(pixels, width, height, bx, (uint32_t)by, texels);
+
+					switch (format)
+					{
+					case DXGI_FORMAT_BC1_UNORM:
+					case DXGI_FORMAT_BC1_UNORM_SRGB:
+						EncodeColorBlock(texels, block);
+						break;
+					case DXGI_FORMAT_BC3_UNORM:
+					case DXGI_FORMAT_BC3_UNORM_SRGB:
+						for (uint32_t i = 0; i < 16; ++i)
+							values[i] = (uint8_t)(texels[i] >> 24);
+						EncodeChannelBlock(values, block);
+						EncodeColorBlock(texels, block + 8);
+						break;
+					case DXGI_FORMAT_BC5_UNORM:
+						for (uint32_t i = 0; i < 16; ++i)
+							values[i] = (uint8_t)(texels[i] & 0xff);
+						EncodeChannelBlock(values, block);
+						for (uint32_t i = 0; i < 16; ++i)
+							values[i] = (uint8_t)((texels[i] >> 8) & 0xff);
+						EncodeChannelBlock(values, block + 8);
+						break;
+					default:
+						EncodeBC7(texels, block);
+						break;
+					}
+				}
+			}
+		});
+	}
+
+	bool WriteDDS(const std::string& path, DXGI_FORMAT format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& mips)
+	{
+		std::ofstream out(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		if (!out.is_open())
+		{
+			LOG_ERROR("Failed to write file {0}", path);
+			return false;
+		}
+
+		DDS::Header header{};
+		header.Size = sizeof(DDS::Header);
+		// size of the first mip for the compressed formats, of one row for the others
+		const bool isCompressed = IsSupported(format);
+		header.Flags = DDS::DDSD_CAPS | DDS::DDSD_HEIGHT | DDS::DDSD_WIDTH | DDS::DDSD_PIXELFORMAT | DDS::DDSD_MIPMAPCOUNT |
+			(isCompressed ? DDS::DDSD_LINEARSIZE : DDS::DDSD_PITCH);
+		header.Height = height;
+		header.Width = width;
+		header.PitchOrLinearSize = (uint32_t)(isCompressed ? mips[0].size() : mips[0].size() / height);
+		header.MipMapCount = (uint32_t)mips.size();
+		header.PixelFormat.Size = sizeof(DDS::PixelFormat);
+		header.PixelFormat.Flags = DDS::DDPF_FOURCC;
+		header.PixelFormat.FourCC = DDS::MakeFourCC('D', 'X', '1', '0');
+		header.Caps = DDS::DDSCAPS_TEXTURE | (mips.size() > 1 ? DDS::DDSCAPS_COMPLEX | DDS::DDSCAPS_MIPMAP : 0);
+
+		DDS::HeaderDXT10 header10{};
+		header10.Format = format;
+		header10.ResourceDimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		header10.ArraySize = 1;
+
+		out.write((const char*)&DDS::MAGIC, sizeof(DDS::MAGIC));
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)&header10, sizeof(header10));
+		for (const auto& mip : mips)
+			out.write((const char*)mip.data(), mip.size());
+
+		return out.good();
+	}
+}
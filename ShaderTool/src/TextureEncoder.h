@@ -0,0 +1,24 @@
+#pragma once
+
+#include <dxgiformat.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Block compression of RGBA8 images for the imported textures: BC1 and BC3 (4 colors), BC5 (red
+// and green) and BC7 (mode 6 only, one subset with alpha and 16 weights). The endpoints are the
+// extremes of the block along the principal axis of its colors, then refined once by least squares
+// with the chosen indices. The rows of blocks are split between the workers.
+namespace TextureEncoder
+{
+	bool IsSupported(DXGI_FORMAT format);
+
+	// Bytes of one mip, rows of (width + 3) / 4 blocks
+	size_t GetEncodedSize(DXGI_FORMAT format, uint32_t width, uint32_t height);
+
+	void Encode(DXGI_FORMAT format, const uint32_t* pixels, uint32_t width, uint32_t height, uint8_t* data);
+
+	// One 2D texture with its mips, finest first, written with the DX10 header. The format can also
+	// be uncompressed, the mips are then rows of pixels without padding.
+	bool WriteDDS(const std::string& path, DXGI_FORMAT format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& mips);
+}
@@ -0,0 +1,108 @@
+#include "pch.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+ThreadPool::ThreadPool()
+{
+	const unsigned int numCores = std::thread::hardware_concurrency();
+	const unsigned int numWorkers = numCores > 1 ? numCores - 1 : 0;
+
+	for (unsigned int i = 0; i < numWorkers; ++i)
+		_Workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_Mutex);
+		_Stopping = true;
+	}
+	_Condition.notify_all();
+
+	for (auto& worker : _Workers)
+		worker.join();
+}
+
+void ThreadPool::WorkerLoop(unsigned int index)
+{
+	Profiler::SetThreadName(("Worker " + std::to_string(index)).c_str());
+
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(_Mutex);
+			_Condition.wait(lock, [this] { return _Stopping || !_Tasks.empty(); });
+
+			if (_Stopping && _Tasks.empty())
+				return;
+
+			task = std::move(_Tasks.front());
+			_Tasks.pop_front();
+		}
+		task();
+	}
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& func)
+{
+	if (count == 0)
+		return;
+
+	if (grainSize == 0)
+		grainSize = 1;
+
+	const size_t numChunks = (count + grainSize - 1) / grainSize;
+	if (numChunks == 1 || _Workers.empty())
+	{
+		func(0, count);
+		return;
+	}
+
+	// Shared with the helper tasks, a helper that starts after all the chunks
+	// were taken just leaves without touching func.
+	struct Job
+	{
+		std::atomic<size_t> NextChunk{ 0 };
+		std::atomic<size_t> DoneChunks{ 0 };
+		std::mutex Mutex;
+		std::condition_variable Done;
+	};
+	auto job = std::make_shared<Job>();
+	const auto* funcPtr = &func;
+
+	auto runChunks = [job, funcPtr, count, grainSize, numChunks]()
+	{
+		for (;;)
+		{
+			const size_t chunk = job->NextChunk.fetch_add(1);
+			if (chunk >= numChunks)
+				return;
+
+			PROFILE_SCOPE("ParallelFor");
+			const size_t begin = chunk * grainSize;
+			const size_t end = begin + grainSize < count ? begin + grainSize : count;
+			(*funcPtr)(begin, end);
+
+			if (job->DoneChunks.fetch_add(1) + 1 == numChunks)
+			{
+				std::lock_guard<std::mutex> lock(job->Mutex);
+				job->Done.notify_all();
+			}
+		}
+	};
+
+	const size_t numHelpers = numChunks - 1 < _Workers.size() ? numChunks - 1 : _Workers.size();
+	{
+		std::lock_guard<std::mutex> lock(_Mutex);
+		for (size_t i = 0; i < numHelpers; ++i)
+			_Tasks.push_back(runChunks);
+	}
+	_Condition.notify_all();
+
+	runChunks();
+
+	// only wait for chunks taken by helpers that are already running them
+	std::unique_lock<std::mutex> lock(job->Mutex);
+	job->Done.wait(lock, [&job, numChunks] { return job->DoneChunks.load() == numChunks; });
+}
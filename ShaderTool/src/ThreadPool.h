@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Worker threads shared by the CPU heavy tasks (model import, mesh processing, ...).
+class ThreadPool
+{
+public:
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool();
+
+	static ThreadPool& Get()
+	{
+		static ThreadPool instance;
+		return instance;
+	}
+
+	size_t GetNumThreads() const { return _Workers.size() + 1; }
+
+	// Calls func(begin, end) over [0, count) split in chunks of grainSize. The calling thread
+	// processes chunks too and the call returns once all of them are done, so it can be nested.
+	void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& func);
+
+private:
+	ThreadPool();
+
+	void WorkerLoop(unsigned int index);
+
+private:
+	std::vector<std::thread> _Workers;
+	std::deque<std::function<void()>> _Tasks;
+	std::mutex _Mutex;
+	std::condition_variable _Condition;
+	bool _Stopping{ false };
+};
@@ -0,0 +1,293 @@
+#include "pch.h"
+#include "ThumbnailRasterizer.h"
+#include "ThreadPool.h"
+#include "Defines.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace ThumbnailRasterizer
+{
+	static constexpr size_t VERTICES_PER_TASK = 4096;
+	static constexpr size_t TRIANGLES_PER_TASK = 4096;
+
+	static constexpr float FIELD_OF_VIEW = XM_PIDIV4;
+	static constexpr float CAMERA_PITCH = 0.4f; // radians, looking slightly down on the mesh
+	static constexpr float AMBIENT = 0.2f;
+
+	struct ScreenVertex
+	{
+		float X, Y;  // pixels, y down
+		float Z;     // 0 at the near plane, 1 at the far plane
+		float Shade; // N.L
+	};
+
+	// Value = A * x + B * y + C at the pixel centers. The edge functions are normalized so each
+	// one is the barycentric of the vertex opposite to its edge.
+	struct TriangleSetup
+	{
+		float EdgeA[3], EdgeB[3], EdgeC[3];
+		bool TopLeft[3]; // the pixel centers on a top or left edge belong to the triangle
+		float DepthA, DepthB, DepthC;
+		float ShadeA, ShadeB, ShadeC;
+		int MinX, MinY, MaxX, MaxY; // pixels, inclusive
+	};
+
+	// Triangles set up by one task, binned per tile in the order of the index buffer
+	struct TriangleBatch
+	{
+		std::vector<TriangleSetup> Triangles;
+		std::vector<std::vector<uint32_t>> Bins;
+	};
+
+	static bool Setup(const ScreenVertex& v0, const ScreenVertex& v1, const ScreenVertex& v2, uint32_t size, TriangleSetup& tri)
+	{
+		// twice the signed area, positive for the triangles clockwise on screen (the front faces)
+		const float area = (v1.X - v0.X) * (v2.Y - v0.Y) - (v1.Y - v0.Y) * (v2.X - v0.X);
+		if (!(area > 0.f))
+			return false;
+
+		const float minX = std::min({ v0.X, v1.X, v2.X });
+		const float maxX = std::max({ v0.X, v1.X, v2.X });
+		const float minY = std::min({ v0.Y, v1.Y, v2.Y });
+		const float maxY = std::max({ v0.Y, v1.Y, v2.Y });
+		if (maxX < 0.f || maxY < 0.f || minX >= size || minY >= size)
+			return false;
+
+		tri.MinX = std::max((int)std::floor(minX), 0);
+		tri.MinY = std::max((int)std::floor(minY), 0);
+		tri.MaxX = std::min((int)std::ceil(maxX), (int)size - 1);
+		tri.MaxY = std::min((int)std::ceil(maxY), (int)size - 1);
+
+		const ScreenVertex* v[3] = { &v0, &v1, &v2 };
+		const float invArea = 1.f / area;
+		for (int i = 0; i < 3; ++i)
+		{
+			// edge opposite to the vertex i
+			const ScreenVertex& a = *v[(i + 1) % 3];
+			const ScreenVertex& b = *v[(i + 2) % 3];
+
+			const float edgeA = a.Y - b.Y;
+			const float edgeB = b.X - a.X;
+			tri.EdgeA[i] = edgeA * invArea;
+			tri.EdgeB[i] = edgeB * invArea;
+			tri.EdgeC[i] = -(edgeA * a.X + edgeB * a.Y) * invArea;
+
+			// clockwise with y down, the top edges go right and the left edges go up
+			tri.TopLeft[i] = (a.Y == b.Y && b.X > a.X) || b.Y < a.Y;
+		}
+
+		tri.DepthA = tri.EdgeA[0] * v0.Z + tri.EdgeA[1] * v1.Z + tri.EdgeA[2] * v2.Z;
+		tri.DepthB = tri.EdgeB[0] * v0.Z + tri.EdgeB[1] * v1.Z + tri.EdgeB[2] * v2.Z;
+		tri.DepthC = tri.EdgeC[0] * v0.Z + tri.EdgeC[1] * v1.Z + tri.EdgeC[2] * v2.Z;
+
+		// interpolated in screen space, the error is not visible at this size
+		tri.ShadeA = tri.EdgeA[0] * v0.Shade + tri.EdgeA[1] * v1.Shade + tri.EdgeA[2] * v2.Shade;
+		tri.ShadeB = tri.EdgeB[0] * v0.Shade + tri.EdgeB[1] * v1.Shade + tri.EdgeB[2] * v2.Shade;
+		tri.ShadeC = tri.EdgeC[0] * v0.Shade + tri.EdgeC[1] * v1.Shade + tri.EdgeC[2] * v2.Shade;
+
+		return true;
+	}
+
+	static void RasterizeTile(const std::vector<TriangleBatch>& batches, uint32_t tileX, uint32_t tileY, uint32_t numTilesX, uint32_t size, uint32_t* pixels)
+	{
+		alignas(16) float depth[TILE_SIZE * TILE_SIZE];
+		alignas(16) float shade[TILE_SIZE * TILE_SIZE];
+		std::fill(std::begin(depth), std::end(depth), 1.f);
+		std::fill(std::begin(shade), std::end(shade), 0.f);
+
+		const int x0 = tileX * TILE_SIZE;
+		const int y0 = tileY * TILE_SIZE;
+		const int x1 = std::min(x0 + (int)TILE_SIZE, (int)size) - 1;
+		const int y1 = std::min(y0 + (int)TILE_SIZE, (int)size) - 1;
+		const uint32_t tile = tileY * numTilesX + tileX;
+
+		const XMVECTOR laneCenters = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+		const XMVECTOR zero = XMVectorZero();
+
+		for (const TriangleBatch& batch : batches)
+		{
+			for (uint32_t index : batch.Bins[tile])
+			{
+				const TriangleSetup& tri = batch.Triangles[index];
+
+				// groups of 4 pixels aligned to the tile, the lanes outside the triangle fail the edge test
+				const int minX = std::max(tri.MinX, x0) & ~3;
+				const int maxX = std::min(tri.MaxX, x1);
+				const int minY = std::max(tri.MinY, y0);
+				const int maxY = std::min(tri.MaxY, y1);
+
+				const XMVECTOR edgeA0 = XMVectorReplicate(tri.EdgeA[0]);
+				const XMVECTOR edgeA1 = XMVectorReplicate(tri.EdgeA[1]);
+				const XMVECTOR edgeA2 = XMVectorReplicate(tri.EdgeA[2]);
+				const XMVECTOR depthA = XMVectorReplicate(tri.DepthA);
+				const XMVECTOR shadeA = XMVectorReplicate(tri.ShadeA);
+
+				for (int y = minY; y <= maxY; ++y)
+				{
+					const float py = y + 0.5f;
+					const XMVECTOR row0 = XMVectorReplicate(tri.EdgeB[0] * py + tri.EdgeC[0]);
+					const XMVECTOR row1 = XMVectorReplicate(tri.EdgeB[1] * py + tri.EdgeC[1]);
+					const XMVECTOR row2 = XMVectorReplicate(tri.EdgeB[2] * py + tri.EdgeC[2]);
+					const XMVECTOR depthRow = XMVectorReplicate(tri.DepthB * py + tri.DepthC);
+					const XMVECTOR shadeRow = XMVectorReplicate(tri.ShadeB * py + tri.ShadeC);
+
+					for (int x = minX; x <= maxX; x += 4)
+					{
+						const XMVECTOR px = XMVectorAdd(XMVectorReplicate((float)x), laneCenters);
+
+						const XMVECTOR w0 = XMVectorMultiplyAdd(edgeA0, px, row0);
+						const XMVECTOR w1 = XMVectorMultiplyAdd(edgeA1, px, row1);
+						const XMVECTOR w2 = XMVectorMultiplyAdd(edgeA2, px, row2);
+
+						XMVECTOR inside = tri.TopLeft[0] ? XMVectorGreaterOrEqual(w0, zero) : XMVectorGreater(w0, zero);
+						inside = XMVectorAndInt(inside, tri.TopLeft[1] ? XMVectorGreaterOrEqual(w1, zero) : XMVectorGreater(w1, zero));
+						inside = XMVectorAndInt(inside, tri.TopLeft[2] ? XMVectorGreaterOrEqual(w2, zero) : XMVectorGreater(w2, zero));
+						if (XMComparisonAllFalse(XMVector4EqualIntR(inside, XMVectorTrueInt())))
+							continue;
+
+						const size_t offset = (y - y0) * TILE_SIZE + (x - x0);
+						const XMVECTOR z = XMVectorMultiplyAdd(depthA, px, depthRow);
+						const XMVECTOR oldZ = XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(&depth[offset]));
+						const XMVECTOR pass = XMVectorAndInt(inside, XMVectorLess(z, oldZ));
+
+						const XMVECTOR s = XMVectorMultiplyAdd(shadeA, px, shadeRow);
+						const XMVECTOR oldS = XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(&shade[offset]));
+
+						XMStoreFloat4A(reinterpret_cast<XMFLOAT4A*>(&depth[offset]), XMVectorSelect(oldZ, z, pass));
+						XMStoreFloat4A(reinterpret_cast<XMFLOAT4A*>(&shade[offset]), XMVectorSelect(oldS, s, pass));
+					}
+				}
+			}
+		}
+
+		for (int y = y0; y <= y1; ++y)
+		{
+			for (int x = x0; x <= x1; ++x)
+			{
+				const size_t offset = (y - y0) * TILE_SIZE + (x - x0);
+				if (depth[offset] >= 1.f)
+				{
+					pixels[y * size + x] = 0;
+					continue;
+				}
+
+				const float intensity = AMBIENT + (1.f - AMBIENT) * std::clamp(shade[offset], 0.f, 1.f);
+				const uint32_t c = (uint32_t)(intensity * 255.f + 0.5f);
+				pixels[y * size + x] = c | (c << 8) | (c << 16) | 0xFF000000;
+			}
+		}
+	}
+
+	std::shared_ptr<const PreviewMesh> CreatePreviewMesh(
+		const std::vector<Vertex>& vertices,
+		const std::vector<uint32_t>& indices,
+		const std::vector<MeshSimplifier::Lod>& lods)
+	{
+		const std::vector<uint32_t>* source = &indices;
+		for (const auto& lod : lods)
+		{
+			if (source->size() / 3 <= PREVIEW_MAX_TRIANGLES || lod.Indices.empty())
+				break;
+			source = &lod.Indices;
+		}
+
+		auto mesh = std::make_shared<PreviewMesh>();
+		mesh->Indices.reserve(source->size());
+
+		// only the vertices the level uses
+		std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+		for (uint32_t index : *source)
+		{
+			uint32_t& newIndex = remap[index];
+			if (newIndex == UINT32_MAX)
+			{
+				newIndex = (uint32_t)mesh->Positions.size();
+				mesh->Positions.push_back(vertices[index].Position);
+				mesh->Normals.push_back(vertices[index].Normal);
+			}
+			mesh->Indices.push_back(newIndex);
+		}
+
+		if (!mesh->Positions.empty())
+			BoundingSphere::CreateFromPoints(mesh->Sphere, mesh->Positions.size(), mesh->Positions.data(), sizeof(XMFLOAT3));
+
+		return mesh;
+	}
+
+	void Render(const PreviewMesh& mesh, float yaw, uint32_t size, uint32_t* pixels)
+	{
+		assert(size % 4 == 0 && "The thumbnail size must be a multiple of 4");
+
+		// the whole sphere fits the view and is in front of the near plane, nothing has to be clipped
+		const XMVECTOR center = XMLoadFloat3(&mesh.Sphere.Center);
+		const float radius = std::max(mesh.Sphere.Radius, 1e-4f);
+		const float distance = radius / std::sin(FIELD_OF_VIEW * 0.5f);
+		const XMVECTOR direction = XMVectorSet(
+			std::sin(yaw) * std::cos(CAMERA_PITCH),
+			std::sin(CAMERA_PITCH),
+			-std::cos(yaw) * std::cos(CAMERA_PITCH),
+			0.f);
+		const XMVECTOR eye = XMVectorAdd(center, XMVectorScale(direction, distance));
+		const XMMATRIX viewProj = XMMatrixMultiply(
+			XMMatrixLookAtLH(eye, center, XMVectorSet(0.f, 1.f, 0.f, 0.f)),
+			XMMatrixPerspectiveFovLH(FIELD_OF_VIEW, 1.f, (distance - radius) * 0.9f, distance + radius * 1.1f));
+
+		// light above the viewer
+		const XMVECTOR light = XMVector3Normalize(XMVectorAdd(direction, XMVectorSet(0.f, 1.f, 0.f, 0.f)));
+
+		std::vector<ScreenVertex> screen(mesh.Positions.size());
+		ThreadPool::Get().ParallelFor(screen.size(), VERTICES_PER_TASK, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				const XMVECTOR ndc = XMVector3TransformCoord(XMLoadFloat3(&mesh.Positions[i]), viewProj);
+				const XMVECTOR normal = XMVector3Normalize(XMLoadFloat3(&mesh.Normals[i]));
+
+				ScreenVertex& v = screen[i];
+				v.X = (XMVectorGetX(ndc) * 0.5f + 0.5f) * size;
+				v.Y = (0.5f - XMVectorGetY(ndc) * 0.5f) * size;
+				v.Z = XMVectorGetZ(ndc);
+				v.Shade = XMVectorGetX(XMVector3Dot(normal, light));
+			}
+		});
+
+		const uint32_t numTilesX = (size + TILE_SIZE - 1) / TILE_SIZE;
+		const uint32_t numTiles = numTilesX * numTilesX;
+		const size_t numTriangles = mesh.Indices.size() / 3;
+
+		std::vector<TriangleBatch> batches((numTriangles + TRIANGLES_PER_TASK - 1) / TRIANGLES_PER_TASK);
+		ThreadPool::Get().ParallelFor(batches.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t b = begin; b < end; ++b)
+			{
+				TriangleBatch& batch = batches[b];
+				batch.Bins.resize(numTiles);
+
+				const size_t first = b * TRIANGLES_PER_TASK;
+				const size_t last = std::min(first + TRIANGLES_PER_TASK, numTriangles);
+				for (size_t t = first; t < last; ++t)
+				{
+					TriangleSetup tri;
+					if (!Setup(screen[mesh.Indices[t * 3 + 0]], screen[mesh.Indices[t * 3 + 1]], screen[mesh.Indices[t * 3 + 2]], size, tri))
+						continue;
+
+					const uint32_t index = (uint32_t)batch.Triangles.size();
+					batch.Triangles.push_back(tri);
+
+					for (int ty = tri.MinY / (int)TILE_SIZE; ty <= tri.MaxY / (int)TILE_SIZE; ++ty)
+						for (int tx = tri.MinX / (int)TILE_SIZE; tx <= tri.MaxX / (int)TILE_SIZE; ++tx)
+							batch.Bins[ty * numTilesX + tx].push_back(index);
+				}
+			}
+		});
+
+		ThreadPool::Get().ParallelFor(numTiles, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t tile = begin; tile < end; ++tile)
+				RasterizeTile(batches, (uint32_t)(tile % numTilesX), (uint32_t)(tile / numTilesX), numTilesX, size, pixels);
+		});
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Rendering/Vertex.h"
+#include "MeshSimplifier.h"
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Geometry of a model kept on the CPU for its preview, a single LOD with only the vertices it uses
+struct PreviewMesh
+{
+	std::vector<DirectX::XMFLOAT3> Positions;
+	std::vector<DirectX::XMFLOAT3> Normals;
+	std::vector<uint32_t> Indices;
+	DirectX::BoundingSphere Sphere;
+};
+
+// Software rasterizer for the node previews, it doesn't need the GPU or a render target.
+// The image is split in tiles and the triangles are binned by the tiles their bounds overlap,
+// then each tile is rasterized by a worker with its own depth buffer, 4 pixels at a time (edge
+// functions, depth test and shading in one XMVECTOR). Shading is N.L per vertex with a light
+// above the viewer, the front faces are clockwise like in the GPU pipeline.
+namespace ThumbnailRasterizer
+{
+	constexpr uint32_t TILE_SIZE = 32;
+
+	// The finest level with at most PREVIEW_MAX_TRIANGLES, the coarsest one when none fits
+	std::shared_ptr<const PreviewMesh> CreatePreviewMesh(
+		const std::vector<Vertex>& vertices,
+		const std::vector<uint32_t>& indices,
+		const std::vector<MeshSimplifier::Lod>& lods);
+
+	// size x size RGBA8 pixels, top row first, transparent where nothing is drawn. The camera
+	// orbits the bounding sphere of the mesh, yaw in radians. size must be a multiple of 4.
+	void Render(const PreviewMesh& mesh, float yaw, uint32_t size, uint32_t* pixels);
+}
@@ -0,0 +1,141 @@
+#include "pch.h"
+#include "TransformBatch.h"
+#include "ThreadPool.h"
+
+using namespace DirectX;
+
+// groups of 4 transforms composed by each task, below that the batch is evaluated on the calling thread
+static constexpr size_t GROUPS_PER_TASK = 256;
+
+// XMScalarSinCos of 4 angles. The operations and constants are the scalar ones, in the same order
+// and without fused multiply-adds, so the results match the ones of XMMatrixRotationX/Y/Z.
+static void XM_CALLCONV SinCos(FXMVECTOR angle, XMVECTOR* sin, XMVECTOR* cos)
+{
+	// Map angle to y in [-pi,pi], angle = 2*pi*quotient + remainder.
+	const XMVECTOR positive = XMVectorGreaterOrEqual(angle, XMVectorZero());
+	XMVECTOR quotient = XMVectorMultiply(XMVectorReplicate(XM_1DIV2PI), angle);
+	quotient = XMVectorAdd(quotient, XMVectorSelect(XMVectorReplicate(-0.5f), g_XMOneHalf, positive));
+	quotient = XMVectorTruncate(quotient);
+	XMVECTOR y = XMVectorSubtract(angle, XMVectorMultiply(g_XMTwoPi, quotient));
+
+	// Map y to [-pi/2,pi/2] with sin(y) = sin(angle).
+	const XMVECTOR above = XMVectorGreater(y, g_XMHalfPi);
+	const XMVECTOR below = XMVectorLess(y, XMVectorNegate(g_XMHalfPi));
+	y = XMVectorSelect(y, XMVectorSubtract(g_XMPi, y), above);
+	y = XMVectorSelect(y, XMVectorSubtract(g_XMNegativePi, y), below);
+	const XMVECTOR sign = XMVectorSelect(g_XMOne, g_XMNegativeOne, XMVectorOrInt(above, below));
+
+	const XMVECTOR y2 = XMVectorMultiply(y, y);
+
+	// 11-degree minimax approximation
+	XMVECTOR s = XMVectorAdd(XMVectorMultiply(XMVectorReplicate(-2.3889859e-08f), y2), XMVectorReplicate(2.7525562e-06f));
+	s = XMVectorSubtract(XMVectorMultiply(s, y2), XMVectorReplicate(0.00019840874f));
+	s = XMVectorAdd(XMVectorMultiply(s, y2), XMVectorReplicate(0.0083333310f));
+	s = XMVectorSubtract(XMVectorMultiply(s, y2), XMVectorReplicate(0.16666667f));
+	s = XMVectorAdd(XMVectorMultiply(s, y2), g_XMOne);
+	*sin = XMVectorMultiply(s, y);
+
+	// 10-degree minimax approximation
+	XMVECTOR c = XMVectorAdd(XMVectorMultiply(XMVectorReplicate(-2.6051615e-07f), y2), XMVectorReplicate(2.4760495e-05f));
+	c = XMVectorSubtract(XMVectorMultiply(c, y2), XMVectorReplicate(0.0013888378f));
+	c = XMVectorAdd(XMVectorMultiply(c, y2), XMVectorReplicate(0.041666638f));
+	c = XMVectorSubtract(XMVectorMultiply(c, y2), g_XMOneHalf);
+	c = XMVectorAdd(XMVectorMultiply(c, y2), g_XMOne);
+	*cos = XMVectorMultiply(sign, c);
+}
+
+static XMVECTOR Load(const std::vector<float>& values, size_t index)
+{
+	return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&values[index]));
+}
+
+static void XM_CALLCONV Store(FXMVECTOR c0, FXMVECTOR c1, FXMVECTOR c2, GXMVECTOR c3, XMFLOAT4X4* worlds, size_t row)
+{
+	// the columns hold one row of 4 matrices, transposing gives the row of each matrix
+	const XMMATRIX rows = XMMatrixTranspose(XMMATRIX(c0, c1, c2, c3));
+	for (size_t i = 0; i < 4; ++i)
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(worlds[i].m[row]), rows.r[i]);
+}
+
+void TransformBatch::Clear()
+{
+	_Size = 0;
+	_PositionX.clear(); _PositionY.clear(); _PositionZ.clear();
+	_RotationX.clear(); _RotationY.clear(); _RotationZ.clear();
+	_ScaleX.clear(); _ScaleY.clear(); _ScaleZ.clear();
+}
+
+size_t TransformBatch::Add(const XMFLOAT3& position, const XMFLOAT3& rotation, const XMFLOAT3& scale)
+{
+	_PositionX.push_back(position.x); _PositionY.push_back(position.y); _PositionZ.push_back(position.z);
+	_RotationX.push_back(rotation.x); _RotationY.push_back(rotation.y); _RotationZ.push_back(rotation.z);
+	_ScaleX.push_back(scale.x); _ScaleY.push_back(scale.y); _ScaleZ.push_back(scale.z);
+	return _Size++;
+}
+
+void TransformBatch::Evaluate()
+{
+	if (_Size == 0)
+		return;
+
+	// the last group is padded with identity transforms
+	const size_t numGroups = (_Size + 3) / 4;
+	const size_t paddedSize = numGroups * 4;
+	_PositionX.resize(paddedSize, 0.f); _PositionY.resize(paddedSize, 0.f); _PositionZ.resize(paddedSize, 0.f);
+	_RotationX.resize(paddedSize, 0.f); _RotationY.resize(paddedSize, 0.f); _RotationZ.resize(paddedSize, 0.f);
+	_ScaleX.resize(paddedSize, 1.f); _ScaleY.resize(paddedSize, 1.f); _ScaleZ.resize(paddedSize, 1.f);
+	_Worlds.resize(paddedSize);
+
+	if (numGroups <= GROUPS_PER_TASK)
+	{
+		EvaluateRange(0, numGroups);
+		return;
+	}
+
+	ThreadPool::Get().ParallelFor(numGroups, GROUPS_PER_TASK, [this](size_t begin, size_t end)
+	{
+		EvaluateRange(begin, end);
+	});
+}
+
+void TransformBatch::EvaluateRange(size_t begin, size_t end)
+{
+	for (size_t group = begin; group < end; ++group)
+	{
+		const size_t i = group * 4;
+
+		XMVECTOR sinX, cosX, sinY, cosY, sinZ, cosZ;
+		SinCos(Load(_RotationX, i), &sinX, &cosX);
+		SinCos(Load(_RotationY, i), &sinY, &cosY);
+		SinCos(Load(_RotationZ, i), &sinZ, &cosZ);
+
+		// rotationY * rotationZ, the entries that aren't plain sines and cosines
+		const XMVECTOR yz00 = XMVectorMultiply(cosY, cosZ);
+		const XMVECTOR yz01 = XMVectorMultiply(cosY, sinZ);
+		const XMVECTOR yz20 = XMVectorMultiply(sinY, cosZ);
+		const XMVECTOR yz21 = XMVectorMultiply(sinY, sinZ);
+
+		// rotationX * (rotationY * rotationZ), every entry of XMMatrixMultiply sums at most two products
+		const XMVECTOR r00 = yz00;
+		const XMVECTOR r01 = yz01;
+		const XMVECTOR r02 = XMVectorNegate(sinY);
+		const XMVECTOR r10 = XMVectorAdd(XMVectorMultiply(cosX, XMVectorNegate(sinZ)), XMVectorMultiply(sinX, yz20));
+		const XMVECTOR r11 = XMVectorAdd(XMVectorMultiply(cosX, cosZ), XMVectorMultiply(sinX, yz21));
+		const XMVECTOR r12 = XMVectorMultiply(sinX, cosY);
+		const XMVECTOR r20 = XMVectorAdd(XMVectorMultiply(sinX, sinZ), XMVectorMultiply(cosX, yz20));
+		const XMVECTOR r21 = XMVectorAdd(XMVectorMultiply(XMVectorNegate(sinX), cosZ), XMVectorMultiply(cosX, yz21));
+		const XMVECTOR r22 = XMVectorMultiply(cosX, cosY);
+
+		// scale * rotation * translation only scales the rows and sets the last one
+		const XMVECTOR scaleX = Load(_ScaleX, i);
+		const XMVECTOR scaleY = Load(_ScaleY, i);
+		const XMVECTOR scaleZ = Load(_ScaleZ, i);
+
+		// transposed, the rows of the output are the columns of the world matrix
+		XMFLOAT4X4* worlds = &_Worlds[i];
+		Store(XMVectorMultiply(scaleX, r00), XMVectorMultiply(scaleY, r10), XMVectorMultiply(scaleZ, r20), Load(_PositionX, i), worlds, 0);
+		Store(XMVectorMultiply(scaleX, r01), XMVectorMultiply(scaleY, r11), XMVectorMultiply(scaleZ, r21), Load(_PositionY, i), worlds, 1);
+		Store(XMVectorMultiply(scaleX, r02), XMVectorMultiply(scaleY, r12), XMVectorMultiply(scaleZ, r22), Load(_PositionZ, i), worlds, 2);
+		Store(XMVectorZero(), XMVectorZero(), XMVectorZero(), g_XMOne, worlds, 3);
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+// Inputs of the transform nodes evaluated in a frame, kept as one array per component so the
+// world matrices are composed 4 transforms at a time (one per XMVECTOR lane).
+// The result is bit for bit the one of TransformNode::OnEval, except that some zeros can be -0:
+//   world = scale * rotationX * rotationY * rotationZ * translation, stored transposed.
+class TransformBatch
+{
+public:
+	void Clear();
+
+	// Index of the transform in the batch
+	size_t Add(const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& rotation, const DirectX::XMFLOAT3& scale);
+
+	void Evaluate();
+
+	size_t GetSize() const { return _Size; }
+	const DirectX::XMFLOAT4X4& GetWorld(size_t index) const { return _Worlds[index]; }
+
+private:
+	void EvaluateRange(size_t begin, size_t end);
+
+private:
+	size_t _Size{ 0 };
+	std::vector<float> _PositionX, _PositionY, _PositionZ;
+	std::vector<float> _RotationX, _RotationY, _RotationZ;
+	std::vector<float> _ScaleX, _ScaleY, _ScaleZ;
+	std::vector<DirectX::XMFLOAT4X4> _Worlds;
+};
@@ -10,9 +10,8 @@ workspace "ShaderTool"
 
 outputdir = "%{cfg.buildcfg}-%{cfg.architecture}/%{prj.name}"
 
-project "ShaderTool"
-	location "ShaderTool"
-	kind "ConsoleApp"
+-- Settings shared by the editor and the headless runner, both build the whole src tree
+function shadertool_settings()
 	language "C++"
 	cppdialect "C++17"
 	staticruntime "on"
@@ -22,20 +21,21 @@ project "ShaderTool"
 	debugdir ("bin/" .. outputdir)
 
 	pchheader "pch.h"
-	pchsource "%{prj.name}/src/pch.cpp"
+	pchsource "ShaderTool/src/pch.cpp"
 
 	files
 	{
-		"%{prj.name}/src/**.h",
-		"%{prj.name}/src/**.cpp",
-		"%{prj.name}/src/**.hlsl",
-		"%{prj.name}/src/**.fx",
-		"%{prj.name}/src/**.c",
+		"ShaderTool/src/**.h",
+		"ShaderTool/src/**.cpp",
+		"ShaderTool/src/**.hlsl",
+		"ShaderTool/src/**.fx",
+		"ShaderTool/src/**.hlsli",
+		"ShaderTool/src/**.c",
 	}
 
 	includedirs
 	{
-		"%{prj.name}/src",
+		"ShaderTool/src",
 		"Common/spdlog/include",
 		"Common/assimp/include",
 	}
@@ -107,8 +107,24 @@ project "ShaderTool"
 		shadertype "Pixel"
 	
 	-- To make sure the fx files are up to date in the targetdir
-	filter 'files:**.fx'
+	filter 'files:**.fx or **.hlsli'
 	   buildmessage 'Copying %{file.relpath}'
 	   buildcommands { '{COPY} %{file.relpath} %{cfg.targetdir}' }
 	   buildoutputs '%{cfg.targetdir}'
-	   
\ No newline at end of file
+	   
+
+	filter {}
+end
+
+project "ShaderTool"
+	location "ShaderTool"
+	kind "ConsoleApp"
+	shadertool_settings()
+	removefiles { "ShaderTool/src/Cli/**" }
+
+-- Runs a saved project for a number of frames, without window, swap chain or ImGui
+project "ShaderToolCli"
+	location "ShaderTool"
+	kind "ConsoleApp"
+	shadertool_settings()
+	removefiles { "ShaderTool/src/Main.cpp" }